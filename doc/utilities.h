@@ -44,7 +44,14 @@ hrpsys-simulator [project file] [options]
 -no-default-lights turn off default lights<br>
 -max-edge-length length[m] divide large triangles which have longer edges than this value<br>
 -max-log-length length[s] set length of ring buffer<br>
--exit-on-finish exit this program when the simulation finishes
+-exit-on-finish exit this program when the simulation finishes<br>
+-collision-threads n the number of threads to check collisions (default:1)<br>
+-log-spill file spill the log to file when its size in memory exceeds the limit. Disk space of states dropped from the ring buffer is released where the file system supports punching holes<br>
+-log-memory size[MB] limit of the log size in memory (default:64)<br>
+-no-log-range don't log outputs of range sensors
+
+The log is kept delta-encoded in memory. Joint angles and poses are quantized by 1e-7,
+outputs of force, rate and acceleration sensors by 1e-5 and ranges by 1e-4[m].
 
 Note:NameServer and openhrp-model-loader must be running
 
@@ -92,6 +99,9 @@ showsensors show sensor output<br>
 size [size] set window size<br>
 bg [r] [g] [b] background color
 max-log-length length[s] set length of ring buffer<br>
+collision-threads n the number of threads to check collisions<br>
+log-spill file spill the log to file when its size in memory exceeds 64[MB]<br>
+no-log-range don't log outputs of range sensors<br>
 
 Note:NameServer and openhrp-model-loader must be running
 
@@ -0,0 +1,113 @@
+// -*- C++ -*-
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+/**
+   Histogram of durations[s] with logarithmic buckets.
+   Buckets cover 1[us] - 2^21[us] with 8 buckets per octave (12.5% resolution).
+   add() never allocates memory so that it can be used in the real-time loop.
+ */
+class LatencyHistogram
+{
+public:
+    enum { SUB_BUCKETS = 8, OCTAVES = 21, NUM_BUCKETS = SUB_BUCKETS*OCTAVES + 2 };
+
+    LatencyHistogram() { reset(); }
+    void reset()
+    {
+        for (int i=0; i<NUM_BUCKETS; i++) m_bucket[i] = 0;
+        m_count = 0;
+        m_max = 0;
+    }
+    void add(double dt)
+    {
+        m_bucket[bucketIndex(dt)]++;
+        m_count++;
+        if (dt > m_max) m_max = dt;
+    }
+    long count() const { return m_count; }
+    double max() const { return m_max; }
+    /**
+       \brief p-quantile of recorded durations
+       \param p ratio in [0, 1]
+       \return upper bound of the bucket which contains the p-quantile
+     */
+    double percentile(double p) const
+    {
+        if (m_count == 0) return 0;
+        long target = (long)ceil(p*m_count);
+        if (target < 1) target = 1;
+        long sum = 0;
+        for (int i=0; i<NUM_BUCKETS; i++){
+            sum += m_bucket[i];
+            if (sum >= target) return std::min(bucketUpperBound(i), m_max);
+        }
+        return m_max;
+    }
+private:
+    static int bucketIndex(double dt)
+    {
+        double us = dt*1e6;
+        if (us < 1.0) return 0;
+        int e;
+        double m = frexp(us, &e); // us = m*2^e, 0.5 <= m < 1
+        int octave = e - 1;
+        if (octave >= OCTAVES) return NUM_BUCKETS - 1;
+        int sub = (int)((m*2 - 1)*SUB_BUCKETS);
+        return 1 + octave*SUB_BUCKETS + sub;
+    }
+    static double bucketUpperBound(int i)
+    {
+        if (i == 0) return 1e-6;
+        if (i == NUM_BUCKETS - 1) return HUGE_VAL;
+        int octave = (i-1)/SUB_BUCKETS, sub = (i-1)%SUB_BUCKETS;
+        return ldexp(1.0 + (sub+1.0)/SUB_BUCKETS, octave)*1e-6;
+    }
+    long m_bucket[NUM_BUCKETS];
+    long m_count;
+    double m_max;
+};
+
+/**
+   Ring buffer which keeps durations of the last N cycles.
+   Memory is allocated only in resize(), add() is allocation-free.
+ */
+class LatencyWindow
+{
+public:
+    LatencyWindow(size_t n=1000) : m_data(n>0?n:1), m_head(0), m_size(0) {}
+    void resize(size_t n)
+    {
+        m_data.resize(n>0?n:1);
+        reset();
+    }
+    void reset()
+    {
+        m_head = m_size = 0;
+    }
+    void add(double dt)
+    {
+        m_data[m_head] = dt;
+        m_head = (m_head + 1) % m_data.size();
+        if (m_size < m_data.size()) m_size++;
+    }
+    size_t capacity() const { return m_data.size(); }
+    size_t size() const { return m_size; }
+    /**
+       \brief copy samples into o_samples in no particular order.
+       This function allocates memory and must not be called from the real-time loop.
+     */
+    void samples(std::vector<double>& o_samples) const
+    {
+        o_samples.assign(m_data.begin(), m_data.begin() + m_size);
+    }
+private:
+    std::vector<double> m_data;
+    size_t m_head, m_size;
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -1,5 +1,8 @@
 #include "hrpEC.h"
 #include "io/iob.h"
+#include <coil/Time.h>
+#include <coil/stringutil.h>
+#include <coil/Guard.h>
 #ifdef OPENRTM_VERSION_TRUNK
 #include <rtm/RTObjectStateMachine.h>
 #endif
@@ -10,9 +13,181 @@ using std::fprintf;
 
 namespace RTC
 {
+    hrpECTraceDrainer::hrpECTraceDrainer(hrpExecutionContext *ec,
+                                         hrpECTraceRing<hrpECTraceRecord> *ring)
+        : m_ec(ec), m_ring(ring), m_fp(NULL), m_running(false), m_dropped(0)
+    {
+    }
+
+    hrpECTraceDrainer::~hrpECTraceDrainer()
+    {
+        if (m_fp) fclose(m_fp);
+    }
+
+    bool hrpECTraceDrainer::openFile(const std::string& filename)
+    {
+        m_fp = fopen(filename.c_str(), "wb");
+        if (!m_fp){
+            perror(filename.c_str());
+            return false;
+        }
+        uint32_t header[3] = {HRPEC_TRACE_VERSION, sizeof(hrpECTraceRecord),
+                              HRPEC_TRACE_MAX_COMPONENTS};
+        fwrite(HRPEC_TRACE_MAGIC, 1, 8, m_fp);
+        fwrite(header, sizeof(uint32_t), 3, m_fp);
+        return true;
+    }
+
+    void hrpECTraceDrainer::start()
+    {
+        m_running = true;
+        activate();
+    }
+
+    int hrpECTraceDrainer::svc(void)
+    {
+        while (m_running){
+            drain();
+            m_ec->updateExecutionPlan();
+            coil::usleep(10000);
+        }
+        drain();
+        if (m_fp){
+            fclose(m_fp);
+            m_fp = NULL;
+        }
+        return 0;
+    }
+
+    void hrpECTraceDrainer::stop()
+    {
+        m_running = false;
+        wait();
+    }
+
+    void hrpECTraceDrainer::writeNames()
+    {
+        if (!m_fp) return;
+        uint32_t tag = HRPEC_TRACE_TAG_NAMES, n = m_names.size();
+        fwrite(&tag, sizeof(tag), 1, m_fp);
+        fwrite(&n, sizeof(n), 1, m_fp);
+        for (unsigned int i=0; i<m_names.size(); i++){
+            uint32_t len = m_names[i].size();
+            fwrite(&len, sizeof(len), 1, m_fp);
+            fwrite(m_names[i].c_str(), 1, len, m_fp);
+        }
+    }
+
+    void hrpECTraceDrainer::drain()
+    {
+        hrpECTraceRecord rec;
+        while (m_ring->pop(rec)){
+            // Update component names only when rtcs length change.
+            if (rec.n_components != m_names.size()){
+                m_ec->getComponentNames(m_names);
+                if (m_names.size() > HRPEC_TRACE_MAX_COMPONENTS){
+                    m_names.resize(HRPEC_TRACE_MAX_COMPONENTS);
+                }
+                writeNames();
+            }
+            if (m_fp){
+                uint32_t tag = HRPEC_TRACE_TAG_RECORD;
+                fwrite(&tag, sizeof(tag), 1, m_fp);
+                fwrite(&rec, sizeof(rec), 1, m_fp);
+            }
+#ifdef NDEBUG
+            if (rec.timeover){
+                fprintf(stderr, "[%d.%6.6d] Timeover: processing time = %4.2f[ms]\n",
+                        (int)rec.sec, (int)rec.usec, rec.process*1e3);
+                for (unsigned int i=0; i<rec.n_components && i<m_names.size(); i++){
+                    fprintf(stderr, "%s(%4.2f), ", m_names[i].c_str(), rec.processes[i]*1e3);
+                }
+                fprintf(stderr, "\n");
+            }
+#endif
+        }
+        if (m_ring->dropped() != m_dropped){
+            fprintf(stderr, "hrpEC: %lu trace records were dropped\n",
+                    m_ring->dropped() - m_dropped);
+            m_dropped = m_ring->dropped();
+        }
+        if (m_fp) fflush(m_fp);
+    }
+
     hrpExecutionContext::~hrpExecutionContext()
     {
+        delete m_drainer;
+        delete m_trace;
+        delete m_plan;
+        delete m_next_plan;
+        delete m_retired_plan;
+        pthread_mutex_destroy(&m_stats_mutex);
+    }
+
+    void hrpExecutionContext::setupProperties(coil::Properties& prop)
+    {
+        // the number of cycles kept for windowed latency statistics
+        getProperty(prop, "exec_cxt.hrpEC.profile_window", m_window_size);
+        m_period_window.resize(m_window_size);
+        m_process_window.resize(m_window_size);
+        // statistics of components are allocated here so that the real-time
+        // loop never reallocates them
+        m_comp_hists.resize(HRPEC_TRACE_MAX_COMPONENTS);
+        m_comp_windows.assign(HRPEC_TRACE_MAX_COMPONENTS, LatencyWindow(m_window_size));
+
+        // trace records are buffered in the ring and saved to trace_file if specified
+        int trace_length = 4096;
+        getProperty(prop, "exec_cxt.hrpEC.trace_length", trace_length);
+        m_trace_file = prop["exec_cxt.hrpEC.trace_file"];
+        m_trace = new hrpECTraceRing<hrpECTraceRecord>(trace_length);
+        m_drainer = new hrpECTraceDrainer(this, m_trace);
+
+        // parallel execution
+        //  threads : the number of worker threads in addition to the real-time thread
+        //  cpus    : cpus to which worker threads are pinned, e.g. "2,3"
+        //  deps    : dependencies of components, e.g. "st:abc,abc:seq sh,log:st kf"
+        //            components not listed here are executed in the attached order
+        getProperty(prop, "exec_cxt.hrpEC.threads", m_nthreads);
+        if (m_nthreads > 0){
+            // worker 0 is the real-time thread itself
+            m_worker_hists.resize(m_nthreads + 1);
+            m_worker_windows.assign(m_nthreads + 1, LatencyWindow(m_window_size));
+        }
+        coil::vstring cpus = coil::split(prop["exec_cxt.hrpEC.cpus"], ",");
+        for (unsigned int i=0; i<cpus.size(); i++){
+            int cpu;
+            if (coil::stringTo(cpu, cpus[i].c_str())) m_cpus.push_back(cpu);
+        }
+        coil::vstring deps = coil::split(prop["exec_cxt.hrpEC.deps"], ",");
+        for (unsigned int i=0; i<deps.size(); i++){
+            coil::vstring comp_deps = coil::split(deps[i], ":");
+            if (comp_deps.size() != 2 || comp_deps[0] == ""){
+                std::cerr << "[hrpEC] invalid dependency: " << deps[i] << std::endl;
+                continue;
+            }
+            std::vector<std::string>& d = m_deps[comp_deps[0]];
+            coil::vstring names = coil::split(comp_deps[1], " ");
+            for (unsigned int j=0; j<names.size(); j++){
+                if (names[j] != "") d.push_back(names[j]);
+            }
+        }
     }
+
+    void hrpExecutionContext::getComponentNames(std::vector<std::string>& o_names)
+    {
+        o_names.clear();
+#ifndef OPENRTM_VERSION_TRUNK
+        for (unsigned int i=0; i< m_comps.size(); i++){
+            RTC::RTObject_var rtc = RTC::RTObject::_narrow(m_comps[i]._ref);
+#else
+        const RTCList& list = getComponentList();
+        for (unsigned int i=0; i< list.length(); i++){
+            RTC::RTObject_var rtc = RTC::RTObject::_narrow(list[i]);
+#endif
+            o_names.push_back(std::string(rtc->get_component_profile()->instance_name));
+        }
+    }
+
     int hrpExecutionContext::svc(void)
     {
         if (open_iob() == FALSE){
@@ -37,59 +212,106 @@ namespace RTC
         std::cout << "period = " << get_signal_period()*nsubstep/1e6
                   << "[ms], priority = " << m_priority << std::endl;
 
+        // the drainer thread must be created before entering RT so that
+        // it doesn't inherit the real-time scheduling policy
+        if (m_trace_file != "") m_drainer->openFile(m_trace_file);
+        m_drainer->start();
+        startWorkers();
+
         if (!enterRT()){
+            stopWorkers();
+            m_drainer->stop();
             unlock_iob();
             close_iob();
             return 0;
         }
+        struct timeval tv_start;
+        gettimeofday(&tv_start, NULL);
+        double signal_period_sec = get_signal_period()/1e9;
+        double min_offset = 0;
+        bool first_cycle = true;
+        hrpECTraceRecord rec;
         do{
             if (!waitForNextPeriod()){
+                stopWorkers();
+                m_drainer->stop();
                 unlock_iob();
                 close_iob();
                 return 0;
             }
             struct timeval tv;
             gettimeofday(&tv, NULL);
+            rec.frame = read_iob_frame();
+            rec.sec = tv.tv_sec;
+            rec.usec = tv.tv_usec;
+            rec.period = 0;
+            // lateness is measured from the earliest wakeup observed so far
+            // relative to the frame count, which is robust against clock offset
+            double offset = (tv.tv_sec - tv_start.tv_sec) + (tv.tv_usec - tv_start.tv_usec)/1e6
+                - rec.frame*signal_period_sec;
+            if (first_cycle || offset < min_offset){
+                min_offset = offset;
+                first_cycle = false;
+            }
+            rec.lateness = offset - min_offset;
             if (m_profile.count > 0){
 #define DELTA_SEC(start, end) end.tv_sec - start.tv_sec + (end.tv_usec - start.tv_usec)/1e6;
                 double dt = DELTA_SEC(m_tv, tv);
                 if (dt > m_profile.max_period) m_profile.max_period = dt;
                 if (dt < m_profile.min_period) m_profile.min_period = dt;
                 m_profile.avg_period = (m_profile.avg_period*m_profile.count + dt)/(m_profile.count+1);
+                rec.period = dt;
             }
             m_profile.count++;
             m_tv = tv;
 
 #ifndef OPENRTM_VERSION_TRUNK
-            invoke_worker iw;
-            struct timeval tbegin, tend;
-	        std::vector<double> processes(m_comps.size());
-            gettimeofday(&tbegin, NULL);
-            for (unsigned int i=0; i< m_comps.size(); i++){
-                iw(m_comps[i]);
-                gettimeofday(&tend, NULL);
-                double dt = DELTA_SEC(tbegin, tend);
-                processes[i] = dt;
-                tbegin = tend;
-            }
+            size_t ncomps = m_comps.size();
 #else
-            struct timeval tbegin, tend;
             const RTCList& list = getComponentList();
-            std::vector<double> processes(list.length());
-            gettimeofday(&tbegin, NULL);
-            for (unsigned int i=0; i< list.length(); i++){
-                RTC_impl::RTObjectStateMachine* rtobj = m_worker.findComponent(list[i]);
-                rtobj->workerDo(); 
-                gettimeofday(&tend, NULL);
-                double dt = DELTA_SEC(tbegin, tend);
-                processes[i] = dt;
-                tbegin = tend;
-            }
+            size_t ncomps = list.length();
 #endif
+            if (m_processes.size() != ncomps) m_processes.resize(ncomps);
+            std::vector<double>& processes(m_processes);
+            m_ncomps = ncomps;
+            swapExecutionPlan();
+            bool parallel = m_plan && m_plan->workers.size() == ncomps;
+            if (parallel){
+                invokeComponentsInParallel();
+            }else{
+                struct timeval tbegin, tend;
+                gettimeofday(&tbegin, NULL);
+                for (unsigned int i=0; i< ncomps; i++){
+                    invokeComponent(i);
+                    gettimeofday(&tend, NULL);
+                    double dt = DELTA_SEC(tbegin, tend);
+                    processes[i] = dt;
+                    tbegin = tend;
+                }
+            }
 
             gettimeofday(&tv, NULL);
             double dt = DELTA_SEC(m_tv, tv);
             if (dt > m_profile.max_process) m_profile.max_process = dt;
+            // statistics of this cycle are dropped while getLatencyProfile()
+            // copies them
+            bool stats_locked = pthread_mutex_trylock(&m_stats_mutex) == 0;
+            if (stats_locked){
+                if (m_profile.count > 1){
+                    m_period_hist.add(rec.period);
+                    m_period_window.add(rec.period);
+                }
+                m_process_hist.add(dt);
+                m_process_window.add(dt);
+                size_t ncomp_stats = std::min(processes.size(), m_comp_hists.size());
+                if (ncomp_stats != m_ncomp_stats){
+                    for (unsigned int i=0; i<ncomp_stats; i++){
+                        m_comp_hists[i].reset();
+                        m_comp_windows[i].reset();
+                    }
+                    m_ncomp_stats = ncomp_stats;
+                }
+            }
 	    if (m_profile.profiles.length() != processes.size()){
 	        m_profile.profiles.length(processes.size());
 		for (unsigned int i=0; i<m_profile.profiles.length(); i++){
@@ -110,28 +332,34 @@ namespace RTC
                 double dt = processes[i];
                 if (lcs == ACTIVE_STATE){
                     prof.avg_process = (prof.avg_process*prof.count + dt)/(++prof.count);
+                    if (stats_locked && i < m_ncomp_stats){
+                        m_comp_hists[i].add(dt);
+                        m_comp_windows[i].add(dt);
+                    }
                 }
 	        if (prof.max_process < dt) prof.max_process = dt;
 	    }
+            if (parallel && stats_locked){
+                for (unsigned int w=0; w<m_plan->orders.size(); w++){
+                    const std::vector<int>& order = m_plan->orders[w];
+                    double busy = 0;
+                    for (unsigned int k=0; k<order.size(); k++) busy += processes[order[k]];
+                    m_worker_hists[w].add(busy);
+                    m_worker_windows[w].add(busy);
+                }
+            }
+            if (stats_locked) pthread_mutex_unlock(&m_stats_mutex);
+            rec.process = dt;
+            rec.timeover = 0;
             if (dt > period_sec*nsubstep){
   	        m_profile.timeover++; 
-#ifdef NDEBUG
-                fprintf(stderr, "[%d.%6.6d] Timeover: processing time = %4.2f[ms]\n",
-                        tv.tv_sec, tv.tv_usec, dt*1e3);
-                // Update rtc_names only when rtcs length change.
-                if (processes.size() != rtc_names.size()){
-                    rtc_names.clear();
-                    for (unsigned int i=0; i< processes.size(); i++){
-                        RTC::RTObject_var rtc = RTC::RTObject::_narrow(m_comps[i]._ref);
-                        rtc_names.push_back(std::string(rtc->get_component_profile()->instance_name));
-                    }
-                }
-                for (unsigned int i=0; i< processes.size(); i++){
-                    fprintf(stderr, "%s(%4.2f), ", rtc_names[i].c_str(),processes[i]*1e3);
-                }
-                fprintf(stderr, "\n");
-#endif
+                rec.timeover = 1;
             }
+            rec.n_components = std::min(processes.size(), (size_t)HRPEC_TRACE_MAX_COMPONENTS);
+            for (unsigned int i=0; i<rec.n_components; i++){
+                rec.processes[i] = processes[i];
+            }
+            m_trace->push(rec);
 
 #ifndef OPENRTM_VERSION_TRUNK
         } while (m_running);
@@ -139,6 +367,8 @@ namespace RTC
         } while (isRunning());
 #endif
         exitRT();
+        stopWorkers();
+        m_drainer->stop();
         unlock_iob();
         close_iob();
 
@@ -170,6 +400,86 @@ namespace RTC
         throw OpenHRP::ExecutionProfileService::ExecutionProfileServiceException("no such component");
     }
 
+    static void setLatencyStatistics(const LatencyHistogram& hist,
+                                     OpenHRP::ExecutionProfileService::LatencyStatistics& stat)
+    {
+        stat.count = hist.count();
+        stat.p50 = hist.percentile(0.5);
+        stat.p99 = hist.percentile(0.99);
+        stat.p999 = hist.percentile(0.999);
+        stat.maximum = hist.max();
+    }
+
+    static void setLatencyStatistics(std::vector<double>& buf,
+                                     OpenHRP::ExecutionProfileService::LatencyStatistics& stat)
+    {
+        std::sort(buf.begin(), buf.end());
+        stat.count = buf.size();
+        if (buf.empty()){
+            stat.p50 = stat.p99 = stat.p999 = stat.maximum = 0;
+            return;
+        }
+        size_t n = buf.size();
+        stat.p50 = buf[std::min(n-1, (size_t)ceil(0.5*n)-1)];
+        stat.p99 = buf[std::min(n-1, (size_t)ceil(0.99*n)-1)];
+        stat.p999 = buf[std::min(n-1, (size_t)ceil(0.999*n)-1)];
+        stat.maximum = buf[n-1];
+    }
+
+    OpenHRP::ExecutionProfileService::LatencyProfile *hrpExecutionContext::getLatencyProfile()
+    {
+        OpenHRP::ExecutionProfileService::LatencyProfile *ret
+            = new OpenHRP::ExecutionProfileService::LatencyProfile;
+        ret->window_size = m_window_size;
+        // copy statistics while holding the lock and sort samples of windows
+        // after releasing it, so the real-time loop drops as few cycles as possible
+        size_t nworkers = m_worker_hists.size();
+        std::vector<LatencyHistogram> hists(2 + HRPEC_TRACE_MAX_COMPONENTS + nworkers);
+        std::vector<std::vector<double> > samples(hists.size());
+        for (size_t i=0; i<samples.size(); i++) samples[i].reserve(m_window_size);
+        pthread_mutex_lock(&m_stats_mutex);
+        size_t n = m_ncomp_stats;
+        hists[0] = m_period_hist;
+        m_period_window.samples(samples[0]);
+        hists[1] = m_process_hist;
+        m_process_window.samples(samples[1]);
+        for (size_t i=0; i<n; i++){
+            hists[2+i] = m_comp_hists[i];
+            m_comp_windows[i].samples(samples[2+i]);
+        }
+        for (size_t i=0; i<nworkers; i++){
+            hists[2+n+i] = m_worker_hists[i];
+            m_worker_windows[i].samples(samples[2+n+i]);
+        }
+        pthread_mutex_unlock(&m_stats_mutex);
+        setLatencyStatistics(hists[0], ret->period);
+        setLatencyStatistics(samples[0], ret->window_period);
+        setLatencyStatistics(hists[1], ret->process);
+        setLatencyStatistics(samples[1], ret->window_process);
+        ret->profiles.length(n);
+        for (size_t i=0; i<n; i++){
+            setLatencyStatistics(hists[2+i], ret->profiles[i].process);
+            setLatencyStatistics(samples[2+i], ret->profiles[i].window_process);
+        }
+        ret->workers.length(nworkers);
+        for (size_t i=0; i<nworkers; i++){
+            setLatencyStatistics(hists[2+n+i], ret->workers[i].process);
+            setLatencyStatistics(samples[2+n+i], ret->workers[i].window_process);
+        }
+        {
+            // the plan is not deleted while the lock is held
+            coil::Guard<coil::Mutex> guard(m_plan_mutex);
+            hrpECExecutionPlan *plan = m_plan;
+            if (plan){
+                ret->assignments.length(plan->workers.size());
+                for (size_t i=0; i<plan->workers.size(); i++){
+                    ret->assignments[i] = plan->workers[i];
+                }
+            }
+        }
+        return ret;
+    }
+
     void hrpExecutionContext::resetProfile()
     {
         m_profile.max_period = m_profile.avg_period = 0;
@@ -181,5 +491,19 @@ namespace RTC
 	    m_profile.profiles[i].max_process = 0;
         }
         m_profile.count = m_profile.timeover = 0;
+        pthread_mutex_lock(&m_stats_mutex);
+        m_period_hist.reset();
+        m_process_hist.reset();
+        m_period_window.reset();
+        m_process_window.reset();
+        for (unsigned int i = 0 ; i < m_comp_hists.size() ; i++ ){
+            m_comp_hists[i].reset();
+            m_comp_windows[i].reset();
+        }
+        for (unsigned int i = 0 ; i < m_worker_hists.size() ; i++ ){
+            m_worker_hists[i].reset();
+            m_worker_windows[i].reset();
+        }
+        pthread_mutex_unlock(&m_stats_mutex);
     }
 };
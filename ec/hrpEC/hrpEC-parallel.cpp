@@ -0,0 +1,282 @@
+// -*- C++ -*-
+#include "hrpEC.h"
+#ifdef OPENRTM_VERSION_TRUNK
+#include <rtm/RTObjectStateMachine.h>
+#endif
+#include <coil/Guard.h>
+
+#include <iostream>
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/time.h>
+
+typedef coil::Guard<coil::Mutex> Guard;
+
+namespace RTC
+{
+    hrpECWorker::hrpECWorker(hrpExecutionContext *ec, int id, int priority, int cpu)
+        : m_ec(ec), m_id(id), m_priority(priority), m_cpu(cpu)
+    {
+    }
+
+    int hrpECWorker::svc(void)
+    {
+        struct sched_param param;
+        param.sched_priority = m_priority;
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0){
+            std::cerr << "[hrpEC] failed to set priority of worker " << m_id << std::endl;
+        }
+#ifdef __linux__
+        if (m_cpu >= 0){
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(m_cpu, &cpuset);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0){
+                std::cerr << "[hrpEC] failed to pin worker " << m_id << " to cpu " << m_cpu << std::endl;
+            }
+        }
+#endif
+        unsigned long cycle = 0;
+        while (m_ec->waitForCycle(cycle)){
+            m_ec->executeComponents(m_id);
+            m_ec->finishCycle();
+        }
+        return 0;
+    }
+
+    void hrpExecutionContext::invokeComponent(unsigned int i)
+    {
+#ifndef OPENRTM_VERSION_TRUNK
+        invoke_worker iw;
+        iw(m_comps[i]);
+#else
+        const RTCList& list = getComponentList();
+        RTC_impl::RTObjectStateMachine* rtobj = m_worker.findComponent(list[i]);
+        rtobj->workerDo();
+#endif
+    }
+
+    void hrpExecutionContext::startWorkers()
+    {
+        if (m_nthreads <= 0) return;
+        m_workers_running = true;
+        for (int i=0; i<m_nthreads; i++){
+            int cpu = i < (int)m_cpus.size() ? m_cpus[i] : -1;
+            hrpECWorker *worker = new hrpECWorker(this, i+1, m_priority, cpu);
+            worker->activate();
+            m_workers.push_back(worker);
+        }
+        std::cout << "[hrpEC] " << m_nthreads << " worker threads are started" << std::endl;
+    }
+
+    void hrpExecutionContext::stopWorkers()
+    {
+        {
+            Guard guard(m_sync_mutex);
+            m_workers_running = false;
+            m_sync_cond.broadcast();
+        }
+        for (unsigned int i=0; i<m_workers.size(); i++){
+            m_workers[i]->wait();
+            delete m_workers[i];
+        }
+        m_workers.clear();
+    }
+
+    bool hrpExecutionContext::waitForCycle(unsigned long& cycle)
+    {
+        Guard guard(m_sync_mutex);
+        while (m_workers_running && m_cycle == cycle) m_sync_cond.wait();
+        if (!m_workers_running) return false;
+        cycle = m_cycle;
+        return true;
+    }
+
+    void hrpExecutionContext::finishCycle()
+    {
+        Guard guard(m_sync_mutex);
+        m_finished_workers++;
+        m_sync_cond.broadcast();
+    }
+
+    void hrpExecutionContext::executeComponents(int worker)
+    {
+        const std::vector<int>& order = m_plan->orders[worker];
+        unsigned long cycle = m_cycle;
+        struct timeval tbegin, tend;
+        for (unsigned int k=0; k<order.size(); k++){
+            int c = order[k];
+            const std::vector<int>& deps = m_plan->deps[c];
+            for (unsigned int j=0; j<deps.size(); j++){
+                if (m_done[deps[j]] != cycle){
+                    Guard guard(m_sync_mutex);
+                    while (m_done[deps[j]] != cycle) m_sync_cond.wait();
+                }
+            }
+            gettimeofday(&tbegin, NULL);
+            invokeComponent(c);
+            gettimeofday(&tend, NULL);
+            m_processes[c] = tend.tv_sec - tbegin.tv_sec + (tend.tv_usec - tbegin.tv_usec)/1e6;
+            Guard guard(m_sync_mutex);
+            m_done[c] = cycle;
+            m_sync_cond.broadcast();
+        }
+    }
+
+    void hrpExecutionContext::invokeComponentsInParallel()
+    {
+        {
+            Guard guard(m_sync_mutex);
+            m_cycle++;
+            m_finished_workers = 0;
+            m_sync_cond.broadcast();
+        }
+        executeComponents(0);
+        Guard guard(m_sync_mutex);
+        while (m_finished_workers < m_workers.size()) m_sync_cond.wait();
+    }
+
+    void hrpExecutionContext::swapExecutionPlan()
+    {
+        // called from the real-time loop while workers are idle
+        if (!m_next_plan) return;
+        __sync_synchronize();
+        m_retired_plan = m_plan;
+        m_plan = m_next_plan;
+        if (m_done.size() != m_plan->workers.size()){
+            m_done.resize(m_plan->workers.size());
+        }
+        std::fill(m_done.begin(), m_done.end(), m_cycle);
+        __sync_synchronize();
+        m_next_plan = NULL;
+    }
+
+    hrpECExecutionPlan *hrpExecutionContext::createExecutionPlan(const std::vector<std::string>& names)
+    {
+        size_t n = names.size();
+        hrpECExecutionPlan *plan = new hrpECExecutionPlan;
+        plan->deps.resize(n);
+        for (size_t i=0; i<n; i++){
+            std::map<std::string, std::vector<std::string> >::iterator it
+                = m_deps.find(names[i]);
+            if (it == m_deps.end()){
+                // components without declared dependencies keep the sequential
+                // order among themselves
+                for (size_t j=0; j<i; j++){
+                    if (m_deps.find(names[j]) == m_deps.end()) plan->deps[i].push_back(j);
+                }
+                continue;
+            }
+            for (size_t k=0; k<it->second.size(); k++){
+                std::vector<std::string>::const_iterator found
+                    = std::find(names.begin(), names.end(), it->second[k]);
+                if (found != names.end() && *found != names[i]){
+                    plan->deps[i].push_back(found - names.begin());
+                }
+            }
+        }
+
+        // topological sort, earlier attached components first
+        std::vector<int> order, indegree(n, 0);
+        std::vector<std::vector<int> > dependents(n);
+        for (size_t i=0; i<n; i++){
+            indegree[i] = plan->deps[i].size();
+            for (size_t j=0; j<plan->deps[i].size(); j++){
+                dependents[plan->deps[i][j]].push_back(i);
+            }
+        }
+        std::vector<bool> scheduled(n, false);
+        while (order.size() < n){
+            size_t i;
+            for (i=0; i<n; i++){
+                if (!scheduled[i] && indegree[i] == 0) break;
+            }
+            if (i == n){
+                // every component left has a dependency left, so following them reaches a cycle
+                std::vector<int> path;
+                std::vector<bool> visited(n, false);
+                for (i=0; scheduled[i]; i++);
+                while (!visited[i]){
+                    visited[i] = true;
+                    path.push_back(i);
+                    for (size_t j=0; j<plan->deps[i].size(); j++){
+                        if (!scheduled[plan->deps[i][j]]){
+                            i = plan->deps[i][j];
+                            break;
+                        }
+                    }
+                }
+                // a -> b means that a depends on b
+                std::cerr << "[hrpEC] dependencies of components are cyclic(";
+                size_t k = std::find(path.begin(), path.end(), (int)i) - path.begin();
+                for (; k<path.size(); k++) std::cerr << names[path[k]] << " -> ";
+                std::cerr << names[i] << "), components are executed sequentially" << std::endl;
+                delete plan;
+                return NULL;
+            }
+            scheduled[i] = true;
+            order.push_back(i);
+            for (size_t j=0; j<dependents[i].size(); j++) indegree[dependents[i][j]]--;
+        }
+
+        // list scheduling with average processing times as costs
+        int nworkers = m_nthreads + 1;
+        std::vector<double> worker_free(nworkers, 0), finish(n, 0);
+        plan->orders.resize(nworkers);
+        plan->workers.resize(n);
+        for (size_t k=0; k<n; k++){
+            int c = order[k];
+            double ready = 0;
+            for (size_t j=0; j<plan->deps[c].size(); j++){
+                ready = std::max(ready, finish[plan->deps[c][j]]);
+            }
+            int best = 0;
+            for (int w=1; w<nworkers; w++){
+                if (std::max(worker_free[w], ready) < std::max(worker_free[best], ready)) best = w;
+            }
+            double cost = 1e-6;
+            if (c < (int)m_profile.profiles.length() && m_profile.profiles[c].count > 0){
+                cost += m_profile.profiles[c].avg_process;
+            }
+            finish[c] = worker_free[best] = std::max(worker_free[best], ready) + cost;
+            plan->orders[best].push_back(c);
+            plan->workers[c] = best;
+        }
+        return plan;
+    }
+
+    void hrpExecutionContext::updateExecutionPlan()
+    {
+        // called from the non real-time thread
+        if (m_nthreads <= 0 || m_next_plan) return;
+        __sync_synchronize();
+        if (m_retired_plan){
+            // getLatencyProfile() may be reading the retired plan
+            Guard guard(m_plan_mutex);
+            delete m_retired_plan;
+            m_retired_plan = NULL;
+        }
+        // rebuild the plan when components are changed and once more
+        // after processing times of components are measured
+        size_t ncomps = m_ncomps;
+        bool measured = m_profile.count > m_window_size;
+        if (ncomps == 0 || (ncomps == m_plan_size && (m_plan_measured || !measured))) return;
+        std::vector<std::string> names;
+        getComponentNames(names);
+        if (names.size() != ncomps) return;
+        m_plan_size = ncomps;
+        m_plan_measured = measured;
+        hrpECExecutionPlan *plan = createExecutionPlan(names);
+        if (!plan) return;
+        for (size_t w=0; w<plan->orders.size(); w++){
+            std::cout << "[hrpEC] worker " << w << ":";
+            for (size_t k=0; k<plan->orders[w].size(); k++){
+                std::cout << " " << names[plan->orders[w][k]];
+            }
+            std::cout << std::endl;
+        }
+        __sync_synchronize();
+        m_next_plan = plan;
+    }
+};
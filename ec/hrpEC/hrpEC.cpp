@@ -33,8 +33,14 @@ namespace RTC
 #else
         : RTC_exp::PeriodicExecutionContext(),
 #endif 
-          m_priority(49)
+          m_priority(49),
+          m_ncomp_stats(0), m_window_size(1000), m_trace(NULL), m_drainer(NULL),
+          m_nthreads(0), m_plan(NULL), m_next_plan(NULL), m_retired_plan(NULL),
+          m_plan_size(0), m_plan_measured(false), m_ncomps(0),
+          m_sync_cond(m_sync_mutex), m_cycle(0), m_finished_workers(0),
+          m_workers_running(false)
     {
+        pthread_mutex_init(&m_stats_mutex, NULL);
         resetProfile();
         rtclog.setName("hrpEC");
         coil::Properties& prop(Manager::instance().getConfig());
@@ -43,6 +49,8 @@ namespace RTC
         getProperty(prop, "exec_cxt.periodic.priority", m_priority);
         getProperty(prop, "exec_cxt.periodic.rtpreempt.priority", m_priority);
         RTC_DEBUG(("Priority: %d", m_priority));
+
+        setupProperties(prop);
     }
 
     bool hrpExecutionContext::waitForNextPeriod()
@@ -11,10 +11,67 @@
 #include <rtm/Manager.h>
 #include <rtm/PeriodicExecutionContext.h>
 
+#include <map>
+#include <cstdio>
+#include <pthread.h>
+
 #include "ExecutionProfileService.hh"
+#include "LatencyHistogram.h"
+#include "hrpECTrace.h"
 
 namespace RTC
 {
+  class hrpExecutionContext;
+
+  /**
+     non real-time thread which drains trace records written by the
+     real-time loop, saves them to a file and reports timeovers.
+     It also rebuilds the execution plan of parallel execution.
+   */
+  class hrpECTraceDrainer : public coil::Task
+  {
+  public:
+    hrpECTraceDrainer(hrpExecutionContext *ec, hrpECTraceRing<hrpECTraceRecord> *ring);
+    virtual ~hrpECTraceDrainer();
+    bool openFile(const std::string& filename);
+    void start();
+    virtual int svc(void);
+    void stop();
+  private:
+    void drain();
+    void writeNames();
+    hrpExecutionContext *m_ec;
+    hrpECTraceRing<hrpECTraceRecord> *m_ring;
+    FILE *m_fp;
+    volatile bool m_running;
+    unsigned long m_dropped;
+    std::vector<std::string> m_names;
+  };
+
+  /**
+     assignment of components to worker threads. Each worker executes
+     its components in topological order of dependencies.
+   */
+  struct hrpECExecutionPlan
+  {
+    std::vector<std::vector<int> > deps;   ///< components each component depends on
+    std::vector<std::vector<int> > orders; ///< components executed by each worker
+    std::vector<int> workers;              ///< worker which executes each component
+  };
+
+  /**
+     thread which executes components in parallel with the real-time loop
+   */
+  class hrpECWorker : public coil::Task
+  {
+  public:
+    hrpECWorker(hrpExecutionContext *ec, int id, int priority, int cpu);
+    virtual int svc(void);
+  private:
+    hrpExecutionContext *m_ec;
+    int m_id, m_priority, m_cpu;
+  };
+
   class hrpExecutionContext
 #ifndef OPENRTM_VERSION_TRUNK
       : public virtual PeriodicExecutionContext,
@@ -34,12 +91,26 @@ namespace RTC
 
     OpenHRP::ExecutionProfileService::Profile *getProfile();
     OpenHRP::ExecutionProfileService::ComponentProfile getComponentProfile(RTC::LightweightRTObject_ptr obj);
+    OpenHRP::ExecutionProfileService::LatencyProfile *getLatencyProfile();
     void resetProfile();
+    void getComponentNames(std::vector<std::string>& o_names);
+    // parallel execution
+    void updateExecutionPlan();
+    bool waitForCycle(unsigned long& cycle);
+    void executeComponents(int worker);
+    void finishCycle();
     //
     bool enterRT();
     bool exitRT();
     bool waitForNextPeriod();
   private:
+    void setupProperties(coil::Properties& prop);
+    void invokeComponent(unsigned int i);
+    void invokeComponentsInParallel();
+    void startWorkers();
+    void stopWorkers();
+    void swapExecutionPlan();
+    hrpECExecutionPlan *createExecutionPlan(const std::vector<std::string>& names);
     template <class T>
     void getProperty(coil::Properties& prop, const char* key, T& value)
     {
@@ -56,6 +127,39 @@ namespace RTC
     struct timeval m_tv;
     int m_priority;
     std::vector<std::string> rtc_names;
+    // latency statistics are allocated in setupProperties() and updated by
+    // the real-time loop only when it gets m_stats_mutex without blocking
+    pthread_mutex_t m_stats_mutex;
+    size_t m_ncomp_stats;
+    LatencyHistogram m_period_hist, m_process_hist;
+    LatencyWindow m_period_window, m_process_window;
+    std::vector<LatencyHistogram> m_comp_hists;
+    std::vector<LatencyWindow> m_comp_windows;
+    int m_window_size;
+    std::vector<double> m_processes;
+    hrpECTraceRing<hrpECTraceRecord> *m_trace;
+    hrpECTraceDrainer *m_drainer;
+    std::string m_trace_file;
+    // parallel execution
+    int m_nthreads;
+    std::vector<int> m_cpus;
+    std::map<std::string, std::vector<std::string> > m_deps;
+    std::vector<hrpECWorker *> m_workers;
+    hrpECExecutionPlan *m_plan;
+    hrpECExecutionPlan * volatile m_next_plan;
+    hrpECExecutionPlan * volatile m_retired_plan;
+    coil::Mutex m_plan_mutex; ///< held while the plan is read outside the real-time loop
+    size_t m_plan_size;
+    bool m_plan_measured;
+    volatile size_t m_ncomps;
+    coil::Mutex m_sync_mutex;
+    coil::Condition<coil::Mutex> m_sync_cond;
+    volatile unsigned long m_cycle;
+    volatile unsigned int m_finished_workers;
+    volatile bool m_workers_running;
+    std::vector<unsigned long> m_done;
+    std::vector<LatencyHistogram> m_worker_hists;
+    std::vector<LatencyWindow> m_worker_windows;
   };
 };
 
@@ -0,0 +1,90 @@
+// -*- C++ -*-
+#ifndef hrpECTrace_h
+#define hrpECTrace_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define HRPEC_TRACE_MAX_COMPONENTS 32
+#define HRPEC_TRACE_MAGIC "HRPECTRC"
+#define HRPEC_TRACE_VERSION 1
+
+/**
+   Binary trace file layout
+
+   header  : char magic[8], uint32 version, uint32 sizeof(hrpECTraceRecord),
+             uint32 HRPEC_TRACE_MAX_COMPONENTS
+   chunks  : uint32 tag followed by
+             HRPEC_TRACE_TAG_NAMES  : uint32 n, n x (uint32 len, char name[len])
+             HRPEC_TRACE_TAG_RECORD : hrpECTraceRecord
+ */
+enum {
+    HRPEC_TRACE_TAG_NAMES = 1,
+    HRPEC_TRACE_TAG_RECORD = 2
+};
+
+/**
+   Record written by the real-time loop once per cycle
+ */
+struct hrpECTraceRecord
+{
+    uint64_t frame;        ///< frame number returned by read_iob_frame()
+    int64_t  sec;          ///< wakeup time[s]
+    int32_t  usec;         ///< wakeup time[us]
+    float    period;       ///< time since the last wakeup[s]
+    float    lateness;     ///< delay of the wakeup from the expected time[s]
+    float    process;      ///< processing time of this cycle[s]
+    uint16_t n_components; ///< the number of valid elements in processes
+    uint16_t timeover;     ///< 1 if the processing time exceeded the period
+    float    processes[HRPEC_TRACE_MAX_COMPONENTS]; ///< processing time of each component[s]
+};
+
+/**
+   Lock-free ring buffer for one producer and one consumer.
+   Memory is allocated only in the constructor.
+ */
+template <class T>
+class hrpECTraceRing
+{
+public:
+    hrpECTraceRing(size_t n) : m_buf(n+1), m_head(0), m_tail(0), m_dropped(0) {}
+    /**
+       \brief push an element, called only from the producer thread
+       \return false if the ring is full and the element is dropped
+     */
+    bool push(const T& v)
+    {
+        size_t head = m_head;
+        size_t next = head + 1 == m_buf.size() ? 0 : head + 1;
+        if (next == m_tail){
+            m_dropped++;
+            return false;
+        }
+        m_buf[head] = v;
+        __sync_synchronize();
+        m_head = next;
+        return true;
+    }
+    /**
+       \brief pop an element, called only from the consumer thread
+       \return false if the ring is empty
+     */
+    bool pop(T& v)
+    {
+        size_t tail = m_tail;
+        if (tail == m_head) return false;
+        __sync_synchronize();
+        v = m_buf[tail];
+        __sync_synchronize();
+        m_tail = tail + 1 == m_buf.size() ? 0 : tail + 1;
+        return true;
+    }
+    unsigned long dropped() const { return m_dropped; }
+private:
+    std::vector<T> m_buf;
+    volatile size_t m_head, m_tail;
+    volatile unsigned long m_dropped;
+};
+
+#endif // hrpECTrace_h
@@ -0,0 +1,153 @@
+// -*- C++ -*-
+/*
+  convert a binary trace file written by hrpExecutionContext
+  (exec_cxt.hrpEC.trace_file) into CSV or Chrome trace event JSON
+  which can be loaded by chrome://tracing.
+
+  usage: hrpECTraceDump [--json] trace_file [output_file]
+ */
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include "hrpECTrace.h"
+
+static bool readNames(FILE *fp, std::vector<std::string>& names)
+{
+    uint32_t n;
+    if (fread(&n, sizeof(n), 1, fp) != 1) return false;
+    names.resize(n);
+    for (unsigned int i=0; i<n; i++){
+        uint32_t len;
+        if (fread(&len, sizeof(len), 1, fp) != 1) return false;
+        names[i].resize(len);
+        if (len && fread(&names[i][0], 1, len, fp) != len) return false;
+    }
+    return true;
+}
+
+static void writeCSVHeader(std::ostream& os, const std::vector<std::string>& names)
+{
+    os << "frame,time,period,lateness,process,timeover";
+    for (unsigned int i=0; i<names.size(); i++){
+        os << "," << names[i];
+    }
+    os << std::endl;
+}
+
+static void writeCSV(std::ostream& os, const hrpECTraceRecord& rec)
+{
+    char buf[64];
+    sprintf(buf, "%lld.%06d", (long long)rec.sec, (int)rec.usec);
+    os << rec.frame << "," << buf << "," << rec.period*1e3 << ","
+       << rec.lateness*1e3 << "," << rec.process*1e3 << "," << rec.timeover;
+    for (unsigned int i=0; i<rec.n_components; i++){
+        os << "," << rec.processes[i]*1e3;
+    }
+    os << std::endl;
+}
+
+static void writeJSONEvent(std::ostream& os, bool& first, const std::string& name,
+                           int tid, double ts, double dur)
+{
+    if (!first) os << "," << std::endl;
+    first = false;
+    os << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << tid
+       << ",\"ts\":" << ts << ",\"dur\":" << dur << "}";
+}
+
+static void writeJSON(std::ostream& os, bool& first, const hrpECTraceRecord& rec,
+                      const std::vector<std::string>& names, double t0)
+{
+    // timestamps of chrome trace events are in microseconds
+    double ts = (rec.sec - t0)*1e6 + rec.usec;
+    writeJSONEvent(os, first, rec.timeover ? "cycle(timeover)" : "cycle",
+                   0, ts, rec.process*1e6);
+    for (unsigned int i=0; i<rec.n_components; i++){
+        std::string name = i < names.size() ? names[i] : "unknown";
+        writeJSONEvent(os, first, name, 1, ts, rec.processes[i]*1e6);
+        ts += rec.processes[i]*1e6;
+    }
+    os << "," << std::endl
+       << "{\"name\":\"lateness\",\"ph\":\"C\",\"pid\":0,\"ts\":"
+       << (rec.sec - t0)*1e6 + rec.usec
+       << ",\"args\":{\"lateness[us]\":" << rec.lateness*1e6 << "}}";
+}
+
+int main(int argc, char *argv[])
+{
+    bool json = false;
+    std::string input, output;
+    for (int i=1; i<argc; i++){
+        if (strcmp(argv[i], "--json") == 0){
+            json = true;
+        }else if (input == ""){
+            input = argv[i];
+        }else{
+            output = argv[i];
+        }
+    }
+    if (input == ""){
+        std::cerr << "usage: " << argv[0] << " [--json] trace_file [output_file]" << std::endl;
+        return 1;
+    }
+
+    FILE *fp = fopen(input.c_str(), "rb");
+    if (!fp){
+        perror(input.c_str());
+        return 1;
+    }
+    char magic[8];
+    uint32_t header[3];
+    if (fread(magic, 1, 8, fp) != 8 || strncmp(magic, HRPEC_TRACE_MAGIC, 8) != 0
+        || fread(header, sizeof(uint32_t), 3, fp) != 3){
+        std::cerr << input << " is not a trace file of hrpExecutionContext" << std::endl;
+        fclose(fp);
+        return 1;
+    }
+    if (header[0] != HRPEC_TRACE_VERSION || header[1] != sizeof(hrpECTraceRecord)
+        || header[2] != HRPEC_TRACE_MAX_COMPONENTS){
+        std::cerr << "unsupported trace format(version = " << header[0]
+                  << ", record size = " << header[1] << ")" << std::endl;
+        fclose(fp);
+        return 1;
+    }
+
+    std::ofstream ofs;
+    if (output != "") ofs.open(output.c_str());
+    std::ostream& os = output != "" ? ofs : std::cout;
+
+    std::vector<std::string> names;
+    hrpECTraceRecord rec;
+    uint32_t tag;
+    bool first = true, names_changed = true;
+    double t0 = -1;
+    if (json) os << "{\"traceEvents\":[" << std::endl;
+    while (fread(&tag, sizeof(tag), 1, fp) == 1){
+        if (tag == HRPEC_TRACE_TAG_NAMES){
+            if (!readNames(fp, names)) break;
+            names_changed = true;
+        }else if (tag == HRPEC_TRACE_TAG_RECORD){
+            if (fread(&rec, sizeof(rec), 1, fp) != 1) break;
+            if (json){
+                if (t0 < 0) t0 = rec.sec;
+                writeJSON(os, first, rec, names, t0);
+            }else{
+                if (names_changed){
+                    writeCSVHeader(os, names);
+                    names_changed = false;
+                }
+                writeCSV(os, rec);
+            }
+        }else{
+            std::cerr << "unknown tag(" << tag << ") is found" << std::endl;
+            break;
+        }
+    }
+    if (json) os << std::endl << "]}" << std::endl;
+    fclose(fp);
+
+    return 0;
+}
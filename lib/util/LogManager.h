@@ -7,7 +7,11 @@
 #include <boost/thread/thread.hpp>
 #include "LogManagerBase.h"
 
-template<class T>
+/**
+   \brief states are kept in Log, which provides push_back(), pop_front(),
+   operator[](), size(), empty() and clear() of std::deque
+ */
+template<class T, class Log = std::deque<T> >
 class LogManager : public LogManagerBase
 {
 public:
@@ -177,7 +181,7 @@ protected:
         m_atLast = m_index == m_log.size()-1; 
     }
 
-    std::deque<T> m_log;
+    Log m_log;
     int m_index;
     bool m_isNewStateAdded, m_atLast;
     double m_initT;
@@ -0,0 +1,319 @@
+#ifndef __SEGMENTED_LOG_H__
+#define __SEGMENTED_LOG_H__
+
+#include <iostream>
+#include <string>
+#include <deque>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdint.h>
+
+/**
+   \brief writer and reader of variable length integers used by codecs
+   of SegmentedLog. Values are quantized and encoded as the difference
+   from the quantized previous values, so small changes take one or two bytes.
+ */
+class LogStream
+{
+public:
+    static void putUInt(std::vector<unsigned char>& buf, uint64_t v){
+        while (v >= 0x80){
+            buf.push_back((unsigned char)(v | 0x80));
+            v >>= 7;
+        }
+        buf.push_back((unsigned char)v);
+    }
+    static void putInt(std::vector<unsigned char>& buf, int64_t v){
+        putUInt(buf, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+    }
+    static void putDouble(std::vector<unsigned char>& buf, double v){
+        unsigned char b[sizeof(double)];
+        memcpy(b, &v, sizeof(double));
+        buf.insert(buf.end(), b, b + sizeof(double));
+    }
+    static int64_t quantize(double v, double quantum){
+        return (int64_t)floor(v/quantum + 0.5);
+    }
+    // v is encoded as the difference from prev
+    static void putDelta(std::vector<unsigned char>& buf, double v, double prev, double quantum){
+        putInt(buf, quantize(v, quantum) - quantize(prev, quantum));
+    }
+    static uint64_t getUInt(const unsigned char*& p){
+        uint64_t v = 0;
+        int shift = 0;
+        while (*p & 0x80){
+            v |= (uint64_t)(*p++ & 0x7f) << shift;
+            shift += 7;
+        }
+        v |= (uint64_t)(*p++) << shift;
+        return v;
+    }
+    static int64_t getInt(const unsigned char*& p){
+        uint64_t v = getUInt(p);
+        return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+    }
+    static double getDouble(const unsigned char*& p){
+        double v;
+        memcpy(&v, p, sizeof(double));
+        p += sizeof(double);
+        return v;
+    }
+    // prev is replaced with the decoded value
+    static void getDelta(const unsigned char*& p, double& prev, double quantum){
+        prev = (quantize(prev, quantum) + getInt(p))*quantum;
+    }
+};
+
+/**
+   \brief container of states which keeps them encoded by Codec in
+   segments of a fixed number of states. The first state of a segment is
+   encoded by itself and the others are encoded as differences from the
+   previous ones, so a state is decoded from the first one of its segment
+   at most. Segments can be spilled to a file which is mapped to memory,
+   and pages of spilled segments are read back by the OS when decoded.
+   Pages of popped segments are released from the file by punching holes
+   where the file system supports it, so the size of the file keeps growing
+   but its disk usage doesn't with a ring buffer.
+   A reference returned by operator[] is valid until the next call.
+   Codec must provide
+   void encode(const T& state, const T& prev, std::vector<unsigned char>& buf);
+   void decode(const unsigned char*& p, T& state);
+   where prev is T() for the first state of a segment, and state is
+   the previous state or T() when it is decoded.
+ */
+template<class T, class Codec>
+class SegmentedLog
+{
+public:
+    SegmentedLog(size_t i_segmentLength=32) :
+        m_segmentLength(i_segmentLength), m_skip(0), m_size(0),
+        m_first(0), m_cacheIndex(-1), m_cacheOffset(0), m_numSpilled(0),
+        m_fd(-1), m_map(NULL), m_mapOffset(0), m_mapSize(0), m_fileSize(0),
+        m_punched(0), m_punchHole(false), m_spilled(0), m_memory(0), m_maxMemory(0){
+    }
+    ~SegmentedLog(){
+        // spilled segments are discarded with the file
+        closeSpillFile(false);
+    }
+    Codec& codec() { return m_codec; }
+    /**
+       \brief spill segments to a file when encoded segments in memory
+       exceed maxMemory[bytes]. Segments spilled to the previous file are
+       read back to memory before it is closed.
+       \return false if the file can't be opened
+     */
+    bool setSpillFile(const std::string& i_filename, size_t i_maxMemory){
+        closeSpillFile(true);
+        m_fd = open(i_filename.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0644);
+        if (m_fd < 0){
+            std::cerr << "failed to open " << i_filename << std::endl;
+            return false;
+        }
+        m_maxMemory = i_maxMemory;
+#ifdef FALLOC_FL_PUNCH_HOLE
+        m_punchHole = true;
+#endif
+        spill();
+        return true;
+    }
+    void push_back(const T& state){
+        bool key = m_segments.empty() || m_segments.back().length == m_segmentLength;
+        if (key) m_segments.push_back(Segment());
+        Segment& s = m_segments.back();
+        size_t size = s.data.size();
+        m_codec.encode(state, key ? T() : m_last, s.data);
+        m_memory += s.data.size() - size;
+        s.length++;
+        m_last = state;
+        m_size++;
+        if (key) spill();
+    }
+    void pop_front(){
+        if (!m_size) return;
+        m_skip++;
+        m_size--;
+        m_first++;
+        if (m_skip == m_segments.front().length){
+            if (m_segments.front().spilled){
+                m_numSpilled--;
+                m_spilled -= m_segments.front().bytes;
+                m_segments.pop_front();
+                punch();
+            }else{
+                m_memory -= m_segments.front().data.size();
+                m_segments.pop_front();
+            }
+            m_skip = 0;
+        }
+    }
+    void clear(){
+        m_segments.clear();
+        m_skip = m_size = 0;
+        m_first = 0;
+        m_cacheIndex = -1;
+        m_numSpilled = 0;
+        m_memory = 0;
+        m_spilled = 0;
+        if (m_fd >= 0){
+            unmap();
+            m_fileSize = m_punched = 0;
+            if (ftruncate(m_fd, 0) < 0){
+                std::cerr << "failed to truncate the spill file" << std::endl;
+            }
+        }
+    }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    T& operator[](size_t i){
+        size_t pos = m_skip + i;
+        size_t seg = pos/m_segmentLength, k = pos%m_segmentLength;
+        // the first state of segment in absolute index
+        long key = (long)(m_first - m_skip + seg*m_segmentLength);
+        const unsigned char *p = data(m_segments[seg]);
+        long index = key + k;
+        if (m_cacheIndex >= key && m_cacheIndex <= index){
+            // decode from the cached state
+            p += m_cacheOffset;
+        }else{
+            m_cache = T();
+            m_codec.decode(p, m_cache);
+            m_cacheIndex = key;
+        }
+        for (; m_cacheIndex < index; m_cacheIndex++){
+            m_codec.decode(p, m_cache);
+        }
+        m_cacheOffset = p - data(m_segments[seg]);
+        return m_cache;
+    }
+    /**
+       \brief size of encoded segments in memory and in the spill file
+     */
+    size_t memorySize() const { return m_memory; }
+    size_t fileSize() const { return m_spilled; }
+    /**
+       \brief false if the file system of the spill file doesn't support
+       punching holes, and pages of popped segments are kept in the file
+     */
+    bool punchHole() const { return m_punchHole; }
+private:
+    struct Segment{
+        Segment() : length(0), spilled(false), offset(0), bytes(0) {}
+        std::vector<unsigned char> data;
+        size_t length;
+        bool spilled;
+        off_t offset;
+        size_t bytes; ///< size of the spilled data
+    };
+    const unsigned char *data(const Segment& s){
+        return s.spilled ? m_map + (s.offset - m_mapOffset) : &s.data[0];
+    }
+    // offset of the first spilled segment kept, or the end of the file
+    off_t firstOffset(){
+        return m_numSpilled ? m_segments.front().offset : (off_t)m_fileSize;
+    }
+    static off_t pageFloor(off_t offset){
+        off_t page = sysconf(_SC_PAGESIZE);
+        return offset/page*page;
+    }
+    // spill the oldest segments except the last one being written
+    void spill(){
+        if (m_fd < 0) return;
+        bool spilled = false;
+        for (; m_numSpilled+1<m_segments.size() && m_memory > m_maxMemory; m_numSpilled++){
+            Segment& s = m_segments[m_numSpilled];
+            if (pwrite(m_fd, &s.data[0], s.data.size(), m_fileSize) != (ssize_t)s.data.size()){
+                std::cerr << "failed to write the spill file" << std::endl;
+                break;
+            }
+            s.offset = m_fileSize;
+            s.bytes = s.data.size();
+            s.spilled = true;
+            m_fileSize += s.data.size();
+            m_spilled += s.data.size();
+            m_memory -= s.data.size();
+            std::vector<unsigned char>().swap(s.data);
+            spilled = true;
+        }
+        if (spilled) remap();
+    }
+    // map pages of the spilled segments kept
+    void remap(){
+        unmap();
+        off_t offset = pageFloor(firstOffset());
+        void *addr = mmap(NULL, m_fileSize - offset, PROT_READ, MAP_SHARED, m_fd, offset);
+        if (addr == MAP_FAILED){
+            std::cerr << "failed to map the spill file" << std::endl;
+            return;
+        }
+        m_map = (const unsigned char *)addr;
+        m_mapOffset = offset;
+        m_mapSize = m_fileSize - offset;
+    }
+    // release pages of the file which no longer have spilled segments.
+    // Returns false if they are kept
+    bool punch(){
+        off_t end = pageFloor(firstOffset());
+        if (end <= m_punched) return m_punchHole;
+#ifdef FALLOC_FL_PUNCH_HOLE
+        if (m_punchHole && fallocate(m_fd, FALLOC_FL_PUNCH_HOLE|FALLOC_FL_KEEP_SIZE, m_punched, end - m_punched) < 0){
+            // pages are just kept if the file system doesn't support it
+            if (errno != EOPNOTSUPP && errno != ENOSYS){
+                std::cerr << "failed to release pages of the spill file : " << strerror(errno) << std::endl;
+            }
+            m_punchHole = false;
+        }
+#endif
+        m_punched = end;
+        return m_punchHole;
+    }
+    void unmap(){
+        if (m_map) munmap((void *)m_map, m_mapSize);
+        m_map = NULL;
+        m_mapSize = 0;
+    }
+    void closeSpillFile(bool i_readBack){
+        if (m_fd < 0) return;
+        for (size_t i=0; i_readBack && i<m_segments.size(); i++){
+            Segment& s = m_segments[i];
+            if (!s.spilled) continue;
+            const unsigned char *p = data(s);
+            s.data.assign(p, p + s.bytes);
+            s.spilled = false;
+            m_memory += s.data.size();
+        }
+        m_numSpilled = 0;
+        m_spilled = 0;
+        unmap();
+        close(m_fd);
+        m_fd = -1;
+        m_fileSize = m_punched = 0;
+    }
+
+    Codec m_codec;
+    std::deque<Segment> m_segments;
+    size_t m_segmentLength;
+    size_t m_skip; ///< the number of states popped from the first segment
+    size_t m_size;
+    size_t m_first; ///< absolute index of the first state
+    T m_last;  ///< the last state pushed
+    T m_cache; ///< the last state decoded
+    long m_cacheIndex;
+    size_t m_cacheOffset; ///< offset of the state next to the cached one in its segment
+    size_t m_numSpilled; ///< segments are spilled from the first one
+    int m_fd;
+    const unsigned char *m_map;
+    off_t m_mapOffset; ///< offset of the mapped pages in the file
+    size_t m_mapSize, m_fileSize;
+    off_t m_punched; ///< pages before this offset are released
+    bool m_punchHole; ///< false if holes can't be punched in the file
+    size_t m_spilled; ///< size of spilled segments kept
+    size_t m_memory, m_maxMemory;
+};
+
+#endif
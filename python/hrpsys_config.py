@@ -1415,6 +1415,75 @@ dr=0, dp=0, dw=0, tm=10, wait=True):
         self.log_svc.save(fname)
         print(self.configurator_name + "saved data to " + fname)
 
+    def saveLogBinary(self, fname='sample'):
+        '''!@brief
+        Save log to fname.hrplog in the binary columnar format. The file is written in background.
+
+        @param fname str: basename of the file
+        '''
+        self.log_svc.saveBinary(fname)
+        print(self.configurator_name + "saving data to " + fname + ".hrplog")
+
+    def startRecording(self, fname='sample', maxFileSize=100*1024*1024, maxFiles=0):
+        '''!@brief
+        Start streaming logs to fname-NNNN.hrplog continuously
+
+        @param fname str: basename of files
+        @param maxFileSize int: maximum size of a file[byte]
+        @param maxFiles int: maximum number of files, the oldest one is removed when exceeded. 0 means unlimited
+        '''
+        return self.log_svc.startRecording(fname, maxFileSize, maxFiles)
+
+    def stopRecording(self):
+        '''!@brief
+        Stop streaming logs started by startRecording
+        '''
+        return self.log_svc.stopRecording()
+
+    def readBinaryLog(self, fname):
+        '''!@brief
+        Read a binary log file saved by saveLogBinary or startRecording
+
+        @param fname str: name of the binary log file(basename.hrplog)
+        @return dict of port name to (times, values, lengths) where times is an array of
+                n_samples, values is an array of shape (n_samples, n_elements) and lengths
+                is the number of elements of each sample, values after it are 0
+        '''
+        import struct
+        segments = {}
+        with open(fname, 'rb') as f:
+            # a file written by recording consists of consecutive segments
+            while True:
+                magic = f.read(8)
+                if len(magic) == 0:
+                    break
+                if magic != b'HRPLOG02':
+                    raise IOError(fname + " is not a binary log file")
+                (nports,) = struct.unpack('<I', f.read(4))
+                headers = []
+                for i in range(nports):
+                    (l,) = struct.unpack('<I', f.read(4))
+                    name = f.read(l).decode()
+                    (l,) = struct.unpack('<I', f.read(4))
+                    dtype = f.read(l).decode()
+                    (nelem, nsample) = struct.unpack('<II', f.read(8))
+                    headers.append((name, nelem, nsample))
+                for (name, nelem, nsample) in headers:
+                    times = numpy.fromfile(f, dtype='<f8', count=nsample)
+                    lengths = numpy.fromfile(f, dtype='<u4', count=nsample)
+                    values = numpy.fromfile(f, dtype='<f8', count=nelem * nsample)
+                    segments.setdefault(name, []).append(
+                        (times, values.reshape(nelem, nsample).transpose(), lengths))
+        ret = {}
+        for name, segs in segments.items():
+            nelem = max([v.shape[1] for (t, v, l) in segs])
+            values = [numpy.pad(v, ((0, 0), (0, nelem - v.shape[1])), 'constant')
+                      for (t, v, l) in segs]
+            ret[name] = (numpy.concatenate([t for (t, v, l) in segs]),
+                         numpy.concatenate(values),
+                         numpy.concatenate([l for (t, v, l) in segs]))
+        return ret
+
     def clearLog(self):
         '''!@brief
         Clear logger's buffer
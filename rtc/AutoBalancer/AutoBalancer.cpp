@@ -1066,19 +1066,8 @@ void AutoBalancer::startWalking ()
     for ( std::map<std::string, ABCIKparam>::iterator it = ikp.begin(); it != ikp.end(); it++ ) {
         it->second.pos_ik_error_count = it->second.rot_ik_error_count = 0;
     }
-    std::vector<std::string> init_swing_leg_names(gg->get_footstep_front_leg_names());
-    std::vector<std::string> tmp_all_limbs(leg_names);
-    std::vector<std::string> init_support_leg_names;
-    std::sort(tmp_all_limbs.begin(), tmp_all_limbs.end());
-    std::sort(init_swing_leg_names.begin(), init_swing_leg_names.end());
-    std::set_difference(tmp_all_limbs.begin(), tmp_all_limbs.end(),
-                        init_swing_leg_names.begin(), init_swing_leg_names.end(),
-                        std::back_inserter(init_support_leg_names));
     std::vector<step_node> init_support_leg_steps, init_swing_leg_dst_steps;
-    for (std::vector<std::string>::iterator it = init_support_leg_names.begin(); it != init_support_leg_names.end(); it++)
-        init_support_leg_steps.push_back(step_node(*it, ikp[*it].target_end_coords, 0, 0, 0, 0));
-    for (std::vector<std::string>::iterator it = init_swing_leg_names.begin(); it != init_swing_leg_names.end(); it++)
-        init_swing_leg_dst_steps.push_back(step_node(*it, ikp[*it].target_end_coords, 0, 0, 0, 0));
+    calcInitialLegSteps(*gg, init_support_leg_steps, init_swing_leg_dst_steps);
     gg->set_default_zmp_offsets(default_zmp_offsets);
     gg->initialize_gait_parameter(ref_cog, init_support_leg_steps, init_swing_leg_dst_steps);
   }
@@ -1090,6 +1079,22 @@ void AutoBalancer::startWalking ()
   }
 }
 
+void AutoBalancer::calcInitialLegSteps (const rats::gait_generator& _gg, std::vector<step_node>& init_support_leg_steps, std::vector<step_node>& init_swing_leg_dst_steps)
+{
+  std::vector<std::string> init_swing_leg_names(_gg.get_footstep_front_leg_names());
+  std::vector<std::string> tmp_all_limbs(leg_names);
+  std::vector<std::string> init_support_leg_names;
+  std::sort(tmp_all_limbs.begin(), tmp_all_limbs.end());
+  std::sort(init_swing_leg_names.begin(), init_swing_leg_names.end());
+  std::set_difference(tmp_all_limbs.begin(), tmp_all_limbs.end(),
+                      init_swing_leg_names.begin(), init_swing_leg_names.end(),
+                      std::back_inserter(init_support_leg_names));
+  for (std::vector<std::string>::iterator it = init_support_leg_names.begin(); it != init_support_leg_names.end(); it++)
+      init_support_leg_steps.push_back(step_node(*it, ikp[*it].target_end_coords, 0, 0, 0, 0));
+  for (std::vector<std::string>::iterator it = init_swing_leg_names.begin(); it != init_swing_leg_names.end(); it++)
+      init_swing_leg_dst_steps.push_back(step_node(*it, ikp[*it].target_end_coords, 0, 0, 0, 0));
+}
+
 void AutoBalancer::stopWalking ()
 {
   std::vector<coordinates> tmp_end_coords_list;
@@ -1225,6 +1230,12 @@ bool AutoBalancer::releaseEmergencyStop ()
 bool AutoBalancer::setFootSteps(const OpenHRP::AutoBalancerService::FootstepsSequence& fss, CORBA::Long overwrite_fs_idx)
 {
   OpenHRP::AutoBalancerService::StepParamsSequence spss;
+  calcDefaultStepParams(fss, spss);
+  return setFootStepsWithParam(fss, spss, overwrite_fs_idx);
+}
+
+void AutoBalancer::calcDefaultStepParams(const OpenHRP::AutoBalancerService::FootstepsSequence& fss, OpenHRP::AutoBalancerService::StepParamsSequence& spss)
+{
   spss.length(fss.length());
   // If gg_is_walking is false, initial footstep will be double support. So, set 0 for step_height and toe heel angles.
   // If gg_is_walking is true, do not set to 0.
@@ -1237,7 +1248,6 @@ bool AutoBalancer::setFootSteps(const OpenHRP::AutoBalancerService::FootstepsSeq
           spss[i].sps[j].heel_angle = ((!gg_is_walking && i==0) ? 0.0 : gg->get_heel_angle());
       }
   }
-  setFootStepsWithParam(fss, spss, overwrite_fs_idx);
 }
 
 bool AutoBalancer::setFootStepsWithParam(const OpenHRP::AutoBalancerService::FootstepsSequence& fss, const OpenHRP::AutoBalancerService::StepParamsSequence& spss, CORBA::Long overwrite_fs_idx)
@@ -1245,79 +1255,8 @@ bool AutoBalancer::setFootStepsWithParam(const OpenHRP::AutoBalancerService::Foo
     if (!is_stop_mode) {
         std::cerr << "[" << m_profile.instance_name << "] setFootStepsList" << std::endl;
 
-        // Initial footstep Snapping
-        coordinates tmpfs, fstrans;
-        step_node initial_support_step, initial_input_step;
-        {
-            std::vector<step_node> initial_support_steps;
-            if (gg_is_walking) {
-                if (overwrite_fs_idx <= 0) {
-                    std::cerr << "[" << m_profile.instance_name << "]   Invalid overwrite index = " << overwrite_fs_idx << std::endl;
-                    return false;
-                }
-                if (!gg->get_footstep_nodes_by_index(initial_support_steps, overwrite_fs_idx-1)) {
-                    std::cerr << "[" << m_profile.instance_name << "]   Invalid overwrite index = " << overwrite_fs_idx << std::endl;
-                    return false;
-                }
-            } else {
-                // If walking, snap initial leg to current ABC foot coords.
-                for (size_t i = 0; i < fss[0].fs.length(); i++) {
-                    initial_support_steps.push_back(step_node(std::string(fss[0].fs[i].leg), ikp[std::string(fss[0].fs[i].leg)].target_end_coords, 0, 0, 0, 0));
-                }
-            }
-            initial_support_step = initial_support_steps.front(); /* use only one leg for representation */
-        }
-        {
-            std::map<leg_type, std::string> leg_type_map = gg->get_leg_type_map();
-            for (size_t i = 0; i < fss[0].fs.length(); i++) {
-                if (std::string(fss[0].fs[i].leg) == leg_type_map[initial_support_step.l_r]) {
-                    coordinates tmp;
-                    memcpy(tmp.pos.data(), fss[0].fs[i].pos, sizeof(double)*3);
-                    tmp.rot = (Eigen::Quaternion<double>(fss[0].fs[i].rot[0], fss[0].fs[i].rot[1], fss[0].fs[i].rot[2], fss[0].fs[i].rot[3])).normalized().toRotationMatrix(); // rtc: (x, y, z, w) but eigen: (w, x, y, z)
-                    initial_input_step = step_node(std::string(fss[0].fs[i].leg), tmp, 0, 0, 0, 0);
-                }
-            }
-        }
-
-        // Get footsteps
-        std::vector< std::vector<coordinates> > fs_vec_list;
-        std::vector< std::vector<std::string> > leg_name_vec_list;
-        for (size_t i = 0; i < fss.length(); i++) {
-            std::vector<coordinates> fs_vec;
-            std::vector<std::string> leg_name_vec;
-            for (size_t j = 0; j < fss[i].fs.length(); j++) {
-                std::string leg(fss[i].fs[j].leg);
-                if (std::find(leg_names.begin(), leg_names.end(), leg) != leg_names.end()) {
-                    memcpy(tmpfs.pos.data(), fss[i].fs[j].pos, sizeof(double)*3);
-                    tmpfs.rot = (Eigen::Quaternion<double>(fss[i].fs[j].rot[0], fss[i].fs[j].rot[1], fss[i].fs[j].rot[2], fss[i].fs[j].rot[3])).normalized().toRotationMatrix(); // rtc: (x, y, z, w) but eigen: (w, x, y, z)
-                    initial_input_step.worldcoords.transformation(fstrans, tmpfs);
-                    tmpfs = initial_support_step.worldcoords;
-                    tmpfs.transform(fstrans);
-                } else {
-                    std::cerr << "[" << m_profile.instance_name << "]   No such target : " << leg << std::endl;
-                    return false;
-                }
-                leg_name_vec.push_back(leg);
-                fs_vec.push_back(tmpfs);
-            }
-            leg_name_vec_list.push_back(leg_name_vec);
-            fs_vec_list.push_back(fs_vec);
-        }
-        if (spss.length() != fs_vec_list.size()) {
-            std::cerr << "[" << m_profile.instance_name << "]   StepParam length " << spss.length () << " != Footstep length " << fs_vec_list.size() << std::endl;
-            return false;
-        }
-        std::cerr << "[" << m_profile.instance_name << "] print footsteps " << std::endl;
         std::vector< std::vector<step_node> > fnsl;
-        for (size_t i = 0; i < fs_vec_list.size(); i++) {
-            if (!(gg_is_walking && i == 0)) { // If initial footstep, e.g., not walking, pass user-defined footstep list. If walking, pass cdr footsteps in order to neglect initial double support leg.
-                std::vector<step_node> tmp_fns;
-                for (size_t j = 0; j < fs_vec_list.at(i).size(); j++) {
-                    tmp_fns.push_back(step_node(leg_name_vec_list[i][j], fs_vec_list[i][j], spss[i].sps[j].step_height, spss[i].sps[j].step_time, spss[i].sps[j].toe_angle, spss[i].sps[j].heel_angle));
-                }
-                fnsl.push_back(tmp_fns);
-            }
-        }
+        if (!calcFootStepNodesList(fss, spss, overwrite_fs_idx, fnsl)) return false;
         if (gg_is_walking) {
             std::cerr << "[" << m_profile.instance_name << "]  Set overwrite footsteps" << std::endl;
             gg->set_overwrite_foot_steps_list(fnsl);
@@ -1334,6 +1273,84 @@ bool AutoBalancer::setFootStepsWithParam(const OpenHRP::AutoBalancerService::Foo
     }
 }
 
+bool AutoBalancer::calcFootStepNodesList(const OpenHRP::AutoBalancerService::FootstepsSequence& fss, const OpenHRP::AutoBalancerService::StepParamsSequence& spss, CORBA::Long overwrite_fs_idx,
+                                         std::vector< std::vector<step_node> >& fnsl)
+{
+    // Initial footstep Snapping
+    coordinates tmpfs, fstrans;
+    step_node initial_support_step, initial_input_step;
+    {
+        std::vector<step_node> initial_support_steps;
+        if (gg_is_walking) {
+            if (overwrite_fs_idx <= 0) {
+                std::cerr << "[" << m_profile.instance_name << "]   Invalid overwrite index = " << overwrite_fs_idx << std::endl;
+                return false;
+            }
+            if (!gg->get_footstep_nodes_by_index(initial_support_steps, overwrite_fs_idx-1)) {
+                std::cerr << "[" << m_profile.instance_name << "]   Invalid overwrite index = " << overwrite_fs_idx << std::endl;
+                return false;
+            }
+        } else {
+            // If walking, snap initial leg to current ABC foot coords.
+            for (size_t i = 0; i < fss[0].fs.length(); i++) {
+                initial_support_steps.push_back(step_node(std::string(fss[0].fs[i].leg), ikp[std::string(fss[0].fs[i].leg)].target_end_coords, 0, 0, 0, 0));
+            }
+        }
+        initial_support_step = initial_support_steps.front(); /* use only one leg for representation */
+    }
+    {
+        std::map<leg_type, std::string> leg_type_map = gg->get_leg_type_map();
+        for (size_t i = 0; i < fss[0].fs.length(); i++) {
+            if (std::string(fss[0].fs[i].leg) == leg_type_map[initial_support_step.l_r]) {
+                coordinates tmp;
+                memcpy(tmp.pos.data(), fss[0].fs[i].pos, sizeof(double)*3);
+                tmp.rot = (Eigen::Quaternion<double>(fss[0].fs[i].rot[0], fss[0].fs[i].rot[1], fss[0].fs[i].rot[2], fss[0].fs[i].rot[3])).normalized().toRotationMatrix(); // rtc: (x, y, z, w) but eigen: (w, x, y, z)
+                initial_input_step = step_node(std::string(fss[0].fs[i].leg), tmp, 0, 0, 0, 0);
+            }
+        }
+    }
+
+    // Get footsteps
+    std::vector< std::vector<coordinates> > fs_vec_list;
+    std::vector< std::vector<std::string> > leg_name_vec_list;
+    for (size_t i = 0; i < fss.length(); i++) {
+        std::vector<coordinates> fs_vec;
+        std::vector<std::string> leg_name_vec;
+        for (size_t j = 0; j < fss[i].fs.length(); j++) {
+            std::string leg(fss[i].fs[j].leg);
+            if (std::find(leg_names.begin(), leg_names.end(), leg) != leg_names.end()) {
+                memcpy(tmpfs.pos.data(), fss[i].fs[j].pos, sizeof(double)*3);
+                tmpfs.rot = (Eigen::Quaternion<double>(fss[i].fs[j].rot[0], fss[i].fs[j].rot[1], fss[i].fs[j].rot[2], fss[i].fs[j].rot[3])).normalized().toRotationMatrix(); // rtc: (x, y, z, w) but eigen: (w, x, y, z)
+                initial_input_step.worldcoords.transformation(fstrans, tmpfs);
+                tmpfs = initial_support_step.worldcoords;
+                tmpfs.transform(fstrans);
+            } else {
+                std::cerr << "[" << m_profile.instance_name << "]   No such target : " << leg << std::endl;
+                return false;
+            }
+            leg_name_vec.push_back(leg);
+            fs_vec.push_back(tmpfs);
+        }
+        leg_name_vec_list.push_back(leg_name_vec);
+        fs_vec_list.push_back(fs_vec);
+    }
+    if (spss.length() != fs_vec_list.size()) {
+        std::cerr << "[" << m_profile.instance_name << "]   StepParam length " << spss.length () << " != Footstep length " << fs_vec_list.size() << std::endl;
+        return false;
+    }
+    std::cerr << "[" << m_profile.instance_name << "] print footsteps " << std::endl;
+    for (size_t i = 0; i < fs_vec_list.size(); i++) {
+        if (!(gg_is_walking && i == 0)) { // If initial footstep, e.g., not walking, pass user-defined footstep list. If walking, pass cdr footsteps in order to neglect initial double support leg.
+            std::vector<step_node> tmp_fns;
+            for (size_t j = 0; j < fs_vec_list.at(i).size(); j++) {
+                tmp_fns.push_back(step_node(leg_name_vec_list[i][j], fs_vec_list[i][j], spss[i].sps[j].step_height, spss[i].sps[j].step_time, spss[i].sps[j].toe_angle, spss[i].sps[j].heel_angle));
+            }
+            fnsl.push_back(tmp_fns);
+        }
+    }
+    return true;
+}
+
 void AutoBalancer::waitFootSteps()
 {
   //while (gg_is_walking) usleep(10);
@@ -1896,6 +1913,117 @@ bool AutoBalancer::getGoPosFootstepsSequence(const double& x, const double& y, c
     }
 };
 
+AutoBalancer::ggPtr AutoBalancer::makeEvaluationGaitGenerator()
+{
+    // leg_pos and stride parameters are overwritten by copy_parameters()
+    ggPtr sim_gg(new rats::gait_generator(m_dt, std::vector<hrp::Vector3>(leg_names.size(), hrp::Vector3::Zero()), leg_names, 0, 0, 0, 0));
+    sim_gg->copy_parameters(*gg);
+    sim_gg->set_all_limbs(leg_names);
+    sim_gg->set_default_zmp_offsets(default_zmp_offsets);
+    return sim_gg;
+}
+
+bool AutoBalancer::evaluateGoPos(const double& x, const double& y, const double& th, const double& sampling_time, OpenHRP::AutoBalancerService::WalkingPatternEvaluation& o_eval)
+{
+    std::cerr << "[" << m_profile.instance_name << "] evaluateGoPos" << std::endl;
+    ggPtr sim_gg;
+    std::vector<step_node> init_support_leg_steps, init_swing_leg_dst_steps;
+    hrp::Vector3 cog;
+    {
+        Guard guard(m_mutex);
+        if (gg_is_walking) {
+            std::cerr << "[" << m_profile.instance_name << "] Cannot call evaluateGoPos in walking" << std::endl;
+            return false;
+        }
+        sim_gg = makeEvaluationGaitGenerator();
+        coordinates start_ref_coords;
+        std::vector<coordinates> initial_support_legs_coords;
+        std::vector<leg_type> initial_support_legs;
+        bool is_valid_gait_type = calc_inital_support_legs(y, initial_support_legs_coords, initial_support_legs, start_ref_coords);
+        if (is_valid_gait_type == false) return false;
+        sim_gg->go_pos_param_2_footstep_nodes_list(x, y, th, initial_support_legs_coords, start_ref_coords, initial_support_legs);
+        calcInitialLegSteps(*sim_gg, init_support_leg_steps, init_swing_leg_dst_steps);
+        cog = ref_cog;
+    }
+    evaluateWalkingPattern(*sim_gg, cog, init_support_leg_steps, init_swing_leg_dst_steps, sampling_time, o_eval);
+    return true;
+}
+
+bool AutoBalancer::evaluateFootSteps(const OpenHRP::AutoBalancerService::FootstepsSequence& fss, const OpenHRP::AutoBalancerService::StepParamsSequence& spss, const double& sampling_time, OpenHRP::AutoBalancerService::WalkingPatternEvaluation& o_eval)
+{
+    std::cerr << "[" << m_profile.instance_name << "] evaluateFootSteps" << std::endl;
+    ggPtr sim_gg;
+    std::vector<step_node> init_support_leg_steps, init_swing_leg_dst_steps;
+    hrp::Vector3 cog;
+    {
+        Guard guard(m_mutex);
+        if (gg_is_walking) {
+            std::cerr << "[" << m_profile.instance_name << "] Cannot call evaluateFootSteps in walking" << std::endl;
+            return false;
+        }
+        if (fss.length() < 2) {
+            std::cerr << "[" << m_profile.instance_name << "]   Footstep length " << fss.length() << " is too short" << std::endl;
+            return false;
+        }
+        OpenHRP::AutoBalancerService::StepParamsSequence default_spss;
+        if (spss.length() == 0) calcDefaultStepParams(fss, default_spss);
+        std::vector< std::vector<step_node> > fnsl;
+        if (!calcFootStepNodesList(fss, (spss.length() == 0 ? default_spss : spss), 0, fnsl)) return false;
+        sim_gg = makeEvaluationGaitGenerator();
+        sim_gg->set_foot_steps_list(fnsl);
+        calcInitialLegSteps(*sim_gg, init_support_leg_steps, init_swing_leg_dst_steps);
+        cog = ref_cog;
+    }
+    evaluateWalkingPattern(*sim_gg, cog, init_support_leg_steps, init_swing_leg_dst_steps, sampling_time, o_eval);
+    return true;
+}
+
+void AutoBalancer::evaluateWalkingPattern(rats::gait_generator& sim_gg, const hrp::Vector3& cog, const std::vector<step_node>& init_support_leg_steps, const std::vector<step_node>& init_swing_leg_dst_steps,
+                                          const double sampling_time, OpenHRP::AutoBalancerService::WalkingPatternEvaluation& o_eval)
+{
+    coil::TimeValue t0(coil::gettimeofday());
+    rats::walking_pattern_evaluation eval;
+    sim_gg.evaluate_walking_pattern(eval, cog, init_support_leg_steps, init_swing_leg_dst_steps, sampling_time);
+    coil::TimeValue t1(coil::gettimeofday());
+
+    size_t len = eval.cog_list.size();
+    o_eval.dt = eval.dt;
+    o_eval.cog.length(len);
+    o_eval.refzmp.length(len);
+    o_eval.cart_zmp.length(len);
+    o_eval.support_leg_coords.length(len);
+    o_eval.swing_leg_coords.length(len);
+    std::map<leg_type, std::string> leg_type_map = sim_gg.get_leg_type_map();
+    for (size_t i = 0; i < len; i++) {
+        o_eval.cog[i].length(3);
+        o_eval.refzmp[i].length(3);
+        o_eval.cart_zmp[i].length(3);
+        for (size_t j = 0; j < 3; j++) {
+            o_eval.cog[i][j] = eval.cog_list[i](j);
+            o_eval.refzmp[i][j] = eval.refzmp_list[i](j);
+            o_eval.cart_zmp[i][j] = eval.cart_zmp_list[i](j);
+        }
+        o_eval.support_leg_coords[i].fs.length(eval.support_leg_steps_list[i].size());
+        for (size_t j = 0; j < eval.support_leg_steps_list[i].size(); j++) {
+            o_eval.support_leg_coords[i].fs[j].leg = leg_type_map[eval.support_leg_steps_list[i][j].l_r].c_str();
+            copyRatscoords2Footstep(o_eval.support_leg_coords[i].fs[j], eval.support_leg_steps_list[i][j].worldcoords);
+        }
+        o_eval.swing_leg_coords[i].fs.length(eval.swing_leg_steps_list[i].size());
+        for (size_t j = 0; j < eval.swing_leg_steps_list[i].size(); j++) {
+            o_eval.swing_leg_coords[i].fs[j].leg = leg_type_map[eval.swing_leg_steps_list[i][j].l_r].c_str();
+            copyRatscoords2Footstep(o_eval.swing_leg_coords[i].fs[j], eval.swing_leg_steps_list[i][j].worldcoords);
+        }
+    }
+    o_eval.walking_time = eval.walking_time;
+    o_eval.max_zmp_error = eval.max_zmp_error;
+    o_eval.max_refzmp_diff = eval.max_refzmp_diff;
+    o_eval.zmp_error_violation_count = eval.zmp_error_violation_count;
+    o_eval.refzmp_diff_violation_count = eval.refzmp_diff_violation_count;
+    o_eval.computation_time = (double)(t1 - t0);
+    std::cerr << "[" << m_profile.instance_name << "]   " << eval.walking_time << "[s] walking is evaluated in " << o_eval.computation_time * 1e3 << "[ms], max zmp error = "
+              << eval.max_zmp_error * 1e3 << "[mm], max refzmp diff = " << eval.max_refzmp_diff * 1e3 << "[mm]" << std::endl;
+}
+
 void AutoBalancer::static_balance_point_proc_one(hrp::Vector3& tmp_input_sbp, const double ref_com_height)
 {
   hrp::Vector3 target_sbp = hrp::Vector3(0, 0, 0);
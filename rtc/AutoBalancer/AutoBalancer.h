@@ -109,6 +109,8 @@ class AutoBalancer
   bool adjustFootSteps(const OpenHRP::AutoBalancerService::Footstep& rfootstep, const OpenHRP::AutoBalancerService::Footstep& lfootstep);
   bool getRemainingFootstepSequence(OpenHRP::AutoBalancerService::FootstepSequence_out o_footstep, CORBA::Long& o_current_fs_idx);
   bool getGoPosFootstepsSequence(const double& x, const double& y, const double& th, OpenHRP::AutoBalancerService::FootstepsSequence_out o_footstep);
+  bool evaluateGoPos(const double& x, const double& y, const double& th, const double& sampling_time, OpenHRP::AutoBalancerService::WalkingPatternEvaluation& o_eval);
+  bool evaluateFootSteps(const OpenHRP::AutoBalancerService::FootstepsSequence& fss, const OpenHRP::AutoBalancerService::StepParamsSequence& spss, const double& sampling_time, OpenHRP::AutoBalancerService::WalkingPatternEvaluation& o_eval);
   bool releaseEmergencyStop();
 
  protected:
@@ -206,6 +208,12 @@ class AutoBalancer
   void fixLegToCoords (const hrp::Vector3& fix_pos, const hrp::Matrix33& fix_rot);
   void startWalking ();
   void stopWalking ();
+  void calcInitialLegSteps (const rats::gait_generator& _gg, std::vector<rats::step_node>& init_support_leg_steps, std::vector<rats::step_node>& init_swing_leg_dst_steps);
+  void calcDefaultStepParams(const OpenHRP::AutoBalancerService::FootstepsSequence& fss, OpenHRP::AutoBalancerService::StepParamsSequence& spss);
+  bool calcFootStepNodesList(const OpenHRP::AutoBalancerService::FootstepsSequence& fss, const OpenHRP::AutoBalancerService::StepParamsSequence& spss, CORBA::Long overwrite_fs_idx,
+                             std::vector< std::vector<rats::step_node> >& fnsl);
+  void evaluateWalkingPattern(rats::gait_generator& sim_gg, const hrp::Vector3& cog, const std::vector<rats::step_node>& init_support_leg_steps, const std::vector<rats::step_node>& init_swing_leg_dst_steps,
+                              const double sampling_time, OpenHRP::AutoBalancerService::WalkingPatternEvaluation& o_eval);
   void copyRatscoords2Footstep(OpenHRP::AutoBalancerService::Footstep& out_fs, const rats::coordinates& in_fs);
   // static balance point offsetting
   void static_balance_point_proc_one(hrp::Vector3& tmp_input_sbp, const double ref_com_height);
@@ -220,6 +228,8 @@ class AutoBalancer
   // for gg
   typedef boost::shared_ptr<rats::gait_generator> ggPtr;
   ggPtr gg;
+  // gait_generator for offline evaluation of walking patterns, which has the same parameters as gg
+  ggPtr makeEvaluationGaitGenerator();
   bool gg_is_walking, gg_solved;
   // for abc
   hrp::Vector3 ref_cog, ref_zmp, prev_imu_sensor_pos, prev_imu_sensor_vel, hand_fix_initial_offset;
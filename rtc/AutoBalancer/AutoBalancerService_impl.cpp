@@ -105,6 +105,18 @@ CORBA::Boolean AutoBalancerService_impl::getGoPosFootstepsSequence(CORBA::Double
     return m_autobalancer->getGoPosFootstepsSequence(x, y, th, o_footstep);
 };
 
+CORBA::Boolean AutoBalancerService_impl::evaluateGoPos(CORBA::Double x, CORBA::Double y, CORBA::Double th, CORBA::Double sampling_time, OpenHRP::AutoBalancerService::WalkingPatternEvaluation_out o_eval)
+{
+    o_eval = new OpenHRP::AutoBalancerService::WalkingPatternEvaluation();
+    return m_autobalancer->evaluateGoPos(x, y, th, sampling_time, *o_eval);
+};
+
+CORBA::Boolean AutoBalancerService_impl::evaluateFootSteps(const OpenHRP::AutoBalancerService::FootstepsSequence& fss, const OpenHRP::AutoBalancerService::StepParamsSequence& spss, CORBA::Double sampling_time, OpenHRP::AutoBalancerService::WalkingPatternEvaluation_out o_eval)
+{
+    o_eval = new OpenHRP::AutoBalancerService::WalkingPatternEvaluation();
+    return m_autobalancer->evaluateFootSteps(fss, spss, sampling_time, *o_eval);
+};
+
 CORBA::Boolean AutoBalancerService_impl::releaseEmergencyStop()
 {
     return m_autobalancer->releaseEmergencyStop();
@@ -33,6 +33,8 @@ public:
   CORBA::Boolean adjustFootSteps(const OpenHRP::AutoBalancerService::Footstep& rfootstep, const OpenHRP::AutoBalancerService::Footstep& lfootstep);
   CORBA::Boolean getRemainingFootstepSequence(OpenHRP::AutoBalancerService::FootstepSequence_out o_footstep , CORBA::Long& o_current_fs_idx);
   CORBA::Boolean getGoPosFootstepsSequence(CORBA::Double x, CORBA::Double y, CORBA::Double th, OpenHRP::AutoBalancerService::FootstepsSequence_out o_footstep);
+  CORBA::Boolean evaluateGoPos(CORBA::Double x, CORBA::Double y, CORBA::Double th, CORBA::Double sampling_time, OpenHRP::AutoBalancerService::WalkingPatternEvaluation_out o_eval);
+  CORBA::Boolean evaluateFootSteps(const OpenHRP::AutoBalancerService::FootstepsSequence& fss, const OpenHRP::AutoBalancerService::StepParamsSequence& spss, CORBA::Double sampling_time, OpenHRP::AutoBalancerService::WalkingPatternEvaluation_out o_eval);
   CORBA::Boolean releaseEmergencyStop();
   //
   //
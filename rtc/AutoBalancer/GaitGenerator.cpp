@@ -614,6 +614,82 @@ namespace rats
     return solved;
   };
 
+  void gait_generator::copy_parameters (const gait_generator& _gg)
+  {
+    thp = _gg.thp;
+    rg.copy_parameters(_gg.rg);
+    lcg.copy_parameters(_gg.lcg);
+    footstep_param = _gg.footstep_param;
+    vel_param = _gg.vel_param;
+    offset_vel_param = _gg.offset_vel_param;
+    all_limbs = _gg.all_limbs;
+    default_step_time = _gg.default_step_time;
+    default_double_support_ratio_before = _gg.default_double_support_ratio_before;
+    default_double_support_ratio_after = _gg.default_double_support_ratio_after;
+    default_double_support_static_ratio_before = _gg.default_double_support_static_ratio_before;
+    default_double_support_static_ratio_after = _gg.default_double_support_static_ratio_after;
+    default_double_support_ratio_swing_before = _gg.default_double_support_ratio_swing_before;
+    default_double_support_ratio_swing_after = _gg.default_double_support_ratio_swing_after;
+    gravitational_acceleration = _gg.gravitational_acceleration;
+    optional_go_pos_finalize_footstep_num = _gg.optional_go_pos_finalize_footstep_num;
+    overwritable_footstep_index_offset = _gg.overwritable_footstep_index_offset;
+    use_inside_step_limitation = _gg.use_inside_step_limitation;
+  };
+
+  void gait_generator::evaluate_walking_pattern (walking_pattern_evaluation& ret,
+                                                 const hrp::Vector3& _cog,
+                                                 const std::vector<step_node>& initial_support_leg_steps,
+                                                 const std::vector<step_node>& initial_swing_leg_dst_steps,
+                                                 const double sampling_time,
+                                                 const double zmp_error_thre, const double refzmp_diff_thre)
+  {
+    size_t sampling_count = std::max(static_cast<size_t>(sampling_time / dt + 0.5), static_cast<size_t>(1));
+    ret.dt = sampling_count * dt;
+    ret.cog_list.clear();
+    ret.refzmp_list.clear();
+    ret.cart_zmp_list.clear();
+    ret.support_leg_steps_list.clear();
+    ret.swing_leg_steps_list.clear();
+    ret.max_zmp_error = ret.max_refzmp_diff = 0.0;
+    ret.zmp_error_violation_count = ret.refzmp_diff_violation_count = 0;
+    size_t len = 0;
+    for (size_t i = 0; i < footstep_nodes_list.size(); i++) len += static_cast<size_t>(footstep_nodes_list[i].front().step_time / dt);
+    len = len / sampling_count + 1;
+    ret.cog_list.reserve(len);
+    ret.refzmp_list.reserve(len);
+    ret.cart_zmp_list.reserve(len);
+    ret.support_leg_steps_list.reserve(len);
+    ret.swing_leg_steps_list.reserve(len);
+
+    initialize_gait_parameter(_cog, initial_support_leg_steps, initial_swing_leg_dst_steps);
+    while ( !proc_one_tick() );
+    size_t count = 0;
+    hrp::Vector3 prev_refzmp(refzmp);
+    while ( proc_one_tick() ) {
+      hrp::Vector3 czmp(get_cart_zmp());
+      double zmp_error = (czmp - refzmp).norm();
+      ret.max_zmp_error = std::max(ret.max_zmp_error, zmp_error);
+      if (zmp_error >= zmp_error_thre) ret.zmp_error_violation_count++;
+      if (count > 0) {
+        double refzmp_diff = (refzmp - prev_refzmp).norm();
+        ret.max_refzmp_diff = std::max(ret.max_refzmp_diff, refzmp_diff);
+        if (refzmp_diff >= refzmp_diff_thre) ret.refzmp_diff_violation_count++;
+      }
+      prev_refzmp = refzmp;
+      if (count % sampling_count == 0) {
+        coordinates tmpc;
+        lcg.get_swing_support_mid_coords(tmpc);
+        ret.cog_list.push_back(hrp::Vector3(cog(0), cog(1), tmpc.pos(2) + cog(2)));
+        ret.refzmp_list.push_back(refzmp);
+        ret.cart_zmp_list.push_back(czmp);
+        ret.support_leg_steps_list.push_back(lcg.get_support_leg_steps());
+        ret.swing_leg_steps_list.push_back(lcg.get_swing_leg_steps());
+      }
+      count++;
+    }
+    ret.walking_time = count * dt;
+  };
+
   /* generate vector of step_node from :go-pos params
    *  x, y and theta are simply divided by using stride params
    *  unit system -> x [mm], y [mm], theta [deg]
@@ -244,6 +244,18 @@ namespace rats
       {
           thp_ptr = NULL;
       };
+      /* copy parameters of other refzmp_generator. zmp_weight_map is set without interpolation. */
+      void copy_parameters (const refzmp_generator& _rg)
+      {
+          default_zmp_offsets = _rg.default_zmp_offsets;
+          toe_zmp_offset_x = _rg.toe_zmp_offset_x;
+          heel_zmp_offset_x = _rg.heel_zmp_offset_x;
+          use_toe_heel_transition = _rg.use_toe_heel_transition;
+          zmp_weight_map = _rg.zmp_weight_map;
+          double zmp_weight_array[4] = {zmp_weight_map[RLEG], zmp_weight_map[LLEG], zmp_weight_map[RARM], zmp_weight_map[LARM]};
+          zmp_weight_interpolator->clear();
+          zmp_weight_interpolator->set(zmp_weight_array);
+      };
       void remove_refzmp_cur_list_over_length (const size_t len)
       {
         while ( refzmp_cur_list.size() > len) refzmp_cur_list.pop_back();
@@ -654,6 +666,23 @@ namespace rats
         }
         thp_ptr = NULL;
       };
+      /* copy parameters of other leg_coords_generator */
+      void copy_parameters (const leg_coords_generator& _lcg)
+      {
+          set_default_step_height(_lcg.default_step_height);
+          set_default_top_ratio(_lcg.default_top_ratio);
+          set_default_orbit_type(_lcg.default_orbit_type);
+          set_swing_trajectory_delay_time_offset(_lcg.time_offset);
+          set_swing_trajectory_final_distance_weight(_lcg.final_distance_weight);
+          set_stair_trajectory_way_point_offset(_lcg.get_stair_trajectory_way_point_offset());
+          set_cycloid_delay_kick_point_offset(_lcg.get_cycloid_delay_kick_point_offset());
+          crdtg.way_point_offset = _lcg.crdtg.way_point_offset;
+          set_toe_pos_offset_x(_lcg.toe_pos_offset_x);
+          set_heel_pos_offset_x(_lcg.heel_pos_offset_x);
+          set_toe_angle(_lcg.toe_angle);
+          set_heel_angle(_lcg.heel_angle);
+          set_use_toe_joint(_lcg.use_toe_joint);
+      };
       void set_default_step_height (const double _tmp) { default_step_height = _tmp; };
       void set_default_top_ratio (const double _tmp) { default_top_ratio = _tmp; };
       void set_default_orbit_type (const orbit_type _tmp) { default_orbit_type = _tmp; };
@@ -836,6 +865,17 @@ namespace rats
       bool get_use_toe_joint () const { return use_toe_joint; };
     };
 
+  /* Walking pattern generated by gait_generator::evaluate_walking_pattern */
+  struct walking_pattern_evaluation
+  {
+    double dt; /* sampling time of the lists below [s] */
+    std::vector<hrp::Vector3> cog_list, refzmp_list, cart_zmp_list; /* cog height is in the world frame */
+    std::vector< std::vector<step_node> > support_leg_steps_list, swing_leg_steps_list;
+    double walking_time; /* [s] */
+    double max_zmp_error, max_refzmp_diff; /* max |cart_zmp - refzmp| and max refzmp difference between control cycles [m] */
+    size_t zmp_error_violation_count, refzmp_diff_violation_count; /* the number of control cycles exceeding thresholds */
+  };
+
   class gait_generator
   {
 
@@ -943,6 +983,19 @@ namespace rats
                                     const std::vector<step_node>& initial_swing_leg_dst_steps,
                                     const double delay = 1.6);
     bool proc_one_tick ();
+    /* Copy parameters of other gait_generator, which has the same dt and leg_pos.
+       Footsteps and walking states are not copied. */
+    void copy_parameters (const gait_generator& _gg);
+    /* Generate the whole walking pattern of footstep_nodes_list without waiting control cycles.
+       Trajectories are sampled every sampling_time (every control cycle if it is less than dt),
+       while zmp error and refzmp difference are checked at every control cycle.
+       This instance must not be the one used for the walking of the robot. */
+    void evaluate_walking_pattern (walking_pattern_evaluation& ret,
+                                   const hrp::Vector3& _cog,
+                                   const std::vector<step_node>& initial_support_leg_steps,
+                                   const std::vector<step_node>& initial_swing_leg_dst_steps,
+                                   const double sampling_time = 0.0,
+                                   const double zmp_error_thre = 50e-3, const double refzmp_diff_thre = 10e-3);
     void append_footstep_nodes (const std::vector<std::string>& _legs, const std::vector<coordinates>& _fss)
     {
         std::vector<step_node> tmp_sns;
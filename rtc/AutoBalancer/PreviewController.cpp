@@ -8,17 +8,8 @@ template <std::size_t dim>
 void preview_control_base<dim>::update_x_k(const hrp::Vector3& pr, const std::vector<hrp::Vector3>& _qdata)
 {
   zmp_z = pr(2);
-  Eigen::Matrix<double, 2, 1> tmpv;
-  tmpv(0,0) = pr(0);
-  tmpv(1,0) = pr(1);
-  p.push_back(tmpv);
-  pz.push_back(pr(2));
-  qdata.push_back(_qdata);
-  if ( p.size() > 1 + delay ) {
-    p.pop_front();
-    pz.pop_front();
-    qdata.pop_front();
-  }
+  p.push_back(pr, _qdata);
+  if ( p.size() > 1 + delay ) p.pop_front();
   if ( is_doing() ) calc_x_k();
 }
 
@@ -44,9 +35,8 @@ void preview_control::calc_f()
 
 void preview_control::calc_u()
 {
-  Eigen::Matrix<double, 1, 2> gfp(Eigen::Matrix<double, 1, 2>::Zero());
-  for (size_t i = 0; i < 1 + delay; i++)
-    gfp += f(i) * p[i];
+  Eigen::Matrix<double, 1, 2> gfp;
+  gfp << f.dot(p.x_segment()), f.dot(p.y_segment());
   u_k = -riccati.K * x_k + gfp;
 };
 
@@ -73,9 +63,8 @@ void extended_preview_control::calc_f()
 
 void extended_preview_control::calc_u()
 {
-  Eigen::Matrix<double, 1, 2> gfp(Eigen::Matrix<double, 1, 2>::Zero());
-  for (size_t i = 0; i < 1 + delay; i++)
-    gfp += f(i) * p[i];
+  Eigen::Matrix<double, 1, 2> gfp;
+  gfp << f.dot(p.x_segment()), f.dot(p.y_segment());
   u_k = -riccati.K * x_k_e + gfp;
 };
 
@@ -4,6 +4,11 @@
 #include <iostream>
 #include <queue>
 #include <deque>
+#include <limits>
+#include <map>
+#include <vector>
+#include <coil/Mutex.h>
+#include <coil/Guard.h>
 #include <hrpUtil/Eigen3d.h>
 #include "util/Hrpsys.h"
 
@@ -11,6 +16,48 @@ namespace rats
 {
   static const double DEFAULT_GRAVITATIONAL_ACCELERATION = 9.80665; // [m/s^2]
 
+  /* solutions of riccati equations shared by all preview controllers */
+  template <std::size_t dim>
+  class riccati_cache
+  {
+    static const size_t max_entries = 32;
+    typedef std::map<std::vector<double>, std::vector<double> > entry_map;
+    static coil::Mutex& mutex () { static coil::Mutex m; return m; };
+    static entry_map& entries () { static entry_map e; return e; };
+    static std::deque<std::vector<double> >& keys () { static std::deque<std::vector<double> > k; return k; };
+  public:
+    static bool find (const std::vector<double>& key, Eigen::Matrix<double, dim, dim>& P)
+    {
+      coil::Guard<coil::Mutex> guard(mutex());
+      typename entry_map::const_iterator it = entries().find(key);
+      if (it == entries().end()) return false;
+      P = Eigen::Map<const Eigen::Matrix<double, dim, dim> >(&it->second[0]);
+      return true;
+    };
+    static void add (const std::vector<double>& key, const Eigen::Matrix<double, dim, dim>& P)
+    {
+      coil::Guard<coil::Mutex> guard(mutex());
+      if (entries().find(key) != entries().end()) return;
+      if (keys().size() >= max_entries) { /* remove the oldest entry */
+        entries().erase(keys().front());
+        keys().pop_front();
+      }
+      entries()[key] = std::vector<double>(P.data(), P.data() + dim * dim);
+      keys().push_back(key);
+    };
+    static void clear ()
+    {
+      coil::Guard<coil::Mutex> guard(mutex());
+      entries().clear();
+      keys().clear();
+    };
+    static size_t size ()
+    {
+      coil::Guard<coil::Mutex> guard(mutex());
+      return entries().size();
+    };
+  };
+
   template <std::size_t dim>
   struct riccati_equation
   {
@@ -30,7 +77,24 @@ namespace rats
                      const Eigen::Matrix<double, 1, dim>& _c, const double _Q, const double _R)
       : A(_A), b(_b), c(_c), P(Eigen::Matrix<double, dim, dim>::Zero()), K(Eigen::Matrix<double, 1, dim>::Zero()), A_minus_bKt(Eigen::Matrix<double, dim, dim>::Zero()), Q(_Q), R(_R), R_btPb_inv(0) {};
     virtual ~riccati_equation() {};
+    /* solve with a cached solution if available, otherwise by the doubling algorithm refined by the iteration */
     bool solve() {
+      std::vector<double> key(A.data(), A.data() + dim * dim);
+      key.insert(key.end(), b.data(), b.data() + dim);
+      key.insert(key.end(), c.data(), c.data() + dim);
+      key.push_back(Q);
+      key.push_back(R);
+      if (riccati_cache<dim>::find(key, P)) {
+        calc_gain();
+        return true;
+      }
+      if (!solve_by_doubling()) P = Eigen::Matrix<double, dim, dim>::Zero();
+      bool ret = solve_by_iteration();
+      if (ret) riccati_cache<dim>::add(key, P);
+      return ret;
+    }
+    /* fixed point iteration of the riccati equation starting from current P */
+    bool solve_by_iteration() {
       Eigen::Matrix<double, dim, dim> prev_P;
       for (int i = 0; i < 10000; i++) {
         R_btPb_inv = (1.0 / (R + (b.transpose() * P * b)(0,0)));
@@ -45,6 +109,80 @@ namespace rats
       }
       return false;
     }
+    /* structure-preserving doubling algorithm, which converges quadratically.
+       P is set to the solution if converged. */
+    bool solve_by_doubling() {
+      typedef Eigen::Matrix<double, dim, dim> matrix;
+      matrix Ak(A), Gk(b * (1.0 / R) * b.transpose()), Hk(c.transpose() * Q * c);
+      const matrix I(matrix::Identity());
+      for (int i = 0; i < 100; i++) {
+        matrix W((I + Gk * Hk).inverse());
+        matrix AW(Ak * W);
+        matrix Hn(Hk + Ak.transpose() * Hk * W * Ak);
+        Gk += AW * Gk * Ak.transpose();
+        Ak = AW * Ak;
+        if (!(Hn.array().abs() < std::numeric_limits<double>::max()).all()) return false; /* diverged or NaN */
+        bool converged = ((Hn - Hk).array().abs() < 5.0e-10 * (1.0 + Hn.array().abs())).all();
+        Hk = Hn;
+        if (converged) {
+          P = Hk;
+          return true;
+        }
+      }
+      return false;
+    }
+    void calc_gain() {
+      R_btPb_inv = (1.0 / (R + (b.transpose() * P * b)(0,0)));
+      K = R_btPb_inv * b.transpose() * (P * A);
+      A_minus_bKt = (A - b * K).transpose();
+    }
+  };
+
+  /* queue of future zmp references and their additional data.
+     Components are stored separately in ring buffers of fixed capacity allocated at once.
+     x and y are written at both i and i + capacity so that they are contiguous from the front,
+     and the sum of the preview term is computed as vectorized dot products. */
+  class preview_queue
+  {
+    size_t capacity, head, length;
+    std::vector<double> px, py, pz;
+    std::vector< std::vector<hrp::Vector3> > qdata;
+  public:
+    preview_queue () : capacity(0), head(0), length(0) {};
+    void reserve (const size_t _capacity)
+    {
+      capacity = _capacity;
+      head = length = 0;
+      px.assign(2 * capacity, 0);
+      py.assign(2 * capacity, 0);
+      pz.assign(capacity, 0);
+      qdata.resize(capacity);
+    };
+    size_t size () const { return length; };
+    void clear () { head = length = 0; };
+    void push_back (const hrp::Vector3& pr, const std::vector<hrp::Vector3>& _qdata)
+    {
+      size_t i = (head + length) % capacity;
+      px[i] = px[i + capacity] = pr(0);
+      py[i] = py[i + capacity] = pr(1);
+      pz[i] = pr(2);
+      qdata[i] = _qdata; /* reuses the storage of the old element */
+      length++;
+    };
+    void pop_front ()
+    {
+      head = (head + 1) % capacity;
+      length--;
+    };
+    void pop_back () { length--; };
+    /* i-th element from the front */
+    double x (const size_t i) const { return px[head + i]; };
+    double y (const size_t i) const { return py[head + i]; };
+    double z (const size_t i) const { return pz[(head + i) % capacity]; };
+    const std::vector<hrp::Vector3>& q (const size_t i) const { return qdata[(head + i) % capacity]; };
+    /* x and y of size() elements from the front */
+    Eigen::Map<const hrp::dvector> x_segment () const { return Eigen::Map<const hrp::dvector>(&px[head], length); };
+    Eigen::Map<const hrp::dvector> y_segment () const { return Eigen::Map<const hrp::dvector>(&py[head], length); };
   };
 
   template <std::size_t dim>
@@ -58,9 +196,7 @@ namespace rats
     Eigen::Matrix<double, 3, 2> x_k;
     Eigen::Matrix<double, 1, 2> u_k;
     hrp::dvector f;
-    std::deque<Eigen::Matrix<double, 2, 1> > p;
-    std::deque<double> pz;
-    std::deque< std::vector<hrp::Vector3> > qdata;
+    preview_queue p;
     double zmp_z, cog_z;
     size_t delay, ending_count;
     virtual void calc_f() = 0;
@@ -82,7 +218,7 @@ namespace rats
     /* dt = [s], zc = [mm], d = [s] */
     preview_control_base(const double dt, const double zc,
                          const hrp::Vector3& init_xk, const double _gravitational_acceleration, const double d = 1.6)
-      : riccati(), x_k(Eigen::Matrix<double, 3, 2>::Zero()), u_k(Eigen::Matrix<double, 1, 2>::Zero()), p(), pz(), qdata(),
+      : riccati(), x_k(Eigen::Matrix<double, 3, 2>::Zero()), u_k(Eigen::Matrix<double, 1, 2>::Zero()), p(),
         zmp_z(0), cog_z(zc), delay(static_cast<size_t>(round(d / dt))), ending_count(1+delay)
     {
       tcA << 1, dt, 0.5 * dt * dt,
@@ -94,21 +230,20 @@ namespace rats
       tcc << 1.0, 0.0, -zc / _gravitational_acceleration;
       x_k(0,0) = init_xk(0);
       x_k(0,1) = init_xk(1);
+      /* one more element than the preview window is pushed before the oldest one is popped */
+      p.reserve(2 + delay);
     };
-    virtual ~preview_control_base()
-    {
-      p.clear();
-      pz.clear();
-      qdata.clear();
-    };
+    virtual ~preview_control_base() {};
     virtual void update_x_k(const hrp::Vector3& pr, const std::vector<hrp::Vector3>& qdata);
     virtual void update_x_k()
     {
       hrp::Vector3 pr;
-      pr(0) = p.back()(0);
-      pr(1) = p.back()(1);
-      pr(2) = pz.back();
-      update_x_k(pr, qdata.back());
+      size_t last = p.size() - 1;
+      pr(0) = p.x(last);
+      pr(1) = p.y(last);
+      pr(2) = p.z(last);
+      /* the last element is not overwritten by the push since the capacity exceeds the window */
+      update_x_k(pr, p.q(last));
       ending_count--;
     };
     // void update_zc(double zc);
@@ -136,40 +271,34 @@ namespace rats
       Eigen::Matrix<double, 1, 2> _p(tcc * x_k);
       ret[0] = _p(0, 0);
       ret[1] = _p(0, 1);
-      ret[2] = pz.front();
+      ret[2] = p.z(0);
     };
     void get_current_refzmp (double* ret)
     {
-      ret[0] = p.front()(0);
-      ret[1] = p.front()(1);
-      ret[2] = pz.front();
+      ret[0] = p.x(0);
+      ret[1] = p.y(0);
+      ret[2] = p.z(0);
     };
     void get_current_qdata (std::vector<hrp::Vector3>& _qdata)
     {
-        _qdata = qdata.front();
+        _qdata = p.q(0);
     };
     bool is_doing () { return p.size() >= 1 + delay; };
     bool is_end () { return ending_count <= 0 ; };
     void remove_preview_queue(const size_t remain_length)
     {
       size_t num = p.size() - remain_length;
-      for (size_t i = 0; i < num; i++) {
-        p.pop_back();
-        pz.pop_back();
-        qdata.pop_back();
-      }
+      for (size_t i = 0; i < num; i++) p.pop_back();
     };
     void remove_preview_queue() // Remove all queue
     {
         p.clear();
-        pz.clear();
-        qdata.clear();
     };
     void print_all_queue ()
     {
       std::cerr << "(list ";
       for (size_t i = 0; i < p.size(); i++) {
-        std::cerr << "#f(" << p[i](0) << " " << p[i](1) << ") ";
+        std::cerr << "#f(" << p.x(i) << " " << p.y(i) << ") ";
       }
       std::cerr << ")" << std::endl;
     }
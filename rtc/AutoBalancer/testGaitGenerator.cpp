@@ -5,6 +5,7 @@
 using namespace rats;
 #include <cstdio>
 #include <coil/stringutil.h>
+#include <sys/time.h>
 
 #define eps_eq(a,b,epsilon) (std::fabs((a)-(b)) < (epsilon))
 
@@ -354,6 +355,61 @@ private:
         plot_walk_pattern();
     }
 
+    void get_initial_steps (step_node& initial_support_leg_step, step_node& initial_swing_leg_dst_step)
+    {
+        std::vector<std::string> tmp_string_vector = boost::assign::list_of("rleg");
+        if (gg->get_footstep_front_leg_names() == tmp_string_vector) {
+            initial_support_leg_step = step_node(LLEG, coordinates(leg_pos[1]), 0, 0, 0, 0);
+            initial_swing_leg_dst_step = step_node(RLEG, coordinates(leg_pos[0]), 0, 0, 0, 0);
+        } else {
+            initial_support_leg_step = step_node(RLEG, coordinates(leg_pos[0]), 0, 0, 0, 0);
+            initial_swing_leg_dst_step = step_node(LLEG, coordinates(leg_pos[1]), 0, 0, 0, 0);
+        }
+    };
+
+    double get_time ()
+    {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return tv.tv_sec + tv.tv_usec * 1e-6;
+    };
+
+    // evaluate footsteps of gg offline by another gait_generator and compare it with the walking pattern of gg
+    bool evaluate_and_compare_walk_pattern(const std::string& name, const int loop)
+    {
+        step_node initial_support_leg_step = step_node(RLEG, coordinates(), 0, 0, 0, 0), initial_swing_leg_dst_step = initial_support_leg_step;
+        get_initial_steps(initial_support_leg_step, initial_swing_leg_dst_step);
+        gait_generator sim_gg(dt, leg_pos, all_limbs, 1e-3*150, 1e-3*50, 10, 1e-3*50);
+        sim_gg.copy_parameters(*gg);
+        std::vector< std::vector<step_node> > fnsl;
+        std::vector<step_node> fns;
+        for (size_t i = 0; gg->get_footstep_nodes_by_index(fns, i); i++) fnsl.push_back(fns);
+        fnsl.pop_back(); // finalize footstep is appended again
+        sim_gg.set_foot_steps_list(fnsl);
+        walking_pattern_evaluation eval;
+        double t0 = get_time();
+        for (int i = 0; i < loop; i++) {
+            sim_gg.evaluate_walking_pattern(eval, cog, boost::assign::list_of(initial_support_leg_step), boost::assign::list_of(initial_swing_leg_dst_step));
+        }
+        double t1 = get_time();
+        // the same pattern generated control cycle by control cycle
+        gg->initialize_gait_parameter(cog, boost::assign::list_of(initial_support_leg_step), boost::assign::list_of(initial_swing_leg_dst_step));
+        while ( !gg->proc_one_tick() );
+        size_t i = 0;
+        double max_cog_diff = 0;
+        while ( gg->proc_one_tick() ) {
+            if (i < eval.cog_list.size()) max_cog_diff = std::max(max_cog_diff, (hrp::Vector3(gg->get_cog()(0), gg->get_cog()(1), 0) - hrp::Vector3(eval.cog_list[i](0), eval.cog_list[i](1), 0)).norm());
+            i++;
+        }
+        bool ret = (i == eval.cog_list.size()) && max_cog_diff < 1e-9 &&
+            eval.zmp_error_violation_count == 0 && eval.refzmp_diff_violation_count == 0;
+        std::cerr << "[testGaitGenerator]   " << name << " : " << (fnsl.size()-1) << " steps, " << eval.walking_time << "[s] walking, "
+                  << (t1 - t0) / loop * 1e3 << "[ms] per evaluation, max zmp error = " << eval.max_zmp_error * 1e3
+                  << "[mm], max refzmp diff = " << eval.max_refzmp_diff * 1e3 << "[mm], max cog diff = " << max_cog_diff
+                  << "[m] " << (ret ? "OK" : "NG") << std::endl;
+        return ret;
+    };
+
     void gen_and_plot_walk_pattern()
     {
         std::vector<std::string> tmp_string_vector = boost::assign::list_of("rleg");
@@ -644,6 +700,47 @@ public:
     };
 
 
+    bool benchmark ()
+    {
+        parse_params();
+        int loop = 10;
+        for (unsigned int i = 0; i < arg_strs.size(); ++ i) {
+            if ( arg_strs[i]== "--loop" ) {
+                if (++i < arg_strs.size()) loop = atoi(arg_strs[i].c_str());
+            }
+        }
+        std::cerr << "[testGaitGenerator] benchmark : offline evaluation of walking patterns, " << loop << " loops" << std::endl;
+        bool ret = true;
+        {
+            std::vector< std::vector<step_node> > fnsl;
+            fnsl.push_back(boost::assign::list_of(step_node("rleg", coordinates(leg_pos[0]), gg->get_default_step_height(), gg->get_default_step_time(), gg->get_toe_angle(), gg->get_heel_angle())));
+            // the last step aligns feet
+            for (size_t i = 1; i <= 20; i++) {
+                fnsl.push_back(boost::assign::list_of(step_node(i%2==0?"rleg":"lleg", coordinates(hrp::Vector3(hrp::Vector3(150*1e-3*std::min(i, static_cast<size_t>(19)), 0, 0)+leg_pos[i%2])), gg->get_default_step_height(), gg->get_default_step_time(), gg->get_toe_angle(), gg->get_heel_angle())));
+            }
+            gg->set_foot_steps_list(fnsl);
+            ret = evaluate_and_compare_walk_pattern("20 steps forward", loop) && ret;
+        }
+        {
+            gg->clear_footstep_nodes_list();
+            coordinates start_ref_coords;
+            mid_coords(start_ref_coords, 0.5, coordinates(leg_pos[0]), coordinates(leg_pos[1]));
+            gg->go_pos_param_2_footstep_nodes_list(200*1e-3, 100*1e-3, 20, boost::assign::list_of(coordinates(leg_pos[0])), start_ref_coords, boost::assign::list_of(RLEG));
+            ret = evaluate_and_compare_walk_pattern("go pos x,y,th (test1)", loop) && ret;
+        }
+        {
+            gg->set_default_orbit_type(STAIR);
+            gg->set_swing_trajectory_delay_time_offset (0.2);
+            std::vector< std::vector<step_node> > fnsl;
+            for (size_t i = 0; i < 8; i++) {
+                fnsl.push_back(boost::assign::list_of(step_node(i%2==0?"rleg":"lleg", coordinates(hrp::Vector3(hrp::Vector3(250*1e-3*(i/2), 0, 200*1e-3*(i/2))+leg_pos[i%2])), gg->get_default_step_height(), gg->get_default_step_time(), gg->get_toe_angle(), gg->get_heel_angle())));
+            }
+            gg->set_foot_steps_list(fnsl);
+            ret = evaluate_and_compare_walk_pattern("stair walk (test9)", loop) && ret;
+        }
+        return ret;
+    };
+
     void parse_params ()
     {
       for (int i = 0; i < arg_strs.size(); ++ i) {
@@ -756,6 +853,7 @@ void print_usage ()
     std::cerr << "  --test12 : Change step param in set foot steps" << std::endl;
     std::cerr << "  --test13 : Arbitrary leg switching" << std::endl;
     std::cerr << "  --test14 : kick walk" << std::endl;
+    std::cerr << "  --benchmark [--loop n] : measure offline evaluation time of walking patterns and compare them with the tick-by-tick patterns" << std::endl;
 };
 
 int main(int argc, char* argv[])
@@ -796,6 +894,8 @@ int main(int argc, char* argv[])
           tgg.test13();
       } else if (std::string(argv[1]) == "--test14") {
           tgg.test14();
+      } else if (std::string(argv[1]) == "--benchmark") {
+          return (tgg.benchmark()?0:2);
       } else {
           print_usage();
           ret = 1;
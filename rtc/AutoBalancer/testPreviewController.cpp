@@ -13,14 +13,161 @@ struct gait_parameter /* for test */
 };
 
 #include<cstdio>
+#include<sys/time.h>
+
+static double get_time ()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/* the same system as extended_preview_control */
+static void riccati_system (const double dt, const double zc,
+                            Eigen::Matrix<double, 4, 4>& A, Eigen::Matrix<double, 4, 1>& b, Eigen::Matrix<double, 1, 4>& c)
+{
+  const double g = DEFAULT_GRAVITATIONAL_ACCELERATION;
+  Eigen::Matrix<double, 3, 3> tmpA;
+  tmpA << 1.0, dt, 0.5 * dt * dt, 0.0, 1.0, dt, 0.0, 0.0, 1.0;
+  Eigen::Matrix<double, 3, 1> tmpb;
+  tmpb << 1 / 6.0 * dt * dt * dt, 0.5 * dt * dt, dt;
+  Eigen::Matrix<double, 1, 3> tmpc;
+  tmpc << 1.0, 0.0, -zc / g;
+  A(0, 0) = 1.0;
+  A.block(0, 1, 1, 3) = tmpc * tmpA;
+  A.block(1, 0, 3, 1) = Eigen::Matrix<double, 3, 1>::Zero();
+  A.block(1, 1, 3, 3) = tmpA;
+  b(0, 0) = (tmpc * tmpb)(0, 0);
+  b.block(1, 0, 3, 1) = tmpb;
+  c << 1, 0, 0, 0;
+}
+
+static double relative_difference (const Eigen::Matrix<double, 1, 4>& K, const Eigen::Matrix<double, 1, 4>& K_ref)
+{
+  return ((K - K_ref).array().abs() / (1.0 + K_ref.array().abs())).maxCoeff();
+}
+
+/* gains given by the doubling algorithm and the cache are the same as the plain iteration */
+static bool test_riccati ()
+{
+  const double dt = 0.005, zcs[2] = {0.8, 0.6};
+  Eigen::Matrix<double, 4, 4> A;
+  Eigen::Matrix<double, 4, 1> b;
+  Eigen::Matrix<double, 1, 4> c;
+  Eigen::Matrix<double, 1, 4> K_ref[2];
+  double err = 0;
+  riccati_cache<4>::clear();
+  for (size_t k = 0; k < 2; k++) {
+    riccati_system(dt, zcs[k], A, b, c);
+    riccati_equation<4> iterative(A, b, c, 1.0, 1.0e-6), doubling(A, b, c, 1.0, 1.0e-6), cached(A, b, c, 1.0, 1.0e-6);
+    iterative.P = Eigen::Matrix<double, 4, 4>::Zero();
+    if (!iterative.solve_by_iteration() || !doubling.solve() || !cached.solve()) return false;
+    K_ref[k] = iterative.K;
+    err = std::max(err, std::max(relative_difference(doubling.K, K_ref[k]), relative_difference(cached.K, K_ref[k])));
+  }
+  /* the entry of the first system is returned after the second one is added */
+  riccati_system(dt, zcs[0], A, b, c);
+  riccati_equation<4> cached(A, b, c, 1.0, 1.0e-6);
+  if (!cached.solve()) return false;
+  err = std::max(err, relative_difference(cached.K, K_ref[0]));
+  /* a preview controller with a short delay gives the same cog with and without the cache */
+  double refcog[2][3];
+  for (size_t k = 0; k < 2; k++) {
+    if (k == 0) riccati_cache<4>::clear();
+    extended_preview_control epc(dt, zcs[0], hrp::Vector3::Zero(), DEFAULT_GRAVITATIONAL_ACCELERATION, 1.0, 1.0e-6, 0.2);
+    std::vector<hrp::Vector3> qdata(2, hrp::Vector3::Zero());
+    hrp::Vector3 pr(hrp::Vector3::Zero());
+    for (size_t i = 0; i < 400; i++) {
+      pr(1) = ((static_cast<size_t>(i * dt / 0.8) % 2) ? 0.1 : -0.1);
+      qdata[0](1) = pr(1);
+      epc.update_x_k(pr, qdata);
+    }
+    epc.get_refcog(refcog[k]);
+  }
+  std::cerr << "relative difference of gains : " << err << ", cog with and without cache : "
+            << refcog[0][1] << " " << refcog[1][1] << std::endl;
+  return err < 1e-6 && fabs(refcog[0][1] - refcog[1][1]) < 1e-9;
+}
+
+/* compare the doubling algorithm and the cache with the plain iteration in solving riccati equation */
+static bool benchmark_riccati ()
+{
+  const double dt = 0.005, zc = 0.8;
+  const int n = 20;
+  Eigen::Matrix<double, 4, 4> A;
+  Eigen::Matrix<double, 4, 1> b;
+  Eigen::Matrix<double, 1, 4> c;
+  riccati_system(dt, zc, A, b, c);
+
+  riccati_equation<4> iterative(A, b, c, 1.0, 1.0e-6), doubling(A, b, c, 1.0, 1.0e-6);
+  double t0 = get_time();
+  for (int i = 0; i < n; i++) {
+    iterative.P = Eigen::Matrix<double, 4, 4>::Zero();
+    iterative.solve_by_iteration();
+  }
+  double t1 = get_time();
+  for (int i = 0; i < n; i++) {
+    riccati_cache<4>::clear();
+    doubling.solve();
+  }
+  double t2 = get_time();
+  for (int i = 0; i < n; i++) doubling.solve();
+  double t3 = get_time();
+  riccati_cache<4>::clear();
+  for (int i = 0; i < n; i++) {
+    riccati_cache<4>::clear();
+    extended_preview_control epc(dt, zc, hrp::Vector3::Zero());
+  }
+  double t4 = get_time();
+  for (int i = 0; i < n; i++) extended_preview_control epc(dt, zc, hrp::Vector3::Zero());
+  double t5 = get_time();
+  std::cerr << "riccati equation [ms] : iteration " << (t1 - t0) * 1e3 / n
+            << ", doubling " << (t2 - t1) * 1e3 / n
+            << ", cached " << (t3 - t2) * 1e3 / n << std::endl;
+  std::cerr << "extended_preview_control [ms] : uncached " << (t4 - t3) * 1e3 / n
+            << ", cached " << (t5 - t4) * 1e3 / n << std::endl;
+  double err = ((iterative.K - doubling.K).array().abs() / (1.0 + iterative.K.array().abs())).maxCoeff();
+  std::cerr << "relative difference of gains : " << err << std::endl;
+  return err < 1e-6;
+}
+
+/* time of one tick of extended_preview_control with long preview windows */
+static bool benchmark_update ()
+{
+  const double dts[2] = {0.005, 0.002};
+  const size_t n = 20000;
+  std::vector<hrp::Vector3> qdata(2, hrp::Vector3::Zero());
+  for (size_t k = 0; k < 2; k++) {
+    extended_preview_control epc(dts[k], 0.8, hrp::Vector3::Zero());
+    hrp::Vector3 pr(hrp::Vector3::Zero());
+    double t0 = get_time();
+    for (size_t i = 0; i < n; i++) {
+      /* zmp moving between feet every 0.8[s] */
+      pr(1) = ((static_cast<size_t>(i * dts[k] / 0.8) % 2) ? 0.1 : -0.1);
+      qdata[0](1) = pr(1);
+      epc.update_x_k(pr, qdata);
+    }
+    double t1 = get_time();
+    double refcog[3];
+    epc.get_refcog(refcog);
+    std::cerr << "extended_preview_control [us/tick] : dt = " << dts[k] << ", delay = " << epc.get_delay()
+              << ", " << (t1 - t0) * 1e6 / n << std::endl;
+    if (!(fabs(refcog[1]) < 0.1)) return false;
+  }
+  return true;
+}
 
 int main(int argc, char* argv[])
 {
   /* this is c++ version example of test-preview-filter1-modified in euslib/jsk/preview.l*/
   bool use_gnuplot = true;
-  if (argc >= 2) {
-      if ( std::string(argv[1])== "--use-gnuplot" ) {
-          use_gnuplot = (std::string(argv[2])=="true");
+  for (int i = 1; i < argc; ++ i) {
+      if ( std::string(argv[i])== "--use-gnuplot" ) {
+          if (++i < argc) use_gnuplot = (std::string(argv[i])=="true");
+      } else if ( std::string(argv[i])== "--test-riccati" ) {
+          if (!test_riccati()) return 1;
+      } else if ( std::string(argv[i])== "--benchmark" ) {
+          if (!benchmark_riccati() || !benchmark_update()) return 1;
       }
   }
 
@@ -63,6 +63,7 @@ CollisionDetector::CollisionDetector(RTC::Manager* manager)
       m_glbody(NULL),
 #endif // USE_HRPSYSUTIL
       m_use_viewer(false),
+      m_use_broad_phase(true),
       m_robot(hrp::BodyPtr()),
 #ifdef USE_HRPSYSUTIL
       m_scene(&m_log),
@@ -205,6 +206,10 @@ RTC::ReturnCode_t CollisionDetector::onInitialize()
         coil::stringTo(m_collision_loop, prop["collision_loop"].c_str());
         std::cerr << "[" << m_profile.instance_name << "] set collision_loop: " << m_collision_loop << std::endl;
     }
+    if ( prop["collision_broad_phase"] != "" ) {
+        m_use_broad_phase = (prop["collision_broad_phase"] == "true");
+        std::cerr << "[" << m_profile.instance_name << "] set collision_broad_phase: " << (m_use_broad_phase?"true":"false") << std::endl;
+    }
 #ifdef USE_HRPSYSUTIL
     if ( m_use_viewer ) {
       m_scene.addBody(m_robot);
@@ -380,6 +385,7 @@ RTC::ReturnCode_t CollisionDetector::onExecute(RTC::UniqueId ec_id)
         //collision check process in case of angle set above
 	m_robot->calcForwardKinematics();
 	coil::TimeValue tm1 = coil::gettimeofday();
+        int culled = 0;
         std::map<std::string, CollisionLinkPair *>::iterator it = m_pair.begin();
 	for (unsigned int i = 0; it != m_pair.end(); it++, i++){
             int sub_size = (m_pair.size() + m_collision_loop -1) / m_collision_loop;  // 10 / 3 = 3  / floor
@@ -388,8 +394,7 @@ RTC::ReturnCode_t CollisionDetector::onExecute(RTC::UniqueId ec_id)
             // k : sub_size*k ... sub_size*(k+1)-1            // 6 .. 8
             // n : sub_size*n ... m_pair.size()               // 9 .. 10
             if ( sub_size*m_loop_for_check <= i && i < sub_size*(m_loop_for_check+1) ) {
-                CollisionLinkPair* c = it->second;
-                c->distance = c->pair->computeDistance(c->point0.data(), c->point1.data());
+                if ( computeDistance(it->second) ) culled++;
                 //std::cerr << i << ":" << (c->distance<=c->pair->getTolerance() ) << " ";
             }
         }
@@ -503,7 +508,7 @@ RTC::ReturnCode_t CollisionDetector::onExecute(RTC::UniqueId ec_id)
         }
         if ( DEBUGP ) {
           std::cerr << "[" << m_profile.instance_name << "] check collisions for " << m_pair.size() << " pairs in " << (tm2.sec()-tm1.sec())*1000+(tm2.usec()-tm1.usec())/1000.0 
-                    << " [msec], safe = " << m_safe_posture << ", time = " << m_recover_time*m_dt << "[s], loop = " << m_loop_for_check << "/" << m_collision_loop << std::endl;
+                    << " [msec] (" << culled << " culled), safe = " << m_safe_posture << ", time = " << m_recover_time*m_dt << "[s], loop = " << m_loop_for_check << "/" << m_collision_loop << std::endl;
         }
         if ( m_pair.size() == 0 && ( DEBUGP || (loop % ((int)(5/m_dt))) == 1) ) {
             std::cerr << "[" << m_profile.instance_name << "] CAUTION!! The robot is moving without checking self collision detection!!! please define collision_pair in configuration file" << std::endl;
@@ -640,6 +645,21 @@ bool CollisionDetector::getCollisionStatus(OpenHRP::CollisionDetectorService::Co
     return true;
 }
 
+bool CollisionDetector::computeDistance(CollisionLinkPair *c)
+{
+    if ( m_use_broad_phase ) {
+        // the bound is computed from the current posture, so a pair whose
+        // bound exceeds the tolerance is never in collision in this posture
+        double bound = c->pair->computeDistanceLowerBound(c->point0.data(), c->point1.data());
+        if ( bound > c->pair->getTolerance() ) {
+            c->distance = bound;
+            return true;
+        }
+    }
+    c->distance = c->pair->computeDistance(c->point0.data(), c->point1.data());
+    return false;
+}
+
 void CollisionDetector::setupVClipModel(hrp::BodyPtr i_body)
 {
     m_VclipLinks.resize(i_body->numLinks());
@@ -681,7 +701,7 @@ bool CollisionDetector::enable(void)
     for (unsigned int i = 0; it != m_pair.end(); it++, i++){
         CollisionLinkPair* c = it->second;
         VclipLinkPairPtr p = c->pair;
-        c->distance = c->pair->computeDistance(c->point0.data(), c->point1.data());
+        computeDistance(c);
         if ( c->distance <= c->pair->getTolerance() ) {
             hrp::JointPathPtr jointPath = m_robot->getJointPath(p->link(0),p->link(1));
             std::cerr << "[" << m_profile.instance_name << "] CollisionDetector cannot be enabled because of collision" << std::endl;
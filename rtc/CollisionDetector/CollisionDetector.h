@@ -179,9 +179,16 @@ class CollisionDetector
   std::vector<int> m_curr_collision_mask, m_init_collision_mask;
   bool m_use_limb_collision;
   bool m_use_viewer;
+  bool m_use_broad_phase;
   hrp::BodyPtr m_robot;
   std::map<std::string, CollisionLinkPair *> m_pair;
   int m_loop_for_check, m_collision_loop;
+  /**
+     \brief compute the distance of a pair. V-Clip is skipped if bounding
+     spheres of links are farther apart than the tolerance.
+     \return true if V-Clip is skipped
+   */
+  bool computeDistance(CollisionLinkPair *c);
   bool m_safe_posture;
   int m_recover_time;
   double m_dt;
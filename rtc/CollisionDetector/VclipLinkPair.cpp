@@ -1,4 +1,27 @@
 #include "VclipLinkPair.h"
+#include <algorithm>
+
+static void computeBoundingSphere(const Vclip::Polyhedron *model, hrp::Vector3& center, double& radius)
+{
+    const std::list<Vclip::Vertex>& verts = model->verts();
+    hrp::Vector3 lower, upper;
+    lower.fill(0); upper.fill(0);
+    for (std::list<Vclip::Vertex>::const_iterator it = verts.begin(); it != verts.end(); it++){
+        hrp::Vector3 v(it->coords().x, it->coords().y, it->coords().z);
+        if (it == verts.begin()){
+            lower = upper = v;
+        }else{
+            lower = lower.cwiseMin(v);
+            upper = upper.cwiseMax(v);
+        }
+    }
+    center = (lower + upper)/2;
+    radius = 0;
+    for (std::list<Vclip::Vertex>::const_iterator it = verts.begin(); it != verts.end(); it++){
+        hrp::Vector3 v(it->coords().x, it->coords().y, it->coords().z);
+        radius = std::max(radius, (v - center).norm());
+    }
+}
 
 VclipLinkPair::VclipLinkPair(hrp::Link* link0, Vclip::Polyhedron* vclip_model0, hrp::Link* link1, Vclip::Polyhedron* vclip_model1, double tolerance)
 {
@@ -9,6 +32,8 @@ VclipLinkPair::VclipLinkPair(hrp::Link* link0, Vclip::Polyhedron* vclip_model0,
     tolerance_ = tolerance;
     Feature_Pair.first  = (const Vclip::Feature *)new Vclip::Vertex(Vclip_Model1->verts().front());
     Feature_Pair.second = (const Vclip::Feature *)new Vclip::Vertex(Vclip_Model2->verts().front());
+    computeBoundingSphere(Vclip_Model1, centers_[0], radii_[0]);
+    computeBoundingSphere(Vclip_Model2, centers_[1], radii_[1]);
 }
 VclipLinkPair::~VclipLinkPair()
 {
@@ -58,4 +83,15 @@ double VclipLinkPair::computeDistance(double *q1, double *q2)
     return len;
 }
 
-
+double VclipLinkPair::computeDistanceLowerBound(double *q1, double *q2)
+{
+    hrp::Vector3 c1(links_[0]->p + links_[0]->attitude()*centers_[0]);
+    hrp::Vector3 c2(links_[1]->p + links_[1]->attitude()*centers_[1]);
+    hrp::Vector3 d(c2 - c1);
+    double len = d.norm();
+    if (len > 0) d /= len;
+    hrp::Vector3 p1(c1 + radii_[0]*d), p2(c2 - radii_[1]*d);
+    q1[0] = p1(0); q1[1] = p1(1); q1[2] = p1(2);
+    q2[0] = p2(0); q2[1] = p2(1); q2[2] = p2(2);
+    return len - radii_[0] - radii_[1];
+}
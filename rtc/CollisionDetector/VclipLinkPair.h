@@ -7,6 +7,14 @@ public:
     ~VclipLinkPair();
     bool checkCollision();
     double computeDistance(double *q1, double *q2);
+    /**
+       \brief compute a lower bound of the distance from bounding spheres of links.
+       It is much cheaper than computeDistance().
+       \param q1 point on the bounding sphere of link0 nearest to link1
+       \param q2 point on the bounding sphere of link1 nearest to link0
+       \return lower bound of the distance, negative if spheres overlap
+     */
+    double computeDistanceLowerBound(double *q1, double *q2);
     hrp::Link* link(int index) { return links_[index]; }
     double getTolerance() { return tolerance_; }
     void setTolerance(double t) { tolerance_ = t; }
@@ -16,6 +24,9 @@ private:
     Vclip::Polyhedron *Vclip_Model1, *Vclip_Model2;
     Vclip::FeaturePair Feature_Pair;
     double tolerance_;
+    // bounding spheres in the link frames
+    hrp::Vector3 centers_[2];
+    double radii_[2];
 };
 
 typedef boost::intrusive_ptr<VclipLinkPair> VclipLinkPairPtr;
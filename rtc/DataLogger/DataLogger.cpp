@@ -7,6 +7,7 @@
  * $Id$
  */
 
+#include <algorithm>
 #include "DataLogger.h"
 #include "util/Hrpsys.h"
 #include "pointcloud.hh"
@@ -87,6 +88,54 @@ void printData(std::ostream& os, const PointCloudTypes::PointCloud& data)
   }
 } 
 
+// flatten data into an array of doubles for the binary log
+unsigned int dataLength(const RTC::Acceleration3D& data) { return 3; }
+void copyData(const RTC::Acceleration3D& data, double *o)
+{
+    o[0] = data.ax; o[1] = data.ay; o[2] = data.az;
+}
+
+unsigned int dataLength(const RTC::Velocity2D& data) { return 3; }
+void copyData(const RTC::Velocity2D& data, double *o)
+{
+    o[0] = data.vx; o[1] = data.vy; o[2] = data.va;
+}
+
+unsigned int dataLength(const RTC::Pose3D& data) { return 6; }
+void copyData(const RTC::Pose3D& data, double *o)
+{
+    o[0] = data.position.x; o[1] = data.position.y; o[2] = data.position.z;
+    o[3] = data.orientation.r; o[4] = data.orientation.p; o[5] = data.orientation.y;
+}
+
+unsigned int dataLength(const RTC::AngularVelocity3D& data) { return 3; }
+void copyData(const RTC::AngularVelocity3D& data, double *o)
+{
+    o[0] = data.avx; o[1] = data.avy; o[2] = data.avz;
+}
+
+unsigned int dataLength(const RTC::Point3D& data) { return 3; }
+void copyData(const RTC::Point3D& data, double *o)
+{
+    o[0] = data.x; o[1] = data.y; o[2] = data.z;
+}
+
+unsigned int dataLength(const RTC::Orientation3D& data) { return 3; }
+void copyData(const RTC::Orientation3D& data, double *o)
+{
+    o[0] = data.r; o[1] = data.p; o[2] = data.y;
+}
+
+template <class T>
+unsigned int dataLength(const T& data) { return data.length(); }
+template <class T>
+void copyData(const T& data, double *o)
+{
+    for (unsigned int j=0; j<data.length(); j++){
+        o[j] = data[j];
+    }
+}
+
 template<class T>
 std::ostream& operator<<(std::ostream& os, const _CORBA_Unbounded_Sequence<T > & data)
 {
@@ -104,11 +153,114 @@ void printData(std::ostream& os, const T& data)
     }
 }
 
+/**
+   logger port which keeps flat double values of samples in a ring buffer
+ */
 template <class T>
 class LoggerPort : public LoggerPortBase
 {
 public:
-    LoggerPort(const char *name) : m_port(name, m_data) {}
+    LoggerPort(const char *name) : m_port(name, m_data), m_ring(m_maxLength),
+                                   m_front(0), m_recording(false) {}
+    const char *name(){
+        return m_port.name();
+    }
+    virtual void dumpLog(std::ostream& os){
+        os.setf(std::ios::fixed, std::ios::floatfield);
+        os << std::setprecision(6);
+        LogElementKind kind = logElementKind(m_typeName);
+        for (unsigned int i=0; i<m_ring.size(); i++){
+            printTextSample(os, m_ring.time(i), m_ring.values(i), m_ring.length(i), kind);
+        }
+    }
+    virtual bool snapshot(LogColumns& o_log){
+        toColumns(m_ring, o_log);
+        return true;
+    }
+    InPort<T>& port(){
+            return m_port;
+    }
+    void log(){
+        if (m_port.isNew()){
+            m_port.read();
+            double tm = m_data.tm.sec + m_data.tm.nsec/1e9;
+            unsigned int len = dataLength(m_data.data);
+            double *values = m_ring.push(tm, len);
+            if (values) copyData(m_data.data, values);
+            if (m_recording){
+                values = m_record[m_front].push(tm, len);
+                if (values) copyData(m_data.data, values);
+            }
+        }
+    }
+    void clear(){
+        m_ring.clear();
+    }
+    void maxLength(unsigned int len){
+        LoggerPortBase::maxLength(len);
+        m_ring.resize(len);
+    }
+    void startRecording(unsigned int length){
+        for (int i=0; i<2; i++){
+            m_record[i].clear();
+            m_record[i].resize(length);
+            m_record[i].reserve(m_ring.stride());
+        }
+        m_front = 0;
+        m_recording = true;
+    }
+    void stopRecording(){
+        m_recording = false;
+        for (int i=0; i<2; i++) m_record[i].resize(0);
+    }
+    bool isRecordBufferFull(){
+        return m_recording && m_record[m_front].size() == m_record[m_front].capacity();
+    }
+    void swapRecordBuffers(){
+        m_front = 1 - m_front;
+    }
+    bool takeRecord(LogColumns& o_log){
+        if (!m_recording) return false;
+        LogRing& back = m_record[1 - m_front];
+        toColumns(back, o_log);
+        back.clear();
+        return true;
+    }
+protected:
+    void toColumns(const LogRing& ring, LogColumns& o_log){
+        o_log.name = name();
+        o_log.type = m_typeName;
+        unsigned int n = ring.size(), m = ring.stride();
+        o_log.n_elements = m;
+        o_log.times.resize(n);
+        o_log.lengths.resize(n);
+        // shorter samples are padded with 0
+        o_log.values.assign(n*m, 0);
+        for (unsigned int i=0; i<n; i++){
+            o_log.times[i] = ring.time(i);
+            o_log.lengths[i] = ring.length(i);
+            const double *values = ring.values(i);
+            for (unsigned int j=0; j<ring.length(i); j++){
+                o_log.values[j*n+i] = values[j];
+            }
+        }
+    }
+    InPort<T> m_port;
+    T m_data;
+    LogRing m_ring;
+    LogRing m_record[2]; // double buffer for recording
+    int m_front;         // index of the buffer being filled
+    bool m_recording;
+};
+
+/**
+   logger port which keeps samples whose size varies widely as they are
+ */
+template <class T>
+class VariableLoggerPort : public LoggerPortBase
+{
+public:
+    VariableLoggerPort(const char *name) : m_port(name, m_data) {}
     const char *name(){
         return m_port.name();
     }
@@ -122,6 +274,9 @@ public:
             os << std::endl;
         }
     }
+    virtual bool snapshot(LogColumns& o_log){
+        return false;
+    }
     InPort<T>& port(){
             return m_port;
     }
@@ -143,10 +298,10 @@ protected:
     std::deque<T> m_log;
 };
 
-class LoggerPortForPointCloud : public LoggerPort<PointCloudTypes::PointCloud>
+class LoggerPortForPointCloud : public VariableLoggerPort<PointCloudTypes::PointCloud>
 {
 public:
-    LoggerPortForPointCloud(const char *name) : LoggerPort<PointCloudTypes::PointCloud>(name) {}
+    LoggerPortForPointCloud(const char *name) : VariableLoggerPort<PointCloudTypes::PointCloud>(name) {}
     void dumpLog(std::ostream& os){
         os.setf(std::ios::fixed, std::ios::floatfield);
         for (unsigned int i=0; i<m_log.size(); i++){
@@ -174,6 +329,8 @@ DataLogger::DataLogger(RTC::Manager* manager)
 
 DataLogger::~DataLogger()
 {
+  m_recorder.stop();
+  m_writer.stop();
 }
 
 
@@ -202,6 +359,8 @@ RTC::ReturnCode_t DataLogger::onInitialize()
   
   // </rtc-template>
 
+  m_writer.start();
+
   return RTC::RTC_OK;
 }
 
@@ -253,6 +412,10 @@ RTC::ReturnCode_t DataLogger::onExecute(RTC::UniqueId ec_id)
         std::cout << "received emergency signal. saving log files("
                   << basename << ")" << std::endl;
         save(basename);
+        if (m_recorder.isRecording()){
+            // samples which are not written yet are written by the recorder thread
+            m_recorder.requestFlush();
+        }
         while (m_emergencySignalIn.isNew()){
             m_emergencySignalIn.read();
         }
@@ -265,6 +428,7 @@ RTC::ReturnCode_t DataLogger::onExecute(RTC::UniqueId ec_id)
     for (unsigned int i=0; i<m_ports.size(); i++){
       m_ports[i]->log();
     }
+    m_recorder.update();
   }
   return RTC::RTC_OK;
 }
@@ -339,7 +503,7 @@ bool DataLogger::add(const char *i_type, const char *i_name)
           return false;
       }
   }else if (strcmp(i_type, "TimedLongSeqSeq")==0){
-      LoggerPort<OpenHRP::TimedLongSeqSeq> *lp = new LoggerPort<OpenHRP::TimedLongSeqSeq>(i_name);
+      VariableLoggerPort<OpenHRP::TimedLongSeqSeq> *lp = new VariableLoggerPort<OpenHRP::TimedLongSeqSeq>(i_name);
       new_port = lp;
       if (!addInPort(i_name, lp->port())) {
           resumeLogging();
@@ -388,7 +552,7 @@ bool DataLogger::add(const char *i_type, const char *i_name)
           return false;
       }
   }else if (strcmp(i_type, "PointCloud")==0){
-    LoggerPort<PointCloudTypes::PointCloud> *lp = new LoggerPortForPointCloud(i_name);
+    VariableLoggerPort<PointCloudTypes::PointCloud> *lp = new LoggerPortForPointCloud(i_name);
       new_port = lp;
       if (!addInPort(i_name, lp->port())) {
           resumeLogging();
@@ -400,6 +564,12 @@ bool DataLogger::add(const char *i_type, const char *i_name)
       resumeLogging();
       return false;
   }
+  new_port->typeName(i_type);
+  if (m_recorder.isRecording()){
+    // the recorder thread must not access m_ports while it is modified
+    m_recorder.flush();
+    new_port->startRecording(DEFAULT_RECORD_BUFFER_LENGTH);
+  }
   m_ports.push_back(new_port);
   resumeLogging();
   return true;
@@ -426,6 +596,58 @@ bool DataLogger::save(const char *i_basename)
   return ret;
 }
 
+bool DataLogger::saveBinary(const char *i_basename)
+{
+  suspendLogging();
+  bool ret = true;
+  std::vector<LogColumns> *logs = new std::vector<LogColumns>;
+  for (unsigned int i=0; i<m_ports.size(); i++){
+    logs->push_back(LogColumns());
+    if (!m_ports[i]->snapshot(logs->back())){
+      // data types which can't be stored in columnar layout are saved in the text format
+      logs->pop_back();
+      std::string fname = i_basename;
+      fname.append(".");
+      fname.append(m_ports[i]->name());
+      std::ofstream ofs(fname.c_str());
+      if (ofs.is_open()){
+        m_ports[i]->dumpLog(ofs);
+      }else{
+        std::cerr << "[" << m_profile.instance_name << "] failed to open(" << fname << ")" << std::endl;
+        ret = false;
+      }
+    }
+  }
+  resumeLogging();
+  std::string fname = i_basename;
+  fname.append(HRPLOG_SUFFIX);
+  m_writer.request(fname, logs);
+  return ret;
+}
+
+bool DataLogger::startRecording(const char *i_basename, unsigned long i_maxFileSize, unsigned int i_maxFiles)
+{
+  suspendLogging();
+  bool ret = m_recorder.start(&m_ports, i_basename, i_maxFileSize, i_maxFiles);
+  resumeLogging();
+  if (ret){
+    std::cerr << "[" << m_profile.instance_name << "] Start recording to " << i_basename << "-*" << HRPLOG_SUFFIX << std::endl;
+  }else{
+    std::cerr << "[" << m_profile.instance_name << "] Already recording" << std::endl;
+  }
+  return ret;
+}
+
+bool DataLogger::stopRecording()
+{
+  if (!m_recorder.isRecording()) return false;
+  suspendLogging();
+  m_recorder.stop();
+  resumeLogging();
+  std::cerr << "[" << m_profile.instance_name << "] Stop recording" << std::endl;
+  return true;
+}
+
 bool DataLogger::clear()
 {
   suspendLogging();
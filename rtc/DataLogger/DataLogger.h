@@ -21,6 +21,10 @@
 #include <rtm/idl/BasicDataTypeSkel.h>
 #include <rtm/idl/ExtendedDataTypesSkel.h>
 #include "HRPDataTypes.hh"
+#include "LogFormat.h"
+#include "LogWriter.h"
+#include "LogRing.h"
+#include "LogRecorder.h"
 
 // Service implementation headers
 // <rtc-template block="service_impl_h">
@@ -45,9 +49,36 @@ public:
     virtual void clear() = 0;
     virtual void dumpLog(std::ostream& os) = 0;
     virtual void log() = 0;
-    void maxLength(unsigned int len) { m_maxLength = len; }
+    /**
+       \brief copy logged data into columnar layout
+       \return false if the data type can't be stored in columnar layout
+     */
+    virtual bool snapshot(LogColumns& o_log) = 0;
+    virtual void maxLength(unsigned int len) { m_maxLength = len; }
+    /**
+       \brief allocate double buffers for recording
+       \param length the number of samples of a buffer
+     */
+    virtual void startRecording(unsigned int length) {}
+    virtual void stopRecording() {}
+    /**
+       \brief check if the buffer being filled is full
+     */
+    virtual bool isRecordBufferFull() { return false; }
+    /**
+       \brief swap the buffer being filled and the buffer being written
+     */
+    virtual void swapRecordBuffers() {}
+    /**
+       \brief move samples in the buffer being written into columnar layout
+       \return false if the port is not recorded
+     */
+    virtual bool takeRecord(LogColumns& o_log) { return false; }
+    void typeName(const char *i_type) { m_typeName = i_type; }
+    const std::string& typeName() { return m_typeName; }
 protected:
     unsigned int m_maxLength;
+    std::string m_typeName;
 };
 
 /**
@@ -116,6 +147,9 @@ class DataLogger
   // virtual RTC::ReturnCode_t onRateChanged(RTC::UniqueId ec_id);
   bool add(const char *i_type, const char *i_name);
   bool save(const char *i_basename);
+  bool saveBinary(const char *i_basename);
+  bool startRecording(const char *i_basename, unsigned long i_maxFileSize, unsigned int i_maxFiles);
+  bool stopRecording();
   bool clear();
   void suspendLogging();
   void resumeLogging();
@@ -162,6 +196,8 @@ class DataLogger
  private:
   bool m_suspendFlag;
   coil::Mutex m_suspendFlagMutex;
+  LogWriter m_writer;
+  LogRecorder m_recorder;
   int dummy;
 };
 
@@ -0,0 +1,51 @@
+// -*- C++ -*-
+/*!
+ * @file  DataLoggerConvert.cpp
+ * @brief convert a binary log file into the text log files
+ * $Date$
+ *
+ * $Id$
+ */
+
+#include <fstream>
+#include <iostream>
+#include "LogFormat.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2){
+        std::cerr << "usage: " << argv[0] << " basename" << HRPLOG_SUFFIX
+                  << " [output_basename]" << std::endl;
+        return 1;
+    }
+    std::string input(argv[1]), basename;
+    if (argc >= 3){
+        basename = argv[2];
+    }else{
+        basename = input;
+        std::string suffix(HRPLOG_SUFFIX);
+        if (basename.size() > suffix.size()
+            && basename.compare(basename.size() - suffix.size(), suffix.size(), suffix) == 0){
+            basename.erase(basename.size() - suffix.size());
+        }
+    }
+
+    std::vector<LogColumns> logs;
+    if (!readBinaryLog(input, logs)){
+        std::cerr << "failed to read " << input << std::endl;
+        return 1;
+    }
+    int ret = 0;
+    for (unsigned int i=0; i<logs.size(); i++){
+        std::string fname = basename + "." + logs[i].name;
+        std::ofstream ofs(fname.c_str());
+        if (!ofs.is_open()){
+            std::cerr << "failed to open(" << fname << ")" << std::endl;
+            ret = 1;
+            continue;
+        }
+        printTextLog(ofs, logs[i]);
+        std::cout << fname << " (" << logs[i].times.size() << " samples)" << std::endl;
+    }
+    return ret;
+}
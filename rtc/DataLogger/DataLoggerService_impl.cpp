@@ -19,6 +19,21 @@ CORBA::Boolean DataLoggerService_impl::save(const char *basename)
   return m_logger->save(basename);
 }
 
+CORBA::Boolean DataLoggerService_impl::saveBinary(const char *basename)
+{
+  return m_logger->saveBinary(basename);
+}
+
+CORBA::Boolean DataLoggerService_impl::startRecording(const char *basename, CORBA::ULong maxFileSize, CORBA::ULong maxFiles)
+{
+  return m_logger->startRecording(basename, maxFileSize, maxFiles);
+}
+
+CORBA::Boolean DataLoggerService_impl::stopRecording()
+{
+  return m_logger->stopRecording();
+}
+
 CORBA::Boolean DataLoggerService_impl::clear()
 {
   return m_logger->clear();
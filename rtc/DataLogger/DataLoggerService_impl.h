@@ -19,6 +19,9 @@ public:
 
   CORBA::Boolean add(const char *type, const char *name);
   CORBA::Boolean save(const char *basename);
+  CORBA::Boolean saveBinary(const char *basename);
+  CORBA::Boolean startRecording(const char *basename, CORBA::ULong maxFileSize, CORBA::ULong maxFiles);
+  CORBA::Boolean stopRecording();
   CORBA::Boolean clear();
   void maxLength(CORBA::ULong len);
 private:
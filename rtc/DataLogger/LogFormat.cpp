@@ -0,0 +1,223 @@
+// -*- C++ -*-
+/*!
+ * @file  LogFormat.cpp
+ * @brief binary columnar log format of DataLogger
+ * $Date$
+ *
+ * $Id$
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <algorithm>
+#include <stdint.h>
+#include "LogFormat.h"
+
+static void writeString(FILE *fp, const std::string& str)
+{
+    uint32_t len = str.size();
+    fwrite(&len, sizeof(len), 1, fp);
+    fwrite(str.c_str(), 1, len, fp);
+}
+
+static bool readString(FILE *fp, std::string& str)
+{
+    uint32_t len;
+    if (fread(&len, sizeof(len), 1, fp) != 1) return false;
+    str.resize(len);
+    return len == 0 || fread(&str[0], 1, len, fp) == len;
+}
+
+size_t binaryLogSegmentSize(const std::vector<LogColumns>& logs)
+{
+    size_t size = 8 + sizeof(uint32_t);
+    for (unsigned int i=0; i<logs.size(); i++){
+        size += 4*sizeof(uint32_t) + logs[i].name.size() + logs[i].type.size();
+        size += sizeof(double)*(logs[i].times.size() + logs[i].values.size());
+        size += sizeof(uint32_t)*logs[i].lengths.size();
+    }
+    return size;
+}
+
+bool writeBinaryLogSegment(FILE *fp, const std::vector<LogColumns>& logs)
+{
+    fwrite(HRPLOG_MAGIC, 1, 8, fp);
+    uint32_t n = logs.size();
+    fwrite(&n, sizeof(n), 1, fp);
+    for (unsigned int i=0; i<logs.size(); i++){
+        writeString(fp, logs[i].name);
+        writeString(fp, logs[i].type);
+        uint32_t header[2] = {logs[i].n_elements, (uint32_t)logs[i].times.size()};
+        fwrite(header, sizeof(uint32_t), 2, fp);
+    }
+    for (unsigned int i=0; i<logs.size(); i++){
+        const LogColumns& log = logs[i];
+        if (log.times.empty()) continue;
+        fwrite(&log.times[0], sizeof(double), log.times.size(), fp);
+        std::vector<uint32_t> lengths(log.lengths.begin(), log.lengths.end());
+        fwrite(&lengths[0], sizeof(uint32_t), lengths.size(), fp);
+        if (!log.values.empty()) fwrite(&log.values[0], sizeof(double), log.values.size(), fp);
+    }
+    return ferror(fp) == 0;
+}
+
+bool writeBinaryLog(const std::string& filename, const std::vector<LogColumns>& logs)
+{
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (!fp) return false;
+    bool ret = writeBinaryLogSegment(fp, logs);
+    if (fclose(fp) != 0) ret = false;
+    return ret;
+}
+
+/**
+   \brief read a segment
+   \return 1 if a segment is read, 0 if the end of file is reached, -1 on error
+ */
+static int readBinaryLogSegment(FILE *fp, std::vector<LogColumns>& logs)
+{
+    char magic[8];
+    uint32_t n;
+    size_t len = fread(magic, 1, 8, fp);
+    if (len == 0 && feof(fp)) return 0;
+    if (len != 8 || strncmp(magic, HRPLOG_MAGIC, 8) != 0
+        || fread(&n, sizeof(n), 1, fp) != 1){
+        return -1;
+    }
+    logs.resize(n);
+    for (unsigned int i=0; i<n; i++){
+        uint32_t header[2];
+        if (!readString(fp, logs[i].name) || !readString(fp, logs[i].type)
+            || fread(header, sizeof(uint32_t), 2, fp) != 2){
+            return -1;
+        }
+        logs[i].n_elements = header[0];
+        logs[i].times.resize(header[1]);
+        logs[i].lengths.resize(header[1]);
+        logs[i].values.resize(header[0]*header[1]);
+    }
+    for (unsigned int i=0; i<n; i++){
+        LogColumns& log = logs[i];
+        if (log.times.empty()) continue;
+        std::vector<uint32_t> lengths(log.times.size());
+        if (fread(&log.times[0], sizeof(double), log.times.size(), fp) != log.times.size()
+            || fread(&lengths[0], sizeof(uint32_t), lengths.size(), fp) != lengths.size()
+            || (!log.values.empty()
+                && fread(&log.values[0], sizeof(double), log.values.size(), fp) != log.values.size())){
+            return -1;
+        }
+        for (size_t j=0; j<lengths.size(); j++){
+            if (lengths[j] > log.n_elements) return -1;
+            log.lengths[j] = lengths[j];
+        }
+    }
+    return 1;
+}
+
+bool readBinaryLog(const std::string& filename, std::vector<LogColumns>& logs)
+{
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if (!fp) return false;
+    std::vector<std::vector<LogColumns> > segments;
+    int ret;
+    do {
+        segments.push_back(std::vector<LogColumns>());
+        ret = readBinaryLogSegment(fp, segments.back());
+    } while (ret == 1);
+    segments.pop_back();
+    fclose(fp);
+    if (ret < 0 || segments.empty()) return false;
+    if (segments.size() == 1){
+        logs.swap(segments[0]);
+        return true;
+    }
+
+    // concatenate segments written by recording
+    logs.clear();
+    std::vector<size_t> n_samples;
+    for (unsigned int i=0; i<segments.size(); i++){
+        for (unsigned int j=0; j<segments[i].size(); j++){
+            const LogColumns& seg = segments[i][j];
+            unsigned int k;
+            for (k=0; k<logs.size(); k++){
+                if (logs[k].name == seg.name) break;
+            }
+            if (k == logs.size()){
+                logs.push_back(LogColumns());
+                logs[k].name = seg.name;
+                logs[k].type = seg.type;
+                logs[k].n_elements = 0;
+                n_samples.push_back(0);
+            }
+            logs[k].n_elements = std::max(logs[k].n_elements, seg.n_elements);
+            n_samples[k] += seg.times.size();
+        }
+    }
+    for (unsigned int k=0; k<logs.size(); k++){
+        logs[k].times.reserve(n_samples[k]);
+        logs[k].lengths.reserve(n_samples[k]);
+        logs[k].values.assign(n_samples[k]*logs[k].n_elements, 0);
+    }
+    for (unsigned int i=0; i<segments.size(); i++){
+        for (unsigned int j=0; j<segments[i].size(); j++){
+            const LogColumns& seg = segments[i][j];
+            unsigned int k;
+            for (k=0; k<logs.size(); k++){
+                if (logs[k].name == seg.name) break;
+            }
+            LogColumns& log = logs[k];
+            size_t offset = log.times.size(), n = seg.times.size();
+            log.times.insert(log.times.end(), seg.times.begin(), seg.times.end());
+            log.lengths.insert(log.lengths.end(), seg.lengths.begin(), seg.lengths.end());
+            for (unsigned int e=0; e<seg.n_elements; e++){
+                std::copy(seg.values.begin() + e*n, seg.values.begin() + (e+1)*n,
+                          log.values.begin() + e*n_samples[k] + offset);
+            }
+        }
+    }
+    return true;
+}
+
+LogElementKind logElementKind(const std::string& type)
+{
+    if (type == "TimedLongSeq") return LOG_LONG_ELEMENT;
+    if (type == "TimedBooleanSeq") return LOG_BOOLEAN_ELEMENT;
+    return LOG_DOUBLE_ELEMENT;
+}
+
+void printTextSample(std::ostream& os, double time, const double *values, unsigned int n,
+                     LogElementKind kind)
+{
+    os << time << " ";
+    for (unsigned int j=0; j<n; j++){
+        switch(kind){
+        case LOG_LONG_ELEMENT:
+            os << (long)values[j] << " ";
+            break;
+        case LOG_BOOLEAN_ELEMENT:
+            // CORBA::Boolean is printed as a character
+            os << (unsigned char)values[j] << " ";
+            break;
+        default:
+            os << values[j] << " ";
+        }
+    }
+    os << std::endl;
+}
+
+void printTextLog(std::ostream& os, const LogColumns& log)
+{
+    os.setf(std::ios::fixed, std::ios::floatfield);
+    os << std::setprecision(6);
+    LogElementKind kind = logElementKind(log.type);
+    size_t n = log.times.size();
+    std::vector<double> sample(log.n_elements + 1);
+    for (size_t i=0; i<n; i++){
+        unsigned int len = log.lengths[i];
+        for (unsigned int j=0; j<len; j++){
+            sample[j] = log.values[j*n+i];
+        }
+        printTextSample(os, log.times[i], &sample[0], len, kind);
+    }
+}
@@ -0,0 +1,103 @@
+// -*- C++ -*-
+/*!
+ * @file  LogFormat.h
+ * @brief binary columnar log format of DataLogger
+ * @date  $Date$
+ *
+ * $Id$
+ */
+
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdio>
+
+/**
+   Binary log file layout. Values are written in the byte order of the
+   host, which is little-endian on all supported platforms.
+
+   char    magic[8] = HRPLOG_MAGIC
+   uint32  the number of ports
+   for each port
+     uint32  length of the port name, char name[]
+     uint32  length of the data type, char type[]
+     uint32  the number of elements per sample
+     uint32  the number of samples
+   for each port (column block)
+     float64 time[n_samples]
+     uint32  length[n_samples], the number of elements of each sample
+     float64 element_0[n_samples], element_1[n_samples], ...
+   elements after the length of a sample are 0.
+
+   The above is a segment. A file written by recording consists of
+   consecutive segments and readBinaryLog() concatenates them.
+ */
+#define HRPLOG_MAGIC "HRPLOG02"
+#define HRPLOG_SUFFIX ".hrplog"
+
+/**
+   logged data of a port in columnar layout
+ */
+struct LogColumns
+{
+    std::string name;         ///< name of the port
+    std::string type;         ///< data type of the port, e.g. TimedDoubleSeq
+    unsigned int n_elements;  ///< the maximum number of elements per sample
+    std::vector<double> times;  ///< time of each sample[s]
+    std::vector<unsigned int> lengths; ///< the number of elements of each sample
+    std::vector<double> values; ///< values[j*times.size()+i] is j-th element of i-th sample
+};
+
+/**
+   how elements are printed in the text format
+ */
+enum LogElementKind {
+    LOG_DOUBLE_ELEMENT,
+    LOG_LONG_ELEMENT,
+    LOG_BOOLEAN_ELEMENT
+};
+
+/**
+   \brief kind of elements of a data type
+ */
+LogElementKind logElementKind(const std::string& type);
+
+/**
+   \brief print a sample in the text format which DataLoggerService::save() generates.
+   The stream must be set to fixed notation with precision 6.
+ */
+void printTextSample(std::ostream& os, double time, const double *values, unsigned int n,
+                     LogElementKind kind);
+
+/**
+   \brief write logs to a binary log file
+   \return true if written successfully, false otherwise
+ */
+bool writeBinaryLog(const std::string& filename, const std::vector<LogColumns>& logs);
+
+/**
+   \brief write logs as a segment to an opened file
+   \return true if written successfully, false otherwise
+ */
+bool writeBinaryLogSegment(FILE *fp, const std::vector<LogColumns>& logs);
+
+/**
+   \brief size of a segment in bytes
+ */
+size_t binaryLogSegmentSize(const std::vector<LogColumns>& logs);
+
+/**
+   \brief read logs from a binary log file
+   \return true if read successfully, false otherwise
+ */
+bool readBinaryLog(const std::string& filename, std::vector<LogColumns>& logs);
+
+/**
+   \brief print a log in the text format which DataLoggerService::save() generates
+ */
+void printTextLog(std::ostream& os, const LogColumns& log);
+
+#endif // LOG_FORMAT_H
@@ -0,0 +1,180 @@
+// -*- C++ -*-
+/*!
+ * @file  LogRecorder.cpp
+ * @brief background thread which streams logged data to rotating files
+ * $Date$
+ *
+ * $Id$
+ */
+
+#include <cstdio>
+#include <coil/Guard.h>
+#include "DataLogger.h"
+#include "LogRecorder.h"
+
+typedef coil::Guard<coil::Mutex> Guard;
+
+LogRecorder::LogRecorder()
+    : m_ports(NULL), m_maxFileSize(0), m_maxFiles(0), m_fileIndex(0), m_fileSize(0),
+      m_fp(NULL), m_cond(m_mutex), m_recording(false), m_running(false), m_pending(false),
+      m_overrun(0), m_flushRequested(false)
+{
+}
+
+LogRecorder::~LogRecorder()
+{
+    if (m_recording) stop();
+}
+
+bool LogRecorder::start(std::vector<LoggerPortBase *> *ports, const std::string& basename,
+                        unsigned long maxFileSize, unsigned int maxFiles)
+{
+    if (m_recording) return false;
+    m_ports = ports;
+    m_basename = basename;
+    m_maxFileSize = maxFileSize;
+    m_maxFiles = maxFiles;
+    m_fileIndex = 0;
+    m_fileSize = 0;
+    m_files.clear();
+    m_overrun = 0;
+    m_flushRequested = false;
+    for (unsigned int i=0; i<m_ports->size(); i++){
+        (*m_ports)[i]->startRecording(DEFAULT_RECORD_BUFFER_LENGTH);
+    }
+    m_pending = false;
+    m_running = true;
+    m_recording = true;
+    reset();
+    activate();
+    return true;
+}
+
+void LogRecorder::stop()
+{
+    if (!m_recording) return;
+    flush();
+    m_recording = false;
+    for (unsigned int i=0; i<m_ports->size(); i++){
+        (*m_ports)[i]->stopRecording();
+    }
+    {
+        Guard guard(m_mutex);
+        m_running = false;
+        m_cond.broadcast();
+    }
+    wait();
+    if (m_fp){
+        fclose(m_fp);
+        m_fp = NULL;
+    }
+    if (m_overrun){
+        std::cerr << "[LogRecorder] buffers overran " << m_overrun
+                  << " times, samples were lost" << std::endl;
+    }
+}
+
+void LogRecorder::update()
+{
+    if (!m_recording) return;
+    if (m_flushRequested){
+        // partially filled buffers are written, retried while the previous ones are being written
+        if (swapBuffers()) m_flushRequested = false;
+        return;
+    }
+    for (unsigned int i=0; i<m_ports->size(); i++){
+        if ((*m_ports)[i]->isRecordBufferFull()){
+            // the oldest samples are overwritten if the previous buffers are being written
+            if (!swapBuffers()) m_overrun++;
+            return;
+        }
+    }
+}
+
+void LogRecorder::flush()
+{
+    if (!m_recording) return;
+    {
+        Guard guard(m_mutex);
+        while (m_pending) m_cond.wait();
+    }
+    swapBuffers();
+    {
+        Guard guard(m_mutex);
+        while (m_pending) m_cond.wait();
+    }
+    if (m_fp) fflush(m_fp);
+}
+
+bool LogRecorder::swapBuffers()
+{
+    Guard guard(m_mutex);
+    if (m_pending) return false;
+    for (unsigned int i=0; i<m_ports->size(); i++){
+        (*m_ports)[i]->swapRecordBuffers();
+    }
+    m_pending = true;
+    m_cond.broadcast();
+    return true;
+}
+
+int LogRecorder::svc(void)
+{
+    while (1){
+        {
+            Guard guard(m_mutex);
+            while (m_running && !m_pending) m_cond.wait();
+            if (!m_pending) break;
+        }
+        write();
+        Guard guard(m_mutex);
+        m_pending = false;
+        m_cond.broadcast();
+    }
+    return 0;
+}
+
+void LogRecorder::write()
+{
+    std::vector<LogColumns> logs;
+    for (unsigned int i=0; i<m_ports->size(); i++){
+        logs.push_back(LogColumns());
+        if (!(*m_ports)[i]->takeRecord(logs.back()) || logs.back().times.empty()){
+            logs.pop_back();
+        }
+    }
+    if (logs.empty()) return;
+    size_t size = binaryLogSegmentSize(logs);
+    if (!m_fp || (m_fileSize > 0 && m_fileSize + size > m_maxFileSize)){
+        if (!openNextFile()) return;
+    }
+    if (!writeBinaryLogSegment(m_fp, logs)){
+        std::cerr << "[LogRecorder] failed to write to " << m_files.back() << std::endl;
+    }
+    fflush(m_fp);
+    m_fileSize += size;
+}
+
+bool LogRecorder::openNextFile()
+{
+    if (m_fp){
+        fclose(m_fp);
+        m_fp = NULL;
+    }
+    if (m_maxFiles > 0 && m_files.size() >= m_maxFiles){
+        remove(m_files.front().c_str());
+        m_files.pop_front();
+    }
+    char suffix[32];
+    sprintf(suffix, "-%04u", m_fileIndex++);
+    std::string fname = m_basename + suffix + HRPLOG_SUFFIX;
+    m_fp = fopen(fname.c_str(), "wb");
+    if (!m_fp){
+        std::cerr << "[LogRecorder] failed to open(" << fname << ")" << std::endl;
+        return false;
+    }
+    m_files.push_back(fname);
+    m_fileSize = 0;
+    std::cerr << "[LogRecorder] recording to " << fname << std::endl;
+    return true;
+}
@@ -0,0 +1,83 @@
+// -*- C++ -*-
+/*!
+ * @file  LogRecorder.h
+ * @brief background thread which streams logged data to rotating files
+ * @date  $Date$
+ *
+ * $Id$
+ */
+
+#ifndef LOG_RECORDER_H
+#define LOG_RECORDER_H
+
+#include <deque>
+#include <coil/Task.h>
+#include <coil/Mutex.h>
+#include <coil/Condition.h>
+#include "LogFormat.h"
+
+#define DEFAULT_RECORD_BUFFER_LENGTH 500
+
+class LoggerPortBase;
+
+/**
+   Streams samples of logger ports to binary log files. Each port has a
+   double buffer of DEFAULT_RECORD_BUFFER_LENGTH samples. When a buffer
+   becomes full, buffers of all ports are swapped and the filled ones are
+   appended to the current file as a segment by the background thread.
+   Files are named basename-NNNN.hrplog and a new file is opened when the
+   current one would exceed the maximum size. When the maximum number of
+   files is reached, the oldest file is removed.
+ */
+class LogRecorder : public coil::Task
+{
+public:
+    LogRecorder();
+    virtual ~LogRecorder();
+    /**
+       \brief start recording
+       \param ports logger ports, must be kept valid while recording
+       \param basename basename of files
+       \param maxFileSize maximum size of a file[byte]
+       \param maxFiles maximum number of files, 0 means unlimited
+     */
+    bool start(std::vector<LoggerPortBase *> *ports, const std::string& basename,
+               unsigned long maxFileSize, unsigned int maxFiles);
+    /**
+       \brief flush buffers and stop recording. Logging must be suspended.
+     */
+    void stop();
+    bool isRecording() { return m_recording; }
+    /**
+       \brief swap buffers if one of them is full, called after logging
+     */
+    void update();
+    /**
+       \brief write all samples in buffers and wait for completion. Logging must be suspended.
+     */
+    void flush();
+    /**
+       \brief request to write samples in buffers without waiting. Buffers
+       are swapped at the next update(), so logging needn't be suspended.
+     */
+    void requestFlush() { m_flushRequested = true; }
+    virtual int svc(void);
+private:
+    bool swapBuffers();
+    void write();
+    bool openNextFile();
+    std::vector<LoggerPortBase *> *m_ports;
+    std::string m_basename;
+    unsigned long m_maxFileSize;
+    unsigned int m_maxFiles, m_fileIndex;
+    unsigned long m_fileSize;
+    FILE *m_fp;
+    std::deque<std::string> m_files;
+    coil::Mutex m_mutex;
+    coil::Condition<coil::Mutex> m_cond;
+    bool m_recording, m_running, m_pending;
+    unsigned long m_overrun;
+    volatile bool m_flushRequested;
+};
+
+#endif // LOG_RECORDER_H
@@ -0,0 +1,105 @@
+// -*- C++ -*-
+/*!
+ * @file  LogRing.h
+ * @brief fixed capacity ring buffer of samples
+ * @date  $Date$
+ *
+ * $Id$
+ */
+
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <vector>
+#include <algorithm>
+
+/**
+   Fixed capacity ring buffer which keeps time and flat double values of
+   the newest samples. Memory is allocated only when the capacity is
+   changed or a sample longer than any previous one is pushed, so
+   logging in steady state is allocation-free.
+ */
+class LogRing
+{
+public:
+    LogRing(unsigned int capacity=0) : m_capacity(capacity), m_stride(0), m_head(0), m_size(0) {}
+
+    /**
+       \brief change the capacity keeping the newest samples
+     */
+    void resize(unsigned int capacity)
+    {
+        if (capacity != m_capacity) reshape(capacity, m_stride);
+    }
+    /**
+       \brief allocate memory for samples which have stride elements
+     */
+    void reserve(unsigned int stride)
+    {
+        if (m_times.empty() || stride > m_stride) reshape(m_capacity, std::max(stride, m_stride));
+    }
+    void clear()
+    {
+        m_head = m_size = 0;
+    }
+    /**
+       \brief push a new sample, the oldest one is dropped if the ring is full
+       \param time time of the sample
+       \param len the number of elements of the sample
+       \return pointer where len values of the sample must be stored,
+       NULL if the capacity is zero
+     */
+    double *push(double time, unsigned int len)
+    {
+        if (m_capacity == 0) return NULL;
+        if (len > m_stride || m_times.empty()) reshape(m_capacity, std::max(len, m_stride));
+        m_times[m_head] = time;
+        m_lengths[m_head] = len;
+        double *ptr = &m_values[0] + m_head*m_stride;
+        m_head = m_head + 1 == m_capacity ? 0 : m_head + 1;
+        if (m_size < m_capacity) m_size++;
+        return ptr;
+    }
+    unsigned int size() const { return m_size; }
+    unsigned int capacity() const { return m_capacity; }
+    /**
+       \brief the maximum number of elements of samples
+     */
+    unsigned int stride() const { return m_stride; }
+    /**
+       \param i index of the sample, 0 is the oldest one
+     */
+    double time(unsigned int i) const { return m_times[index(i)]; }
+    unsigned int length(unsigned int i) const { return m_lengths[index(i)]; }
+    const double *values(unsigned int i) const { return &m_values[0] + index(i)*m_stride; }
+private:
+    unsigned int index(unsigned int i) const
+    {
+        unsigned int idx = m_head + m_capacity - m_size + i;
+        return idx >= m_capacity ? idx - m_capacity : idx;
+    }
+    void reshape(unsigned int capacity, unsigned int stride)
+    {
+        unsigned int n = std::min(m_size, capacity);
+        std::vector<double> times(capacity), values(capacity*stride + 1);
+        std::vector<unsigned int> lengths(capacity);
+        for (unsigned int i=0; i<n; i++){
+            unsigned int src = m_size - n + i;
+            times[i] = time(src);
+            lengths[i] = length(src);
+            std::copy(this->values(src), this->values(src) + lengths[i], &values[0] + i*stride);
+        }
+        m_times.swap(times);
+        m_values.swap(values);
+        m_lengths.swap(lengths);
+        m_capacity = capacity;
+        m_stride = stride;
+        m_size = n;
+        m_head = capacity == 0 || n == capacity ? 0 : n;
+    }
+    std::vector<double> m_times, m_values;
+    std::vector<unsigned int> m_lengths;
+    unsigned int m_capacity, m_stride, m_head, m_size;
+};
+
+#endif // LOG_RING_H
@@ -0,0 +1,85 @@
+// -*- C++ -*-
+/*!
+ * @file  LogWriter.cpp
+ * @brief background thread which writes binary log files
+ * $Date$
+ *
+ * $Id$
+ */
+
+#include <cstdio>
+#include <coil/Guard.h>
+#include "LogWriter.h"
+
+typedef coil::Guard<coil::Mutex> Guard;
+
+LogWriter::LogWriter() : m_cond(m_mutex), m_running(false), m_busy(false)
+{
+}
+
+LogWriter::~LogWriter()
+{
+    stop();
+}
+
+void LogWriter::start()
+{
+    Guard guard(m_mutex);
+    if (m_running) return;
+    m_running = true;
+    activate();
+}
+
+void LogWriter::stop()
+{
+    {
+        Guard guard(m_mutex);
+        if (!m_running) return;
+        m_running = false;
+        m_cond.signal();
+    }
+    wait();
+}
+
+void LogWriter::request(const std::string& filename, std::vector<LogColumns> *logs)
+{
+    Guard guard(m_mutex);
+    Job job;
+    job.filename = filename;
+    job.logs = logs;
+    m_jobs.push_back(job);
+    m_cond.signal();
+}
+
+bool LogWriter::isBusy()
+{
+    Guard guard(m_mutex);
+    return m_busy || !m_jobs.empty();
+}
+
+int LogWriter::svc(void)
+{
+    while (1){
+        Job job;
+        {
+            Guard guard(m_mutex);
+            // pending requests are completed before the thread exits
+            while (m_running && m_jobs.empty()) m_cond.wait();
+            if (m_jobs.empty()) break;
+            job = m_jobs.front();
+            m_jobs.pop_front();
+            m_busy = true;
+        }
+        std::string tmpname = job.filename + ".tmp";
+        if (writeBinaryLog(tmpname, *job.logs)
+            && rename(tmpname.c_str(), job.filename.c_str()) == 0){
+            std::cerr << "[LogWriter] Save log to " << job.filename << std::endl;
+        }else{
+            std::cerr << "[LogWriter] failed to save(" << job.filename << ")" << std::endl;
+        }
+        delete job.logs;
+        Guard guard(m_mutex);
+        m_busy = false;
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+// -*- C++ -*-
+/*!
+ * @file  LogWriter.h
+ * @brief background thread which writes binary log files
+ * @date  $Date$
+ *
+ * $Id$
+ */
+
+#ifndef LOG_WRITER_H
+#define LOG_WRITER_H
+
+#include <deque>
+#include <coil/Task.h>
+#include <coil/Mutex.h>
+#include <coil/Condition.h>
+#include "LogFormat.h"
+
+/**
+   Writes binary log files on a background thread. A file is written to
+   filename.tmp first and renamed when it is completed so that readers
+   never see a partially written file.
+ */
+class LogWriter : public coil::Task
+{
+public:
+    LogWriter();
+    virtual ~LogWriter();
+    void start();
+    void stop();
+    /**
+       \brief request to write logs
+       \param filename name of the binary log file
+       \param logs logs to be written, ownership is transferred to the writer
+     */
+    void request(const std::string& filename, std::vector<LogColumns> *logs);
+    /**
+       \brief check if there are requests which are not completed
+     */
+    bool isBusy();
+    virtual int svc(void);
+private:
+    struct Job {
+        std::string filename;
+        std::vector<LogColumns> *logs;
+    };
+    coil::Mutex m_mutex;
+    coil::Condition<coil::Mutex> m_cond;
+    std::deque<Job> m_jobs;
+    bool m_running, m_busy;
+};
+
+#endif // LOG_WRITER_H
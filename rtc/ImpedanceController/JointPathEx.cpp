@@ -51,14 +51,15 @@ int hrp::calcSRInverse(const dmatrix& _a, dmatrix &_a_sr, double _sr_ratio, dmat
         _w = dmatrix::Identity(n, n);
     }
 
-    dmatrix at = _a.transpose();
-    dmatrix a1(c, c);
-    a1 = (_a * _w * at +  _sr_ratio * dmatrix::Identity(c,c)).inverse();
+    // W is symmetric, so that J# = ((J W Jt + kI)-1 J W)t and J W Jt + kI is solved by LDLT instead of inverse
+    dmatrix aw = _a * _w;
+    dmatrix a1 = aw * _a.transpose() + _sr_ratio * dmatrix::Identity(c,c);
 
-    //if (DEBUG) { dmatrix aat = _a * at; std::cerr << " a*at :" << std::endl << aat; }
+    //if (DEBUG) { dmatrix aat = _a * _a.transpose(); std::cerr << " a*at :" << std::endl << aat; }
 
-    _a_sr  = _w * at * a1;
+    _a_sr = a1.ldlt().solve(aw).transpose();
     //if (DEBUG) { dmatrix ii = _a * _a_sr; std::cerr << "    i :" << std::endl << ii; }
+    return 0;
 }
 
 // overwrite hrplib/hrpUtil/Eigen3d.cpp
@@ -95,6 +96,7 @@ JointPathEx::JointPathEx(BodyPtr& robot, Link* base, Link* end, double control_c
     joints.push_back(joint(i));
   }
   avoid_weight_gain.resize(numJoints());
+  ee_jacobian.resize(6, numJoints());
   optional_weight_vector.resize(numJoints());
   for (int i = 0 ; i < numJoints(); i++ ) {
       optional_weight_vector[i] = 1.0;
@@ -155,9 +157,17 @@ void JointPathEx::getInterlockingJointPairIndices (std::vector<std::pair<size_t,
 };
 
 bool JointPathEx::calcJacobianInverseNullspace(dmatrix &J, dmatrix &Jinv, dmatrix &Jnull) {
+    Jinv.resize(J.cols(), J.rows());
+    Jnull.resize(J.cols(), J.cols());
+    return calcJacobianInverseNullspace<Eigen::Dynamic, Eigen::Dynamic>(J, Jinv, Jnull);
+}
+
+template <int M, int N>
+bool JointPathEx::calcJacobianInverseNullspace(const Eigen::Matrix<double, M, N>& J, Eigen::Matrix<double, N, M>& Jinv, Eigen::Matrix<double, N, N>& Jnull) {
     const int n = numJoints();
-                
-    hrp::dmatrix w = hrp::dmatrix::Identity(n,n);
+
+    // diagonal elements of weighting matrix
+    Eigen::Matrix<double, N, 1> w(n);
     //
     // wmat/weight: weighting joint angle weight
     //
@@ -194,12 +204,12 @@ bool JointPathEx::calcJacobianInverseNullspace(dmatrix &J, dmatrix &Jinv, dmatri
         // If use_inside_joint_weight_retrieval = true (true by default), use T. F. Chang and R.-V. Dubeby weight retrieval inward.
         // Otherwise, joint weight is always calculated from limit value to resolve https://github.com/fkanehiro/hrpsys-base/issues/516.
         if (( r - avoid_weight_gain[j] ) >= 0 ) {
-	  w(j, j) = optional_weight_vector[j] * ( 1.0 / ( 1.0 + r) );
+	  w(j) = optional_weight_vector[j] * ( 1.0 / ( 1.0 + r) );
 	} else {
             if (use_inside_joint_weight_retrieval)
-                w(j, j) = optional_weight_vector[j] * 1.0;
+                w(j) = optional_weight_vector[j] * 1.0;
             else
-                w(j, j) = optional_weight_vector[j] * ( 1.0 / ( 1.0 + r) );
+                w(j) = optional_weight_vector[j] * ( 1.0 / ( 1.0 + r) );
 	}
         avoid_weight_gain[j] = r;
     }
@@ -211,7 +221,7 @@ bool JointPathEx::calcJacobianInverseNullspace(dmatrix &J, dmatrix &Jinv, dmatri
         for(int j = 0; j < n; j++ ) { std::cerr << std::setw(8) << std::setiosflags(std::ios::fixed) << std::setprecision(4) << optional_weight_vector[j]; }
         std::cerr << std::endl;
         std::cerr << "    w :";
-        for(int j = 0; j < n; j++ ) { std::cerr << std::setw(8) << std::setiosflags(std::ios::fixed) << std::setprecision(4) << w(j, j); }
+        for(int j = 0; j < n; j++ ) { std::cerr << std::setw(8) << std::setiosflags(std::ios::fixed) << std::setprecision(4) << w(j); }
         std::cerr << std::endl;
     }
 
@@ -226,11 +236,32 @@ bool JointPathEx::calcJacobianInverseNullspace(dmatrix &J, dmatrix &Jinv, dmatri
 
     calcSRInverse(J, Jinv, sr_gain * k, w);
 
-    Jnull = ( hrp::dmatrix::Identity(n, n) - Jinv * J);
+    Jnull.setIdentity(n, n);
+    Jnull.noalias() -= Jinv * J;
 
     return true;
 }
 
+template bool JointPathEx::calcJacobianInverseNullspace<6, 6>(const Eigen::Matrix<double, 6, 6>& J, Eigen::Matrix<double, 6, 6>& Jinv, Eigen::Matrix<double, 6, 6>& Jnull);
+template bool JointPathEx::calcJacobianInverseNullspace<6, 7>(const Eigen::Matrix<double, 6, 7>& J, Eigen::Matrix<double, 7, 6>& Jinv, Eigen::Matrix<double, 7, 7>& Jnull);
+
+bool JointPathEx::calcInverseKinematics2Loop(const Vector3& dp, const Vector3& omega,
+                                             const double LAMBDA, const double avoid_gain, const double reference_gain, const hrp::dvector* reference_q) {
+    // Fixed size matrices for usual limbs, which are allocated on the stack
+    if ( interlocking_joint_pair_indices.empty() ) {
+        switch ( numJoints() ) {
+        case 6:
+            return calcInverseKinematics2Loop<6, 6>(dp, omega, LAMBDA, avoid_gain, reference_gain, reference_q);
+        case 7:
+            return calcInverseKinematics2Loop<6, 7>(dp, omega, LAMBDA, avoid_gain, reference_gain, reference_q);
+        default:
+            break;
+        }
+    }
+    return calcInverseKinematics2Loop<Eigen::Dynamic, Eigen::Dynamic>(dp, omega, LAMBDA, avoid_gain, reference_gain, reference_q);
+}
+
+template <int M, int N>
 bool JointPathEx::calcInverseKinematics2Loop(const Vector3& dp, const Vector3& omega,
                                              const double LAMBDA, const double avoid_gain, const double reference_gain, const hrp::dvector* reference_q) {
     const int n = numJoints();
@@ -248,29 +279,27 @@ bool JointPathEx::calcInverseKinematics2Loop(const Vector3& dp, const Vector3& o
     size_t workspace_dim = ee_workspace_dim + ij_workspace_dim;
 
     // Total jacobian, workspace velocty, and so on
-    hrp::dmatrix J(workspace_dim, n);
-    dvector v(workspace_dim);
-    hrp::dmatrix Jinv(n, workspace_dim);
-    hrp::dmatrix Jnull(n, n);
-    hrp::dvector dq(n);
-
+    Eigen::Matrix<double, M, N> J(workspace_dim, n);
+    Eigen::Matrix<double, M, 1> v(workspace_dim);
+    Eigen::Matrix<double, N, M> Jinv(n, workspace_dim);
+    Eigen::Matrix<double, N, N> Jnull(n, n);
+    Eigen::Matrix<double, N, 1> dq(n);
+
+    v.segment(0, 3) = dp;
+    v.segment(3, 3) = omega;
+    calcJacobian(ee_jacobian);
+    J.block(0, 0, ee_workspace_dim, n) = ee_jacobian;
     if (ij_workspace_dim > 0) {
-        v << dp, omega, dvector::Zero(ij_workspace_dim);
-        hrp::dmatrix ee_J = dmatrix::Zero(ee_workspace_dim, n);
-        calcJacobian(ee_J);
-        hrp::dmatrix ij_J = dmatrix::Zero(ij_workspace_dim, n);
+        v.tail(ij_workspace_dim).setZero();
+        J.bottomRows(ij_workspace_dim).setZero();
         for (size_t i = 0; i < ij_workspace_dim; i++) {
             std::pair<size_t, size_t>& pair = interlocking_joint_pair_indices[i];
-            ij_J(i, pair.first) = 1;
-            ij_J(i, pair.second) = -1;
+            J(ee_workspace_dim + i, pair.first) = 1;
+            J(ee_workspace_dim + i, pair.second) = -1;
         }
-        J << ee_J, ij_J;
-    } else {
-        v << dp, omega;
-        calcJacobian(J);
     }
     calcJacobianInverseNullspace(J, Jinv, Jnull);
-    dq = Jinv * v; // dq = pseudoInverse(J) * v
+    dq.noalias() = Jinv * v; // dq = pseudoInverse(J) * v
 
     if ( DEBUG ) {
         std::cerr << "    v :";
@@ -287,7 +316,7 @@ bool JointPathEx::calcInverseKinematics2Loop(const Vector3& dp, const Vector3& o
       // avoid-nspace-joint-limit: avoiding joint angle limit
       //
       // dH/dq = (((t_max + t_min)/2 - t) / ((t_max - t_min)/2)) ^2
-      hrp::dvector u(n);
+      Eigen::Matrix<double, N, 1> u(n);
       for ( int j = 0; j < n ; j++ ) {
         double jang = joint(j)->q;
         double jmax = joint(j)->ulimit;
@@ -303,19 +332,19 @@ bool JointPathEx::calcInverseKinematics2Loop(const Vector3& dp, const Vector3& o
         }
         std::cerr << std::endl;
         std::cerr << " JN*u :";
-        hrp::dvector Jnullu = Jnull * u;
+        Eigen::Matrix<double, N, 1> Jnullu = Jnull * u;
         for(int j=0; j < n; ++j){
           std::cerr << std::setw(8) << std::setiosflags(std::ios::fixed) << std::setprecision(4) << rad2deg(Jnullu(j));
         }
         std::cerr << std::endl;
       }
-      dq = dq + Jnull * u;
+      dq.noalias() += Jnull * u;
     }
     // If reference_gain and reference_q are set, add following to reference_q by null space vector
     if ( reference_gain > 0.0 && reference_q != NULL ) {
       //
       // qref - qcurr
-      hrp::dvector u(n);
+      Eigen::Matrix<double, N, 1> u(n);
       for ( int j = 0; j < numJoints(); j++ ) {
         u[j] = optional_weight_vector[j] * reference_gain * ( (*reference_q)[joint(j)->jointId] - joint(j)->q );
       }
@@ -326,13 +355,13 @@ bool JointPathEx::calcInverseKinematics2Loop(const Vector3& dp, const Vector3& o
         }
         std::cerr << std::endl;
         std::cerr << "  JN*u:";
-        hrp::dvector nullu = Jnull * u;
+        Eigen::Matrix<double, N, 1> nullu = Jnull * u;
         for(int j=0; j < n; ++j){
           std::cerr << std::setw(8) << std::setiosflags(std::ios::fixed) << std::setprecision(4) << rad2deg(nullu(j));
         }
         std::cerr << std::endl;
       }
-      dq = dq + Jnull * u;
+      dq.noalias() += Jnull * u;
     }
     if ( DEBUG ) {
       std::cerr << "   dq :";
@@ -5,10 +5,24 @@
 #include <hrpModel/JointPath.h>
 #include <cmath>
 #include <coil/stringutil.h>
+#include <Eigen/Cholesky>
 
 // hrplib/hrpUtil/MatrixSolvers.h
 namespace hrp {
     int calcSRInverse(const dmatrix& _a, dmatrix &_a_sr, double _sr_ratio = 1.0, dmatrix _w = dmatrix::Identity(0,0));
+    /**
+       Weighted SR-inverse whose weight is a diagonal matrix given by its diagonal elements _w.
+       Fixed size matrices can be used so that no memory is allocated for 6 or 7 dof limbs.
+     */
+    template <int C, int N>
+    void calcSRInverse(const Eigen::Matrix<double, C, N>& _a, Eigen::Matrix<double, N, C>& _a_sr, double _sr_ratio, const Eigen::Matrix<double, N, 1>& _w)
+    {
+        // J# = W Jt(J W Jt + kI)-1 = ((J W Jt + kI)-1 J W)t, J W Jt + kI is solved by LDLT instead of inverse
+        Eigen::Matrix<double, C, N> aw(_a * _w.asDiagonal());
+        Eigen::Matrix<double, C, C> a1(aw * _a.transpose());
+        a1.diagonal().array() += _sr_ratio;
+        _a_sr = a1.ldlt().solve(aw).transpose();
+    }
 };
 
 // hrplib/hrpModel/JointPath.h
@@ -17,6 +31,8 @@ namespace hrp {
   public:
     JointPathEx(BodyPtr& robot, Link* base, Link* end, double control_cycle, bool _use_inside_joint_weight_retrieval = true, const std::string& _debug_print_prefix = "");
     bool calcJacobianInverseNullspace(dmatrix &J, dmatrix &Jinv, dmatrix &Jnull);
+    template <int M, int N>
+    bool calcJacobianInverseNullspace(const Eigen::Matrix<double, M, N>& J, Eigen::Matrix<double, N, M>& Jinv, Eigen::Matrix<double, N, N>& Jnull);
     bool calcInverseKinematics2Loop(const Vector3& dp, const Vector3& omega, const double LAMBDA, const double avoid_gain = 0.0, const double reference_gain = 0.0, const dvector* reference_q = NULL);
     bool calcInverseKinematics2Loop(const Vector3& end_effector_p, const Matrix33& end_effector_R,
                                     const double LAMBDA, const double avoid_gain = 0.0, const double reference_gain = 0.0, const hrp::dvector* reference_q = NULL,
@@ -24,10 +40,10 @@ namespace hrp {
                                     const hrp::Vector3& localPos = hrp::Vector3::Zero(), const hrp::Matrix33& localR = hrp::Matrix33::Identity());
     bool calcInverseKinematics2(const Vector3& end_p, const Matrix33& end_R, const double avoid_gain = 0.0, const double reference_gain = 0.0, const dvector* reference_q = NULL);
     double getSRGain() { return sr_gain; }
-    bool setSRGain(double g) { sr_gain = g; }
+    bool setSRGain(double g) { sr_gain = g; return true; }
     double getManipulabilityLimit() { return manipulability_limit; }
-    bool setManipulabilityLimit(double l) { manipulability_limit = l; }
-    bool setManipulabilityGain(double l) { manipulability_gain = l; }
+    bool setManipulabilityLimit(double l) { manipulability_limit = l; return true; }
+    bool setManipulabilityGain(double l) { manipulability_gain = l; return true; }
     void setMaxIKError(double epos, double erot);
     void setMaxIKError(double e);
     void setMaxIKIteration(int iter);
@@ -47,6 +63,9 @@ namespace hrp {
         }
     };
   protected:
+        // M x N jacobian of M dimensional workspace and N joints, which is Eigen::Dynamic unless 6 or 7 dof limbs without interlocking joints
+        template <int M, int N>
+        bool calcInverseKinematics2Loop(const Vector3& dp, const Vector3& omega, const double LAMBDA, const double avoid_gain, const double reference_gain, const dvector* reference_q);
         double maxIKPosErrorSqr, maxIKRotErrorSqr;
         int maxIKIteration;
         std::vector<Link*> joints;
@@ -62,6 +81,8 @@ namespace hrp {
         std::vector<size_t> joint_limit_debug_print_counts;
         size_t debug_print_freq_count;
         bool use_inside_joint_weight_retrieval;
+        // end-effector jacobian allocated once, which calcJacobian() writes to
+        hrp::dmatrix ee_jacobian;
     };
 
     typedef boost::shared_ptr<JointPathEx> JointPathExPtr;
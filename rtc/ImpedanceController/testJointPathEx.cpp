@@ -0,0 +1,238 @@
+/* -*- coding:utf-8-unix; mode:c++; -*- */
+
+#include "JointPathEx.h"
+/* samples */
+#include <stdio.h>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#include <sys/time.h>
+
+#ifndef deg2rad
+#define deg2rad(deg) (deg * M_PI / 180)
+#endif
+
+class testJointPathEx
+{
+protected:
+    double dt; /* [s] */
+    int loop;
+    hrp::BodyPtr m_robot;
+    std::vector<hrp::JointPathExPtr> manips;
+    double get_time ()
+    {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return tv.tv_sec + tv.tv_usec * 1e-6;
+    };
+    // serial link whose joint axes are given by axes, e.g. "zyxyzyx"
+    hrp::Link* makeLimb (hrp::Link* root, const std::string& name, const std::string& axes, int& jointId)
+    {
+        hrp::Link* parent = root;
+        for (size_t i = 0; i < axes.size(); i++) {
+            hrp::Link* l = new hrp::Link();
+            l->name = name + "_JOINT" + (char)('0' + i);
+            l->jointType = hrp::Link::ROTATIONAL_JOINT;
+            l->jointId = jointId++;
+            l->a = (axes[i] == 'x' ? hrp::Vector3::UnitX() : (axes[i] == 'y' ? hrp::Vector3::UnitY() : hrp::Vector3::UnitZ()));
+            l->b = (i == 0 ? hrp::Vector3(0, 0, 0) : hrp::Vector3(0.01, 0, -0.1));
+            l->ulimit = deg2rad(170.0);
+            l->llimit = deg2rad(-170.0);
+            l->uvlimit = 1e3;
+            l->lvlimit = -1e3;
+            l->q = deg2rad(20.0) * (i % 2 == 0 ? 1 : -1) + deg2rad(5.0) * i;
+            parent->addChild(l);
+            parent = l;
+        }
+        return parent;
+    };
+    // previous implementation allocating dmatrices and inverting J W Jt + kI
+    void calcSRInverseByInverse (const hrp::dmatrix& J, hrp::dmatrix& Jinv, double sr_ratio, const hrp::dmatrix& w)
+    {
+        hrp::dmatrix Jt = J.transpose();
+        hrp::dmatrix a1 = (J * w * Jt + sr_ratio * hrp::dmatrix::Identity(J.rows(), J.rows())).inverse();
+        Jinv = w * Jt * a1;
+    };
+    template <int N>
+    bool checkJacobianInverse (hrp::JointPathExPtr manip)
+    {
+        const int n = manip->numJoints();
+        hrp::dmatrix J(6, n), Jinv(n, 6), Jnull(n, n), w(hrp::dmatrix::Zero(n, n)), Jinv_ref;
+        manip->calcJacobian(J);
+        manip->calcJacobianInverseNullspace(J, Jinv, Jnull);
+        Eigen::Matrix<double, 6, N> fixed_J(J);
+        Eigen::Matrix<double, N, 6> fixed_Jinv;
+        Eigen::Matrix<double, N, N> fixed_Jnull;
+        manip->calcJacobianInverseNullspace(fixed_J, fixed_Jinv, fixed_Jnull);
+        double fixed_error = std::max((fixed_Jinv - Jinv).cwiseAbs().maxCoeff(), (fixed_Jnull - Jnull).cwiseAbs().maxCoeff());
+        // SR-inverse solved by LDLT should be the same as the one by inverse
+        Eigen::Matrix<double, N, 1> fixed_w;
+        for (int i = 0; i < n; i++) fixed_w(i) = w(i, i) = 1.0 / (1.0 + i);
+        double inverse_error = 0;
+        for (double sr_ratio = 0; sr_ratio < 0.1; sr_ratio = (sr_ratio + 1e-6) * 10) {
+            calcSRInverseByInverse(J, Jinv_ref, sr_ratio, w);
+            hrp::calcSRInverse(J, Jinv, sr_ratio, w);
+            hrp::calcSRInverse(fixed_J, fixed_Jinv, sr_ratio, fixed_w);
+            double scale = std::max(1.0, Jinv_ref.cwiseAbs().maxCoeff());
+            inverse_error = std::max(inverse_error, std::max((Jinv - Jinv_ref).cwiseAbs().maxCoeff(), (fixed_Jinv - Jinv_ref).cwiseAbs().maxCoeff()) / scale);
+        }
+        std::cerr << "[testJointPathEx]   " << n << "dof : |fixed - dynamic| = " << fixed_error << ", |LDLT - inverse| = " << inverse_error << std::endl;
+        return fixed_error < 1e-10 && inverse_error < 1e-8;
+    };
+    bool checkInverseKinematics (hrp::JointPathExPtr manip)
+    {
+        hrp::Link* target = manip->endLink();
+        std::vector<double> qorg;
+        for (int i = 0; i < manip->numJoints(); i++) qorg.push_back(manip->joint(i)->q);
+        // reachable target pose obtained by moving joints
+        for (int i = 0; i < manip->numJoints(); i++) manip->joint(i)->q += deg2rad(3.0);
+        manip->calcForwardKinematics();
+        hrp::Vector3 target_p(target->p);
+        hrp::Matrix33 target_R(target->R);
+        for (int i = 0; i < manip->numJoints(); i++) manip->joint(i)->q = qorg[i];
+        manip->calcForwardKinematics();
+        bool ret = manip->calcInverseKinematics2(target_p, target_R);
+        double pos_error = (target->p - target_p).norm(), rot_error = (target->R - target_R).cwiseAbs().maxCoeff();
+        std::cerr << "[testJointPathEx]   " << manip->numJoints() << "dof : IK " << (ret ? "converged" : "failed")
+                  << ", pos error = " << pos_error << "[m], rot error = " << rot_error << std::endl;
+        for (int i = 0; i < manip->numJoints(); i++) manip->joint(i)->q = qorg[i];
+        manip->calcForwardKinematics();
+        return ret && pos_error < 1e-3 && rot_error < 1e-2;
+    };
+public:
+    std::vector<std::string> arg_strs;
+    testJointPathEx() : dt(0.002), loop(100000)
+    {
+        m_robot = hrp::BodyPtr(new hrp::Body());
+        hrp::Link* root = new hrp::Link();
+        root->name = "WAIST";
+        root->jointType = hrp::Link::FREE_JOINT;
+        m_robot->setRootLink(root);
+        int jointId = 0;
+        hrp::Link* leg_end = makeLimb(root, "LEG", "zxyyyx", jointId);
+        hrp::Link* arm_end = makeLimb(root, "ARM", "yxzyzyx", jointId);
+        hrp::Link* dual_end = makeLimb(root, "DUAL", "zxyyyyx", jointId);
+        m_robot->updateLinkTree();
+        m_robot->calcForwardKinematics();
+        manips.push_back(hrp::JointPathExPtr(new hrp::JointPathEx(m_robot, root, leg_end, dt)));
+        manips.push_back(hrp::JointPathExPtr(new hrp::JointPathEx(m_robot, root, arm_end, dt)));
+        // 7dof limb with interlocking joints, which uses the dynamic size path
+        manips.push_back(hrp::JointPathExPtr(new hrp::JointPathEx(m_robot, root, dual_end, dt)));
+        std::vector<std::pair<size_t, size_t> > pairs;
+        pairs.push_back(std::pair<size_t, size_t>(3, 4));
+        manips[2]->setInterlockingJointPairIndices(pairs);
+    };
+    bool test0 ()
+    {
+        std::cerr << "[testJointPathEx] test0 : SR-inverse and IK of 6dof and 7dof limbs" << std::endl;
+        bool ret = true;
+        // weights are updated from joint angles at the first call
+        for (size_t i = 0; i < manips.size(); i++) {
+            hrp::dmatrix J, Jinv, Jnull;
+            manips[i]->calcJacobian(J);
+            manips[i]->calcJacobianInverseNullspace(J, Jinv, Jnull);
+        }
+        ret = checkJacobianInverse<6>(manips[0]) && ret;
+        ret = checkJacobianInverse<7>(manips[1]) && ret;
+        for (size_t i = 0; i < manips.size(); i++) {
+            ret = checkInverseKinematics(manips[i]) && ret;
+        }
+        return ret;
+    };
+    bool benchmark ()
+    {
+        parse_params();
+        std::cerr << "[testJointPathEx] benchmark : " << loop << " loops" << std::endl;
+        for (size_t i = 0; i < 2; i++) {
+            hrp::JointPathExPtr manip = manips[i];
+            const int n = manip->numJoints();
+            hrp::dmatrix J(6, n), Jinv(n, 6), Jnull(n, n), w(hrp::dmatrix::Identity(n, n));
+            manip->calcJacobian(J);
+            double t0 = get_time();
+            for (int j = 0; j < loop; j++) {
+                calcSRInverseByInverse(J, Jinv, 1e-6, w);
+            }
+            double t1 = get_time();
+            for (int j = 0; j < loop; j++) {
+                hrp::calcSRInverse(J, Jinv, 1e-6, w);
+            }
+            double t2 = get_time();
+            hrp::dvector dynamic_w(hrp::dvector::Ones(n));
+            for (int j = 0; j < loop; j++) {
+                hrp::calcSRInverse(J, Jinv, 1e-6, dynamic_w);
+            }
+            double t3 = get_time();
+            double t4, t5;
+            if (n == 6) {
+                Eigen::Matrix<double, 6, 6> fixed_J(J), fixed_Jinv;
+                Eigen::Matrix<double, 6, 1> fixed_w(Eigen::Matrix<double, 6, 1>::Ones());
+                t4 = get_time();
+                for (int j = 0; j < loop; j++) {
+                    hrp::calcSRInverse(fixed_J, fixed_Jinv, 1e-6, fixed_w);
+                }
+                t5 = get_time();
+            } else {
+                Eigen::Matrix<double, 6, 7> fixed_J(J);
+                Eigen::Matrix<double, 7, 6> fixed_Jinv;
+                Eigen::Matrix<double, 7, 1> fixed_w(Eigen::Matrix<double, 7, 1>::Ones());
+                t4 = get_time();
+                for (int j = 0; j < loop; j++) {
+                    hrp::calcSRInverse(fixed_J, fixed_Jinv, 1e-6, fixed_w);
+                }
+                t5 = get_time();
+            }
+            // IK loop with zero velocity so that joint angles are kept
+            hrp::Vector3 dp(hrp::Vector3::Zero()), omega(hrp::Vector3::Zero());
+            for (int j = 0; j < loop; j++) {
+                manip->calcInverseKinematics2Loop(dp, omega, 1.0);
+            }
+            double t6 = get_time();
+            std::cerr << "[testJointPathEx]   " << n << "dof : SR-inverse by inverse = " << (t1 - t0) / loop * 1e6
+                      << "[us], by LDLT = " << (t2 - t1) / loop * 1e6
+                      << "[us], diagonal weight = " << (t3 - t2) / loop * 1e6
+                      << "[us], fixed size = " << (t5 - t4) / loop * 1e6
+                      << "[us], calcInverseKinematics2Loop = " << (t6 - t5) / loop * 1e6 << "[us]" << std::endl;
+        }
+        return true;
+    };
+    void parse_params ()
+    {
+        for (unsigned int i = 0; i < arg_strs.size(); ++ i) {
+            if ( arg_strs[i]== "--loop" ) {
+                if (++i < arg_strs.size()) loop = atoi(arg_strs[i].c_str());
+            }
+        }
+    };
+};
+
+void print_usage ()
+{
+    std::cerr << "Usage : testJointPathEx [option]" << std::endl;
+    std::cerr << " [option] should be:" << std::endl;
+    std::cerr << "  --test0 : SR-inverse and IK of 6dof and 7dof limbs" << std::endl;
+    std::cerr << "  --benchmark [--loop n] : compare computation time of SR-inverse and IK loop" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    int ret = 0;
+    if (argc >= 2) {
+        testJointPathEx tjpe;
+        for (int i = 1; i < argc; ++ i) {
+            tjpe.arg_strs.push_back(std::string(argv[i]));
+        }
+        if (std::string(argv[1]) == "--test0") {
+            ret = tjpe.test0() ? 0 : 1;
+        } else if (std::string(argv[1]) == "--benchmark") {
+            ret = tjpe.benchmark() ? 0 : 1;
+        } else {
+            print_usage();
+            ret = 1;
+        }
+    } else {
+        print_usage();
+        ret = 1;
+    }
+    return ret;
+}
+
@@ -10,6 +10,9 @@
 #include "OccupancyGridMap3D.h"
 #include "hrpUtil/Eigen3d.h"
 #include <octomap/octomap.h>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
 
 #define KDEBUG 0
 //#define KDEBUG 1 // 121022
@@ -45,6 +48,9 @@ static const char* occupancygridmap3d_spec[] =
     "conf.default.initialMap", "",
     "conf.default.knownMap", "",
     "conf.default.debugLevel", "0",
+    "conf.default.insertThreads", "0",
+    "conf.default.maxRange", "-1",
+    "conf.default.voxelDedup", "1",
     ""
   };
 // </rtc-template>
@@ -58,6 +64,7 @@ OccupancyGridMap3D::OccupancyGridMap3D(RTC::Manager* manager)
     m_sensorPosIn("sensorPos", m_sensorPos),
     m_updateIn("update", m_update),
     m_updateOut("updateSignal", m_updateSignal),
+    m_mapDeltaOut("mapDelta", m_mapDelta),
     m_OGMap3DServicePort("OGMap3DService"),
     // </rtc-template>
     m_service0(this),
@@ -83,6 +90,9 @@ RTC::ReturnCode_t OccupancyGridMap3D::onInitialize()
   bindParameter("initialMap", m_initialMap, "");
   bindParameter("knownMap", m_knownMapPath, "");
   bindParameter("debugLevel", m_debugLevel, "0");
+  bindParameter("insertThreads", m_insertThreads, "0");
+  bindParameter("maxRange", m_maxRange, "-1");
+  bindParameter("voxelDedup", m_voxelDedup, "1");
   
   // </rtc-template>
 
@@ -97,6 +107,7 @@ RTC::ReturnCode_t OccupancyGridMap3D::onInitialize()
 
   // Set OutPort buffer
   addOutPort("updateSignal", m_updateOut);
+  addOutPort("mapDelta", m_mapDeltaOut);
   
   // Set service provider to Ports
   m_OGMap3DServicePort.registerProvider("service1", "OGMap3DService", m_service0);
@@ -129,6 +140,9 @@ RTC::ReturnCode_t OccupancyGridMap3D::onInitialize()
   m_sensorPos.data.z = 0;
 
   m_updateSignal.data = 0;
+
+  m_mapDelta.seq = 0;
+  m_mapDelta.cleared = false;
  
   return RTC::RTC_OK;
 }
@@ -171,6 +185,13 @@ RTC::ReturnCode_t OccupancyGridMap3D::onActivated(RTC::UniqueId ec_id)
   }else{
     m_map = new OcTree(m_resolution);
   }
+  // voxels are reported to mapDelta port when they are created or their
+  // states flip between occupied and empty by occupiedThd. The threshold
+  // of the tree is changed for that, save() uses the original one.
+  m_savedOccupancyThd = m_map->getOccupancyThres();
+  m_map->setOccupancyThres(m_occupiedThd);
+  m_appliedOccupiedThd = m_occupiedThd;
+  m_map->enableChangeDetection(true);
   m_updateOut.write();
 
   if(KDEBUG){
@@ -198,6 +219,7 @@ RTC::ReturnCode_t OccupancyGridMap3D::onActivated(RTC::UniqueId ec_id)
 RTC::ReturnCode_t OccupancyGridMap3D::onDeactivated(RTC::UniqueId ec_id)
 {
   std::cout << m_profile.instance_name<< ": onDeactivated(" << ec_id << ")" << std::endl;
+  m_inserter.setNumThreads(1);
   Guard guard(m_mutex);
   delete m_map;
   if (m_knownMap) delete m_knownMap;
@@ -218,9 +240,24 @@ RTC::ReturnCode_t OccupancyGridMap3D::onExecute(RTC::UniqueId ec_id)
         return RTC::RTC_OK;
     }
 
+    if (m_occupiedThd != m_appliedOccupiedThd){
+        // occupiedThd is reconfigured. The threshold of the tree is not
+        // compared since it is stored as logodds and differs slightly
+        Guard guard(m_mutex);
+        m_map->setOccupancyThres(m_occupiedThd);
+        m_appliedOccupiedThd = m_occupiedThd;
+        // states of voxels may flip without changes of the tree
+        writeMap();
+    }
+
+    if (m_insertThreads > 0){
+        m_inserter.setNumThreads(m_insertThreads);
+        m_inserter.setMaxRange(m_maxRange);
+        m_inserter.setDeduplication(m_voxelDedup);
+    }
+
     while (m_rangeIn.isNew()){
         m_rangeIn.read();
-        Guard guard(m_mutex);
         Pointcloud cloud;
         for (unsigned int i=0; i<m_range.ranges.length(); i++){
             double th = m_range.config.minAngle + i*m_range.config.angularRes;
@@ -236,14 +273,13 @@ RTC::ReturnCode_t OccupancyGridMap3D::onExecute(RTC::UniqueId ec_id)
                      pose.orientation.r,
                      pose.orientation.p,
                      pose.orientation.y);
-        m_map->insertPointCloud(cloud, sensor, frame);
+        insertPointCloud(cloud, sensor, frame);
     }
 
     if (m_cloudIn.isNew()){
         while (m_cloudIn.isNew()) m_cloudIn.read();
         while (m_poseIn.isNew())  m_poseIn.read();
         while (m_sensorPosIn.isNew())  m_sensorPosIn.read();
-        Guard guard(m_mutex);
         float *ptr = (float *)m_cloud.data.get_buffer();
         if (strcmp(m_cloud.type, "xyz")==0 
             || strcmp(m_cloud.type, "xyzrgb")==0){
@@ -261,8 +297,26 @@ RTC::ReturnCode_t OccupancyGridMap3D::onExecute(RTC::UniqueId ec_id)
                          m_pose.data.orientation.r,
                          m_pose.data.orientation.p,
                          m_pose.data.orientation.y);
-            m_map->insertPointCloud(cloud, sensor, frame);
+            insertPointCloud(cloud, sensor, frame);
+        }else if (strcmp(m_cloud.type, "xyzv")==0 && m_insertThreads > 0){
+            pose6d frame(m_pose.data.position.x,
+                         m_pose.data.position.y,
+                         m_pose.data.position.z, 
+                         m_pose.data.orientation.r,
+                         m_pose.data.orientation.p,
+                         m_pose.data.orientation.y);
+            Pointcloud cloud;
+            std::vector<bool> occupied;
+            for (unsigned int i=0; i<m_cloud.data.length()/16; i++, ptr+=4){
+                if (isnan(ptr[0])) continue;
+                cloud.push_back(frame.transform(point3d(ptr[0],ptr[1],ptr[2])));
+                occupied.push_back(ptr[3]>0.0);
+            }
+            m_inserter.computeUpdate(*m_map, cloud, occupied);
+            Guard guard(m_mutex);
+            m_inserter.applyUpdate(*m_map);
         }else if (strcmp(m_cloud.type, "xyzv")==0){
+            Guard guard(m_mutex);
             hrp::Matrix33 R;
             hrp::Vector3 p;
             p[0] = m_pose.data.position.x; 
@@ -437,6 +491,11 @@ RTC::ReturnCode_t OccupancyGridMap3D::onExecute(RTC::UniqueId ec_id)
         m_updateOut.write();
     }
 
+    {
+        Guard guard(m_mutex);
+        if (m_map->numChangesDetected() > 0) writeMapDelta();
+    }
+
     coil::TimeValue t2(coil::gettimeofday());
     if (m_debugLevel > 0){
         coil::TimeValue dt = t2-t1;
@@ -482,14 +541,25 @@ RTC::ReturnCode_t OccupancyGridMap3D::onRateChanged(RTC::UniqueId ec_id)
 }
 */
 
-OpenHRP::OGMap3D* OccupancyGridMap3D::getOGMap3D(const OpenHRP::AABB& region)
+void OccupancyGridMap3D::insertPointCloud(const Pointcloud& cloud, const point3d& sensor, const pose6d& frame)
 {
-    Guard guard(m_mutex);
-    coil::TimeValue t1(coil::gettimeofday());
+    if (m_insertThreads > 0){
+        // the map is not modified while voxels are computed
+        m_inserter.computeUpdate(*m_map, cloud, sensor, frame);
+        Guard guard(m_mutex);
+        m_inserter.applyUpdate(*m_map);
+    }else{
+        Guard guard(m_mutex);
+        m_map->insertPointCloud(cloud, sensor, frame);
+    }
+}
 
-    OpenHRP::OGMap3D *map = new OpenHRP::OGMap3D;
+void OccupancyGridMap3D::takeSnapshot(const OpenHRP::AABB& region, OGMapSnapshot& snapshot)
+{
+    Guard guard(m_mutex);
     double size = m_map->getResolution();
-    map->resolution = size;
+    snapshot.resolution = size;
+    snapshot.occupiedThd = m_appliedOccupiedThd;
 
     double min[3];
     m_map->getMetricMin(min[0],min[1],min[2]);
@@ -534,76 +604,228 @@ OpenHRP::OGMap3D* OccupancyGridMap3D::getOGMap3D(const OpenHRP::AABB& region)
         l[i] = e[i] - s[i];
     }
 
+    for (int i=0; i<3; i++){
 #ifdef USE_ONLY_GRIDS
-    map->pos.x = ((int)(s[0]/size))*size;
-    map->pos.y = ((int)(s[1]/size))*size;
-    map->pos.z = ((int)(s[2]/size))*size;
+        snapshot.pos[i] = ((int)(s[i]/size))*size;
 #else
-#if 0
-    map->pos.x = s[0];
-    map->pos.y = s[1];
-    map->pos.z = s[2];
-    if(KDEBUG){
-      std::cout << m_profile.instance_name << ": pos = " << map->pos.x << " " << map->pos.y << " " << map->pos.z << " " << std::endl;
-      map->pos.x += size/2.0;
-      map->pos.y += size/2.0;
-      map->pos.z += size/2.0;
-    }
-#endif      
-    map->pos.x = ((int)(s[0]/size)+0.5)*size; // 121024
-    map->pos.y = ((int)(s[1]/size)+0.5)*size; // 121024
-    map->pos.z = ((int)(s[2]/size)+0.5)*size; // 121024
+        snapshot.pos[i] = ((int)(s[i]/size)+0.5)*size; // 121024
 #endif
-    map->nx = l[0]/size;
-    map->ny = l[1]/size;
-    map->nz = l[2]/size;
-    int rank=0;
-    point3d p;
-    map->cells.length(map->nx*map->ny*map->nz);
-    {
-        int no=0, ne=0, nu=0;
-        //Guard guard(m_mutex);
-        for (int i=0; i<map->nx; i++){
-            p.x() = map->pos.x + i*size;
-            for (int j=0; j<map->ny; j++){
-                p.y() = map->pos.y + j*size;
-                for (int k=0; k<map->nz; k++){
-                    p.z() = map->pos.z + k*size;
-                    OcTreeNode *result = m_map->search(p);
-		    //                    if (result){
-                    if (result && !(result->hasChildren())){ // 121023
-                        double prob = result->getOccupancy();
-                        if (prob >= m_occupiedThd){
-                            map->cells[rank] = prob*0xfe;
-                            no++;
-			    //			    if(KDEBUG) std::cout << m_profile.instance_name << ": output " << p << " " << prob << std::endl;
-                        }else{
-                            map->cells[rank] = OpenHRP::gridEmpty;
-                            ne++;
-                        }
-                        //printf("%6.3f %6.3f %6.3f:%d\n", p.x(), p.y(), p.z(),map->cells[rank-1]);
+        snapshot.n[i] = l[i]/size;
+    }
+
+    // copy leaves which contain centers of voxels, octrees are no longer
+    // accessed and map updates by onExecute() are not blocked while rasterizing.
+    // Inner nodes are not copied for both maps. OcTree::search() at the full
+    // depth returns a leaf or NULL for a child which doesn't exist, so the
+    // known map gives the same states as searching it at each voxel
+    snapshot.leaves.clear();
+    snapshot.knownLeaves.clear();
+    if (snapshot.n[0] <= 0 || snapshot.n[1] <= 0 || snapshot.n[2] <= 0) return;
+    point3d bmin(snapshot.pos[0], snapshot.pos[1], snapshot.pos[2]);
+    point3d bmax(snapshot.pos[0] + (snapshot.n[0]-1)*size,
+                 snapshot.pos[1] + (snapshot.n[1]-1)*size,
+                 snapshot.pos[2] + (snapshot.n[2]-1)*size);
+    OcTree *maps[] = {m_map, m_knownMap};
+    std::vector<OGMapLeaf> *leaves[] = {&snapshot.leaves, &snapshot.knownLeaves};
+    for (int i=0; i<2; i++){
+        if (!maps[i]) continue;
+        for (OcTree::leaf_bbx_iterator it = maps[i]->begin_leafs_bbx(bmin, bmax),
+                 end = maps[i]->end_leafs_bbx(); it != end; ++it){
+            OGMapLeaf leaf;
+            point3d c = it.getCoordinate();
+            leaf.x = c.x();
+            leaf.y = c.y();
+            leaf.z = c.z();
+            leaf.size = it.getSize();
+            leaf.prob = it->getOccupancy();
+            leaves[i]->push_back(leaf);
+        }
+    }
+}
+
+// voxels [b, e) whose centers are in the leaf, false if there is no such voxel
+static bool leafRange(const double *pos, const short *n, double size,
+                      double x, double y, double z, double leafSize,
+                      int *b, int *e)
+{
+    double c[] = {x, y, z};
+    for (int i=0; i<3; i++){
+        // same as a key of octree, a leaf contains [c - leafSize/2, c + leafSize/2)
+        b[i] = (int)ceil((c[i] - leafSize/2 - pos[i])/size);
+        e[i] = (int)ceil((c[i] + leafSize/2 - pos[i])/size);
+        if (b[i] < 0) b[i] = 0;
+        if (e[i] > n[i]) e[i] = n[i];
+        if (b[i] >= e[i]) return false;
+    }
+    return true;
+}
+
+// fill voxels whose centers are in the leaf
+static void fillLeaf(const double *pos, const short *n, double size,
+                     double x, double y, double z, double leafSize,
+                     unsigned char value, unsigned char *cells)
+{
+    int b[3], e[3];
+    if (!leafRange(pos, n, size, x, y, z, leafSize, b, e)) return;
+    for (int i=b[0]; i<e[0]; i++){
+        for (int j=b[1]; j<e[1]; j++){
+            memset(cells + ((size_t)i*n[1] + j)*n[2] + b[2], value, e[2] - b[2]);
+        }
+    }
+}
+
+void OccupancyGridMap3D::rasterize(const OGMapSnapshot& snapshot, unsigned char *cells)
+{
+    const short *n = snapshot.n;
+    if (n[0] <= 0 || n[1] <= 0 || n[2] <= 0) return;
+    memset(cells, OpenHRP::gridUnknown, (size_t)n[0]*n[1]*n[2]);
+    for (size_t i=0; i<snapshot.leaves.size(); i++){
+        const OGMapLeaf& leaf = snapshot.leaves[i];
+        unsigned char value = leaf.prob >= snapshot.occupiedThd ? (unsigned char)(leaf.prob*0xfe) : OpenHRP::gridEmpty;
+        fillLeaf(snapshot.pos, n, snapshot.resolution, leaf.x, leaf.y, leaf.z, leaf.size, value, cells);
+    }
+    // occupied voxels in the known map overwrite the map
+    for (size_t i=0; i<snapshot.knownLeaves.size(); i++){
+        const OGMapLeaf& leaf = snapshot.knownLeaves[i];
+        if (leaf.prob < snapshot.occupiedThd) continue;
+        fillLeaf(snapshot.pos, n, snapshot.resolution, leaf.x, leaf.y, leaf.z, leaf.size, (unsigned char)(leaf.prob*0xfe), cells);
+    }
+}
+
+// voxels [b, e) of a column along Z axis which have the same state
+struct ColumnSegment
+{
+    int b, e;
+    unsigned char value;
+    bool operator<(const ColumnSegment& s) const { return b < s.b; }
+};
+
+// leaf whose voxel state is decided
+struct LeafState
+{
+    double x, y, z, size;
+    unsigned char value;
+};
+
+// segments of leaves grouped by columns, segments of the column c are
+// segments[offsets[c]] ... segments[offsets[c+1]-1] and they don't overlap
+static void bucketSegments(const double *pos, const short *n, double size,
+                           const std::vector<LeafState>& leaves,
+                           std::vector<unsigned int>& offsets,
+                           std::vector<ColumnSegment>& segments)
+{
+    offsets.assign((size_t)n[0]*n[1] + 1, 0);
+    int b[3], e[3];
+    for (int pass=0; pass<2; pass++){
+        for (size_t l=0; l<leaves.size(); l++){
+            const LeafState& leaf = leaves[l];
+            if (!leafRange(pos, n, size, leaf.x, leaf.y, leaf.z, leaf.size, b, e)) continue;
+            for (int i=b[0]; i<e[0]; i++){
+                for (int j=b[1]; j<e[1]; j++){
+                    size_t c = (size_t)i*n[1] + j;
+                    if (pass == 0){
+                        offsets[c+1]++;
                     }else{
-                        map->cells[rank] = OpenHRP::gridUnknown;
-                        nu++;
-                    }
-                    if (m_knownMap){
-                        OcTreeNode *result = m_knownMap->search(p);
-                        if (result){
-                            double prob = result->getOccupancy();
-                            if (prob >= m_occupiedThd){
-                                map->cells[rank] = prob*0xfe;
-                            }
-                        }
+                        ColumnSegment& s = segments[offsets[c]++];
+                        s.b = b[2];
+                        s.e = e[2];
+                        s.value = leaf.value;
                     }
-                    rank++;
                 }
             }
         }
-#if 0
-        std::cout << "occupied/empty/unknown = " << no << "/" << ne << "/" 
-                  << nu << std::endl;
-#endif
+        if (pass == 0){
+            for (size_t c=0; c+1<offsets.size(); c++) offsets[c+1] += offsets[c];
+            segments.resize(offsets.back());
+        }else{
+            // offsets[c] is moved to the beginning of the column c+1
+            for (size_t c=offsets.size()-1; c>0; c--) offsets[c] = offsets[c-1];
+            offsets[0] = 0;
+        }
     }
+    for (size_t c=0; c+1<offsets.size(); c++){
+        std::sort(segments.begin() + offsets[c], segments.begin() + offsets[c+1]);
+    }
+}
+
+void OccupancyGridMap3D::encode(const OGMapSnapshot& snapshot, std::vector<OpenHRP::OGMap3DRun>& runs)
+{
+    runs.clear();
+    const short *n = snapshot.n;
+    if (n[0] <= 0 || n[1] <= 0 || n[2] <= 0) return;
+    // leaves of the known map are used only if they are occupied, same as rasterize()
+    std::vector<LeafState> leaves, knownLeaves;
+    for (size_t i=0; i<snapshot.leaves.size(); i++){
+        const OGMapLeaf& leaf = snapshot.leaves[i];
+        LeafState l = {leaf.x, leaf.y, leaf.z, leaf.size,
+                       leaf.prob >= snapshot.occupiedThd ? (unsigned char)(leaf.prob*0xfe) : OpenHRP::gridEmpty};
+        leaves.push_back(l);
+    }
+    for (size_t i=0; i<snapshot.knownLeaves.size(); i++){
+        const OGMapLeaf& leaf = snapshot.knownLeaves[i];
+        if (leaf.prob < snapshot.occupiedThd) continue;
+        LeafState l = {leaf.x, leaf.y, leaf.z, leaf.size, (unsigned char)(leaf.prob*0xfe)};
+        knownLeaves.push_back(l);
+    }
+    std::vector<unsigned int> offsets, knownOffsets;
+    std::vector<ColumnSegment> segments, knownSegments, column;
+    bucketSegments(snapshot.pos, n, snapshot.resolution, leaves, offsets, segments);
+    bucketSegments(snapshot.pos, n, snapshot.resolution, knownLeaves, knownOffsets, knownSegments);
+
+    for (size_t c=0; c+1<offsets.size(); c++){
+        // segments of the map which are not covered by the known map
+        column.assign(knownSegments.begin() + knownOffsets[c], knownSegments.begin() + knownOffsets[c+1]);
+        size_t k = knownOffsets[c], kend = knownOffsets[c+1];
+        for (size_t m=offsets[c]; m<offsets[c+1]; m++){
+            ColumnSegment s = segments[m];
+            while (k < kend && knownSegments[k].e <= s.b) k++;
+            for (size_t q=k; q<kend && knownSegments[q].b < s.e; q++){
+                if (knownSegments[q].b > s.b){
+                    ColumnSegment r = s;
+                    r.e = knownSegments[q].b;
+                    column.push_back(r);
+                }
+                if (knownSegments[q].e > s.b) s.b = knownSegments[q].e;
+            }
+            if (s.b < s.e) column.push_back(s);
+        }
+        std::sort(column.begin(), column.end());
+        // voxels which are not covered by segments are unknown and not sent
+        for (size_t i=0; i<column.size(); i++){
+            unsigned long index = c*n[2] + column[i].b;
+            unsigned long length = column[i].e - column[i].b;
+            if (!runs.empty() && runs.back().value == column[i].value
+                && runs.back().index + runs.back().length == index){
+                runs.back().length += length;
+            }else{
+                OpenHRP::OGMap3DRun run;
+                run.index = index;
+                run.length = length;
+                run.value = column[i].value;
+                runs.push_back(run);
+            }
+        }
+    }
+}
+
+OpenHRP::OGMap3D* OccupancyGridMap3D::getOGMap3D(const OpenHRP::AABB& region)
+{
+    coil::TimeValue t1(coil::gettimeofday());
+
+    OGMapSnapshot snapshot;
+    takeSnapshot(region, snapshot);
+
+    OpenHRP::OGMap3D *map = new OpenHRP::OGMap3D;
+    map->resolution = snapshot.resolution;
+    map->pos.x = snapshot.pos[0];
+    map->pos.y = snapshot.pos[1];
+    map->pos.z = snapshot.pos[2];
+    map->nx = snapshot.n[0];
+    map->ny = snapshot.n[1];
+    map->nz = snapshot.n[2];
+    map->cells.length(map->nx*map->ny*map->nz);
+    rasterize(snapshot, map->cells.get_buffer());
+
     coil::TimeValue t2(coil::gettimeofday());
     if (m_debugLevel > 0){
         coil::TimeValue dt = t2-t1;
@@ -614,19 +836,136 @@ OpenHRP::OGMap3D* OccupancyGridMap3D::getOGMap3D(const OpenHRP::AABB& region)
     return map;
 }
 
+OpenHRP::SparseOGMap3D* OccupancyGridMap3D::getSparseOGMap3D(const OpenHRP::AABB& region)
+{
+    coil::TimeValue t1(coil::gettimeofday());
+
+    OGMapSnapshot snapshot;
+    takeSnapshot(region, snapshot);
+
+    OpenHRP::SparseOGMap3D *map = new OpenHRP::SparseOGMap3D;
+    map->resolution = snapshot.resolution;
+    map->pos.x = snapshot.pos[0];
+    map->pos.y = snapshot.pos[1];
+    map->pos.z = snapshot.pos[2];
+    map->nx = snapshot.n[0];
+    map->ny = snapshot.n[1];
+    map->nz = snapshot.n[2];
+    // runs are made from leaves, the grid is not rasterized
+    std::vector<OpenHRP::OGMap3DRun> runs;
+    encode(snapshot, runs);
+    unsigned int nruns = runs.size();
+    map->runs.length(nruns);
+    for (unsigned int i=0; i<nruns; i++) map->runs[i] = runs[i];
+
+    coil::TimeValue t2(coil::gettimeofday());
+    if (m_debugLevel > 0){
+        coil::TimeValue dt = t2-t1;
+        std::cout << "OccupancyGridMap3D::getSparseOGMap3D() : " 
+                  << dt.sec()*1e3+dt.usec()/1e3 << "[ms], "
+                  << nruns << " runs" << std::endl;
+    }
+
+    return map;
+}
+
 void OccupancyGridMap3D::save(const char *filename)
 {
     Guard guard(m_mutex);
+    // write with the threshold of the tree before occupiedThd is applied
+    double thd = m_map->getOccupancyThres();
+    m_map->setOccupancyThres(m_savedOccupancyThd);
     m_map->writeBinary(filename);
+    m_map->setOccupancyThres(thd);
 }
 
 void OccupancyGridMap3D::clear()
 {
     Guard guard(m_mutex);
     m_map->clear();
+    m_map->resetChangeDetection();
+    writeMapDelta(true);
     m_updateOut.write();
 }
 
+void OccupancyGridMap3D::writeMapDelta(bool cleared)
+{
+    double size = m_map->getResolution();
+    m_mapDelta.resolution = size;
+    m_mapDelta.cleared = cleared;
+    m_mapDelta.voxels.length(m_map->numChangesDetected());
+    unsigned int n = 0;
+    for (KeyBoolMap::const_iterator it = m_map->changedKeysBegin();
+         it != m_map->changedKeysEnd(); ++it, n++){
+        setVoxel(m_mapDelta.voxels[n], m_map->keyToCoord(it->first),
+                 m_map->search(it->first));
+    }
+    m_map->resetChangeDetection();
+    publishMapDelta();
+}
+
+void OccupancyGridMap3D::writeMap()
+{
+    double size = m_map->getResolution();
+    m_mapDelta.resolution = size;
+    m_mapDelta.cleared = true;
+    // pruned leaves are sent as voxels of the resolution
+    unsigned int n = 0;
+    for (OcTree::leaf_iterator it = m_map->begin_leafs(); it != m_map->end_leafs(); ++it){
+        unsigned int m = (unsigned int)(it.getSize()/size + 0.5);
+        n += m*m*m;
+    }
+    m_mapDelta.voxels.length(n);
+    n = 0;
+    for (OcTree::leaf_iterator it = m_map->begin_leafs(); it != m_map->end_leafs(); ++it){
+        unsigned int m = (unsigned int)(it.getSize()/size + 0.5);
+        point3d c = it.getCoordinate();
+        double offset = (m - 1)*size/2;
+        for (unsigned int i=0; i<m; i++){
+            for (unsigned int j=0; j<m; j++){
+                for (unsigned int k=0; k<m; k++){
+                    point3d p(c.x() - offset + i*size,
+                              c.y() - offset + j*size,
+                              c.z() - offset + k*size);
+                    setVoxel(m_mapDelta.voxels[n++], p, &(*it));
+                }
+            }
+        }
+    }
+    m_map->resetChangeDetection();
+    publishMapDelta();
+}
+
+void OccupancyGridMap3D::setVoxel(OpenHRP::OGMap3DVoxel& voxel, const point3d& p, OcTreeNode *node)
+{
+    double size = m_map->getResolution();
+    voxel.ix = (CORBA::Long)floor(p.x()/size);
+    voxel.iy = (CORBA::Long)floor(p.y()/size);
+    voxel.iz = (CORBA::Long)floor(p.z()/size);
+    // only the state is sent since changes of the probability which
+    // don't flip the state are not detected
+    if (node){
+        voxel.value = node->getOccupancy() >= m_appliedOccupiedThd ? OpenHRP::gridOccupied : OpenHRP::gridEmpty;
+    }else{
+        voxel.value = OpenHRP::gridUnknown;
+    }
+    if (m_knownMap){
+        OcTreeNode *result = m_knownMap->search(p);
+        if (result && result->getOccupancy() >= m_appliedOccupiedThd){
+            voxel.value = OpenHRP::gridOccupied;
+        }
+    }
+}
+
+void OccupancyGridMap3D::publishMapDelta()
+{
+    coil::TimeValue tm(coil::gettimeofday());
+    m_mapDelta.tm.sec = tm.sec();
+    m_mapDelta.tm.nsec = tm.usec()*1000;
+    m_mapDelta.seq++;
+    m_mapDeltaOut.write();
+}
+
 extern "C"
 {
 
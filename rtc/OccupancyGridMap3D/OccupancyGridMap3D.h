@@ -18,10 +18,8 @@
 #include <rtm/idl/BasicDataTypeSkel.h>
 #include <rtm/idl/InterfaceDataTypes.hh>
 #include "pointcloud.hh"
-
-namespace octomap{
-    class OcTree;
-};
+#include "PointCloudInserter.h"
+#include <vector>
 
 
 // Service implementation headers
@@ -104,6 +102,7 @@ class OccupancyGridMap3D
   // virtual RTC::ReturnCode_t onRateChanged(RTC::UniqueId ec_id);
 
   OpenHRP::OGMap3D* getOGMap3D(const OpenHRP::AABB& region);
+  OpenHRP::SparseOGMap3D* getSparseOGMap3D(const OpenHRP::AABB& region);
   void save(const char *filename);
   void clear();
 
@@ -130,10 +129,12 @@ class OccupancyGridMap3D
   // </rtc-template>
 
   TimedLong m_updateSignal;
+  OpenHRP::TimedOGMap3DDelta m_mapDelta;
 
   // DataOutPort declaration
   // <rtc-template block="outport_declare">
   OutPort<TimedLong> m_updateOut;
+  OutPort<OpenHRP::TimedOGMap3DDelta> m_mapDeltaOut;
   
   // </rtc-template>
 
@@ -155,13 +156,72 @@ class OccupancyGridMap3D
   // </rtc-template>
 
  private:
+  struct OGMapLeaf
+  {
+    double x, y, z; ///< center of leaf
+    double size;    ///< length of edges
+    double prob;    ///< occupancy probability
+  };
+  /**
+     \brief grid of a region and leaves of the octrees in it, which are copied while m_mutex is locked
+  */
+  struct OGMapSnapshot
+  {
+    double resolution;
+    double pos[3]; ///< center of the voxel which has smallest x, y and z values
+    short n[3];    ///< the number of voxels along X, Y and Z axes
+    double occupiedThd;
+    std::vector<OGMapLeaf> leaves, knownLeaves;
+  };
+  void takeSnapshot(const OpenHRP::AABB& region, OGMapSnapshot& snapshot);
+  /**
+     \brief fill voxel states of the grid, which are ordered as OGMap3D::cells
+  */
+  void rasterize(const OGMapSnapshot& snapshot, unsigned char *cells);
+  /**
+     \brief compute runs of voxel states of the grid which are the same as
+     run length encoded cells of rasterize(), without allocating the grid
+  */
+  void encode(const OGMapSnapshot& snapshot, std::vector<OpenHRP::OGMap3DRun>& runs);
+  /**
+     \brief write voxels whose states are changed since the previous call to mapDelta port.
+     m_mutex must be locked.
+     \param cleared true if the map is cleared
+  */
+  void writeMapDelta(bool cleared = false);
+  /**
+     \brief write all voxels of the map to mapDelta port with cleared = true,
+     which is used when the states of voxels are changed by occupiedThd.
+     m_mutex must be locked.
+  */
+  void writeMap();
+  /**
+     \brief set the state of a voxel whose center is p
+     \param node leaf of m_map, or NULL if the voxel is unknown
+  */
+  void setVoxel(OpenHRP::OGMap3DVoxel& voxel, const octomap::point3d& p, octomap::OcTreeNode *node);
+  /**
+     \brief write m_mapDelta whose voxels are filled
+  */
+  void publishMapDelta();
+  /**
+     \brief insert a point cloud with octomap or PointCloudInserter if insertThreads > 0
+  */
+  void insertPointCloud(const octomap::Pointcloud& cloud, const octomap::point3d& sensor, const octomap::pose6d& frame);
+
   octomap::OcTree *m_map, *m_knownMap;
   double m_occupiedThd, m_resolution;
+  double m_savedOccupancyThd;
+  double m_appliedOccupiedThd; ///< occupiedThd which is set to m_map
   std::string m_initialMap;
   std::string m_knownMapPath;
   std::string m_cwd;
   coil::Mutex m_mutex;
   int m_debugLevel;
+  int m_insertThreads;
+  double m_maxRange;
+  bool m_voxelDedup;
+  PointCloudInserter m_inserter;
   int dummy;
 };
 
@@ -0,0 +1,217 @@
+// -*- C++ -*-
+/*!
+ * @file  PointCloudInserter.cpp
+ * @brief multithreaded point cloud insertion into an octree
+ * $Date$
+ *
+ * $Id$
+ */
+
+#include "PointCloudInserter.h"
+#include <coil/Guard.h>
+#include <algorithm>
+
+typedef coil::Guard<coil::Mutex> Guard;
+
+using namespace octomap;
+
+// the number of end points processed by a thread at once
+static const size_t chunk_size = 256;
+
+PointCloudInserterWorker::PointCloudInserterWorker(PointCloudInserter *inserter, int id)
+    : m_inserter(inserter), m_id(id)
+{
+}
+
+int PointCloudInserterWorker::svc(void)
+{
+    unsigned long job = 0;
+    while (m_inserter->waitForJob(job)){
+        m_inserter->processChunks(m_id);
+        m_inserter->finishJob();
+    }
+    return 0;
+}
+
+PointCloudInserter::PointCloudInserter()
+    : m_cond(m_mutex), m_running(true), m_job(0), m_finished(0), m_next(0),
+      m_maxRange(-1), m_dedup(true), m_tree(NULL), m_castRays(true),
+      m_free(1), m_occupied(1), m_rays(1)
+{
+}
+
+PointCloudInserter::~PointCloudInserter()
+{
+    setNumThreads(1);
+}
+
+void PointCloudInserter::setNumThreads(int n)
+{
+    if (n < 1) n = 1;
+    if (n == numThreads()) return;
+    {
+        Guard guard(m_mutex);
+        m_running = false;
+        m_cond.broadcast();
+    }
+    for (unsigned int i=0; i<m_workers.size(); i++){
+        m_workers[i]->wait();
+        delete m_workers[i];
+    }
+    m_workers.clear();
+    // new workers wait for the first job
+    m_running = true;
+    m_job = 0;
+    m_free.resize(n);
+    m_occupied.resize(n);
+    m_rays.resize(n);
+    for (int i=1; i<n; i++){
+        PointCloudInserterWorker *worker = new PointCloudInserterWorker(this, i);
+        worker->activate();
+        m_workers.push_back(worker);
+    }
+}
+
+size_t PointCloudInserter::computeUpdate(const OcTree& tree,
+                                         const Pointcloud& scan,
+                                         const point3d& sensor_origin,
+                                         const pose6d& frame_origin)
+{
+    m_tree = &tree;
+    m_castRays = true;
+    m_origin = frame_origin.transform(sensor_origin);
+    m_ends.clear();
+    m_hits.clear();
+    m_seenHits.clear();
+    m_seenMisses.clear();
+    m_ends.reserve(scan.size());
+    for (Pointcloud::const_iterator it = scan.begin(); it != scan.end(); it++){
+        point3d p = frame_origin.transform(*it);
+        if (m_maxRange > 0 && (p - m_origin).norm() > m_maxRange){
+            addEndPoint(m_origin + (p - m_origin).normalized()*m_maxRange, false);
+        }else{
+            addEndPoint(p, true);
+        }
+    }
+    run();
+    return m_ends.size();
+}
+
+size_t PointCloudInserter::computeUpdate(const OcTree& tree,
+                                         const Pointcloud& points,
+                                         const std::vector<bool>& occupied)
+{
+    m_tree = &tree;
+    m_castRays = false;
+    m_ends.clear();
+    m_hits.clear();
+    m_seenHits.clear();
+    m_seenMisses.clear();
+    m_ends.reserve(points.size());
+    size_t i = 0;
+    for (Pointcloud::const_iterator it = points.begin(); it != points.end(); it++, i++){
+        addEndPoint(*it, occupied[i]);
+    }
+    run();
+    return m_ends.size();
+}
+
+void PointCloudInserter::addEndPoint(const point3d& p, bool hit)
+{
+    if (m_dedup){
+        OcTreeKey key;
+        if (!m_tree->coordToKeyChecked(p, key)) return;
+        KeySet& seen = hit ? m_seenHits : m_seenMisses;
+        if (!seen.insert(key).second) return;
+    }
+    m_ends.push_back(p);
+    m_hits.push_back(hit);
+}
+
+void PointCloudInserter::run()
+{
+    m_free[0].clear();
+    m_occupied[0].clear();
+    m_next = 0;
+    if (m_workers.empty() || m_ends.size() <= chunk_size){
+        processChunks(0);
+        return;
+    }
+    {
+        Guard guard(m_mutex);
+        m_job++;
+        m_finished = 0;
+        m_cond.broadcast();
+    }
+    processChunks(0);
+    {
+        Guard guard(m_mutex);
+        while (m_finished < m_workers.size()) m_cond.wait();
+    }
+    for (unsigned int i=1; i<m_free.size(); i++){
+        m_free[0].insert(m_free[i].begin(), m_free[i].end());
+        m_occupied[0].insert(m_occupied[i].begin(), m_occupied[i].end());
+        m_free[i].clear();
+        m_occupied[i].clear();
+    }
+}
+
+bool PointCloudInserter::waitForJob(unsigned long& job)
+{
+    Guard guard(m_mutex);
+    while (m_running && m_job == job) m_cond.wait();
+    if (!m_running) return false;
+    job = m_job;
+    return true;
+}
+
+void PointCloudInserter::finishJob()
+{
+    Guard guard(m_mutex);
+    m_finished++;
+    m_cond.broadcast();
+}
+
+void PointCloudInserter::processChunks(int id)
+{
+    KeySet& free_cells = m_free[id];
+    KeySet& occupied_cells = m_occupied[id];
+    KeyRay& ray = m_rays[id];
+    OcTreeKey key;
+    while (1){
+        size_t begin = __sync_fetch_and_add(&m_next, chunk_size);
+        if (begin >= m_ends.size()) break;
+        size_t end = std::min(begin + chunk_size, m_ends.size());
+        for (size_t i=begin; i<end; i++){
+            const point3d& p = m_ends[i];
+            if (m_castRays){
+                if (m_tree->computeRayKeys(m_origin, p, ray)){
+                    free_cells.insert(ray.begin(), ray.end());
+                }
+                // end points of truncated rays are not observed
+                if (!m_hits[i]) continue;
+            }
+            if (m_tree->coordToKeyChecked(p, key)){
+                if (m_hits[i]){
+                    occupied_cells.insert(key);
+                }else{
+                    free_cells.insert(key);
+                }
+            }
+        }
+    }
+}
+
+void PointCloudInserter::applyUpdate(OcTree& tree)
+{
+    KeySet& free_cells = m_free[0];
+    KeySet& occupied_cells = m_occupied[0];
+    for (KeySet::iterator it = free_cells.begin(); it != free_cells.end(); it++){
+        if (occupied_cells.find(*it) == occupied_cells.end()){
+            tree.updateNode(*it, false);
+        }
+    }
+    for (KeySet::iterator it = occupied_cells.begin(); it != occupied_cells.end(); it++){
+        tree.updateNode(*it, true);
+    }
+}
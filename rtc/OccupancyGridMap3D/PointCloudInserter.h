@@ -0,0 +1,120 @@
+// -*- C++ -*-
+/*!
+ * @file  PointCloudInserter.h
+ * @brief multithreaded point cloud insertion into an octree
+ * @date  $Date$
+ *
+ * $Id$
+ */
+
+#ifndef POINT_CLOUD_INSERTER_H
+#define POINT_CLOUD_INSERTER_H
+
+#include <coil/Task.h>
+#include <coil/Mutex.h>
+#include <coil/Condition.h>
+#include <octomap/octomap.h>
+#include <vector>
+
+class PointCloudInserter;
+
+class PointCloudInserterWorker : public coil::Task
+{
+public:
+    PointCloudInserterWorker(PointCloudInserter *inserter, int id);
+    int svc(void);
+private:
+    PointCloudInserter *m_inserter;
+    int m_id;
+};
+
+/**
+   \brief insert point clouds into an octree in three steps. Rays are
+   decimated first, voxels hit or passed through by the rays are then
+   computed in parallel into key sets of each thread, and the merged key
+   sets are applied to the octree at once. The octree is only read while
+   voxels are computed, so it can be locked only while the update is applied.
+ */
+class PointCloudInserter
+{
+public:
+    PointCloudInserter();
+    ~PointCloudInserter();
+    /**
+       \brief set the number of threads including the caller thread
+     */
+    void setNumThreads(int n);
+    int numThreads() const { return m_workers.size() + 1; }
+    /**
+       \brief rays longer than maxRange are truncated and their end points
+       are not regarded as occupied. Negative value means no limit.
+     */
+    void setMaxRange(double r) { m_maxRange = r; }
+    /**
+       \brief cast only one ray for each voxel hit by the points
+     */
+    void setDeduplication(bool on) { m_dedup = on; }
+    /**
+       \brief compute voxels passed through by rays from sensor_origin
+       to points and voxels hit by the points. The octree is not modified.
+       \param tree octree which gives resolution and bounds of keys
+       \param scan points in the frame_origin coordinates
+       \param sensor_origin origin of rays in the frame_origin coordinates
+       \param frame_origin frame of scan in the world coordinates
+       \return the number of rays after decimation
+     */
+    size_t computeUpdate(const octomap::OcTree& tree,
+                         const octomap::Pointcloud& scan,
+                         const octomap::point3d& sensor_origin,
+                         const octomap::pose6d& frame_origin);
+    /**
+       \brief compute voxels which contain labelled points, no rays are cast
+       \param tree octree which gives resolution and bounds of keys
+       \param points points in the world coordinates
+       \param occupied labels of points, true if occupied
+       \return the number of points after decimation
+     */
+    size_t computeUpdate(const octomap::OcTree& tree,
+                         const octomap::Pointcloud& points,
+                         const std::vector<bool>& occupied);
+    /**
+       \brief apply the update computed by computeUpdate() to the octree.
+       Occupied voxels take priority over free ones.
+     */
+    void applyUpdate(octomap::OcTree& tree);
+    size_t numFreeCells() const { return m_free[0].size(); }
+    size_t numOccupiedCells() const { return m_occupied[0].size(); }
+
+    // called from worker threads
+    bool waitForJob(unsigned long& job);
+    void processChunks(int id);
+    void finishJob();
+private:
+    void addEndPoint(const octomap::point3d& p, bool hit);
+    void run();
+
+    std::vector<PointCloudInserterWorker *> m_workers;
+    coil::Mutex m_mutex;
+    coil::Condition<coil::Mutex> m_cond;
+    bool m_running;
+    unsigned long m_job;
+    unsigned int m_finished;
+    volatile size_t m_next; ///< index of the first end point not processed yet
+
+    double m_maxRange;
+    bool m_dedup;
+
+    // inputs of a job
+    const octomap::OcTree *m_tree;
+    bool m_castRays;
+    octomap::point3d m_origin;
+    std::vector<octomap::point3d> m_ends;
+    std::vector<bool> m_hits;
+    octomap::KeySet m_seenHits, m_seenMisses;
+
+    // outputs of each thread
+    std::vector<octomap::KeySet> m_free, m_occupied;
+    std::vector<octomap::KeyRay> m_rays;
+};
+
+#endif // POINT_CLOUD_INSERTER_H
@@ -0,0 +1,266 @@
+/* -*- coding:utf-8-unix; mode:c++; -*- */
+
+#include "PointCloudInserter.h"
+/* samples */
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <sys/time.h>
+
+#ifndef deg2rad
+#define deg2rad(deg) (deg * M_PI / 180)
+#endif
+
+using namespace octomap;
+
+class testPointCloudInserter
+{
+protected:
+    int loop, threads;
+    double resolution, max_range;
+    std::string log_file;
+    std::vector<Pointcloud> scans;
+    double get_time ()
+    {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return tv.tv_sec + tv.tv_usec * 1e-6;
+    };
+    // scan of a 64 beam lidar at (0, 0, 1) in a 10x8x3[m] room, rotated by yaw
+    void makeScan (Pointcloud& scan, double yaw)
+    {
+        const double half[3] = {5.0, 4.0, 1.5}, center[3] = {0, 0, 0.5};
+        for (int i = 0; i < 64; i++) {
+            double el = deg2rad(-25.0 + 40.0 * i / 63);
+            for (int j = 0; j < 1024; j++) {
+                double az = yaw + 2 * M_PI * j / 1024;
+                double d[3] = {cos(el) * cos(az), cos(el) * sin(az), sin(el)};
+                // distance to the nearest wall
+                double t = 1e10;
+                for (int k = 0; k < 3; k++) {
+                    if (d[k] > 1e-9) t = std::min(t, (center[k] + half[k]) / d[k]);
+                    else if (d[k] < -1e-9) t = std::min(t, (center[k] - half[k]) / d[k]);
+                }
+                t += 0.01 * sin(37.0 * az + 11.0 * el); // noise
+                scan.push_back(point3d(t * d[0], t * d[1], t * d[2]));
+            }
+        }
+    };
+    // DataLogger writes NaN as nan, which operator>> can't parse
+    bool readValue (std::istream& is, double& value)
+    {
+        std::string token;
+        if (!(is >> token)) return false;
+        char *end;
+        value = strtod(token.c_str(), &end);
+        return end != token.c_str() && *end == '\0';
+    };
+    bool loadLog (const std::string& filename)
+    {
+        std::ifstream ifs(filename.c_str());
+        if (!ifs.is_open()) {
+            std::cerr << "[testPointCloudInserter] can't open " << filename << std::endl;
+            return false;
+        }
+        double tm, v[6];
+        int w, h, npoint;
+        std::string type;
+        while (readValue(ifs, tm)) {
+            if (!(ifs >> w >> h >> type >> npoint) || npoint < 0) break;
+            int nvalues = type == "xyzrgb" ? 6 : 3;
+            Pointcloud scan;
+            int i;
+            for (i = 0; i < npoint; i++) {
+                int k;
+                for (k = 0; k < nvalues && readValue(ifs, v[k]); k++);
+                if (k < nvalues) break;
+                if (!std::isnan(v[0])) scan.push_back(point3d(v[0], v[1], v[2]));
+            }
+            if (i < npoint) {
+                std::cerr << "[testPointCloudInserter] " << filename << " is truncated or broken" << std::endl;
+                break;
+            }
+            scans.push_back(scan);
+        }
+        return !scans.empty();
+    };
+    void prepareScans ()
+    {
+        scans.clear();
+        if (log_file != "") {
+            if (loadLog(log_file)) return;
+            scans.clear();
+        }
+        for (int i = 0; i < 4; i++) {
+            scans.push_back(Pointcloud());
+            makeScan(scans.back(), deg2rad(10.0) * i);
+        }
+    };
+    // returns the number of leaves whose occupancies differ
+    size_t compareTrees (OcTree& t1, OcTree& t2, bool occupied_only)
+    {
+        size_t ndiff = 0;
+        OcTree* trees[2] = {&t1, &t2};
+        for (int k = 0; k < 2; k++) {
+            OcTree* other = trees[1 - k];
+            for (OcTree::leaf_iterator it = trees[k]->begin_leafs(); it != trees[k]->end_leafs(); ++it) {
+                if (occupied_only && !trees[k]->isNodeOccupied(*it)) continue;
+                OcTreeNode* node = other->search(it.getKey());
+                if (!node) {
+                    ndiff++;
+                } else if (occupied_only) {
+                    if (!other->isNodeOccupied(node)) ndiff++;
+                } else if (fabs(node->getLogOdds() - it->getLogOdds()) > 1e-6) {
+                    ndiff++;
+                }
+            }
+        }
+        return ndiff;
+    };
+    void insert (OcTree& tree, PointCloudInserter& inserter, size_t& nrays, size_t nscans)
+    {
+        point3d origin(0, 0, 0);
+        pose6d frame(0, 0, 1, 0, 0, 0);
+        nrays = 0;
+        for (int i = 0; i < loop; i++) {
+            for (size_t j = 0; j < nscans; j++) {
+                nrays += inserter.computeUpdate(tree, scans[j], origin, frame);
+                inserter.applyUpdate(tree);
+            }
+        }
+    };
+public:
+    std::vector<std::string> arg_strs;
+    testPointCloudInserter() : loop(1), threads(4), resolution(0.05), max_range(-1)
+    {
+    };
+    bool test0 ()
+    {
+        std::cerr << "[testPointCloudInserter] test0 : compare with OcTree::insertPointCloud" << std::endl;
+        prepareScans();
+        bool ret = true;
+        double ranges[2] = {-1, 3.0};
+        for (int r = 0; r < 2; r++) {
+            // maps made from all scans and from the first scan
+            OcTree ref(resolution), ref_first(resolution);
+            point3d origin(0, 0, 0);
+            pose6d frame(0, 0, 1, 0, 0, 0);
+            for (size_t j = 0; j < scans.size(); j++) {
+                ref.insertPointCloud(scans[j], origin, frame, ranges[r]);
+            }
+            ref_first.insertPointCloud(scans[0], origin, frame, ranges[r]);
+            int nthreads[2] = {1, threads};
+            for (int k = 0; k < 2; k++) {
+                for (int dedup = 0; dedup < 2; dedup++) {
+                    OcTree tree(resolution);
+                    PointCloudInserter inserter;
+                    inserter.setNumThreads(nthreads[k]);
+                    inserter.setMaxRange(ranges[r]);
+                    inserter.setDeduplication(dedup);
+                    size_t nrays;
+                    // rays decimated by voxels pass through slightly different voxels,
+                    // so only occupied voxels of the first scan are compared
+                    insert(tree, inserter, nrays, dedup ? 1 : scans.size());
+                    size_t ndiff = compareTrees(dedup ? ref_first : ref, tree, dedup);
+                    std::cerr << "[testPointCloudInserter]   maxRange = " << ranges[r] << ", " << nthreads[k] << " threads, "
+                              << (dedup ? "dedup" : "no dedup") << " : " << nrays << " rays, "
+                              << ndiff << (dedup ? " different occupied voxels" : " different voxels") << std::endl;
+                    ret = ret && ndiff == 0;
+                }
+            }
+        }
+        return ret;
+    };
+    bool benchmark ()
+    {
+        parse_params();
+        prepareScans();
+        size_t npoints = 0;
+        for (size_t j = 0; j < scans.size(); j++) npoints += scans[j].size();
+        npoints *= loop;
+        std::cerr << "[testPointCloudInserter] benchmark : " << scans.size() << " scans x " << loop << " loops, "
+                  << npoints << " points, resolution = " << resolution << "[m], maxRange = " << max_range << "[m]" << std::endl;
+        {
+            OcTree tree(resolution);
+            point3d origin(0, 0, 0);
+            pose6d frame(0, 0, 1, 0, 0, 0);
+            double t0 = get_time();
+            for (int i = 0; i < loop; i++) {
+                for (size_t j = 0; j < scans.size(); j++) {
+                    tree.insertPointCloud(scans[j], origin, frame, max_range);
+                }
+            }
+            double t1 = get_time();
+            std::cerr << "[testPointCloudInserter]   OcTree::insertPointCloud : " << npoints / (t1 - t0) << "[points/s]" << std::endl;
+        }
+        int nthreads[2] = {1, threads};
+        for (int k = 0; k < 2; k++) {
+            for (int dedup = 0; dedup < 2; dedup++) {
+                OcTree tree(resolution);
+                PointCloudInserter inserter;
+                inserter.setNumThreads(nthreads[k]);
+                inserter.setMaxRange(max_range);
+                inserter.setDeduplication(dedup);
+                size_t nrays;
+                double t0 = get_time();
+                insert(tree, inserter, nrays, scans.size());
+                double t1 = get_time();
+                std::cerr << "[testPointCloudInserter]   PointCloudInserter(" << nthreads[k] << " threads, "
+                          << (dedup ? "dedup" : "no dedup") << ") : " << npoints / (t1 - t0) << "[points/s], "
+                          << nrays << " rays" << std::endl;
+            }
+        }
+        return true;
+    };
+    void parse_params ()
+    {
+        for (unsigned int i = 0; i < arg_strs.size(); ++ i) {
+            if ( arg_strs[i]== "--log" ) {
+                if (++i < arg_strs.size()) log_file = arg_strs[i];
+            } else if ( arg_strs[i]== "--loop" ) {
+                if (++i < arg_strs.size()) loop = atoi(arg_strs[i].c_str());
+            } else if ( arg_strs[i]== "--threads" ) {
+                if (++i < arg_strs.size()) threads = atoi(arg_strs[i].c_str());
+            } else if ( arg_strs[i]== "--resolution" ) {
+                if (++i < arg_strs.size()) resolution = atof(arg_strs[i].c_str());
+            } else if ( arg_strs[i]== "--maxRange" ) {
+                if (++i < arg_strs.size()) max_range = atof(arg_strs[i].c_str());
+            }
+        }
+    };
+};
+
+void print_usage ()
+{
+    std::cerr << "Usage : testPointCloudInserter [option]" << std::endl;
+    std::cerr << " [option] should be:" << std::endl;
+    std::cerr << "  --test0 : compare with OcTree::insertPointCloud" << std::endl;
+    std::cerr << "  --benchmark [--log file] [--loop n] [--threads n] [--resolution r] [--maxRange r] : measure inserted points per second." << std::endl;
+    std::cerr << "    file is a point cloud log of DataLogger, a synthetic scan of a 64 beam lidar is used if it is not given" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    int ret = 0;
+    if (argc >= 2) {
+        testPointCloudInserter tpci;
+        for (int i = 1; i < argc; ++ i) {
+            tpci.arg_strs.push_back(std::string(argv[i]));
+        }
+        if (std::string(argv[1]) == "--test0") {
+            ret = tpci.test0() ? 0 : 1;
+        } else if (std::string(argv[1]) == "--benchmark") {
+            ret = tpci.benchmark() ? 0 : 1;
+        } else {
+            print_usage();
+            ret = 1;
+        }
+    } else {
+        print_usage();
+        ret = 1;
+    }
+    return ret;
+}
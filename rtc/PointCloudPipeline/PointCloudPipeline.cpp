@@ -0,0 +1,230 @@
+// -*- C++ -*-
+/*!
+ * @file  PointCloudPipeline.cpp
+ * @brief chain of point cloud filters
+ * $Date$
+ *
+ * $Id$
+ */
+
+#include "PointCloudPipeline.h"
+
+// Module specification
+// <rtc-template block="module_spec">
+static const char* spec[] =
+  {
+    "implementation_id", "PointCloudPipeline",
+    "type_name",         "PointCloudPipeline",
+    "description",       "Point Cloud Pipeline",
+    "version",           HRPSYS_PACKAGE_VERSION,
+    "vendor",            "AIST",
+    "category",          "example",
+    "activity_type",     "DataFlowComponent",
+    "max_instance",      "10",
+    "language",          "C++",
+    "lang_type",         "compile",
+    // Configuration variables
+    "conf.default.stages", "VoxelGridFilter,SORFilter,PlaneRemover",
+    "conf.default.size", "0.01",
+    "conf.default.meanK", "50",
+    "conf.default.stddevMulThresh", "1.0",
+    "conf.default.radius", "0.03",
+    "conf.default.distanceThd", "0.02",
+    "conf.default.pointNumThd", "500",
+    "conf.default.debugLevel", "0",
+
+    ""
+  };
+// </rtc-template>
+
+PointCloudPipeline::PointCloudPipeline(RTC::Manager* manager)
+  : RTC::DataFlowComponentBase(manager),
+    // <rtc-template block="initializer">
+    m_originalIn("original", m_original),
+    m_filteredOut("filtered", m_filtered),
+    m_stageTimesOut("stageTimes", m_stageTimes),
+    // </rtc-template>
+    dummy(0),
+    m_chain(m_param)
+{
+}
+
+PointCloudPipeline::~PointCloudPipeline()
+{
+}
+
+
+
+RTC::ReturnCode_t PointCloudPipeline::onInitialize()
+{
+  //std::cout << m_profile.instance_name << ": onInitialize()" << std::endl;
+  // <rtc-template block="bind_config">
+  // Bind variables and configuration variable
+  bindParameter("stages", m_stages, "VoxelGridFilter,SORFilter,PlaneRemover");
+  bindParameter("size", m_param.size, "0.01");
+  bindParameter("meanK", m_param.meanK, "50");
+  bindParameter("stddevMulThresh", m_param.stddevMulThresh, "1.0");
+  bindParameter("radius", m_param.radius, "0.03");
+  bindParameter("distanceThd", m_param.distanceThd, "0.02");
+  bindParameter("pointNumThd", m_param.pointNumThd, "500");
+  bindParameter("debugLevel", m_debugLevel, "0");
+  
+  // </rtc-template>
+
+  // Registration: InPort/OutPort/Service
+  // <rtc-template block="registration">
+  // Set InPort buffers
+  addInPort("originalIn", m_originalIn);
+
+  // Set OutPort buffer
+  addOutPort("filteredOut", m_filteredOut);
+  addOutPort("stageTimes", m_stageTimesOut);
+  
+  // Set service provider to Ports
+  
+  // Set service consumers to Ports
+  
+  // Set CORBA Service Ports
+  
+  // </rtc-template>
+
+  m_filtered.height = 1;
+  m_filtered.type = "xyz";
+  m_filtered.fields.length(3);
+  m_filtered.fields[0].name = "x";
+  m_filtered.fields[0].offset = 0;
+  m_filtered.fields[0].data_type = PointCloudTypes::FLOAT32;
+  m_filtered.fields[0].count = 4;
+  m_filtered.fields[1].name = "y";
+  m_filtered.fields[1].offset = 4;
+  m_filtered.fields[1].data_type = PointCloudTypes::FLOAT32;
+  m_filtered.fields[1].count = 4;
+  m_filtered.fields[2].name = "z";
+  m_filtered.fields[2].offset = 8;
+  m_filtered.fields[2].data_type = PointCloudTypes::FLOAT32;
+  m_filtered.fields[2].count = 4;
+  m_filtered.is_bigendian = false;
+  m_filtered.point_step = 16;
+  m_filtered.is_dense = true;
+
+  return RTC::RTC_OK;
+}
+
+
+
+/*
+RTC::ReturnCode_t PointCloudPipeline::onFinalize()
+{
+  return RTC::RTC_OK;
+}
+*/
+
+/*
+RTC::ReturnCode_t PointCloudPipeline::onStartup(RTC::UniqueId ec_id)
+{
+  return RTC::RTC_OK;
+}
+*/
+
+/*
+RTC::ReturnCode_t PointCloudPipeline::onShutdown(RTC::UniqueId ec_id)
+{
+  return RTC::RTC_OK;
+}
+*/
+
+RTC::ReturnCode_t PointCloudPipeline::onActivated(RTC::UniqueId ec_id)
+{
+  std::cout << m_profile.instance_name<< ": onActivated(" << ec_id << ")" << std::endl;
+  return RTC::RTC_OK;
+}
+
+RTC::ReturnCode_t PointCloudPipeline::onDeactivated(RTC::UniqueId ec_id)
+{
+  std::cout << m_profile.instance_name<< ": onDeactivated(" << ec_id << ")" << std::endl;
+  return RTC::RTC_OK;
+}
+
+RTC::ReturnCode_t PointCloudPipeline::onExecute(RTC::UniqueId ec_id)
+{
+  //std::cout << m_profile.instance_name<< ": onExecute(" << ec_id << ")" << std::endl;
+
+  // stages are rebuilt when the configuration is changed
+  if (m_stages != m_chain.stageNames()){
+    if (!m_chain.setStages(m_stages)){
+      std::cerr << m_profile.instance_name << ": unknown stage is included in " << m_stages << std::endl;
+      return RTC::RTC_ERROR;
+    }
+    m_stageTimes.data.length(m_chain.numStages());
+  }
+
+  if (m_originalIn.isNew()){
+    m_originalIn.read();
+
+    m_chain.process(m_original, m_filtered);
+    m_filteredOut.write();
+
+    for (size_t i=0; i<m_chain.numStages(); i++){
+      m_stageTimes.data[i] = m_chain.stageTime(i);
+      if (m_debugLevel > 0){
+        std::cout << m_profile.instance_name << ": " << m_chain.stageName(i) << " "
+                  << m_chain.stageTime(i)*1e3 << "[ms], "
+                  << m_chain.stagePoints(i) << " points" << std::endl;
+      }
+    }
+    m_stageTimes.tm = m_original.tm;
+    m_stageTimesOut.write();
+  }
+
+  return RTC::RTC_OK;
+}
+
+/*
+RTC::ReturnCode_t PointCloudPipeline::onAborting(RTC::UniqueId ec_id)
+{
+  return RTC::RTC_OK;
+}
+*/
+
+/*
+RTC::ReturnCode_t PointCloudPipeline::onError(RTC::UniqueId ec_id)
+{
+  return RTC::RTC_OK;
+}
+*/
+
+/*
+RTC::ReturnCode_t PointCloudPipeline::onReset(RTC::UniqueId ec_id)
+{
+  return RTC::RTC_OK;
+}
+*/
+
+/*
+RTC::ReturnCode_t PointCloudPipeline::onStateUpdate(RTC::UniqueId ec_id)
+{
+  return RTC::RTC_OK;
+}
+*/
+
+/*
+RTC::ReturnCode_t PointCloudPipeline::onRateChanged(RTC::UniqueId ec_id)
+{
+  return RTC::RTC_OK;
+}
+*/
+
+
+
+extern "C"
+{
+
+  void PointCloudPipelineInit(RTC::Manager* manager)
+  {
+    RTC::Properties profile(spec);
+    manager->registerFactory(profile,
+                             RTC::Create<PointCloudPipeline>,
+                             RTC::Delete<PointCloudPipeline>);
+  }
+
+};
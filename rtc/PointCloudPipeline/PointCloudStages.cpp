@@ -0,0 +1,212 @@
+// -*- C++ -*-
+/*!
+ * @file  PointCloudStages.cpp
+ * @brief point cloud filters which are chained in a process
+ * $Date$
+ *
+ * $Id$
+ */
+
+#include <pcl/filters/voxel_grid.h>
+#include <pcl/filters/statistical_outlier_removal.h>
+#include <pcl/filters/extract_indices.h>
+#include <pcl/surface/mls.h>
+#include <pcl/segmentation/sac_segmentation.h>
+#include <coil/stringutil.h>
+#include <coil/Time.h>
+#include "PointCloudStages.h"
+
+PointCloudStageParam::PointCloudStageParam()
+    : size(0.01), meanK(50), stddevMulThresh(1.0), radius(0.03),
+      distanceThd(0.02), pointNumThd(500)
+{
+}
+
+class VoxelGridStage : public PointCloudStage
+{
+public:
+    VoxelGridStage(const PointCloudStageParam& param) : PointCloudStage(param) {}
+    const char *name() const { return "VoxelGridFilter"; }
+    void filter(const PointCloudXYZ::Ptr& input, PointCloudXYZ& output)
+    {
+        m_filter.setInputCloud(input);
+        m_filter.setLeafSize(m_param.size, m_param.size, m_param.size);
+        m_filter.filter(output);
+    }
+private:
+    pcl::VoxelGrid<pcl::PointXYZ> m_filter;
+};
+
+class SORStage : public PointCloudStage
+{
+public:
+    SORStage(const PointCloudStageParam& param) : PointCloudStage(param) {}
+    const char *name() const { return "SORFilter"; }
+    void filter(const PointCloudXYZ::Ptr& input, PointCloudXYZ& output)
+    {
+        m_filter.setInputCloud(input);
+        m_filter.setMeanK(m_param.meanK);
+        m_filter.setStddevMulThresh(m_param.stddevMulThresh);
+        m_filter.filter(output);
+    }
+private:
+    pcl::StatisticalOutlierRemoval<pcl::PointXYZ> m_filter;
+};
+
+class MLSStage : public PointCloudStage
+{
+public:
+    MLSStage(const PointCloudStageParam& param)
+        : PointCloudStage(param), m_tree(new pcl::search::KdTree<pcl::PointXYZ>)
+    {
+        m_mls.setPolynomialFit(true);
+        m_mls.setSearchMethod(m_tree);
+    }
+    const char *name() const { return "MLSFilter"; }
+    void filter(const PointCloudXYZ::Ptr& input, PointCloudXYZ& output)
+    {
+        m_mls.setInputCloud(input);
+        m_mls.setSearchRadius(m_param.radius);
+        m_mls.process(output);
+    }
+private:
+    pcl::search::KdTree<pcl::PointXYZ>::Ptr m_tree;
+    pcl::MovingLeastSquares<pcl::PointXYZ, pcl::PointXYZ> m_mls;
+};
+
+class PlaneRemoverStage : public PointCloudStage
+{
+public:
+    PlaneRemoverStage(const PointCloudStageParam& param)
+        : PointCloudStage(param),
+          m_coefficients(new pcl::ModelCoefficients),
+          m_inliers(new pcl::PointIndices),
+          m_remaining(new PointCloudXYZ)
+    {
+        m_seg.setOptimizeCoefficients(true);
+        m_seg.setModelType(pcl::SACMODEL_PLANE);
+        m_seg.setMethodType(pcl::SAC_RANSAC);
+        m_extract.setNegative(true);
+    }
+    const char *name() const { return "PlaneRemover"; }
+    void filter(const PointCloudXYZ::Ptr& input, PointCloudXYZ& output)
+    {
+        m_seg.setDistanceThreshold(m_param.distanceThd);
+        // remove planes one by one, m_remaining and input are reused as buffers
+        PointCloudXYZ::Ptr cloud = input, cloud_f = m_remaining;
+        while(1){
+            m_seg.setInputCloud(cloud);
+            m_seg.segment(*m_inliers, *m_coefficients);
+            if (m_inliers->indices.size() < (size_t)m_param.pointNumThd) break;
+            m_extract.setInputCloud(cloud);
+            m_extract.setIndices(m_inliers);
+            m_extract.filter(*cloud_f);
+            cloud.swap(cloud_f);
+        }
+        output.swap(*cloud);
+    }
+private:
+    pcl::SACSegmentation<pcl::PointXYZ> m_seg;
+    pcl::ExtractIndices<pcl::PointXYZ> m_extract;
+    pcl::ModelCoefficients::Ptr m_coefficients;
+    pcl::PointIndices::Ptr m_inliers;
+    PointCloudXYZ::Ptr m_remaining;
+};
+
+PointCloudStage *createPointCloudStage(const std::string& name, const PointCloudStageParam& param)
+{
+    if (name == "VoxelGridFilter"){
+        return new VoxelGridStage(param);
+    }else if (name == "SORFilter"){
+        return new SORStage(param);
+    }else if (name == "MLSFilter"){
+        return new MLSStage(param);
+    }else if (name == "PlaneRemover"){
+        return new PlaneRemoverStage(param);
+    }
+    return NULL;
+}
+
+void convertToPCL(const PointCloudTypes::PointCloud& input, PointCloudXYZ& output)
+{
+    output.points.resize(input.width*input.height);
+    output.width = output.points.size();
+    output.height = 1;
+    // the filter components give a newly constructed cloud to the filters,
+    // reset the flag which may be left by a previous stage of the chain
+    output.is_dense = true;
+    const float *src = (const float *)input.data.get_buffer();
+    for (unsigned int i=0; i<output.points.size(); i++){
+        output.points[i].x = src[0];
+        output.points[i].y = src[1];
+        output.points[i].z = src[2];
+        src += input.point_step/sizeof(float);
+    }
+}
+
+void convertFromPCL(const PointCloudXYZ& input, PointCloudTypes::PointCloud& output)
+{
+    output.width = input.points.size();
+    output.row_step = output.point_step*output.width;
+    output.data.length(output.height*output.row_step);
+    float *dst = (float *)output.data.get_buffer();
+    for (unsigned int i=0; i<input.points.size(); i++){
+        dst[0] = input.points[i].x;
+        dst[1] = input.points[i].y;
+        dst[2] = input.points[i].z;
+        dst += output.point_step/sizeof(float);
+    }
+}
+
+PointCloudStageChain::PointCloudStageChain(const PointCloudStageParam& param)
+    : m_param(param)
+{
+    m_clouds[0] = PointCloudXYZ::Ptr(new PointCloudXYZ);
+    m_clouds[1] = PointCloudXYZ::Ptr(new PointCloudXYZ);
+}
+
+PointCloudStageChain::~PointCloudStageChain()
+{
+    clearStages();
+}
+
+void PointCloudStageChain::clearStages()
+{
+    for (size_t i=0; i<m_stages.size(); i++) delete m_stages[i];
+    m_stages.clear();
+}
+
+bool PointCloudStageChain::setStages(const std::string& names)
+{
+    std::vector<PointCloudStage *> stages;
+    coil::vstring stage_names = coil::split(names, ",");
+    for (size_t i=0; i<stage_names.size(); i++){
+        PointCloudStage *stage = createPointCloudStage(stage_names[i], m_param);
+        if (!stage){
+            for (size_t j=0; j<stages.size(); j++) delete stages[j];
+            return false;
+        }
+        stages.push_back(stage);
+    }
+    clearStages();
+    m_stages = stages;
+    m_names = names;
+    m_times.assign(m_stages.size(), 0);
+    m_points.assign(m_stages.size(), 0);
+    return true;
+}
+
+void PointCloudStageChain::process(const PointCloudTypes::PointCloud& input, PointCloudTypes::PointCloud& output)
+{
+    convertToPCL(input, *m_clouds[0]);
+    for (size_t i=0; i<m_stages.size(); i++){
+        coil::TimeValue t1(coil::gettimeofday());
+        m_stages[i]->filter(m_clouds[0], *m_clouds[1]);
+        coil::TimeValue t2(coil::gettimeofday());
+        coil::TimeValue dt = t2-t1;
+        m_times[i] = dt.sec() + dt.usec()*1e-6;
+        m_points[i] = m_clouds[1]->points.size();
+        m_clouds[0].swap(m_clouds[1]);
+    }
+    convertFromPCL(*m_clouds[0], output);
+}
@@ -0,0 +1,101 @@
+// -*- C++ -*-
+/*!
+ * @file  PointCloudStages.h
+ * @brief point cloud filters which are chained in a process
+ * @date  $Date$
+ *
+ * $Id$
+ */
+
+#ifndef POINT_CLOUD_STAGES_H
+#define POINT_CLOUD_STAGES_H
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <string>
+#include <vector>
+#include "pointcloud.hh"
+
+typedef pcl::PointCloud<pcl::PointXYZ> PointCloudXYZ;
+
+/**
+   \brief parameters of stages, whose names and default values are the
+   same as the ones of the filter components
+ */
+struct PointCloudStageParam
+{
+    double size;            ///< VoxelGridFilter : leaf size [m]
+    int meanK;              ///< SORFilter : the number of neighbors
+    double stddevMulThresh; ///< SORFilter : threshold of distances
+    double radius;          ///< MLSFilter : search radius [m]
+    double distanceThd;     ///< PlaneRemover : distance threshold of inliers [m]
+    int pointNumThd;        ///< PlaneRemover : the minimum number of inliers of a plane
+    PointCloudStageParam();
+};
+
+class PointCloudStage
+{
+public:
+    PointCloudStage(const PointCloudStageParam& param) : m_param(param) {}
+    virtual ~PointCloudStage() {}
+    virtual const char *name() const = 0;
+    /**
+       \brief filter input into output
+     */
+    virtual void filter(const PointCloudXYZ::Ptr& input, PointCloudXYZ& output) = 0;
+protected:
+    const PointCloudStageParam& m_param;
+};
+
+/**
+   \brief create a stage
+   \param name name of the filter component, VoxelGridFilter, SORFilter,
+   MLSFilter or PlaneRemover
+   \return the stage or NULL if name is unknown
+ */
+PointCloudStage *createPointCloudStage(const std::string& name, const PointCloudStageParam& param);
+
+void convertToPCL(const PointCloudTypes::PointCloud& input, PointCloudXYZ& output);
+void convertFromPCL(const PointCloudXYZ& input, PointCloudTypes::PointCloud& output);
+
+/**
+   \brief chain of stages which filter a point cloud in a process. The
+   point cloud is converted from/to PointCloudTypes::PointCloud only at
+   both ends and buffers of intermediate clouds are reused over frames.
+ */
+class PointCloudStageChain
+{
+public:
+    PointCloudStageChain(const PointCloudStageParam& param);
+    ~PointCloudStageChain();
+    /**
+       \brief replace stages
+       \param names comma separated names of stages
+       \return false if an unknown stage is included, stages are not changed then
+     */
+    bool setStages(const std::string& names);
+    const std::string& stageNames() const { return m_names; }
+    size_t numStages() const { return m_stages.size(); }
+    const char *stageName(size_t i) const { return m_stages[i]->name(); }
+    /**
+       \brief computation time of the i-th stage in the last process() [s]
+     */
+    double stageTime(size_t i) const { return m_times[i]; }
+    /**
+       \brief the number of points output from the i-th stage in the last process()
+     */
+    size_t stagePoints(size_t i) const { return m_points[i]; }
+    void process(const PointCloudTypes::PointCloud& input, PointCloudTypes::PointCloud& output);
+private:
+    void clearStages();
+
+    const PointCloudStageParam& m_param;
+    std::string m_names;
+    std::vector<PointCloudStage *> m_stages;
+    std::vector<double> m_times;
+    std::vector<size_t> m_points;
+    // input and output of each stage, which are swapped after the stage
+    PointCloudXYZ::Ptr m_clouds[2];
+};
+
+#endif // POINT_CLOUD_STAGES_H
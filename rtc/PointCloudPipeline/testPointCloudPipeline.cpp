@@ -0,0 +1,272 @@
+/* -*- coding:utf-8-unix; mode:c++; -*- */
+
+#include "PointCloudStages.h"
+#include <pcl/filters/voxel_grid.h>
+#include <pcl/filters/statistical_outlier_removal.h>
+#include <pcl/filters/extract_indices.h>
+#include <pcl/surface/mls.h>
+#include <pcl/segmentation/sac_segmentation.h>
+#include <coil/stringutil.h>
+/* samples */
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <sys/time.h>
+
+class testPointCloudPipeline
+{
+protected:
+    int loop, npoints;
+    std::string stages;
+    PointCloudStageParam param;
+    PointCloudTypes::PointCloud original;
+    double get_time ()
+    {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return tv.tv_sec + tv.tv_usec * 1e-6;
+    };
+    double random (double min, double max)
+    {
+        return min + (max - min) * rand() / RAND_MAX;
+    };
+    void initCloud (PointCloudTypes::PointCloud& cloud)
+    {
+        cloud.height = 1;
+        cloud.type = "xyz";
+        cloud.point_step = 16;
+        cloud.width = 0;
+        cloud.data.length(0);
+    };
+    // floor, wall, a sphere and outliers
+    void makeCloud ()
+    {
+        srand(0);
+        initCloud(original);
+        original.width = npoints;
+        original.row_step = original.point_step * original.width;
+        original.data.length(original.row_step);
+        float *ptr = (float *)original.data.get_buffer();
+        for (int i = 0; i < npoints; i++, ptr += 4) {
+            double r = random(0, 1);
+            if (r < 0.6) {
+                ptr[0] = random(0, 2); ptr[1] = random(-1, 1); ptr[2] = random(-0.002, 0.002);
+            } else if (r < 0.8) {
+                ptr[0] = 2 + random(-0.002, 0.002); ptr[1] = random(-1, 1); ptr[2] = random(0, 1);
+            } else if (r < 0.95) {
+                double th = random(0, M_PI), phi = random(0, 2 * M_PI);
+                ptr[0] = 1 + 0.2 * sin(th) * cos(phi); ptr[1] = 0.2 * sin(th) * sin(phi); ptr[2] = 0.3 + 0.2 * cos(th);
+            } else {
+                ptr[0] = random(0, 2); ptr[1] = random(-1, 1); ptr[2] = random(0, 1);
+            }
+        }
+    };
+    // the same processing as onExecute() of the filter component "name",
+    // written independently of PointCloudStage so that the pipeline is
+    // checked against the components themselves
+    static bool filterAsComponent (const std::string& name, const PointCloudStageParam& param,
+                                   const PointCloudTypes::PointCloud& input, PointCloudTypes::PointCloud& output)
+    {
+        // RTM -> PCL
+        pcl::PointCloud<pcl::PointXYZ>::Ptr cloud (new pcl::PointCloud<pcl::PointXYZ>);
+        pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_filtered (new pcl::PointCloud<pcl::PointXYZ>);
+        cloud->points.resize(input.width*input.height);
+        const float *src = (const float *)input.data.get_buffer();
+        for (size_t i = 0; i < cloud->points.size(); i++) {
+            cloud->points[i].x = src[0];
+            cloud->points[i].y = src[1];
+            cloud->points[i].z = src[2];
+            src += 4;
+        }
+        // PCL Processing
+        if (name == "VoxelGridFilter") {
+            pcl::VoxelGrid<pcl::PointXYZ> sor;
+            sor.setInputCloud (cloud);
+            sor.setLeafSize(param.size, param.size, param.size);
+            sor.filter(*cloud_filtered);
+        } else if (name == "SORFilter") {
+            pcl::StatisticalOutlierRemoval<pcl::PointXYZ> sor;
+            sor.setInputCloud (cloud);
+            sor.setMeanK (param.meanK);
+            sor.setStddevMulThresh (param.stddevMulThresh);
+            sor.filter (*cloud_filtered);
+        } else if (name == "MLSFilter") {
+            pcl::search::KdTree<pcl::PointXYZ>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZ>);
+            pcl::MovingLeastSquares<pcl::PointXYZ, pcl::PointXYZ> mls;
+            mls.setInputCloud (cloud);
+            mls.setPolynomialFit (true);
+            mls.setSearchMethod (tree);
+            mls.setSearchRadius (param.radius);
+            mls.process (*cloud_filtered);
+        } else if (name == "PlaneRemover") {
+            pcl::ModelCoefficients::Ptr coefficients (new pcl::ModelCoefficients);
+            pcl::PointIndices::Ptr inliers (new pcl::PointIndices);
+            pcl::SACSegmentation<pcl::PointXYZ> seg;
+            seg.setOptimizeCoefficients (true);
+            seg.setModelType (pcl::SACMODEL_PLANE);
+            seg.setMethodType (pcl::SAC_RANSAC);
+            seg.setDistanceThreshold (param.distanceThd);
+            pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_f (new pcl::PointCloud<pcl::PointXYZ>);
+            pcl::ExtractIndices<pcl::PointXYZ> extract;
+            while (1) {
+                seg.setInputCloud (cloud);
+                seg.segment (*inliers, *coefficients);
+                if (inliers->indices.size () < (size_t)param.pointNumThd) break;
+                extract.setInputCloud( cloud );
+                extract.setIndices( inliers );
+                extract.setNegative( true );
+                extract.filter( *cloud_f );
+                cloud = cloud_f;
+            }
+            cloud_filtered = cloud;
+        } else {
+            return false;
+        }
+        // PCL -> RTM
+        output.width = cloud_filtered->points.size();
+        output.row_step = output.point_step*output.width;
+        output.data.length(output.height*output.row_step);
+        float *dst = (float *)output.data.get_buffer();
+        for (size_t i = 0; i < cloud_filtered->points.size(); i++) {
+            dst[0] = cloud_filtered->points[i].x;
+            dst[1] = cloud_filtered->points[i].y;
+            dst[2] = cloud_filtered->points[i].z;
+            dst += 4;
+        }
+        return true;
+    };
+    // chained filter components, each of which converts the cloud from/to
+    // PointCloudTypes::PointCloud and sends it to the next one
+    bool processChained (PointCloudTypes::PointCloud& output, std::vector<double>& times)
+    {
+        coil::vstring names = coil::split(stages, ",");
+        PointCloudTypes::PointCloud input(original);
+        times.assign(names.size(), 0);
+        for (size_t i = 0; i < names.size(); i++) {
+            double t0 = get_time();
+            initCloud(output);
+            if (!filterAsComponent(names[i], param, input, output)) return false;
+            // copy through a data port
+            input = output;
+            times[i] = get_time() - t0;
+        }
+        output = input;
+        return true;
+    };
+    bool compareClouds (const PointCloudTypes::PointCloud& c1, const PointCloudTypes::PointCloud& c2)
+    {
+        if (c1.width != c2.width || c1.data.length() != c2.data.length()) return false;
+        const float *p1 = (const float *)c1.data.get_buffer(), *p2 = (const float *)c2.data.get_buffer();
+        for (unsigned int i = 0; i < c1.width * 4; i += 4) {
+            if (p1[i] != p2[i] || p1[i + 1] != p2[i + 1] || p1[i + 2] != p2[i + 2]) return false;
+        }
+        return true;
+    };
+public:
+    std::vector<std::string> arg_strs;
+    testPointCloudPipeline() : loop(10), npoints(100000), stages("VoxelGridFilter,SORFilter,PlaneRemover")
+    {
+    };
+    bool test0 ()
+    {
+        std::cerr << "[testPointCloudPipeline] test0 : compare with chained components" << std::endl;
+        npoints = 20000;
+        makeCloud();
+        bool ret = true;
+        const char *stage_lists[3] = {"VoxelGridFilter,SORFilter,PlaneRemover", "SORFilter,MLSFilter", ""};
+        PointCloudStageChain chain(param);
+        PointCloudTypes::PointCloud ref, filtered;
+        initCloud(filtered);
+        std::vector<double> times;
+        for (int k = 0; k < 3; k++) {
+            stages = stage_lists[k];
+            bool set = chain.setStages(stages) && processChained(ref, times);
+            // twice so that reused buffers are also checked
+            chain.process(original, filtered);
+            chain.process(original, filtered);
+            bool same = set && compareClouds(ref, filtered);
+            std::cerr << "[testPointCloudPipeline]   \"" << stages << "\" : " << original.width << " -> "
+                      << filtered.width << " points, " << (same ? "same as" : "different from") << " chained components" << std::endl;
+            ret = ret && same;
+        }
+        ret = ret && !chain.setStages("VoxelGridFilter,UnknownFilter") && chain.stageNames() == "";
+        return ret;
+    };
+    bool benchmark ()
+    {
+        parse_params();
+        makeCloud();
+        PointCloudStageChain chain(param);
+        if (!chain.setStages(stages)) {
+            std::cerr << "[testPointCloudPipeline] unknown stage is included in " << stages << std::endl;
+            return false;
+        }
+        std::cerr << "[testPointCloudPipeline] benchmark : \"" << stages << "\", " << npoints << " points x " << loop << " loops" << std::endl;
+        PointCloudTypes::PointCloud ref, filtered;
+        initCloud(filtered);
+        std::vector<double> times, chained_times(chain.numStages(), 0), pipeline_times(chain.numStages(), 0);
+        double t0 = get_time();
+        for (int i = 0; i < loop; i++) {
+            processChained(ref, times);
+            for (size_t j = 0; j < times.size(); j++) chained_times[j] += times[j];
+        }
+        double t1 = get_time();
+        for (int i = 0; i < loop; i++) {
+            chain.process(original, filtered);
+            for (size_t j = 0; j < chain.numStages(); j++) pipeline_times[j] += chain.stageTime(j);
+        }
+        double t2 = get_time();
+        for (size_t j = 0; j < chain.numStages(); j++) {
+            std::cerr << "[testPointCloudPipeline]   " << chain.stageName(j) << " : chained components = "
+                      << chained_times[j] / loop * 1e3 << "[ms], pipeline = " << pipeline_times[j] / loop * 1e3 << "[ms]" << std::endl;
+        }
+        std::cerr << "[testPointCloudPipeline]   total : chained components = " << (t1 - t0) / loop * 1e3
+                  << "[ms], pipeline = " << (t2 - t1) / loop * 1e3 << "[ms]" << std::endl;
+        return true;
+    };
+    void parse_params ()
+    {
+        for (unsigned int i = 0; i < arg_strs.size(); ++ i) {
+            if ( arg_strs[i]== "--loop" ) {
+                if (++i < arg_strs.size()) loop = atoi(arg_strs[i].c_str());
+            } else if ( arg_strs[i]== "--points" ) {
+                if (++i < arg_strs.size()) npoints = atoi(arg_strs[i].c_str());
+            } else if ( arg_strs[i]== "--stages" ) {
+                if (++i < arg_strs.size()) stages = arg_strs[i];
+            }
+        }
+    };
+};
+
+void print_usage ()
+{
+    std::cerr << "Usage : testPointCloudPipeline [option]" << std::endl;
+    std::cerr << " [option] should be:" << std::endl;
+    std::cerr << "  --test0 : compare with chained components" << std::endl;
+    std::cerr << "  --benchmark [--loop n] [--points n] [--stages list] : compare computation time with chained components" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    int ret = 0;
+    if (argc >= 2) {
+        testPointCloudPipeline tpcp;
+        for (int i = 1; i < argc; ++ i) {
+            tpcp.arg_strs.push_back(std::string(argv[i]));
+        }
+        if (std::string(argv[1]) == "--test0") {
+            ret = tpcp.test0() ? 0 : 1;
+        } else if (std::string(argv[1]) == "--benchmark") {
+            ret = tpcp.benchmark() ? 0 : 1;
+        } else {
+            print_usage();
+            ret = 1;
+        }
+    } else {
+        print_usage();
+        ret = 1;
+    }
+    return ret;
+}
@@ -0,0 +1,85 @@
+// -*- C++ -*-
+/*!
+ * @file  PointCloudBuilder.cpp
+ * @brief assembler of scan lines into a point cloud
+ * $Date$
+ *
+ * $Id$
+ */
+
+#include <math.h>
+#include <algorithm>
+#include "PointCloudBuilder.h"
+
+PointCloudBuilder::PointCloudBuilder(PointCloudTypes::PointCloud& cloud)
+    : m_cloud(cloud), m_npoint(0), m_minAngle(0), m_angularRes(0)
+{
+}
+
+void PointCloudBuilder::clear()
+{
+    m_npoint = 0;
+    // use the whole buffer, which has been shrinked by finish()
+    m_cloud.data.length(m_cloud.data.maximum());
+}
+
+void PointCloudBuilder::reserve(unsigned int n)
+{
+    unsigned int len = (m_npoint + n)*m_cloud.point_step;
+    if (len <= m_cloud.data.length()) return;
+    // double the buffer so that adding lines costs O(points) in total
+    m_cloud.data.length(std::max(len, 2*m_cloud.data.length()));
+}
+
+void PointCloudBuilder::updateTable(const RTC::RangeConfig& config, unsigned int n)
+{
+    if (m_sin.size() == n && m_minAngle == config.minAngle
+        && m_angularRes == config.angularRes) return;
+    m_minAngle = config.minAngle;
+    m_angularRes = config.angularRes;
+    m_sin.resize(n);
+    m_cos.resize(n);
+    for (unsigned int i=0; i<n; i++){
+        double th = m_minAngle + i*m_angularRes;
+        m_sin[i] = -sin(th);
+        m_cos[i] = -cos(th);
+    }
+    m_x.resize(n);
+    m_y.resize(n);
+    m_z.resize(n);
+}
+
+void PointCloudBuilder::addScan(const RTC::RangeData& range)
+{
+    unsigned int n = range.ranges.length();
+    if (n == 0) return;
+    reserve(n);
+    updateTable(range.config, n);
+
+    // a beam in the sensor frame is (-d*sin(th), 0, -d*cos(th))
+    const RTC::Pose3D &pose = range.geometry.geometry.pose;
+    hrp::Matrix33 R = hrp::rotFromRpy(pose.orientation.r,
+                                      pose.orientation.p,
+                                      pose.orientation.y);
+    Eigen::Map<const Eigen::ArrayXd> d(range.ranges.get_buffer(), n);
+    m_x = pose.position.x + d*(R(0,0)*m_sin + R(0,2)*m_cos);
+    m_y = pose.position.y + d*(R(1,0)*m_sin + R(1,2)*m_cos);
+    m_z = pose.position.z + d*(R(2,0)*m_sin + R(2,2)*m_cos);
+
+    float *ptr = (float *)m_cloud.data.get_buffer() + m_npoint*4;
+    for (unsigned int i=0; i<n; i++){
+        if (d[i]==0) continue;
+        ptr[0] = m_x[i];
+        ptr[1] = m_y[i];
+        ptr[2] = m_z[i];
+        ptr+=4;
+        m_npoint++;
+    }
+}
+
+void PointCloudBuilder::finish()
+{
+    m_cloud.width = m_npoint;
+    m_cloud.row_step = m_cloud.point_step*m_cloud.width;
+    m_cloud.data.length(m_cloud.row_step);
+}
@@ -0,0 +1,59 @@
+// -*- C++ -*-
+/*!
+ * @file  PointCloudBuilder.h
+ * @brief assembler of scan lines into a point cloud
+ * @date  $Date$
+ *
+ * $Id$
+ */
+
+#ifndef POINT_CLOUD_BUILDER_H
+#define POINT_CLOUD_BUILDER_H
+
+#include <rtm/idl/InterfaceDataTypes.hh>
+#include <hrpUtil/Eigen3d.h>
+#include "pointcloud.hh"
+
+/**
+   \brief assemble scan lines of range sensors into a point cloud whose
+   points consist of x, y, z and a padding. The buffer of the point cloud
+   is kept over clouds, so it is reallocated only when it gets larger.
+ */
+class PointCloudBuilder
+{
+public:
+    /**
+       \brief constructor
+       \param cloud point cloud whose point_step is 16 bytes
+     */
+    PointCloudBuilder(PointCloudTypes::PointCloud& cloud);
+    /**
+       \brief start a new cloud
+     */
+    void clear();
+    /**
+       \brief reserve the buffer for n points in addition to the added points
+     */
+    void reserve(unsigned int n);
+    /**
+       \brief add points of a scan line, which are transformed by the sensor pose.
+       Beams whose ranges are zero are skipped.
+     */
+    void addScan(const RTC::RangeData& range);
+    /**
+       \brief set width, row_step and length of the cloud
+     */
+    void finish();
+    unsigned int numPoints() const { return m_npoint; }
+private:
+    void updateTable(const RTC::RangeConfig& config, unsigned int n);
+
+    PointCloudTypes::PointCloud& m_cloud;
+    unsigned int m_npoint;
+    // -sin and -cos of beam angles, which are computed for each configuration
+    double m_minAngle, m_angularRes;
+    Eigen::ArrayXd m_sin, m_cos;
+    Eigen::ArrayXd m_x, m_y, m_z;
+};
+
+#endif // POINT_CLOUD_BUILDER_H
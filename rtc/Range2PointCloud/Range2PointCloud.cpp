@@ -7,8 +7,6 @@
  * $Id$
  */
 
-#include <math.h>
-#include <hrpUtil/Eigen3d.h>
 #include "Range2PointCloud.h"
 
 // Module specification
@@ -37,6 +35,7 @@ Range2PointCloud::Range2PointCloud(RTC::Manager* manager)
     m_rangeIn("range", m_range),
     m_cloudOut("cloud", m_cloud),
     // </rtc-template>
+    m_builder(m_cloud),
     dummy(0)
 {
 }
@@ -135,44 +134,18 @@ RTC::ReturnCode_t Range2PointCloud::onExecute(RTC::UniqueId ec_id)
     //std::cout << m_profile.instance_name<< ": onExecute(" << ec_id << ")" << std::endl;
   if (!m_rangeIn.isNew()) return RTC::RTC_OK;
 
-  m_cloud.width = 0;
-  int npoint=0;
+  m_builder.clear();
   int nlines=0;
   while (m_rangeIn.isNew()){
     nlines++;
     m_rangeIn.read();
-    m_cloud.width += m_range.ranges.length();
-    m_cloud.row_step = m_cloud.point_step*m_cloud.width;
-    m_cloud.data.length(m_cloud.row_step);// shrinked later
-    // range -> point cloud
-    float *ptr = (float *)m_cloud.data.get_buffer() + npoint*4;
-    Pose3D &pose = m_range.geometry.geometry.pose;
-    hrp::Vector3 relP, absP, sensorP(pose.position.x,
-				     pose.position.y,
-				     pose.position.z);
-    hrp::Matrix33 sensorR = hrp::rotFromRpy(pose.orientation.r,
-					    pose.orientation.p,
-					    pose.orientation.y);
-    for (unsigned int i=0; i<m_range.ranges.length(); i++){
-      double th = m_range.config.minAngle + i*m_range.config.angularRes;
-      double d = m_range.ranges[i];
-      if (d==0) continue;
-      relP << -d*sin(th), 0, -d*cos(th);
-      absP = sensorP + sensorR*relP;
-      ptr[0] = absP[0];
-      ptr[1] = absP[1];
-      ptr[2] = absP[2];
-      //std::cout << "(" << i << "," << ptr[2] << "," << d << ")" << std::endl;
-      ptr+=4;
-      npoint++;
-    }
+    m_builder.addScan(m_range);
   }
+  m_builder.finish();
 #if 0
   std::cout << "Range2PointCloud: processed " << nlines << " lines, " 
-	    << npoint << " points" << std::endl;
+	    << m_builder.numPoints() << " points" << std::endl;
 #endif
-  m_cloud.width = npoint;
-  m_cloud.data.length(npoint*m_cloud.point_step);
   m_cloudOut.write();
 
   return RTC::RTC_OK;
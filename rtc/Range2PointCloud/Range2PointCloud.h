@@ -18,6 +18,7 @@
 #include <rtm/idl/BasicDataTypeSkel.h>
 #include <rtm/idl/InterfaceDataTypes.hh>
 #include "pointcloud.hh"
+#include "PointCloudBuilder.h"
 
 // Service implementation headers
 // <rtc-template block="service_impl_h">
@@ -134,6 +135,7 @@ class Range2PointCloud
   // </rtc-template>
 
  private:
+  PointCloudBuilder m_builder;
   int dummy;
 };
 
@@ -0,0 +1,202 @@
+/* -*- coding:utf-8-unix; mode:c++; -*- */
+
+#include "PointCloudBuilder.h"
+/* samples */
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <sys/time.h>
+
+#ifndef deg2rad
+#define deg2rad(deg) (deg * M_PI / 180)
+#endif
+
+class testPointCloudBuilder
+{
+protected:
+    int loop, nlines, nbeams;
+    std::vector<RTC::RangeData> scans;
+    double get_time ()
+    {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return tv.tv_sec + tv.tv_usec * 1e-6;
+    };
+    void initCloud (PointCloudTypes::PointCloud& cloud)
+    {
+        cloud.height = 1;
+        cloud.type = "xyz";
+        cloud.point_step = 16;
+        cloud.width = 0;
+        cloud.data.length(0);
+    };
+    // sweep of a LRF tilting around Y axis at (0, 0, 1), whose beams hit the floor or a cylindrical wall
+    void makeSweep (int nbeams_, double tilt0, double tilt1)
+    {
+        scans.resize(nlines);
+        for (int j = 0; j < nlines; j++) {
+            RTC::RangeData& range = scans[j];
+            range.config.minAngle = deg2rad(-135.0);
+            range.config.angularRes = deg2rad(270.0) / (nbeams_ - 1);
+            RTC::Pose3D& pose = range.geometry.geometry.pose;
+            pose.position.x = 0;
+            pose.position.y = 0;
+            pose.position.z = 1.0;
+            pose.orientation.r = 0;
+            pose.orientation.p = tilt0 + (tilt1 - tilt0) * j / nlines;
+            pose.orientation.y = 0;
+            range.ranges.length(nbeams_);
+            for (int i = 0; i < nbeams_; i++) {
+                double d = 3.0 + 0.5 * sin(0.1 * i + 0.3 * j);
+                // no echo
+                if ((i * 7 + j) % 31 == 0) d = 0;
+                range.ranges[i] = d;
+            }
+        }
+    };
+    // previous implementation, which extends the cloud for each line and computes sin/cos of every beam
+    void buildByLines (PointCloudTypes::PointCloud& cloud)
+    {
+        cloud.width = 0;
+        int npoint = 0;
+        for (size_t j = 0; j < scans.size(); j++) {
+            const RTC::RangeData& range = scans[j];
+            cloud.width += range.ranges.length();
+            cloud.row_step = cloud.point_step * cloud.width;
+            cloud.data.length(cloud.row_step);
+            float *ptr = (float *)cloud.data.get_buffer() + npoint * 4;
+            const RTC::Pose3D &pose = range.geometry.geometry.pose;
+            hrp::Vector3 relP, absP, sensorP(pose.position.x,
+                                             pose.position.y,
+                                             pose.position.z);
+            hrp::Matrix33 sensorR = hrp::rotFromRpy(pose.orientation.r,
+                                                    pose.orientation.p,
+                                                    pose.orientation.y);
+            for (unsigned int i = 0; i < range.ranges.length(); i++) {
+                double th = range.config.minAngle + i * range.config.angularRes;
+                double d = range.ranges[i];
+                if (d == 0) continue;
+                relP << -d * sin(th), 0, -d * cos(th);
+                absP = sensorP + sensorR * relP;
+                ptr[0] = absP[0];
+                ptr[1] = absP[1];
+                ptr[2] = absP[2];
+                ptr += 4;
+                npoint++;
+            }
+        }
+        cloud.width = npoint;
+        cloud.data.length(npoint * cloud.point_step);
+    };
+    void build (PointCloudBuilder& builder)
+    {
+        builder.clear();
+        for (size_t j = 0; j < scans.size(); j++) {
+            builder.addScan(scans[j]);
+        }
+        builder.finish();
+    };
+    double compareClouds (const PointCloudTypes::PointCloud& c1, const PointCloudTypes::PointCloud& c2)
+    {
+        if (c1.width != c2.width || c1.data.length() != c2.data.length()) return 1e10;
+        const float *p1 = (const float *)c1.data.get_buffer(), *p2 = (const float *)c2.data.get_buffer();
+        double error = 0;
+        for (unsigned int i = 0; i < c1.width; i++) {
+            for (int k = 0; k < 3; k++) error = std::max(error, (double)fabs(p1[i * 4 + k] - p2[i * 4 + k]));
+        }
+        return error;
+    };
+public:
+    std::vector<std::string> arg_strs;
+    testPointCloudBuilder() : loop(100), nlines(40), nbeams(1081)
+    {
+    };
+    bool test0 ()
+    {
+        std::cerr << "[testPointCloudBuilder] test0 : compare with the previous implementation" << std::endl;
+        PointCloudTypes::PointCloud ref, cloud;
+        initCloud(ref);
+        initCloud(cloud);
+        PointCloudBuilder builder(cloud);
+        bool ret = true;
+        // the number of beams and lines are changed so that the table and the buffer are updated
+        int beams[3] = {1081, 541, 1081}, lines[3] = {40, 80, 10};
+        for (int k = 0; k < 3; k++) {
+            nlines = lines[k];
+            makeSweep(beams[k], deg2rad(-30.0 + 10 * k), deg2rad(30.0));
+            buildByLines(ref);
+            build(builder);
+            double error = compareClouds(ref, cloud);
+            std::cerr << "[testPointCloudBuilder]   " << nlines << " lines x " << beams[k] << " beams : "
+                      << cloud.width << " points, error = " << error << "[m]" << std::endl;
+            ret = ret && error < 1e-5 && cloud.row_step == cloud.width * cloud.point_step;
+        }
+        return ret;
+    };
+    bool benchmark ()
+    {
+        parse_params();
+        makeSweep(nbeams, deg2rad(-30.0), deg2rad(30.0));
+        std::cerr << "[testPointCloudBuilder] benchmark : " << loop << " clouds of " << nlines << " lines x " << nbeams << " beams" << std::endl;
+        PointCloudTypes::PointCloud ref, cloud;
+        initCloud(ref);
+        initCloud(cloud);
+        PointCloudBuilder builder(cloud);
+        double t0 = get_time();
+        for (int i = 0; i < loop; i++) {
+            buildByLines(ref);
+        }
+        double t1 = get_time();
+        for (int i = 0; i < loop; i++) {
+            build(builder);
+        }
+        double t2 = get_time();
+        std::cerr << "[testPointCloudBuilder]   extending by lines : " << (double)ref.width * loop / (t1 - t0) << "[points/s]" << std::endl;
+        std::cerr << "[testPointCloudBuilder]   PointCloudBuilder  : " << (double)cloud.width * loop / (t2 - t1) << "[points/s]" << std::endl;
+        return true;
+    };
+    void parse_params ()
+    {
+        for (unsigned int i = 0; i < arg_strs.size(); ++ i) {
+            if ( arg_strs[i]== "--loop" ) {
+                if (++i < arg_strs.size()) loop = atoi(arg_strs[i].c_str());
+            } else if ( arg_strs[i]== "--lines" ) {
+                if (++i < arg_strs.size()) nlines = atoi(arg_strs[i].c_str());
+            } else if ( arg_strs[i]== "--beams" ) {
+                if (++i < arg_strs.size()) nbeams = atoi(arg_strs[i].c_str());
+            }
+        }
+    };
+};
+
+void print_usage ()
+{
+    std::cerr << "Usage : testPointCloudBuilder [option]" << std::endl;
+    std::cerr << " [option] should be:" << std::endl;
+    std::cerr << "  --test0 : compare with the previous implementation" << std::endl;
+    std::cerr << "  --benchmark [--loop n] [--lines n] [--beams n] : measure points per second replaying a sweep of a tilting LRF" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    int ret = 0;
+    if (argc >= 2) {
+        testPointCloudBuilder tpcb;
+        for (int i = 1; i < argc; ++ i) {
+            tpcb.arg_strs.push_back(std::string(argv[i]));
+        }
+        if (std::string(argv[1]) == "--test0") {
+            ret = tpcb.test0() ? 0 : 1;
+        } else if (std::string(argv[1]) == "--benchmark") {
+            ret = tpcb.benchmark() ? 0 : 1;
+        } else {
+            print_usage();
+            ret = 1;
+        }
+    } else {
+        print_usage();
+        ret = 1;
+    }
+    return ret;
+}
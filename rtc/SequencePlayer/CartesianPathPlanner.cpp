@@ -0,0 +1,207 @@
+// -*- C++ -*-
+/*!
+ * @file  CartesianPathPlanner.cpp
+ * @brief inverse kinematics of a Cartesian path solved in a worker thread
+ * $Date$
+ *
+ * $Id$
+ */
+
+#include "CartesianPathPlanner.h"
+#include <coil/Guard.h>
+#include <hrpModel/Link.h>
+#include <hrpUtil/Eigen3d.h>
+#include "../ImpedanceController/JointPathEx.h"
+#include <iostream>
+#include <algorithm>
+
+typedef coil::Guard<coil::Mutex> Guard;
+
+CartesianPathPlanner::CartesianPathPlanner(hrp::BodyPtr robot, double dt, const std::string& instance_name)
+    : m_robot(robot), m_dt(dt), m_instanceName(instance_name),
+      m_cond(m_mutex), m_running(true), m_request(0), m_state(IDLE), m_cancel(false),
+      m_errorPos(0.0001), m_errorRot(0.001), m_iteration(50), m_debugLevel(0),
+      m_pathErrorPos(m_errorPos), m_pathErrorRot(m_errorRot), m_pathIteration(m_iteration), m_pathDebugLevel(m_debugLevel),
+      m_tm(0), m_solvedTime(0)
+{
+    activate();
+}
+
+CartesianPathPlanner::~CartesianPathPlanner()
+{
+    {
+        Guard guard(m_mutex);
+        m_running = false;
+        m_cancel = true;
+        m_cond.broadcast();
+    }
+    wait();
+}
+
+int CartesianPathPlanner::svc(void)
+{
+    unsigned long request = 0;
+    while (waitForRequest(request)){
+        solve();
+    }
+    return 0;
+}
+
+bool CartesianPathPlanner::waitForRequest(unsigned long& request)
+{
+    Guard guard(m_mutex);
+    while (m_running && m_request == request) m_cond.wait();
+    if (!m_running) return false;
+    request = m_request;
+    return true;
+}
+
+void CartesianPathPlanner::setMaxIKError(double pos, double rot)
+{
+    Guard guard(m_mutex);
+    m_errorPos = pos;
+    m_errorRot = rot;
+}
+
+void CartesianPathPlanner::setMaxIKIteration(short iter)
+{
+    Guard guard(m_mutex);
+    m_iteration = iter;
+}
+
+void CartesianPathPlanner::setDebugLevel(unsigned int level)
+{
+    Guard guard(m_mutex);
+    m_debugLevel = level;
+}
+
+unsigned long CartesianPathPlanner::start(const std::string& base_name, const std::string& target_name,
+                                          const double *q, const hrp::Vector3& end_p, const hrp::Matrix33& end_R, double tm)
+{
+    if (!m_robot->link(base_name) || !m_robot->link(target_name)) return 0;
+    Guard guard(m_mutex);
+    // inputs are read by the worker thread while the previous path is solved
+    m_cancel = true;
+    while (m_state == PLANNING) m_cond.wait();
+    m_baseName = base_name;
+    m_targetName = target_name;
+    m_q.assign(q, q + m_robot->numJoints());
+    m_endP = end_p;
+    m_endR = end_R;
+    m_tm = tm;
+    m_pathErrorPos = m_errorPos;
+    m_pathErrorRot = m_errorRot;
+    m_pathIteration = m_iteration;
+    m_pathDebugLevel = m_debugLevel;
+    m_samples.clear();
+    m_solvedTime = 0;
+    m_cancel = false;
+    m_state = PLANNING;
+    m_request++;
+    m_cond.broadcast();
+    return m_request;
+}
+
+void CartesianPathPlanner::cancel()
+{
+    Guard guard(m_mutex);
+    m_cancel = true;
+    m_samples.clear();
+    m_cond.broadcast();
+}
+
+bool CartesianPathPlanner::waitForSamples(unsigned long id, double lookahead)
+{
+    Guard guard(m_mutex);
+    while (m_request == id && !m_cancel && m_state == PLANNING && m_solvedTime < lookahead) m_cond.wait();
+    return m_request == id && !m_cancel && m_state != FAILED;
+}
+
+bool CartesianPathPlanner::popSamples(std::deque<Sample>& o_samples)
+{
+    Guard guard(m_mutex);
+    o_samples.clear();
+    o_samples.swap(m_samples);
+    return m_state == PLANNING && !m_cancel;
+}
+
+void CartesianPathPlanner::publish(const hrp::dvector& q, const hrp::dvector& v, double tm)
+{
+    Guard guard(m_mutex);
+    if (m_cancel) return;
+    m_samples.push_back(Sample());
+    Sample& s = m_samples.back();
+    s.q = q;
+    s.v = v;
+    s.tm = tm;
+    m_solvedTime += tm;
+    m_cond.broadcast();
+}
+
+void CartesianPathPlanner::solve()
+{
+    for (int i=0; i<m_robot->numJoints(); i++){
+        hrp::Link *j = m_robot->joint(i);
+        if (j) j->q = m_q[i];
+    }
+    m_robot->calcForwardKinematics();
+    hrp::JointPathExPtr manip = hrp::JointPathExPtr(new hrp::JointPathEx(m_robot, m_robot->link(m_baseName), m_robot->link(m_targetName), m_dt, true, m_instanceName));
+    manip->setMaxIKError(m_pathErrorPos, m_pathErrorRot);
+    manip->setMaxIKIteration(m_pathIteration);
+
+    hrp::Link *target = m_robot->link(m_targetName);
+    hrp::Vector3 start_p(target->p);
+    hrp::Matrix33 start_R(target->R);
+    hrp::Vector3 omega = hrp::omegaFromRot(start_R.transpose() * m_endR);
+    int len = std::max(((start_p - m_endP).norm() / 0.02 ), // 2cm
+                       (omega.norm() / 0.025)); // 2 deg
+    len = std::max(len, 1);
+    double tm = m_tm/len;
+
+    // a sample is published when the next one is solved since its velocity
+    // is given by the previous and the next samples as playPatternOfGroup()
+    int n = manip->numJoints();
+    hrp::dvector q_prev(n), q(n), q_next(n), v(n);
+    for (int j = 0; j < n; j++) q[j] = manip->joint(j)->q;
+    bool ret = true;
+    int i;
+    for (i = 0; i < len && !m_cancel; i++){
+        double a = (1+i)/(double)len;
+        hrp::Vector3 p = (1-a)*start_p + a*m_endP;
+        hrp::Matrix33 R = start_R * hrp::rodrigues(omega.isZero()?omega:omega.normalized(), a*omega.norm());
+        // joint angles of the previous waypoint are left in the model as the initial guess
+        ret = manip->calcInverseKinematics2(p, R);
+        if ( m_pathDebugLevel > 0 ) {
+            std::cerr << "target pos/rot : " << i << "/" << a << " : "
+                      << p[0] << " " << p[1] << " " << p[2] << ","
+                      << omega[0] << " " << omega[1] << " " << omega[2] << std::endl;
+        }
+        if ( ! ret ) break;
+        for (int j = 0; j < n; j++) q_next[j] = manip->joint(j)->q;
+        if (i > 0){
+            for (int j = 0; j < n; j++){
+                double v0 = (q[j] - q_prev[j])/tm, v1 = (q_next[j] - q[j])/tm;
+                v[j] = v0 * v1 >= 0 ? 0.5 * (v0 + v1) : 0;
+            }
+            publish(q, v, tm);
+        }
+        q_prev = q;
+        q = q_next;
+    }
+    // the robot stops at the last waypoint solved
+    if (i > 0 && !m_cancel){
+        publish(q, hrp::dvector::Zero(n), tm);
+    }
+    if ( ! ret ) {
+        std::cerr << "[setTargetPose] IK failed at " << i << "/" << len << " of the path" << std::endl;
+    }
+
+    Guard guard(m_mutex);
+    if (m_cancel){
+        m_samples.clear();
+        m_state = IDLE;
+    }else{
+        m_state = ret ? FINISHED : FAILED;
+    }
+    m_cond.broadcast();
+}
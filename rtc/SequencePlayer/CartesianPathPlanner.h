@@ -0,0 +1,111 @@
+// -*- C++ -*-
+/*!
+ * @file  CartesianPathPlanner.h
+ * @brief inverse kinematics of a Cartesian path solved in a worker thread
+ * @date  $Date$
+ *
+ * $Id$
+ */
+
+#ifndef CARTESIAN_PATH_PLANNER_H
+#define CARTESIAN_PATH_PLANNER_H
+
+#include <coil/Task.h>
+#include <coil/Mutex.h>
+#include <coil/Condition.h>
+#include <hrpModel/Body.h>
+#include <hrpUtil/EigenTypes.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+/**
+   \brief solve inverse kinematics of a straight Cartesian path of an end
+   link in a worker thread. Each waypoint is solved from the solution of the
+   previous one, and joint angles of waypoints are published as soon as
+   they are solved so that they can be played before the whole path is solved.
+   The planner owns its robot model, which must not be shared with other threads.
+ */
+class CartesianPathPlanner : public coil::Task
+{
+public:
+    struct Sample {
+        hrp::dvector q;  ///< joint angles of the joint path
+        hrp::dvector v;  ///< joint velocities of the joint path
+        double tm;       ///< time from the previous sample
+    };
+    CartesianPathPlanner(hrp::BodyPtr robot, double dt, const std::string& instance_name);
+    ~CartesianPathPlanner();
+    int svc(void);
+
+    /**
+       \brief set parameters of IK, which are applied from the next path
+     */
+    void setMaxIKError(double pos, double rot);
+    void setMaxIKIteration(short iter);
+    void setDebugLevel(unsigned int level);
+    /**
+       \brief start solving a path. The path being solved is cancelled.
+       \param base_name name of the base link of the joint path
+       \param target_name name of the end link of the joint path
+       \param q joint angles of all joints at the beginning of the path
+       \param end_p target position of the end link in the world frame
+       \param end_R target orientation of the end link in the world frame
+       \param tm duration of the path
+       \return id of the path, 0 if the joint path can't be made
+     */
+    unsigned long start(const std::string& base_name, const std::string& target_name,
+                        const double *q, const hrp::Vector3& end_p, const hrp::Matrix33& end_R, double tm);
+    /**
+       \brief cancel the path being solved and discard samples which are not popped yet
+     */
+    void cancel();
+    /**
+       \brief wait until samples for lookahead[s] are solved or the path is solved
+       \return false if IK fails before that or the path is replaced by another one
+     */
+    bool waitForSamples(unsigned long id, double lookahead);
+    /**
+       \brief move solved samples to o_samples
+       \return true if the path is still being solved
+     */
+    bool popSamples(std::deque<Sample>& o_samples);
+    unsigned long pathId() const { return m_request; }
+private:
+    bool waitForRequest(unsigned long& request);
+    void solve();
+    void publish(const hrp::dvector& q, const hrp::dvector& v, double tm);
+
+    typedef enum { IDLE, PLANNING, FINISHED, FAILED } state_t;
+
+    hrp::BodyPtr m_robot;
+    double m_dt;
+    std::string m_instanceName;
+    coil::Mutex m_mutex;
+    coil::Condition<coil::Mutex> m_cond;
+    bool m_running;
+    unsigned long m_request;
+    state_t m_state;
+    volatile bool m_cancel;
+
+    // parameters given by setters and ones latched by start()
+    double m_errorPos, m_errorRot;
+    short m_iteration;
+    unsigned int m_debugLevel;
+
+    // inputs of a path
+    double m_pathErrorPos, m_pathErrorRot;
+    short m_pathIteration;
+    unsigned int m_pathDebugLevel;
+    std::string m_baseName, m_targetName;
+    std::vector<double> m_q;
+    hrp::Vector3 m_endP;
+    hrp::Matrix33 m_endR;
+    double m_tm;
+
+    // outputs of a path
+    std::deque<Sample> m_samples;
+    double m_solvedTime;
+};
+
+#endif // CARTESIAN_PATH_PLANNER_H
@@ -0,0 +1,223 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <coil/Time.h>
+#include "PatternFile.h"
+
+// size of pages which are released at once[byte]
+#define PATTERN_ADVANCE_CHUNK (1<<20)
+// size of pages which are kept in memory ahead of the reader[byte]
+#define PATTERN_PREFETCH_WINDOW (4<<20)
+
+struct PatternChannelHeader
+{
+    char name[HRPPAT_NAME_LENGTH];
+    uint32_t n_elements;
+    uint32_t n_samples;
+    uint64_t offset;
+};
+
+bool readTextPattern(const std::string& filename, PatternChannel& channel)
+{
+    std::ifstream strm(filename.c_str());
+    if (!strm.is_open()) return false;
+    channel.data.clear();
+    channel.n_elements = 0;
+    std::string line;
+    std::vector<double> values;
+    bool first = true;
+    while (std::getline(strm, line)){
+        values.clear();
+        const char *buf = line.c_str();
+        char *end;
+        while (1){
+            double v = strtod(buf, &end);
+            if (end == buf) break;
+            values.push_back(v);
+            buf = end;
+        }
+        if (values.empty()) continue;
+        if (first){
+            channel.n_elements = values.size() - 1;
+            first = false;
+        }else if (values.size() != channel.n_elements + 1){
+            std::cerr << "[PatternFile] the number of elements is inconsistent in " << filename << std::endl;
+            return false;
+        }
+        channel.data.insert(channel.data.end(), values.begin(), values.end());
+    }
+    return !first;
+}
+
+bool writeBinaryPattern(const std::string& filename, const std::vector<PatternChannel>& channels)
+{
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (!fp) return false;
+    fwrite(HRPPAT_MAGIC, 1, 8, fp);
+    uint32_t header[2] = {(uint32_t)channels.size(), 0};
+    fwrite(header, sizeof(uint32_t), 2, fp);
+    uint64_t offset = 8 + sizeof(header) + channels.size()*sizeof(PatternChannelHeader);
+    for (unsigned int i=0; i<channels.size(); i++){
+        PatternChannelHeader ch;
+        memset(&ch, 0, sizeof(ch));
+        strncpy(ch.name, channels[i].name.c_str(), HRPPAT_NAME_LENGTH-1);
+        ch.n_elements = channels[i].n_elements;
+        ch.n_samples = channels[i].size();
+        ch.offset = offset;
+        fwrite(&ch, sizeof(ch), 1, fp);
+        offset += sizeof(double)*channels[i].data.size();
+    }
+    for (unsigned int i=0; i<channels.size(); i++){
+        if (!channels[i].data.empty()){
+            fwrite(&channels[i].data[0], sizeof(double), channels[i].data.size(), fp);
+        }
+    }
+    bool ret = ferror(fp) == 0;
+    if (fclose(fp) != 0) ret = false;
+    return ret;
+}
+
+PatternPrefetcher::PatternPrefetcher(PatternFile *file)
+    : m_file(file), m_running(true)
+{
+}
+
+int PatternPrefetcher::svc(void)
+{
+    while (m_running && m_file->prefetch()){
+        coil::usleep(10000);
+    }
+    return 0;
+}
+
+void PatternPrefetcher::stop()
+{
+    m_running = false;
+    wait();
+}
+
+PatternFile::PatternFile() : m_addr(NULL), m_length(0), m_prefetcher(NULL)
+{
+}
+
+PatternFile::~PatternFile()
+{
+    close();
+}
+
+bool PatternFile::open(const std::string& filename)
+{
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < 16){
+        ::close(fd);
+        return false;
+    }
+    void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) return false;
+    m_addr = (char *)addr;
+    m_length = st.st_size;
+
+    uint32_t n;
+    memcpy(&n, m_addr + 8, sizeof(n));
+    size_t headers_end = 16 + (size_t)n*sizeof(PatternChannelHeader);
+    if (memcmp(m_addr, HRPPAT_MAGIC, 8) != 0 || headers_end > m_length){
+        std::cerr << "[PatternFile] invalid pattern file(" << filename << ")" << std::endl;
+        close();
+        return false;
+    }
+    for (unsigned int i=0; i<n; i++){
+        PatternChannelHeader h;
+        memcpy(&h, m_addr + 16 + i*sizeof(h), sizeof(h));
+        Channel ch;
+        ch.name.assign(h.name, strnlen(h.name, HRPPAT_NAME_LENGTH));
+        ch.n_elements = h.n_elements;
+        ch.n_samples = h.n_samples;
+        ch.data = (const double *)(m_addr + h.offset);
+        ch.begin = ch.released = ch.prefetched = h.offset;
+        ch.end = h.offset + sizeof(double)*(h.n_elements+1)*(uint64_t)h.n_samples;
+        ch.consumed = ch.available = 0;
+        if (h.offset % sizeof(double) != 0
+            || h.offset + sizeof(double)*(h.n_elements+1)*(uint64_t)h.n_samples > m_length){
+            std::cerr << "[PatternFile] channel " << ch.name << " is broken in "
+                      << filename << std::endl;
+            close();
+            return false;
+        }
+        m_channels.push_back(ch);
+    }
+    // samples are read sequentially
+    madvise(m_addr, m_length, MADV_SEQUENTIAL);
+    // the first samples are available when this function returns
+    prefetch();
+    m_prefetcher = new PatternPrefetcher(this);
+    m_prefetcher->activate();
+    return true;
+}
+
+void PatternFile::close()
+{
+    if (m_prefetcher){
+        m_prefetcher->stop();
+        delete m_prefetcher;
+        m_prefetcher = NULL;
+    }
+    if (m_addr){
+        munmap(m_addr, m_length);
+        m_addr = NULL;
+        m_length = 0;
+    }
+    m_channels.clear();
+}
+
+int PatternFile::findChannel(const std::string& name) const
+{
+    for (unsigned int i=0; i<m_channels.size(); i++){
+        if (m_channels[i].name == name) return i;
+    }
+    return -1;
+}
+
+bool PatternFile::prefetch()
+{
+    size_t pagesize = sysconf(_SC_PAGESIZE);
+    bool remaining = false;
+    for (unsigned int ch=0; ch<m_channels.size(); ch++){
+        Channel& c = m_channels[ch];
+        unsigned int consumed = c.consumed;
+        if (consumed < c.n_samples) remaining = true;
+        size_t pos = (const char *)sample(ch, consumed) - m_addr;
+        // pages shared with the neighboring channels are kept until close()
+        size_t begin = std::max(c.released, (c.begin + pagesize - 1)/pagesize*pagesize);
+        size_t end = pos/pagesize*pagesize;
+        if (end >= begin + PATTERN_ADVANCE_CHUNK){
+            munlock(m_addr + begin, end - begin);
+            madvise(m_addr + begin, end - begin, MADV_DONTNEED);
+            c.released = end;
+        }
+        size_t target = std::min(c.end, pos + PATTERN_PREFETCH_WINDOW);
+        if (target <= c.prefetched) continue;
+        begin = c.prefetched/pagesize*pagesize;
+        // pages are still read ahead even if they can't be locked because of
+        // RLIMIT_MEMLOCK, though they may be paged out under memory pressure
+        mlock(m_addr + begin, target - begin);
+        volatile char sum = 0;
+        for (size_t i=begin; i<target; i+=pagesize) sum += m_addr[i];
+        sum += m_addr[target-1];
+        c.prefetched = target;
+        __sync_synchronize();
+        c.available = (target - c.begin)/(sizeof(double)*(c.n_elements+1));
+    }
+    return remaining;
+}
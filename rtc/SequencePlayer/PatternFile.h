@@ -0,0 +1,146 @@
+#ifndef PATTERN_FILE_H
+#define PATTERN_FILE_H
+
+#include <string>
+#include <vector>
+#include <coil/Task.h>
+
+/**
+   Packed binary motion pattern file. It holds the data of the text pattern
+   files [basename].pos, .zmp, .gsens, .hip, .waist, .torque, .wrenches and
+   .optionaldata in one file. Values are written in the byte order of the
+   host and every sample is 8 byte aligned so that it can be read directly
+   from a memory mapped file.
+
+   char    magic[8] = HRPPAT_MAGIC
+   uint32  the number of channels
+   uint32  reserved (0)
+   for each channel
+     char    name[16], extension of the text file without '.', e.g. "pos"
+     uint32  the number of elements per sample
+     uint32  the number of samples
+     uint64  offset of the first sample from the beginning of the file
+   for each channel
+     float64 time_0 element_0_0 ... element_0_n-1
+     float64 time_1 element_1_0 ... element_1_n-1
+     ...
+ */
+#define HRPPAT_MAGIC "HRPPAT01"
+#define HRPPAT_SUFFIX ".hrppat"
+#define HRPPAT_NAME_LENGTH 16
+
+/**
+   samples of a channel of a motion pattern
+ */
+struct PatternChannel
+{
+    std::string name;         ///< extension of the text file, e.g. "pos"
+    unsigned int n_elements;  ///< the number of elements per sample
+    std::vector<double> data; ///< samples of [time element_0 ... element_n-1]
+    unsigned int size() const { return data.size()/(n_elements+1); }
+};
+
+/**
+   \brief read a text pattern file which consists of lines of
+   "time element_0 ... element_n-1"
+   \return true if read successfully, false otherwise
+ */
+bool readTextPattern(const std::string& filename, PatternChannel& channel);
+
+/**
+   \brief write channels to a binary pattern file
+   \return true if written successfully, false otherwise
+ */
+bool writeBinaryPattern(const std::string& filename, const std::vector<PatternChannel>& channels);
+
+class PatternFile;
+
+/**
+   thread which pages in samples of a PatternFile ahead of the reader
+   and releases consumed ones
+ */
+class PatternPrefetcher : public coil::Task
+{
+public:
+    PatternPrefetcher(PatternFile *file);
+    int svc(void);
+    void stop();
+private:
+    PatternFile *m_file;
+    volatile bool m_running;
+};
+
+/**
+   Read-only memory mapped binary pattern file. Samples are paged in and
+   locked in memory by a prefetch thread ahead of the reader, so reading
+   available samples never waits for the disk. Resident memory does not
+   grow with the length of the pattern as long as consumed samples are
+   notified by advance().
+ */
+class PatternFile
+{
+public:
+    PatternFile();
+    ~PatternFile();
+    /**
+       \brief map a binary pattern file, page in the first samples and
+       start the prefetch thread
+       \return true if mapped successfully, false otherwise
+     */
+    bool open(const std::string& filename);
+    /**
+       \brief stop the prefetch thread and unmap the file. This must not be
+       called from the real-time thread.
+     */
+    void close();
+    unsigned int numChannels() const { return m_channels.size(); }
+    /**
+       \return index of the channel, -1 if not found
+     */
+    int findChannel(const std::string& name) const;
+    const std::string& name(unsigned int ch) const { return m_channels[ch].name; }
+    unsigned int numElements(unsigned int ch) const { return m_channels[ch].n_elements; }
+    unsigned int numSamples(unsigned int ch) const { return m_channels[ch].n_samples; }
+    /**
+       \return the number of samples from the beginning which are paged in
+     */
+    unsigned int numAvailable(unsigned int ch) const { return m_channels[ch].available; }
+    /**
+       \return pointer to [time element_0 ... element_n-1] of i-th sample.
+       Samples after numAvailable() may be read from the disk.
+     */
+    const double *sample(unsigned int ch, unsigned int i) const
+    {
+        const Channel& c = m_channels[ch];
+        return c.data + (size_t)i*(c.n_elements+1);
+    }
+    /**
+       \brief notify that samples before i-th one are no longer used.
+       Pages of them are released and the following pages are read ahead
+       by the prefetch thread. This can be called from the real-time thread.
+     */
+    void advance(unsigned int ch, unsigned int i) { m_channels[ch].consumed = i; }
+    /**
+       \brief release consumed pages and page in the following ones.
+       This is called by the prefetch thread.
+       \return false if all samples are consumed
+     */
+    bool prefetch();
+private:
+    struct Channel
+    {
+        std::string name;
+        unsigned int n_elements, n_samples;
+        const double *data;
+        size_t begin, end;  ///< offsets of samples in the file
+        size_t released;    ///< offset of the end of released pages
+        size_t prefetched;  ///< offset of the end of pages paged in
+        volatile unsigned int consumed, available;
+    };
+    std::vector<Channel> m_channels;
+    char *m_addr;
+    size_t m_length;
+    PatternPrefetcher *m_prefetcher;
+};
+
+#endif
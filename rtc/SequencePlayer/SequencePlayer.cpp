@@ -18,6 +18,9 @@
 
 typedef coil::Guard<coil::Mutex> Guard;
 
+// length of the path of setTargetPose() solved before it is played[s]
+#define CARTESIAN_PATH_LOOKAHEAD 0.3
+
 // Module specification
 // <rtc-template block="module_spec">
 static const char* sequenceplayer_spec[] =
@@ -61,6 +64,7 @@ SequencePlayer::SequencePlayer(RTC::Manager* manager)
       m_error_pos(0.0001),
       m_error_rot(0.001),
       m_iteration(50),
+      m_planner(NULL),
       dummy(0)
 {
     m_service0.player(this);
@@ -127,6 +131,15 @@ RTC::ReturnCode_t SequencePlayer::onInitialize()
         std::cerr << "failed to load model[" << prop["model"] << "]" 
                   << std::endl;
     }
+    // setTargetPose() is solved with another model in a worker thread
+    hrp::BodyPtr planner_robot = hrp::BodyPtr(new Body());
+    if (!loadBodyFromModelLoader(planner_robot, prop["model"].c_str(), 
+                                 CosNaming::NamingContext::_duplicate(naming.getRootContext())
+                                 )){
+        std::cerr << "failed to load model[" << prop["model"] << "]" 
+                  << std::endl;
+    }
+    m_planner = new CartesianPathPlanner(planner_robot, dt, std::string(m_profile.instance_name));
 
     unsigned int dof = m_robot->numJoints();
 
@@ -185,6 +198,8 @@ RTC::ReturnCode_t SequencePlayer::onFinalize()
     if ( m_debugLevel > 0 ) {
         std::cerr << __PRETTY_FUNCTION__ << std::endl;
     }
+    delete m_planner;
+    m_planner = NULL;
     return RTC::RTC_OK;
 }
 
@@ -228,14 +243,21 @@ RTC::ReturnCode_t SequencePlayer::onExecute(RTC::UniqueId ec_id)
     if (m_baseRpyInitIn.isNew()) m_baseRpyInitIn.read();
     if (m_zmpRefInitIn.isNew()) m_zmpRefInitIn.read();
 
-    if (m_gname != "" && m_seq->isEmpty(m_gname.c_str())){
+    // the group of setTargetPose() is not empty until its path is solved
+    std::string cartesian_group;
+    {
+        Guard guard(m_mutex);
+        if (feedCartesianPath()) cartesian_group = m_cartesianGroup;
+    }
+
+    if (m_gname != "" && m_seq->isEmpty(m_gname.c_str()) && m_gname != cartesian_group){
         if (m_waitFlag){
             m_gname = "";
             m_waitFlag = false;
             m_waitSem.post();
         }
     }
-    if (m_seq->isEmpty()){
+    if (m_seq->isEmpty() && cartesian_group == ""){
         m_clearFlag = false;
         if (m_waitFlag){
             m_waitFlag = false;
@@ -280,6 +302,8 @@ RTC::ReturnCode_t SequencePlayer::onExecute(RTC::UniqueId ec_id)
         }
 
         if (m_clearFlag){
+            m_planner->cancel();
+            m_cartesianGroup = "";
             m_seq->clear(0.001);
         }
     }
@@ -449,6 +473,8 @@ bool SequencePlayer::clearJointAngles()
 
     if (!setInitialState()) return false;
 
+    m_planner->cancel();
+    m_cartesianGroup = "";
     return m_seq->clearJointAngles();
 }
 
@@ -479,6 +505,10 @@ bool SequencePlayer::clearJointAnglesOfGroup(const char *gname)
 
     if (!m_seq->resetJointGroup(gname, m_qInit.data.get_buffer())) return false;
 
+    if (m_cartesianGroup == gname){
+        m_planner->cancel();
+        m_cartesianGroup = "";
+    }
     return m_seq->clearJointAnglesOfGroup(gname);
 }
 
@@ -549,118 +579,96 @@ bool SequencePlayer::setTargetPose(const char* gname, const double *xyz, const d
     if ( m_debugLevel > 0 ) {
         std::cerr << __PRETTY_FUNCTION__ << std::endl;
     }
-    Guard guard(m_mutex);
-    if (!setInitialState()) return false;
-    // setup
-    std::vector<int> indices;
-    hrp::dvector start_av, end_av;
-    std::vector<hrp::dvector> avs;
-    if (! m_seq->getJointGroup(gname, indices) ) {
-        std::cerr << "[setTargetPose] Could not find joint group " << gname << std::endl;
-        return false;
-    }
-    start_av.resize(indices.size());
-    end_av.resize(indices.size());
-
-    //std::cerr << std::endl;
-    if ( ! m_robot->joint(indices[0])->parent ) {
-        std::cerr << "[setTargetPose] " << m_robot->joint(indices[0])->name << " does not have parent" << std::endl;
-        return false;
-    }
-    string base_parent_name = m_robot->joint(indices[0])->parent->name;
-    string target_name = m_robot->joint(indices[indices.size()-1])->name;
-    // prepare joint path
-    hrp::JointPathExPtr manip = hrp::JointPathExPtr(new hrp::JointPathEx(m_robot, m_robot->link(base_parent_name), m_robot->link(target_name), dt, true, std::string(m_profile.instance_name)));
+    unsigned long path_id;
+    {
+        Guard guard(m_mutex);
+        if (!setInitialState()) return false;
+        // setup
+        std::vector<int> indices;
+        if (! m_seq->getJointGroup(gname, indices) ) {
+            std::cerr << "[setTargetPose] Could not find joint group " << gname << std::endl;
+            return false;
+        }
 
-    // calc fk
-    for (int i=0; i<m_robot->numJoints(); i++){
-        hrp::Link *j = m_robot->joint(i);
-        if (j) j->q = m_qRef.data.get_buffer()[i];
-    }
-    m_robot->calcForwardKinematics();
-    for ( int i = 0; i < manip->numJoints(); i++ ){
-        start_av[i] = manip->joint(i)->q;
-    }
+        //std::cerr << std::endl;
+        if ( ! m_robot->joint(indices[0])->parent ) {
+            std::cerr << "[setTargetPose] " << m_robot->joint(indices[0])->name << " does not have parent" << std::endl;
+            return false;
+        }
+        string base_parent_name = m_robot->joint(indices[0])->parent->name;
+        string target_name = m_robot->joint(indices[indices.size()-1])->name;
 
-    // xyz and rpy are relateive to root link, where as pos and rotatoin of manip->calcInverseKinematics are relative to base link
+        // calc fk
+        for (int i=0; i<m_robot->numJoints(); i++){
+            hrp::Link *j = m_robot->joint(i);
+            if (j) j->q = m_qRef.data.get_buffer()[i];
+        }
+        m_robot->calcForwardKinematics();
 
-    // ik params
-    hrp::Vector3 start_p(m_robot->link(target_name)->p);
-    hrp::Matrix33 start_R(m_robot->link(target_name)->R);
-    hrp::Vector3 end_p(xyz[0], xyz[1], xyz[2]);
-    hrp::Matrix33 end_R = m_robot->link(target_name)->calcRfromAttitude(hrp::rotFromRpy(rpy[0], rpy[1], rpy[2]));
+        // xyz and rpy are relateive to root link, where as pos and rotatoin of manip->calcInverseKinematics are relative to base link
 
-    // change start and end must be relative to the frame_name
-    if ( (frame_name != NULL) && (! m_robot->link(frame_name) ) ) {
-        std::cerr << "[setTargetPose] Could not find frame_name " << frame_name << std::endl;
-        return false;
-    } else if ( frame_name != NULL ) {
-        hrp::Vector3 frame_p(m_robot->link(frame_name)->p);
-        hrp::Matrix33 frame_R(m_robot->link(frame_name)->attitude());
-        // fix start/end references from root to frame;
-        end_p = frame_R * end_p + frame_p;
-        end_R = frame_R * end_R;
-    }
-    manip->setMaxIKError(m_error_pos,m_error_rot);
-    manip->setMaxIKIteration(m_iteration);
-    std::cerr << "[setTargetPose] Solveing IK with frame" << frame_name << ", Error " << m_error_pos << m_error_rot << ", Iteration " << m_iteration << std::endl;
-    std::cerr << "                Start " << start_p << start_R<< std::endl;
-    std::cerr << "                End   " << end_p << end_R<< std::endl;
-
-    // interpolate & calc ik
-    int len = max(((start_p - end_p).norm() / 0.02 ), // 2cm
-                  ((hrp::omegaFromRot(start_R.transpose() * end_R).norm()) / 0.025)); // 2 deg
-    len = max(len, 1);
+        // ik params
+        hrp::Vector3 start_p(m_robot->link(target_name)->p);
+        hrp::Matrix33 start_R(m_robot->link(target_name)->R);
+        hrp::Vector3 end_p(xyz[0], xyz[1], xyz[2]);
+        hrp::Matrix33 end_R = m_robot->link(target_name)->calcRfromAttitude(hrp::rotFromRpy(rpy[0], rpy[1], rpy[2]));
 
-    std::vector<const double *> v_pos;
-    std::vector<double> v_tm;
-    v_pos.resize(len);
-    v_tm.resize(len);
-
-    // do loop
-    for (int i = 0; i < len; i++ ) {
-        double a = (1+i)/(double)len;
-        hrp::Vector3 p = (1-a)*start_p + a*end_p;
-        hrp::Vector3 omega = hrp::omegaFromRot(start_R.transpose() * end_R);
-        hrp::Matrix33 R = start_R * rodrigues(omega.isZero()?omega:omega.normalized(), a*omega.norm());
-        bool ret = manip->calcInverseKinematics2(p, R);
-
-        if ( m_debugLevel > 0 ) {
-            // for debug
-            std::cerr << "target pos/rot : " << i << "/" << a << " : "
-                      << p[0] << " " << p[1] << " " << p[2] << ","
-                      << omega[0] << " " << omega[1] << " " << omega[2] << std::endl;
-        }
-        if ( ! ret ) {
-            std::cerr << "[setTargetPose] IK failed" << std::endl;
+        // change start and end must be relative to the frame_name
+        if ( (frame_name != NULL) && (! m_robot->link(frame_name) ) ) {
+            std::cerr << "[setTargetPose] Could not find frame_name " << frame_name << std::endl;
             return false;
+        } else if ( frame_name != NULL ) {
+            hrp::Vector3 frame_p(m_robot->link(frame_name)->p);
+            hrp::Matrix33 frame_R(m_robot->link(frame_name)->attitude());
+            // fix start/end references from root to frame;
+            end_p = frame_R * end_p + frame_p;
+            end_R = frame_R * end_R;
         }
-        v_pos[i] = (const double *)malloc(sizeof(double)*manip->numJoints());
-        for ( int j = 0; j < manip->numJoints(); j++ ){
-            ((double *)v_pos[i])[j] = manip->joint(j)->q;
-        }
-        v_tm[i] = tm/len;
-    }
-
-    if ( m_debugLevel > 0 ) {
-        // for debug
-        for(int i = 0; i < len; i++ ) {
-            std::cerr << v_tm[i] << ":";
-            for(int j = 0; j < start_av.size(); j++ ) {
-                std::cerr << v_pos[i][j] << " ";
-            }
-            std::cerr << std::endl;
+        std::cerr << "[setTargetPose] Solveing IK with frame" << frame_name << ", Error " << m_error_pos << m_error_rot << ", Iteration " << m_iteration << std::endl;
+        std::cerr << "                Start " << start_p << start_R<< std::endl;
+        std::cerr << "                End   " << end_p << end_R<< std::endl;
+
+        // the path being played is stopped and IK of the new path is solved in
+        // the worker thread, its samples are fed in onExecute()
+        m_cartesianGroup = "";
+        m_planner->setMaxIKError(m_error_pos, m_error_rot);
+        m_planner->setMaxIKIteration(m_iteration);
+        m_planner->setDebugLevel(m_debugLevel);
+        path_id = m_planner->start(base_parent_name, target_name, m_qRef.data.get_buffer(), end_p, end_R, tm);
+        if ( ! path_id ) {
+            std::cerr << "[setTargetPose] Could not make joint path from " << base_parent_name << " to " << target_name << std::endl;
+            return false;
         }
     }
 
-    bool ret = m_seq->playPatternOfGroup(gname, v_pos, v_tm, m_qInit.data.get_buffer(), v_pos.size()>0?indices.size():0);
-
-    // clean up memory, need to improve
-    for (int i = 0; i < len; i++ ) {
-        free((double *)v_pos[i]);
+    // playing starts when the beginning of the path is solved, so that
+    // the motion is not stopped if IK fails there
+    if ( ! m_planner->waitForSamples(path_id, CARTESIAN_PATH_LOOKAHEAD) ) {
+        std::cerr << "[setTargetPose] IK failed" << std::endl;
+        Guard guard(m_mutex);
+        if (m_planner->pathId() == path_id) m_planner->cancel();
+        return false;
     }
+    Guard guard(m_mutex);
+    // replaced by another path
+    if (m_planner->pathId() != path_id) return false;
+    m_cartesianGroup = gname;
+    return true;
+}
 
-    return ret;
+// feed samples solved by the planner to the group interpolator, returns
+// true while the path is being solved
+bool SequencePlayer::feedCartesianPath()
+{
+    if (m_cartesianGroup == "") return false;
+    bool planning = m_planner->popSamples(m_cartesianSamples);
+    for (size_t i = 0; i < m_cartesianSamples.size(); i++){
+        const CartesianPathPlanner::Sample& s = m_cartesianSamples[i];
+        m_seq->playSampleOfGroup(m_cartesianGroup.c_str(), s.q.data(), s.v.data(), s.tm, s.q.size());
+    }
+    m_cartesianSamples.clear();
+    if (!planning) m_cartesianGroup = "";
+    return planning;
 }
 
 void SequencePlayer::loadPattern(const char *basename, double tm)
@@ -21,6 +21,7 @@
 #include <hrpModel/Body.h>
 #include <hrpModel/Sensor.h>
 #include "seqplay.h"
+#include "CartesianPathPlanner.h"
 
 // Service implementation headers
 // <rtc-template block="service_impl_h">
@@ -179,6 +180,7 @@ class SequencePlayer
   // </rtc-template>
 
  private:
+  bool feedCartesianPath();
   seqplay *m_seq;
   bool m_clearFlag, m_waitFlag;
   boost::interprocess::interprocess_semaphore m_waitSem;
@@ -190,6 +192,10 @@ class SequencePlayer
   coil::Mutex m_mutex;
   double m_error_pos, m_error_rot;
   short m_iteration;
+  // path of setTargetPose() solved in a worker thread
+  CartesianPathPlanner *m_planner;
+  std::string m_cartesianGroup;
+  std::deque<CartesianPathPlanner::Sample> m_cartesianSamples;
 };
 
 
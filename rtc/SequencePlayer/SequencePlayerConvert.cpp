@@ -0,0 +1,49 @@
+// -*- C++ -*-
+/*!
+ * @file  SequencePlayerConvert.cpp
+ * @brief convert text motion pattern files into a binary pattern file
+ * $Date$
+ *
+ * $Id$
+ */
+
+#include <iostream>
+#include <unistd.h>
+#include "PatternFile.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2){
+        std::cerr << "usage: " << argv[0] << " basename [output" << HRPPAT_SUFFIX << "]" << std::endl;
+        std::cerr << "  converts basename.{pos,zmp,gsens,hip,waist,torque,wrenches,optionaldata}" << std::endl;
+        return 1;
+    }
+    std::string basename(argv[1]);
+    std::string output = argc >= 3 ? std::string(argv[2]) : basename + HRPPAT_SUFFIX;
+
+    const char *names[] = {"pos", "zmp", "gsens", "hip", "waist", "torque", "wrenches", "optionaldata"};
+    std::vector<PatternChannel> channels;
+    for (unsigned int i=0; i<sizeof(names)/sizeof(names[0]); i++){
+        std::string fname = basename + "." + names[i];
+        if (access(fname.c_str(), 0) != 0) continue;
+        PatternChannel ch;
+        ch.name = names[i];
+        if (!readTextPattern(fname, ch)){
+            std::cerr << "failed to read " << fname << std::endl;
+            return 1;
+        }
+        std::cout << fname << " (" << ch.size() << " samples, "
+                  << ch.n_elements << " elements)" << std::endl;
+        channels.push_back(ch);
+    }
+    if (channels.empty()){
+        std::cerr << "pattern not found(" << basename << ")" << std::endl;
+        return 1;
+    }
+    if (!writeBinaryPattern(output, channels)){
+        std::cerr << "failed to write " << output << std::endl;
+        return 1;
+    }
+    std::cout << "wrote " << output << std::endl;
+    return 0;
+}
@@ -1,4 +1,6 @@
 #include <fstream>
+#include <sstream>
+#include <cstdlib>
 #include <iostream>
 #include <cmath>
 #include <cstring>
@@ -12,6 +14,7 @@ interpolator::interpolator(int dim_, double dt_, interpolation_mode imode_, doub
   dim = dim_;
   dt = dt_;
   length = 0;
+  q_capacity = q_head = q_size = 0;
   gx = new double[dim];
   gv = new double[dim];
   ga = new double[dim];
@@ -92,8 +95,22 @@ void interpolator::linear_interpolation(double &remain_t_,
 
 void interpolator::sync()
 {
-  //cout << "sync:" << length << "," << q.size() << endl;
-  length = q.size();
+  //cout << "sync:" << length << "," << q_size << endl;
+  length = q_size;
+}
+
+void interpolator::reserve(int n)
+{
+  if (n <= q_capacity) return;
+  // grow geometrically so that successive reservations are amortized
+  int new_capacity = q_capacity*2 > n ? q_capacity*2 : n;
+  std::vector<double> new_q((size_t)new_capacity*3*dim + 1);
+  for (int i=0; i<q_size; i++){
+    memcpy(&new_q[0] + (size_t)i*3*dim, sample(i), sizeof(double)*3*dim);
+  }
+  q.swap(new_q);
+  q_capacity = new_capacity;
+  q_head = 0;
 }
 
 double interpolator::calc_interpolation_time(const double *newg)
@@ -205,6 +222,7 @@ void interpolator::go(const double *newg, const double *newv, double time, bool
 {
   if (time == 0) time = calc_interpolation_time(newg);
   setGoal(newg, newv, time, false);
+  reserve(q_size + (int)ceil(time/dt) + 1);
   
   do{
       interpolate(time);
@@ -212,6 +230,16 @@ void interpolator::go(const double *newg, const double *newv, double time, bool
   if (immediate) sync();
 }
 
+// read the next number in buf, return false if there is no number
+static bool readValue(const char *&buf, double &value)
+{
+  char *end;
+  value = strtod(buf, &end);
+  if (end == buf) return false;
+  buf = end;
+  return true;
+}
+
 void interpolator::load(const char *fname, double time_to_start, double scale,
 			bool immediate, size_t offset1, size_t offset2)
 {
@@ -220,29 +248,36 @@ void interpolator::load(const char *fname, double time_to_start, double scale,
     cerr << "[interpolator " << name << "] file not found(" << fname << ")" << endl;
     return;
   }
-  double *vs, ptime=-1,time, tmp;
-  vs = new double[dim];
-  strm >> time;
-  while(strm.eof()==0){
-    for (int i=0; i<offset1; i++){
-      strm >> tmp;
+  // read the whole file at once, parsing with operator>> is much slower than strtod
+  ostringstream contents;
+  contents << strm.rdbuf();
+  strm.close();
+  const std::string& str = contents.str();
+  const char *buf = str.c_str();
+  double ptime=-1,time, tmp;
+  std::vector<double> vs(dim);
+  while(readValue(buf, time)){
+    bool valid = true;
+    for (int i=0; i<offset1 && valid; i++){
+      valid = readValue(buf, tmp);
     }
-    for (int i=0; i<dim; i++){
-      strm >> vs[i];
+    for (int i=0; i<dim && valid; i++){
+      valid = readValue(buf, vs[i]);
+    }
+    for (int i=0; i<offset2 && valid; i++){
+      valid = readValue(buf, tmp);
     }
-    for (int i=0; i<offset2; i++){
-      strm >> tmp;
+    if (!valid){
+      cerr << "[interpolator " << name << "] incomplete line at time " << time << " in " << fname << endl;
+      break;
     }
     if (ptime <0){
-      go(vs, time_to_start, false);
+      go(&vs[0], time_to_start, false);
     }else{
-      go(vs, scale*(time-ptime), false);
+      go(&vs[0], scale*(time-ptime), false);
     }
     ptime = time;
-    strm >> time;
   }
-  strm.close();
-  delete [] vs;
   if (immediate) sync();
 }
 
@@ -254,15 +289,12 @@ void interpolator::load(string fname, double time_to_start, double scale,
 
 void interpolator::push(const double *x_, const double *v_, const double *a_, bool immediate)
 {
-  double *p = new double[dim];
-  double *dp = new double[dim];
-  double *ddp = new double[dim];
+  if (q_size == q_capacity) reserve(q_size + 1);
+  double *p = sample(q_size);
   memcpy(p, x_, sizeof(double)*dim);
-  memcpy(dp, v_, sizeof(double)*dim);
-  memcpy(ddp, a_, sizeof(double)*dim);
-  q.push_back(p);
-  dq.push_back(dp);
-  ddq.push_back(ddp);
+  memcpy(p+dim, v_, sizeof(double)*dim);
+  memcpy(p+2*dim, a_, sizeof(double)*dim);
+  q_size++;
   if (immediate) sync();
 }
 
@@ -271,15 +303,8 @@ void interpolator::pop()
   coil::Guard<coil::Mutex> lock(pop_mutex_);
   if (length > 0){
     length--;
-    double *&vs = q.front();
-    delete [] vs;
-    q.pop_front();
-    double *&dvs = dq.front();
-    delete [] dvs;
-    dq.pop_front();
-    double *&ddvs = ddq.front();
-    delete [] ddvs;
-    ddq.pop_front();
+    q_size--;
+    q_head = q_head + 1 == q_capacity ? 0 : q_head + 1;
   }
 }
 
@@ -288,28 +313,15 @@ void interpolator::pop_back()
   coil::Guard<coil::Mutex> lock(pop_mutex_);
   if (length > 0){
     length--;
-    double *&vs = q.back();
-    delete [] vs;
-    q.pop_back();
+    q_size--;
     if (length > 0){
-      memcpy(x, q.back(), sizeof(double)*dim);
+      double *p = sample(q_size-1);
+      memcpy(x, p, sizeof(double)*dim);
+      memcpy(v, p+dim, sizeof(double)*dim);
+      memcpy(a, p+2*dim, sizeof(double)*dim);
     }else{
       memcpy(x, gx, sizeof(double)*dim);
-    }
-    double *&dvs = dq.back();
-    delete [] dvs;
-    dq.pop_back();
-    if (length > 0){
-      memcpy(v, dq.back(), sizeof(double)*dim);
-    }else{
       memcpy(v, gv, sizeof(double)*dim);
-    }
-    double *&ddvs = ddq.back();
-    delete [] ddvs;
-    ddq.pop_back();
-    if (length > 0){
-      memcpy(a, ddq.back(), sizeof(double)*dim);
-    }else{
       memcpy(a, ga, sizeof(double)*dim);
     }
   } else if (remain_t > 0) {
@@ -333,7 +345,7 @@ void interpolator::set(const double *x_, const double *v_)
 double *interpolator::front()
 {
   if (length!=0){
-    return q.front();
+    return sample(0);
   }else{
     return gx;
   }
@@ -354,24 +366,10 @@ void interpolator::get(double *x_, double *v_, double *a_, bool popp)
   interpolate(remain_t);
 
   if (length!=0){
-    double *&vs = q.front();
-    if (vs == NULL) {
-      cerr << "[interpolator " << name << "] interpolator::get vs = NULL, q.size() = " << q.size() 
-	   << ", length = " << length << endl;
-    }
-    double *&dvs = dq.front();
-    if (dvs == NULL) {
-      cerr << "[interpolator " << name << "] interpolator::get dvs = NULL, dq.size() = " << dq.size() 
-	   << ", length = " << length << endl;
-    }
-    double *&ddvs = ddq.front();
-    if (ddvs == NULL) {
-      cerr << "[interpolator " << name << "] interpolator::get ddvs = NULL, ddq.size() = " << ddq.size() 
-	   << ", length = " << length << endl;
-    }
+    double *vs = sample(0);
     memcpy(x_, vs, sizeof(double)*dim);
-    if ( v_ != NULL ) memcpy(v_, dvs, sizeof(double)*dim);
-    if ( a_ != NULL ) memcpy(a_, ddvs, sizeof(double)*dim);
+    if ( v_ != NULL ) memcpy(v_, vs+dim, sizeof(double)*dim);
+    if ( a_ != NULL ) memcpy(a_, vs+2*dim, sizeof(double)*dim);
     if (popp) pop();
   }else{
     memcpy(x_, gx, sizeof(double)*dim);
@@ -1,7 +1,7 @@
 #ifndef __INTERPOLATOR_H__
 #define __INTERPOLATOR_H__
 
-#include <deque>
+#include <vector>
 #include <string>
 #include <coil/Mutex.h>
 
@@ -41,6 +41,8 @@ public:
   void pop();
   void pop_back();
   void clear();
+  // Reserve memory of value queue for n samples to avoid reallocation while pushing.
+  void reserve(int n);
   void sync();
   void load(string fname, double time_to_start=1.0, double scale=1.0,
 	    bool immediate=true, size_t offset1 = 0, size_t offset2 = 0);
@@ -65,8 +67,13 @@ private:
   // Current interpolation mode
   interpolation_mode imode;
   // Queue of positions, velocities, and accelerations ([q_t, q_t+1, ...., q_t+n]).
-  deque<double *> q, dq, ddq;
-  // Length of queue.
+  //   Samples are stored in a ring buffer (q) of q_capacity samples. Each sample occupies
+  //   3*dim elements, [x_0...x_dim-1 v_0...v_dim-1 a_0...a_dim-1]. Memory is reused
+  //   after pop() and reallocated only when the queue grows beyond its capacity.
+  std::vector<double> q;
+  // Capacity of ring buffer, index of the oldest sample and the number of pushed samples.
+  int q_capacity, q_head, q_size;
+  // Length of queue (synchronized with q_size by sync()).
   int length;
   // Dimension of interpolated vector (dim of x, v, a, ... etc)
   int dim;
@@ -93,6 +100,8 @@ private:
   void linear_interpolation(double &remain_t_,
 			    double gx,
 			    double &xx, double &vv, double &aa);
+  // Pointer to i-th sample in queue, 0 is the oldest one.
+  double *sample(int i) { int idx = q_head + i; return &q[0] + (idx >= q_capacity ? idx - q_capacity : idx)*3*dim; }
   //Mutex to avoid poping twice the same element
   coil::Mutex pop_mutex_;
 };
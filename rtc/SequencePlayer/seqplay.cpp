@@ -1,12 +1,16 @@
 // -*- mode: c++; indent-tabs-mode: t; tab-width: 4; c-basic-offset: 4; -*-
 
 #include <iostream>
+#include <limits>
+#include <cstring>
 #include <unistd.h>
 #include "seqplay.h"
 
 #define deg2rad(x)	((x)*M_PI/180)
+// length of samples kept in interpolators while a binary pattern is streamed[s]
+#define PATTERN_LOOKAHEAD 1.0
 
-seqplay::seqplay(unsigned int i_dof, double i_dt, unsigned int i_fnum, unsigned int optional_data_dim) : m_dof(i_dof)
+seqplay::seqplay(unsigned int i_dof, double i_dt, unsigned int i_fnum, unsigned int optional_data_dim) : debug_level(0), m_dof(i_dof)
 {
     interpolators[Q] = new interpolator(i_dof, i_dt);
     interpolators[ZMP] = new interpolator(3, i_dt);
@@ -47,6 +51,8 @@ seqplay::seqplay(unsigned int i_dof, double i_dt, unsigned int i_fnum, unsigned
 
 seqplay::~seqplay()
 {
+	dropPatterns();
+	deleteFinishedPatterns();
 	for (unsigned int i=0; i<NINTERPOLATOR; i++){
 		delete interpolators[i];
 	}
@@ -102,6 +108,7 @@ void seqplay::goInitial(double tm)
 
 bool seqplay::isEmpty() const
 {
+	if (!patternStreams.empty()) return false;
 	for (unsigned int i=0; i<NINTERPOLATOR; i++){
 		if (!interpolators[i]->isEmpty()) return false;
 	}
@@ -152,6 +159,7 @@ void seqplay::getReferenceState(::CharacterState_out ref)
 
 void seqplay::setJointAngles(const double *jvs, double tm)
 {
+	flushPatterns();
 	if (tm == 0){
 		interpolators[Q]->set(jvs);
 	}else{
@@ -167,6 +175,7 @@ void seqplay::getJointAngles(double *jvs)
 
 void seqplay::setZmp(const double *i_zmp, double i_tm)
 {
+	flushPatterns();
 	if (i_tm == 0){
 		interpolators[ZMP]->set(i_zmp);
 	}else{
@@ -176,6 +185,7 @@ void seqplay::setZmp(const double *i_zmp, double i_tm)
 
 void seqplay::setBasePos(const double *i_pos, double i_tm)
 {
+	flushPatterns();
 	if (i_tm == 0){
 		interpolators[P]->set(i_pos);
 	}else{
@@ -185,6 +195,7 @@ void seqplay::setBasePos(const double *i_pos, double i_tm)
 
 void seqplay::setBaseRpy(const double *i_rpy, double i_tm)
 {
+	flushPatterns();
 	if (i_tm == 0){
 		interpolators[RPY]->set(i_rpy);
 	}else{
@@ -194,6 +205,7 @@ void seqplay::setBaseRpy(const double *i_rpy, double i_tm)
 
 void seqplay::setBaseAcc(const double *i_acc, double i_tm)
 {
+	flushPatterns();
 	if (i_tm == 0){
 		interpolators[ACC]->set(i_acc);
 	}else{
@@ -203,6 +215,7 @@ void seqplay::setBaseAcc(const double *i_acc, double i_tm)
 
 void seqplay::setWrenches(const double *i_wrenches, double i_tm)
 {
+	flushPatterns();
 	if (i_tm == 0){
 		interpolators[WRENCHES]->set(i_wrenches);
 	}else{
@@ -212,6 +225,7 @@ void seqplay::setWrenches(const double *i_wrenches, double i_tm)
 
 void seqplay::setJointAngle(unsigned int i_rank, double jv, double tm)
 {
+    flushPatterns();
     double pos[m_dof];
 	getJointAngles(pos);
     pos[i_rank] = jv;
@@ -220,6 +234,7 @@ void seqplay::setJointAngle(unsigned int i_rank, double jv, double tm)
 
 void seqplay::playPattern(std::vector<const double*> pos, std::vector<const double*> zmp, std::vector<const double*> rpy, std::vector<double> tm, const double *qInit, unsigned int len)
 {
+    flushPatterns();
     const double *q=NULL, *z=NULL, *a=NULL, *p=NULL, *e=NULL, *tq=NULL, *wr=NULL, *od=NULL; double t=0;
     double *v = new double[len];
     for (unsigned int i=0; i<pos.size(); i++){
@@ -262,6 +277,7 @@ void seqplay::playPattern(std::vector<const double*> pos, std::vector<const doub
 
 void seqplay::clear(double i_timeLimit)
 {
+	dropPatterns();
 	tick_t t1 = get_tick();
 	while (!isEmpty()){
 		if (i_timeLimit > 0 
@@ -272,6 +288,8 @@ void seqplay::clear(double i_timeLimit)
 
 void seqplay::loadPattern(const char *basename, double tm)
 {
+    if (streamPattern(basename, tm)) return;
+    flushPatterns();
     double scale = 1.0;
     bool found = false;
     if (debug_level > 0) cout << "pos   = ";
@@ -337,6 +355,142 @@ void seqplay::loadPattern(const char *basename, double tm)
     sync();
 }
 
+bool seqplay::streamPattern(const char *basename, double tm)
+{
+    deleteFinishedPatterns();
+    string fname = basename; fname.append(HRPPAT_SUFFIX);
+    if (access(fname.c_str(),0)!=0) return false;
+    patternStream *ps = new patternStream();
+    if (!ps->file.open(fname)){
+        cerr << "failed to open(" << fname << "), try text files" << endl;
+        delete ps;
+        return false;
+    }
+    if (debug_level > 0) cout << "pattern = " << fname << endl;
+    ps->time_to_start = tm;
+    // channels are assigned to interpolators in the same way as text files
+    const char *names[] = {"pos", "zmp", "gsens", "hip", "waist", "waist", "torque", "wrenches", "optionaldata"};
+    const int targets[] = {Q, ZMP, ACC, RPY, P, RPY, TQ, WRENCHES, OPTIONAL_DATA};
+    const int offsets[] = {0, 0, 0, 0, 0, 3, 0, 0, 0};
+    bool hip = ps->file.findChannel("hip") >= 0;
+    for (unsigned int i=0; i<sizeof(names)/sizeof(names[0]); i++){
+        int ch = ps->file.findChannel(names[i]);
+        if (ch < 0 || ps->file.numSamples(ch) == 0) continue;
+        if (hip && strcmp(names[i], "waist") == 0) continue;
+        unsigned int len = offsets[i] + (unsigned int)interpolators[targets[i]]->dimension();
+        if (ps->file.numElements(ch) < len){
+            cerr << names[i] << " of " << fname << " has " << ps->file.numElements(ch)
+                 << " elements, " << len << " are required" << endl;
+            continue;
+        }
+        patternStream::target t;
+        t.channel = ch;
+        t.interpolator = targets[i];
+        t.offset = offsets[i];
+        t.next = 0;
+        t.ptime = -1;
+        ps->targets.push_back(t);
+    }
+    if (ps->targets.empty()){
+        cerr << "pattern not found(" << fname << ")" << endl;
+        delete ps;
+        return true;
+    }
+    patternStreams.push_back(ps);
+    // removeFinishedPatterns() in the real-time thread must not allocate
+    finishedPatternStreams.reserve(patternStreams.size() + finishedPatternStreams.size());
+    feedPatterns(PATTERN_LOOKAHEAD);
+    return true;
+}
+
+void seqplay::feedPatterns(double lookahead, bool all)
+{
+    // samples of a pattern are fed to an interpolator after all samples of
+    // the preceding patterns for the interpolator are fed
+    bool blocked[NINTERPOLATOR];
+    for (unsigned int i=0; i<NINTERPOLATOR; i++) blocked[i] = false;
+    for (std::deque<patternStream *>::iterator it=patternStreams.begin(); it!=patternStreams.end(); it++){
+        patternStream *ps = *it;
+        for (unsigned int i=0; i<ps->targets.size(); i++){
+            patternStream::target& t = ps->targets[i];
+            unsigned int n = ps->file.numSamples(t.channel);
+            if (t.next >= n || blocked[t.interpolator]) continue;
+            // samples which are not paged in yet are fed in later cycles
+            unsigned int available = all ? n : ps->file.numAvailable(t.channel);
+            interpolator *ip = interpolators[t.interpolator];
+            while (t.next < available && ip->remain_time() < lookahead){
+                const double *sample = ps->file.sample(t.channel, t.next++);
+                ip->go(sample + 1 + t.offset, t.ptime < 0 ? ps->time_to_start : sample[0] - t.ptime);
+                t.ptime = sample[0];
+            }
+            if (t.next < n) blocked[t.interpolator] = true;
+        }
+        advancePattern(ps);
+    }
+    removeFinishedPatterns();
+}
+
+void seqplay::advancePattern(patternStream *ps)
+{
+    // a channel may be fed to two interpolators
+    for (unsigned int i=0; i<ps->targets.size(); i++){
+        unsigned int next = ps->targets[i].next;
+        for (unsigned int j=0; j<ps->targets.size(); j++){
+            if (ps->targets[j].channel == ps->targets[i].channel && ps->targets[j].next < next){
+                next = ps->targets[j].next;
+            }
+        }
+        ps->file.advance(ps->targets[i].channel, next);
+    }
+}
+
+void seqplay::flushPatterns()
+{
+    if (!patternStreams.empty()) feedPatterns(std::numeric_limits<double>::max(), true);
+    deleteFinishedPatterns();
+}
+
+void seqplay::dropPatterns(int i_interpolator)
+{
+    for (unsigned int i=0; i<patternStreams.size(); i++){
+        patternStream *ps = patternStreams[i];
+        for (unsigned int j=0; j<ps->targets.size(); j++){
+            patternStream::target& t = ps->targets[j];
+            if (i_interpolator < 0 || t.interpolator == i_interpolator){
+                t.next = ps->file.numSamples(t.channel);
+            }
+        }
+        advancePattern(ps);
+    }
+    // streams are deleted later since this is called from clear() in the real-time thread
+    removeFinishedPatterns();
+}
+
+void seqplay::removeFinishedPatterns()
+{
+    for (std::deque<patternStream *>::iterator it=patternStreams.begin(); it!=patternStreams.end();){
+        patternStream *ps = *it;
+        bool finished = true;
+        for (unsigned int i=0; i<ps->targets.size(); i++){
+            if (ps->targets[i].next < ps->file.numSamples(ps->targets[i].channel)) finished = false;
+        }
+        if (finished){
+            finishedPatternStreams.push_back(ps);
+            it = patternStreams.erase(it);
+        }else{
+            ++it;
+        }
+    }
+}
+
+void seqplay::deleteFinishedPatterns()
+{
+    for (unsigned int i=0; i<finishedPatternStreams.size(); i++){
+        delete finishedPatternStreams[i];
+    }
+    finishedPatternStreams.clear();
+}
+
 void seqplay::sync()
 {
 	for (unsigned int i=0; i<NINTERPOLATOR; i++){
@@ -355,6 +509,7 @@ void seqplay::get(double *o_q, double *o_zmp, double *o_accel,
 				  double *o_basePos, double *o_baseRpy, double *o_tq, double *o_wrenches, double *o_optional_data)
 {
 	double v[m_dof];
+	if (!patternStreams.empty()) feedPatterns(PATTERN_LOOKAHEAD);
 	interpolators[Q]->get(o_q, v);
 	std::map<std::string, groupInterpolator *>::iterator it;
 	for (it=groupInterpolators.begin(); it!=groupInterpolators.end();){
@@ -393,6 +548,7 @@ void seqplay::go(const double *i_q, const double *i_zmp, const double *i_acc,
 				 const double *ii_p, const double *ii_rpy, const double *ii_tq, const double *ii_wrenches, const double *ii_optional_data,
 				 double i_time,	 bool immediate)
 {
+	flushPatterns();
 	if (i_q) interpolators[Q]->go(i_q, ii_q, i_time, false);
 	if (i_zmp) interpolators[ZMP]->go(i_zmp, ii_zmp, i_time, false);
 	if (i_acc) interpolators[ACC]->go(i_acc, ii_acc, i_time, false);
@@ -409,6 +565,7 @@ bool seqplay::setInterpolationMode (interpolator::interpolation_mode i_mode_)
     if (i_mode_ != interpolator::LINEAR && i_mode_ != interpolator::HOFFARBIB &&
 		i_mode_ != interpolator::QUINTICSPLINE && i_mode_ != interpolator::CUBICSPLINE) return false;
 
+	flushPatterns();
 	bool ret=true; 
 	for (unsigned int i=0; i<NINTERPOLATOR; i++){
 		ret &= interpolators[i]->setInterpolationMode(i_mode_);
@@ -595,8 +752,40 @@ bool seqplay::playPatternOfGroup(const char *gname, std::vector<const double *>
 	}
 }
 
+bool seqplay::playSampleOfGroup(const char *gname, const double *pos, const double *vel, double tm, unsigned int len)
+{
+	char *s = (char *)gname; while(*s) {*s=toupper(*s);s++;}
+	groupInterpolator *i = groupInterpolators[gname];
+	if (i){
+		if (len != i->indices.size() ) {
+			std::cerr << "[playSampleOfGroup] group name " << gname << " : size of manipulater is not equal to input. " << len << " /= " << i->indices.size() << std::endl;
+			return false;
+		}
+		if (i->state == groupInterpolator::created){
+			double q[m_dof], dq[m_dof];
+			interpolators[Q]->get(q, dq, false);
+			std::map<std::string, groupInterpolator *>::iterator it;
+			for (it=groupInterpolators.begin(); it!=groupInterpolators.end(); it++){
+				groupInterpolator *gi = it->second;
+				if (gi)	gi->get(q, dq, false);
+			}
+			double x[i->indices.size()], v[i->indices.size()];
+			i->extract(x, q);
+			i->extract(v, dq);
+			i->inter->go(x,v,interpolators[Q]->deltaT());
+		}
+		i->go(pos, vel, tm);
+		return true;
+	}else{
+		std::cerr << "[playSampleOfGroup] group name " << gname << " is not installed" << std::endl;
+		return false;
+	}
+}
+
 bool seqplay::setJointAnglesSequence(std::vector<const double*> pos, std::vector<double> tm)
 {
+	dropPatterns(Q);
+	deleteFinishedPatterns();
 	// setJointAngles to override curren tgoal
 	double x[m_dof], v[m_dof], a[m_dof];
 	interpolators[Q]->get(x, v, a, false);
@@ -643,6 +832,8 @@ bool seqplay::setJointAnglesSequence(std::vector<const double*> pos, std::vector
 
 bool seqplay::clearJointAngles()
 {
+	dropPatterns(Q);
+	deleteFinishedPatterns();
 	// setJointAngles to override curren tgoal
 	double x[m_dof], v[m_dof], a[m_dof];
 	interpolators[Q]->get(x, v, a, false);
@@ -659,6 +850,8 @@ bool seqplay::clearJointAngles()
 
 bool seqplay::setJointAnglesSequenceFull(std::vector<const double*> i_pos, std::vector<const double*> i_vel, std::vector<const double*> i_torques, std::vector<const double*> i_bpos, std::vector<const double*> i_brpy, std::vector<const double*> i_bacc,  std::vector<const double*> i_zmps, std::vector<const double*> i_wrenches, std::vector<const double*> i_optionals, std::vector<double> i_tm)
 {
+	dropPatterns();
+	deleteFinishedPatterns();
 	// setJointAngles to override curren tgoal
 	double x[m_dof], v[m_dof], a[m_dof];
 	interpolators[Q]->get(x, v, a, false);
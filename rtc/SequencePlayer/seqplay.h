@@ -3,10 +3,12 @@
 
 #include <fstream>
 #include <vector>
+#include <deque>
 #include <map>
 #include <hrpUtil/EigenTypes.h>
 #include "interpolator.h"
 #include "timeUtil.h"
+#include "PatternFile.h"
 
 using namespace hrp;
 
@@ -34,6 +36,8 @@ public:
     bool setJointAnglesOfGroup(const char *gname, const double* i_qRef, const size_t i_qsize, double i_tm=0.0);
     void clearOfGroup(const char *gname, double i_timeLimit);
     bool playPatternOfGroup(const char *gname, std::vector<const double*> pos, std::vector<double> tm, const double *qInit, unsigned int len);
+    // append a sample with velocity to the group, used to play a pattern while it is being made
+    bool playSampleOfGroup(const char *gname, const double *pos, const double *vel, double tm, unsigned int len);
 
     bool resetJointGroup(const char *gname, const double *full);
     //
@@ -141,9 +145,42 @@ private:
         gi_state state;
         double time2remove;
     };
+    // binary pattern which is fed to interpolators while playing
+    class patternStream{
+    public:
+        struct target{
+            int channel;        // index of channel in the file
+            int interpolator;   // index of interpolator
+            int offset;         // index of the first element used
+            unsigned int next;  // index of the next sample to be fed
+            double ptime;       // time of the previous sample, negative if none
+        };
+        PatternFile file;
+        double time_to_start;
+        std::vector<target> targets;
+    };
     void pop_back();
+    bool streamPattern(const char *i_basename, double i_tm);
+    // feed samples of streamed patterns until each interpolator has lookahead[s] of samples.
+    // Only samples paged in by the prefetch threads are fed unless all is true
+    void feedPatterns(double lookahead, bool all=false);
+    // feed all remaining samples, called before the queue is modified by other commands
+    void flushPatterns();
+    // discard samples which are not fed yet to the interpolator (-1 means all)
+    void dropPatterns(int i_interpolator=-1);
+    // finished patterns are moved to finishedPatternStreams, and they are
+    // deleted by deleteFinishedPatterns() outside the real-time thread since
+    // PatternFile::close() joins the prefetch thread. dropPatterns() and
+    // feedPatterns() don't delete them as they are called from clear() and
+    // get() in the real-time thread
+    void removeFinishedPatterns();
+    void deleteFinishedPatterns();
+    // notify the file of samples consumed by all targets
+    void advancePattern(patternStream *ps);
     enum {Q, ZMP, ACC, P, RPY, TQ, WRENCHES, OPTIONAL_DATA, NINTERPOLATOR};
     interpolator *interpolators[NINTERPOLATOR];
+    std::deque<patternStream *> patternStreams;
+    std::vector<patternStream *> finishedPatternStreams;
     std::map<std::string, groupInterpolator *> groupInterpolators; 
     int debug_level, m_dof;
 };
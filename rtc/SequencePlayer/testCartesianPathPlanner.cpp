@@ -0,0 +1,182 @@
+/* -*- coding:utf-8-unix; mode:c++; -*- */
+
+#include "CartesianPathPlanner.h"
+#include "../ImpedanceController/JointPathEx.h"
+#include <coil/Time.h>
+/* samples */
+#include <cstdio>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#ifndef deg2rad
+#define deg2rad(deg) (deg * M_PI / 180)
+#endif
+
+class testCartesianPathPlanner
+{
+protected:
+    double dt; /* [s] */
+    hrp::BodyPtr m_robot;
+    std::vector<double> m_q;
+    // 6dof serial link, the planner and the test have their own models
+    hrp::BodyPtr makeRobot ()
+    {
+        hrp::BodyPtr robot(new hrp::Body());
+        hrp::Link* root = new hrp::Link();
+        root->name = "WAIST";
+        root->jointType = hrp::Link::FREE_JOINT;
+        robot->setRootLink(root);
+        const std::string axes("zxyyyx");
+        hrp::Link* parent = root;
+        for (size_t i = 0; i < axes.size(); i++) {
+            hrp::Link* l = new hrp::Link();
+            l->name = std::string("ARM_JOINT") + (char)('0' + i);
+            l->jointType = hrp::Link::ROTATIONAL_JOINT;
+            l->jointId = i;
+            l->a = (axes[i] == 'x' ? hrp::Vector3::UnitX() : (axes[i] == 'y' ? hrp::Vector3::UnitY() : hrp::Vector3::UnitZ()));
+            l->b = (i == 0 ? hrp::Vector3(0, 0, 0) : hrp::Vector3(0.01, 0, -0.1));
+            l->ulimit = deg2rad(170.0);
+            l->llimit = deg2rad(-170.0);
+            l->uvlimit = 1e3;
+            l->lvlimit = -1e3;
+            parent->addChild(l);
+            parent = l;
+        }
+        robot->updateLinkTree();
+        return robot;
+    };
+    // reachable pose of the end link whose joint angles are moved from m_q by dq
+    void targetPose (double dq, hrp::Vector3& p, hrp::Matrix33& R)
+    {
+        for (int i = 0; i < m_robot->numJoints(); i++) m_robot->joint(i)->q = m_q[i] + dq;
+        m_robot->calcForwardKinematics();
+        hrp::Link* target = m_robot->link("ARM_JOINT5");
+        p = target->p;
+        R = target->R;
+    };
+    // pop samples until the path is solved
+    void popAll (CartesianPathPlanner& planner, std::deque<CartesianPathPlanner::Sample>& o_samples, int& o_pops)
+    {
+        std::deque<CartesianPathPlanner::Sample> samples;
+        bool planning = true;
+        o_pops = 0;
+        while (planning) {
+            planning = planner.popSamples(samples);
+            if (!samples.empty()) o_pops++;
+            o_samples.insert(o_samples.end(), samples.begin(), samples.end());
+            if (planning) coil::usleep(1000);
+        }
+    };
+public:
+    std::vector<std::string> arg_strs;
+    testCartesianPathPlanner() : dt(0.002)
+    {
+        m_robot = makeRobot();
+        for (int i = 0; i < m_robot->numJoints(); i++) {
+            m_q.push_back(deg2rad(20.0) * (i % 2 == 0 ? 1 : -1) + deg2rad(5.0) * i);
+        }
+    };
+    bool test0 ()
+    {
+        std::cerr << "[testCartesianPathPlanner] test0 : stream samples of a path" << std::endl;
+        CartesianPathPlanner planner(makeRobot(), dt, "test");
+        planner.setMaxIKError(1e-3, 1e-2);
+        planner.setMaxIKIteration(100);
+        hrp::Vector3 end_p;
+        hrp::Matrix33 end_R;
+        targetPose(deg2rad(20.0), end_p, end_R);
+        double tm = 2.0;
+        unsigned long id = planner.start("WAIST", "ARM_JOINT5", &m_q[0], end_p, end_R, tm);
+        // parameters given while the path is solved are used from the next path
+        for (int i = 0; i < 100; i++) planner.setMaxIKError(1e-9 * (i + 1), 1e-9);
+        bool ready = planner.waitForSamples(id, 0.1);
+        std::deque<CartesianPathPlanner::Sample> samples;
+        int pops;
+        popAll(planner, samples, pops);
+        double total = 0;
+        for (size_t i = 0; i < samples.size(); i++) total += samples[i].tm;
+        // the last sample reaches the target and stops
+        hrp::JointPathExPtr manip(new hrp::JointPathEx(m_robot, m_robot->link("WAIST"), m_robot->link("ARM_JOINT5"), dt));
+        for (int i = 0; i < m_robot->numJoints(); i++) m_robot->joint(i)->q = m_q[i];
+        double pos_error = 1, rot_error = 1, vel = 1;
+        if (!samples.empty()) {
+            for (int j = 0; j < manip->numJoints(); j++) manip->joint(j)->q = samples.back().q[j];
+            m_robot->calcForwardKinematics();
+            pos_error = (manip->endLink()->p - end_p).norm();
+            rot_error = (manip->endLink()->R - end_R).cwiseAbs().maxCoeff();
+            vel = samples.back().v.cwiseAbs().maxCoeff();
+        }
+        std::cerr << "[testCartesianPathPlanner]   " << samples.size() << " samples in " << pops << " pops, duration = " << total
+                  << "[s], pos error = " << pos_error << "[m], rot error = " << rot_error << std::endl;
+        return id != 0 && ready && samples.size() > 1 && fabs(total - tm) < 1e-9
+            && pos_error < 2e-3 && rot_error < 2e-2 && vel == 0;
+    };
+    bool test1 ()
+    {
+        std::cerr << "[testCartesianPathPlanner] test1 : replace and cancel paths" << std::endl;
+        CartesianPathPlanner planner(makeRobot(), dt, "test");
+        planner.setMaxIKError(1e-3, 1e-2);
+        planner.setMaxIKIteration(100);
+        hrp::Vector3 end_p;
+        hrp::Matrix33 end_R;
+        targetPose(deg2rad(20.0), end_p, end_R);
+        bool ret = true;
+        // a new path cancels the previous one
+        unsigned long id1 = planner.start("WAIST", "ARM_JOINT5", &m_q[0], end_p, end_R, 2.0);
+        unsigned long id2 = planner.start("WAIST", "ARM_JOINT5", &m_q[0], end_p, end_R, 2.0);
+        bool replaced = id1 != 0 && id2 != id1 && planner.pathId() == id2 && !planner.waitForSamples(id1, 0.1);
+        std::cerr << "[testCartesianPathPlanner]   replace : " << (replaced ? "OK" : "NG") << std::endl;
+        ret = ret && replaced;
+        // no sample is left after cancel
+        planner.cancel();
+        std::deque<CartesianPathPlanner::Sample> samples;
+        int pops;
+        popAll(planner, samples, pops);
+        bool cancelled = samples.empty() && !planner.waitForSamples(id2, 0.1);
+        std::cerr << "[testCartesianPathPlanner]   cancel : " << (cancelled ? "OK" : "NG") << std::endl;
+        ret = ret && cancelled;
+        // the planner is reused after cancel
+        unsigned long id3 = planner.start("WAIST", "ARM_JOINT5", &m_q[0], end_p, end_R, 2.0);
+        bool solved = planner.waitForSamples(id3, 10.0);
+        popAll(planner, samples, pops);
+        solved = solved && !samples.empty() && samples.back().v.cwiseAbs().maxCoeff() == 0;
+        std::cerr << "[testCartesianPathPlanner]   restart : " << (solved ? "OK" : "NG") << std::endl;
+        ret = ret && solved;
+        // unknown links
+        bool unknown = planner.start("WAIST", "UNKNOWN", &m_q[0], end_p, end_R, 2.0) == 0;
+        std::cerr << "[testCartesianPathPlanner]   unknown link : " << (unknown ? "OK" : "NG") << std::endl;
+        return ret && unknown;
+    };
+};
+
+void print_usage ()
+{
+    std::cerr << "Usage : testCartesianPathPlanner [option]" << std::endl;
+    std::cerr << " [option] should be:" << std::endl;
+    std::cerr << "  --test0 : stream samples of a path" << std::endl;
+    std::cerr << "  --test1 : replace and cancel paths" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    int ret = 0;
+    if (argc >= 2) {
+        testCartesianPathPlanner tcpp;
+        for (int i = 1; i < argc; ++ i) {
+            tcpp.arg_strs.push_back(std::string(argv[i]));
+        }
+        if (std::string(argv[1]) == "--test0") {
+            ret = tcpp.test0() ? 0 : 1;
+        } else if (std::string(argv[1]) == "--test1") {
+            ret = tcpp.test1() ? 0 : 1;
+        } else {
+            print_usage();
+            ret = 1;
+        }
+    } else {
+        print_usage();
+        ret = 1;
+    }
+    return ret;
+}
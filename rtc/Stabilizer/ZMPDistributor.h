@@ -13,6 +13,7 @@
 #include <hrpModel/Body.h>
 #include <iostream>
 #include <iterator>
+#include <map>
 #include "../ImpedanceController/JointPathEx.h"
 #include "../TorqueFilter/IIRFilter.h"
 #include <hrpUtil/MatrixSolvers.h>
@@ -56,9 +57,22 @@ class SimpleZMPDistributor
     FootSupportPolygon fs;
     double leg_inside_margin, leg_outside_margin, leg_front_margin, leg_rear_margin, wrench_alpha_blending;
     boost::shared_ptr<FirstOrderLowPassFilter<double> > alpha_filter;
+    // scratch buffers of distributeZMPToForceMomentsQP
+    std::vector<double> qp_alpha_vector, qp_fz_alpha_vector;
+    bool qp_warm_start;
+#ifdef USE_QPOASES
+    // persistent QP solver for each state dimension, whose working set is reused by hotstart
+    struct QPSolver
+    {
+        boost::shared_ptr<SQProblem> problem;
+        bool initialized;
+        QPSolver () : initialized(false) {};
+    };
+    std::map<size_t, QPSolver> qp_solvers;
+#endif
 public:
     enum leg_type {RLEG, LLEG, RARM, LARM, BOTH, ALL};
-    SimpleZMPDistributor (const double _dt) : wrench_alpha_blending (0.5)
+    SimpleZMPDistributor (const double _dt) : wrench_alpha_blending (0.5), qp_warm_start (true)
     {
         alpha_filter = boost::shared_ptr<FirstOrderLowPassFilter<double> >(new FirstOrderLowPassFilter<double>(1e7, _dt, 0.5)); // [Hz], Almost no filter by default
     };
@@ -141,6 +155,8 @@ public:
     };
     // setter
     void set_wrench_alpha_blending (const double a) { wrench_alpha_blending = a; };
+    // if false, QP is solved from scratch every time
+    void set_qp_warm_start (const bool a) { qp_warm_start = a; };
     void set_leg_front_margin (const double a) { leg_front_margin = a; };
     void set_leg_rear_margin (const double a) { leg_rear_margin = a; };
     void set_leg_inside_margin (const double a) { leg_inside_margin = a; };
@@ -512,25 +528,12 @@ public:
     };
 
 #ifdef USE_QPOASES
-    void solveForceMomentQPOASES (std::vector<hrp::dvector>& fret,
-                                  const size_t state_dim,
-                                  const size_t ee_num,
-                                  const hrp::dmatrix& Hmat,
-                                  const hrp::dvector& gvec)
+    // Hmat is symmetric, so it can be passed to qpOASES in column major order
+    template <class HMatrix, class GVector>
+    void solveForceMomentQPOASES (GVector& x, const HMatrix& Hmat, const GVector& gvec)
     {
-        real_t* H = new real_t[state_dim*state_dim];
-        real_t* g = new real_t[state_dim];
-        real_t* lb = new real_t[state_dim];
-        real_t* ub = new real_t[state_dim];
-        for (size_t i = 0; i < state_dim; i++) {
-            for (size_t j = 0; j < state_dim; j++) {
-                H[i*state_dim+j] = Hmat(i,j);
-            }
-            g[i] = gvec(i);
-            lb[i] = 0.0;
-            ub[i] = 1e10;
-        }
-        QProblemB example( state_dim );
+        size_t state_dim = gvec.size();
+        GVector lb(GVector::Zero(state_dim)), ub(GVector::Constant(state_dim, 1e10));
         Options options;
         //options.enableFlippingBounds = BT_FALSE;
         options.initialStatusBounds = ST_INACTIVE;
@@ -538,23 +541,29 @@ public:
         options.enableCholeskyRefactorisation = 1;
         //options.printLevel = PL_LOW;
         options.printLevel = PL_NONE;
-        example.setOptions( options );
-        /* Solve first QP. */
         int nWSR = 10;
-        example.init( H,g,lb,ub, nWSR,0 );
-        real_t* xOpt = new real_t[state_dim];
-        example.getPrimalSolution( xOpt );
-        size_t state_dim_one = state_dim / ee_num;
-        for (size_t fidx = 0; fidx < ee_num; fidx++) {
-            for (size_t i = 0; i < state_dim_one; i++) {
-                fret[fidx](i) = xOpt[i+state_dim_one*fidx];
-            }
-        }
-        delete[] H;
-        delete[] g;
-        delete[] lb;
-        delete[] ub;
-        delete[] xOpt;
+        if (!qp_warm_start) {
+            QProblemB example( state_dim );
+            example.setOptions( options );
+            example.init( Hmat.data(), gvec.data(), lb.data(), ub.data(), nWSR, 0 );
+            example.getPrimalSolution( x.data() );
+            return;
+        }
+        QPSolver& solver = qp_solvers[state_dim];
+        if (!solver.problem) {
+            solver.problem = boost::shared_ptr<SQProblem>(new SQProblem(state_dim, 0));
+            solver.problem->setOptions( options );
+        }
+        // start from the working set of the previous cycle, which rarely changes
+        bool solved = solver.initialized &&
+            solver.problem->hotstart( Hmat.data(), gvec.data(), 0, lb.data(), ub.data(), 0, 0, nWSR, 0 ) == SUCCESSFUL_RETURN;
+        if (!solved) {
+            nWSR = 10;
+            solver.problem->reset();
+            solved = solver.problem->init( Hmat.data(), gvec.data(), 0, lb.data(), ub.data(), 0, 0, nWSR, 0 ) == SUCCESSFUL_RETURN;
+        }
+        solver.initialized = solved;
+        solver.problem->getPrimalSolution( x.data() );
     };
 
     void distributeZMPToForceMomentsQP (std::vector<hrp::Vector3>& ref_foot_force, std::vector<hrp::Vector3>& ref_foot_moment,
@@ -567,8 +576,42 @@ public:
                                         const double total_fz, const double dt, const bool printp = true, const std::string& print_str = "",
                                         const bool use_cop_distribution = false)
     {
+        // fixed size matrices for two legs and four limbs to avoid allocation
+        switch (ee_name.size()) {
+        case 2:
+            distributeZMPToForceMomentsQPImpl<8>(ref_foot_force, ref_foot_moment, ee_pos, cop_pos, ee_rot, ee_name, limb_gains,
+                                                 new_refzmp, ref_zmp, total_fz, dt, printp, print_str, use_cop_distribution);
+            break;
+        case 4:
+            distributeZMPToForceMomentsQPImpl<16>(ref_foot_force, ref_foot_moment, ee_pos, cop_pos, ee_rot, ee_name, limb_gains,
+                                                  new_refzmp, ref_zmp, total_fz, dt, printp, print_str, use_cop_distribution);
+            break;
+        default:
+            distributeZMPToForceMomentsQPImpl<Eigen::Dynamic>(ref_foot_force, ref_foot_moment, ee_pos, cop_pos, ee_rot, ee_name, limb_gains,
+                                                              new_refzmp, ref_zmp, total_fz, dt, printp, print_str, use_cop_distribution);
+            break;
+        }
+    };
+
+    // SD is the dimension of the state, 4 (vertices) * the number of end effectors
+    template <int SD>
+    void distributeZMPToForceMomentsQPImpl (std::vector<hrp::Vector3>& ref_foot_force, std::vector<hrp::Vector3>& ref_foot_moment,
+                                            const std::vector<hrp::Vector3>& ee_pos,
+                                            const std::vector<hrp::Vector3>& cop_pos,
+                                            const std::vector<hrp::Matrix33>& ee_rot,
+                                            const std::vector<std::string>& ee_name,
+                                            const std::vector<double>& limb_gains,
+                                            const hrp::Vector3& new_refzmp, const hrp::Vector3& ref_zmp,
+                                            const double total_fz, const double dt, const bool printp, const std::string& print_str,
+                                            const bool use_cop_distribution)
+    {
+        enum { EN = (SD == Eigen::Dynamic) ? Eigen::Dynamic : SD / 4,
+               CN = (SD == Eigen::Dynamic) ? Eigen::Dynamic : SD / 2 };
         size_t ee_num = ee_name.size();
-        std::vector<double> alpha_vector(ee_num), fz_alpha_vector(ee_num);
+        std::vector<double>& alpha_vector(qp_alpha_vector);
+        std::vector<double>& fz_alpha_vector(qp_fz_alpha_vector);
+        alpha_vector.resize(ee_num);
+        fz_alpha_vector.resize(ee_num);
         if ( use_cop_distribution ) {
             //calcAlphaVectorFromCOP(alpha_vector, fz_alpha_vector, cop_pos, ee_name, new_refzmp, ref_zmp);
             calcAlphaVectorFromCOPDistance(alpha_vector, fz_alpha_vector, cop_pos, ee_name, new_refzmp, ref_zmp);
@@ -579,17 +622,14 @@ public:
         // QP
         double norm_weight = 1e-7;
         double cop_weight = 1e-3;
-        hrp::dvector total_fm(3);
-        total_fm(0) = total_fz;
-        total_fm(1) = 0;
-        total_fm(2) = 0;
+        hrp::Vector3 total_fm(total_fz, 0, 0);
         size_t state_dim = 4*ee_num, state_dim_one = 4; // TODO
         //
-        std::vector<hrp::dvector> ff(ee_num, hrp::dvector(state_dim_one));
-        std::vector<hrp::dmatrix> mm(ee_num, hrp::dmatrix(3, state_dim_one));
+        Eigen::Matrix<double, SD, 1> ff(state_dim);
+        Eigen::Matrix<double, 3, SD> mm(3, state_dim); // [mm of ee 0, mm of ee 1, ...]
         //
-        hrp::dmatrix Hmat = hrp::dmatrix::Zero(state_dim,state_dim);
-        hrp::dvector gvec = hrp::dvector::Zero(state_dim);
+        Eigen::Matrix<double, SD, SD> Hmat(Eigen::Matrix<double, SD, SD>::Zero(state_dim,state_dim));
+        Eigen::Matrix<double, SD, 1> gvec(Eigen::Matrix<double, SD, 1>::Zero(state_dim));
         double alpha_thre = 1e-20;
         // fz_alpha inversion for weighing matrix
         for (size_t i = 0; i < fz_alpha_vector.size(); i++) {
@@ -600,44 +640,44 @@ public:
                 Hmat(i+j*state_dim_one,i+j*state_dim_one) = norm_weight * fz_alpha_vector[j];
             }
         }
-        hrp::dmatrix Gmat(3,state_dim);
+        Eigen::Matrix<double, 3, SD> Gmat(3,state_dim);
         for (size_t i = 0; i < state_dim; i++) {
             Gmat(0,i) = 1.0;
         }
         for (size_t fidx = 0; fidx < ee_num; fidx++) {
             for (size_t i = 0; i < state_dim_one; i++) {
                 hrp::Vector3 fpos = ee_rot[fidx]*hrp::Vector3(fs.get_foot_vertex(fidx,i)(0), fs.get_foot_vertex(fidx,i)(1), 0) + ee_pos[fidx];
-                mm[fidx](0,i) = 1.0;
-                mm[fidx](1,i) = -(fpos(1)-cop_pos[fidx](1));
-                mm[fidx](2,i) = (fpos(0)-cop_pos[fidx](0));
+                mm(0,i+state_dim_one*fidx) = 1.0;
+                mm(1,i+state_dim_one*fidx) = -(fpos(1)-cop_pos[fidx](1));
+                mm(2,i+state_dim_one*fidx) = (fpos(0)-cop_pos[fidx](0));
                 Gmat(1,i+state_dim_one*fidx) = -(fpos(1)-new_refzmp(1));
                 Gmat(2,i+state_dim_one*fidx) = (fpos(0)-new_refzmp(0));
             }
             //std::cerr << "fpos " << fpos[0] << " " << fpos[1] << std::endl;
         }
-        Hmat += Gmat.transpose() * Gmat;
-        gvec += -1 * Gmat.transpose() * total_fm;
+        Hmat.noalias() += Gmat.transpose() * Gmat;
+        gvec.noalias() += -1 * Gmat.transpose() * total_fm;
         // std::cerr << "Gmat " << std::endl;
         // std::cerr << Gmat << std::endl;
         // std::cerr << "total_fm " << std::endl;
         // std::cerr << total_fm << std::endl;
         //
         {
-            hrp::dmatrix Kmat = hrp::dmatrix::Zero(ee_num,state_dim);
-            hrp::dmatrix KW = hrp::dmatrix::Zero(ee_num, ee_num);
-            hrp::dvector reff(ee_num);
+            Eigen::Matrix<double, EN, SD> Kmat(Eigen::Matrix<double, EN, SD>::Zero(ee_num,state_dim));
+            Eigen::Matrix<double, EN, EN> KW(Eigen::Matrix<double, EN, EN>::Zero(ee_num, ee_num));
+            Eigen::Matrix<double, EN, 1> reff(ee_num);
             for (size_t j = 0; j < ee_num; j++) {
                 for (size_t i = 0; i < state_dim_one; i++) {
                     Kmat(j,i+j*state_dim_one) = 1.0;
                 }
                 reff(j) = total_fz/2.0;
             }
-            Hmat += Kmat.transpose() * KW * Kmat;
-            gvec += -1 * Kmat.transpose() * KW * reff;
+            Hmat.noalias() += Kmat.transpose() * KW * Kmat;
+            gvec.noalias() += -1 * Kmat.transpose() * KW * reff;
         }
         {
-            hrp::dmatrix Cmat = hrp::dmatrix::Zero(ee_num*2,state_dim);
-            hrp::dmatrix CW = hrp::dmatrix::Zero(ee_num*2,ee_num*2);
+            Eigen::Matrix<double, CN, SD> Cmat(Eigen::Matrix<double, CN, SD>::Zero(ee_num*2,state_dim));
+            Eigen::Matrix<double, CN, CN> CW(Eigen::Matrix<double, CN, CN>::Zero(ee_num*2,ee_num*2));
             hrp::Vector3 fpos;
             for (size_t j = 0; j < ee_num; j++) {
                 for (size_t i = 0; i < state_dim_one; i++) {
@@ -647,14 +687,14 @@ public:
                 }
                 CW(j*2,j*2) = CW(j*2+1,j*2+1) = cop_weight;
             }
-            Hmat += Cmat.transpose() * CW * Cmat;
+            Hmat.noalias() += Cmat.transpose() * CW * Cmat;
         }
         // std::cerr << "H " << Hmat << std::endl;
         // std::cerr << "g " << gvec << std::endl;
-        solveForceMomentQPOASES(ff, state_dim, ee_num, Hmat, gvec);
-        hrp::dvector tmpv(3);
+        solveForceMomentQPOASES(ff, Hmat, gvec);
+        hrp::Vector3 tmpv;
         for (size_t fidx = 0; fidx < ee_num; fidx++) {
-            tmpv = mm[fidx] * ff[fidx];
+            tmpv = mm.template block<3,4>(0,state_dim_one*fidx) * ff.template segment<4>(state_dim_one*fidx);
             ref_foot_force[fidx] = hrp::Vector3(0,0,tmpv(0));
             ref_foot_moment[fidx] = -1*hrp::Vector3(tmpv(1),tmpv(2),0);
         }
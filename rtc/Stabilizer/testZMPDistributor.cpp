@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <cstdio>
 #include <iostream>
+#include <sys/time.h>
 #include "util/Hrpsys.h" // added for QNX compile
 
 class testZMPDistributor
@@ -232,6 +233,61 @@ public:
         ee_rot.push_back(tmpr);
         gen_and_plot();
     };
+
+    bool test3 ()
+    {
+        std::cerr << "test3 : Warm QP solve gives the same force as cold one" << std::endl;
+        return compare_warm_start(500);
+    };
+
+    bool benchmark ()
+    {
+        std::cerr << "benchmark : Cold and warm QP solve" << std::endl;
+        return compare_warm_start(5000);
+    };
+
+    // solve the same distributions n times with and without warm start
+    bool compare_warm_start (size_t n)
+    {
+        parse_params();
+        ee_pos = leg_pos;
+        cop_pos = leg_pos;
+        ee_rot.push_back(hrp::Matrix33::Identity());
+        ee_rot.push_back(hrp::Matrix33::Identity());
+        std::vector<std::string> names;
+        names.push_back("rleg");
+        names.push_back("lleg");
+        std::vector<double> limb_gains(names.size(), 1.0);
+        std::vector<hrp::Vector3> cold_force(names.size(), hrp::Vector3::Zero()), cold_moment(names.size(), hrp::Vector3::Zero());
+        std::vector<hrp::Vector3> warm_force(names.size(), hrp::Vector3::Zero()), warm_moment(names.size(), hrp::Vector3::Zero());
+        // swing refzmp between the feet as in walking
+        double cold_tm = 0, warm_tm = 0, max_diff = 0;
+        for (size_t i = 0; i < n; i++) {
+            double phase = 2 * M_PI * i / 1000.0;
+            hrp::Vector3 refzmp(0.02*sin(2*phase), 0.12*sin(phase), 0.0);
+            struct timeval t0, t1, t2;
+            gettimeofday(&t0, NULL);
+            szd->set_qp_warm_start(false);
+            szd->distributeZMPToForceMomentsQP(cold_force, cold_moment,
+                                               ee_pos, cop_pos, ee_rot, names, limb_gains,
+                                               refzmp, refzmp, total_fz, dt, false, "", (distribution_algorithm == EEFMQP2));
+            gettimeofday(&t1, NULL);
+            szd->set_qp_warm_start(true);
+            szd->distributeZMPToForceMomentsQP(warm_force, warm_moment,
+                                               ee_pos, cop_pos, ee_rot, names, limb_gains,
+                                               refzmp, refzmp, total_fz, dt, false, "", (distribution_algorithm == EEFMQP2));
+            gettimeofday(&t2, NULL);
+            cold_tm += (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_usec - t0.tv_usec);
+            warm_tm += (t2.tv_sec - t1.tv_sec) * 1e6 + (t2.tv_usec - t1.tv_usec);
+            for (size_t j = 0; j < names.size(); j++) {
+                max_diff = std::max(max_diff, (cold_force[j] - warm_force[j]).norm());
+                max_diff = std::max(max_diff, (cold_moment[j] - warm_moment[j]).norm());
+            }
+        }
+        std::cerr << "  cold solve = " << cold_tm / n << "[us], warm solve = " << warm_tm / n << "[us]" << std::endl;
+        std::cerr << "  max difference of force and moment = " << max_diff << std::endl;
+        return max_diff < 1e-3 * total_fz;
+    };
 };
 
 class testZMPDistributorHRP2JSK : public testZMPDistributor
@@ -274,6 +330,8 @@ void print_usage ()
     std::cerr << "  --test0 : Default foot pos" << std::endl;
     std::cerr << "  --test1 : Fwd foot pos" << std::endl;
     std::cerr << "  --test2 : Rot foot pos" << std::endl;
+    std::cerr << "  --test3 : Warm QP solve gives the same force as cold one" << std::endl;
+    std::cerr << "  --benchmark : Cold and warm QP solve" << std::endl;
 };
 
 int main(int argc, char* argv[])
@@ -299,6 +357,10 @@ int main(int argc, char* argv[])
                 tzd->test1();
             } else if (std::string(argv[2]) == "--test2") {
                 tzd->test2();
+            } else if (std::string(argv[2]) == "--test3") {
+                if (!tzd->test3()) ret = 1;
+            } else if (std::string(argv[2]) == "--benchmark") {
+                if (!tzd->benchmark()) ret = 1;
             } else {
                 print_usage();
                 ret = 1;
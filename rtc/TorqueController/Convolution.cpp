@@ -9,10 +9,9 @@
  */
 
 #include "Convolution.h"
-#include <vector>
+#include <cmath>
 
 Convolution::Convolution(double _dt, unsigned int _range) {
-  integrator = Integrator();
   setup(_dt, _range);
 }
 
@@ -22,7 +21,6 @@ Convolution::~Convolution(void) {
 void Convolution::reset(void) {
   f_buffer.clear();
   g_buffer.clear();
-  integrator.reset();
   buffer_size = 0;
   return;
 }
@@ -30,7 +28,6 @@ void Convolution::reset(void) {
 void Convolution::setup(double _dt, unsigned int _range) {
   dt = _dt;
   range = _range;
-  integrator.setup(_dt, 0); // integrator range is inf (if range of integrator > 0, integrator remove f(0)*g(t) first)
   reset();
   return;
 }
@@ -48,15 +45,108 @@ void Convolution::update (double _f, double _g) {
 }
 
 double Convolution::calculate(void) {
-  // calc f(x) * g(t-x) buffer
-  std::vector<double> fg_buffer;
-  for (int i = 0; i < buffer_size; i++) {
-    fg_buffer.push_back(f_buffer[i] * g_buffer[(buffer_size -1) - i]);
+  // integrate f(x) * g(t-x) by trapezoidal rule in the same order as Integrator
+  if (buffer_size == 0) return 0;
+  double first = f_buffer[0] * g_buffer[buffer_size - 1];
+  if (buffer_size == 1) return 0.5 * first * dt;
+  double sum = 0;
+  for (int i = 1; i < buffer_size - 1; i++) {
+    sum += f_buffer[i] * g_buffer[(buffer_size - 1) - i];
   }
-  // calc integration
-  integrator.reset();
-  for (int i = 0; i < buffer_size; i++) {
-    integrator.update(fg_buffer[i]);
+  double last = f_buffer[buffer_size - 1] * g_buffer[0];
+  return (0.5 * first + sum + 0.5 * last) * dt;
+}
+
+ExponentialConvolution::ExponentialConvolution(double _dt, unsigned int _range) {
+  setup(_dt, _range);
+}
+
+ExponentialConvolution::~ExponentialConvolution(void) {
+}
+
+void ExponentialConvolution::reset(void) {
+  for (std::vector<Term>::iterator itr = terms.begin(); itr != terms.end(); ++itr) {
+    (*itr).r_first = (*itr).r_last = 1;
+    (*itr).sum = (*itr).next_sum = 0;
+  }
+  g_head = 0;
+  buffer_size = 0;
+  g_first = g_last = 0;
+  return;
+}
+
+void ExponentialConvolution::setup(double _dt, unsigned int _range) {
+  dt = _dt;
+  range = _range;
+  g_buffer.assign(range, 0.0);
+  for (std::vector<Term>::iterator itr = terms.begin(); itr != terms.end(); ++itr) {
+    (*itr).r_range = std::pow((*itr).r, (double)range);
+  }
+  reset();
+  return;
+}
+
+void ExponentialConvolution::clearTerms(void) {
+  terms.clear();
+  reset();
+  return;
+}
+
+void ExponentialConvolution::addTerm(double _c, double _r) {
+  Term t;
+  t.c = _c;
+  t.r = _r;
+  t.r_range = std::pow(_r, (double)range);
+  terms.push_back(t);
+  reset();
+  return;
+}
+
+void ExponentialConvolution::update (double _g) {
+  bool is_full = range > 0 && buffer_size == range;
+  double g_oldest = is_full ? g_buffer[g_head] : 0; // removed from the range
+  bool is_wrapped = range > 0 && g_head == 0; // g_buffer starts from this g
+  for (std::vector<Term>::iterator itr = terms.begin(); itr != terms.end(); ++itr) {
+    Term& t = *itr;
+    if (buffer_size > 0) t.r_last *= t.r; // f(i) of the newest value
+    // sum(r^i * g(t - i * dt)) = r * (previous sum) + g(t) - r^range * g(t - range * dt)
+    t.sum = t.r * t.sum + _g;
+    if (is_full) {
+      t.sum -= t.r_range * g_oldest;
+      t.r_first *= t.r; // the oldest f moves forward
+    }
+    if (is_wrapped) t.next_sum = 0;
+    t.next_sum = t.r * t.next_sum + _g;
+  }
+  if (range > 0) {
+    g_buffer[g_head] = _g;
+    g_head = (g_head + 1 == range) ? 0 : g_head + 1;
+  }
+  if (!is_full) buffer_size++;
+  if (buffer_size == 1) g_first = _g;
+  else if (range > 0 && buffer_size == range) g_first = g_buffer[g_head];
+  g_last = _g;
+  // replace sums once per range not to accumulate rounding errors, which grow if r > 1.
+  // next_sum is summed up one g per update without subtraction, so the cost doesn't depend on the range
+  if (is_full && g_head == 0) {
+    for (std::vector<Term>::iterator itr = terms.begin(); itr != terms.end(); ++itr) {
+      (*itr).sum = (*itr).next_sum;
+    }
+  }
+  return;
+}
+
+double ExponentialConvolution::calculate(void) {
+  // integrate f(x) * g(t-x) by trapezoidal rule
+  // (1/2 * first + sum(f(x_i) * g(t - x_i), 1, N-1) + 1/2 * last) * dt
+  if (buffer_size == 0) return 0;
+  double total = 0, f_first = 0, f_last = 0;
+  for (std::vector<Term>::const_iterator itr = terms.begin(); itr != terms.end(); ++itr) {
+    total += (*itr).c * (*itr).r_first * (*itr).sum;
+    f_first += (*itr).c * (*itr).r_first;
+    f_last += (*itr).c * (*itr).r_last;
   }
-  return integrator.calculate();
+  double first = f_first * g_last, last = f_last * g_first;
+  if (buffer_size == 1) return 0.5 * first * dt;
+  return (total - 0.5 * first - 0.5 * last) * dt;
 }
@@ -13,6 +13,7 @@
 // </rtc-template>
 
 #include "../Stabilizer/Integrator.h"
+#include <vector>
 
 class Convolution {
 public:
@@ -29,7 +30,36 @@ private:
   std::deque<double> f_buffer; // integration data buffer for f
   std::deque<double> g_buffer; // integration data buffer for g
   long long buffer_size; // buffer size of convolution values (f, g)
-  Integrator integrator; // convolution(f, g) = integrate(f(x)*g(t-x), x=0, x=t);
+};
+
+// Convolution whose f is a sum of exponential sequences, f(i) = sum_k c_k * r_k^i (i: number of updates from reset).
+// It gives the same value as Convolution, but the cost of update and calculate does not depend on the range.
+class ExponentialConvolution {
+public:
+  // if range = 0, integrate from 0 to t. Otherwise, integrate from t - (range - 1) * dt to t.
+  ExponentialConvolution(double _dt = 0.005, unsigned int _range = 0);
+  ~ExponentialConvolution(void);
+  void reset(void);
+  void setup(double _dt, unsigned int _range);
+  void clearTerms(void);
+  void addTerm(double _c, double _r); // add c * r^i to f(i)
+  void update(double _g);
+  double calculate(void);
+private:
+  struct Term {
+    double c, r; // c * r^i
+    double r_range; // r^range
+    double r_first, r_last; // r^i of the oldest and the newest f in the range
+    double sum; // sum(r^i * g(t - i * dt), i=0, i=buffer_size-1)
+    double next_sum; // the same sum of g stored from g_buffer[0], which replaces sum when g_buffer is filled
+  };
+  double dt; // control cycle
+  unsigned int range; // integration range (from t_now - range * dt to t_now [sec])
+  std::vector<Term> terms;
+  std::vector<double> g_buffer; // ring buffer of g in the range (only used if range > 0)
+  unsigned int g_head; // index of g_buffer where the next g is stored
+  long long buffer_size; // the number of values in the range
+  double g_first, g_last; // the oldest and the newest g in the range
 };
 
 #endif // CONVOLUTION_H
@@ -17,24 +17,14 @@
 TwoDofControllerDynamicsModel::TwoDofControllerDynamicsModel() {
   param = TwoDofControllerDynamicsModel::TwoDofControllerDynamicsModelParam(); // use default constructor
   current_time = 0;
-  convolutions.clear();
-  exp_sinh.clear();
-  for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
-    convolutions.push_back(Convolution(0.0, 0.0));
-  }
-  integrate_exp_sinh_current.setup(0.0, 0.0);
+  setupConvolutions(0);
   error_prefix = ""; // inheritted from TwoDofControllerInterface
 }
 
 TwoDofControllerDynamicsModel::TwoDofControllerDynamicsModel(TwoDofControllerDynamicsModel::TwoDofControllerDynamicsModelParam &_param, unsigned int _range) {
   param.alpha = _param.alpha; param.beta = _param.beta; param.ki = _param.ki; param.tc = _param.tc; param.dt = _param.dt;
   current_time = 0;
-  convolutions.clear();
-  exp_sinh.clear();
-  for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
-    convolutions.push_back(Convolution(_param.dt, _range));
-  }
-  integrate_exp_sinh_current.setup(_param.dt, _range);
+  setupConvolutions(_range);
   error_prefix = ""; // inheritted from TwoDofControllerInterface  
 }
 
@@ -44,28 +34,49 @@ TwoDofControllerDynamicsModel::~TwoDofControllerDynamicsModel() {
 void TwoDofControllerDynamicsModel::setup() {
   param.alpha = 0; param.beta = 0; param.ki = 0; param.tc = 0; param.dt = 0;
   convolutions.clear();
-  exp_sinh.clear();
+  use_exponential_integral = false;
   integrate_exp_sinh_current.reset();
+  integral_convolution.reset();
   reset();
 }
 
 void TwoDofControllerDynamicsModel::setup(TwoDofControllerDynamicsModel::TwoDofControllerDynamicsModelParam &_param, unsigned int _range) {
   param.alpha = _param.alpha; param.beta = _param.beta; param.ki = _param.ki; param.tc = _param.tc; param.dt = _param.dt;
+  setupConvolutions(_range);
+  reset();
+}
+
+void TwoDofControllerDynamicsModel::setupConvolutions(unsigned int _range) {
+  // exp(-a*t)*sinh(b*t) = (r1^i - r2^i) / 2 where r1 = exp((b-a)*dt), r2 = exp(-(a+b)*dt)
+  double r1 = std::exp((param.beta - param.alpha) * param.dt), r2 = std::exp(-(param.alpha + param.beta) * param.dt);
   convolutions.clear();
   for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
-    convolutions.push_back(Convolution(_param.dt, _range));
+    convolutions.push_back(ExponentialConvolution(param.dt, _range));
   }
-  integrate_exp_sinh_current.setup(_param.dt, _range);
-  reset();
+  for (int i = 0; i < 2; i++) {
+    convolutions[i].addTerm(0.5, r1);
+    convolutions[i].addTerm(-0.5, r2);
+  }
+  // integral of exp(-a*t)*sinh(b*t) from 0 by trapezoidal rule is
+  // dt * (sum((r1^j - r2^j) / 2, j=0, j=i) - (r1^i - r2^i) / 4), whose sums are geometric series.
+  // windowed integral or r = 1 is not a sum of exponentials, so it is convoluted directly.
+  use_exponential_integral = (_range == 0 && std::fabs(r1 - 1) > 1e-6 && std::fabs(r2 - 1) > 1e-6);
+  if (use_exponential_integral) {
+    convolutions[2].addTerm(0.5 * param.dt * (r1 / (r1 - 1) - 0.5), r1);
+    convolutions[2].addTerm(-0.5 * param.dt * (r2 / (r2 - 1) - 0.5), r2);
+    convolutions[2].addTerm(0.5 * param.dt * (1 / (r2 - 1) - 1 / (r1 - 1)), 1.0);
+  }
+  integrate_exp_sinh_current.setup(param.dt, _range);
+  integral_convolution.setup(param.dt, _range);
 }
 
 void TwoDofControllerDynamicsModel::reset() {
   current_time = 0;
-  exp_sinh.clear();
-  for (std::vector<Convolution>::iterator itr = convolutions.begin(); itr != convolutions.end(); ++itr) {
+  for (std::vector<ExponentialConvolution>::iterator itr = convolutions.begin(); itr != convolutions.end(); ++itr) {
     (*itr).reset();
   }
   integrate_exp_sinh_current.reset();
+  integral_convolution.reset();
 }
 
 bool TwoDofControllerDynamicsModel::getParameter() {
@@ -94,19 +105,24 @@ double TwoDofControllerDynamicsModel::update (double _x, double _xd) {
     return 0;
   }
   
-  // update exp(-a*t)*sinh(b*t) buffer
-  double exp_sinh_current = std::exp(-param.alpha * current_time) * std::sinh(param.beta * current_time);
-  exp_sinh.push_back(exp_sinh_current);
-  integrate_exp_sinh_current.update(exp_sinh_current);
-
   // update convolution
-  convolutions[0].update(exp_sinh_current, _x);
-  convolutions[1].update(exp_sinh_current, _xd - _x);
-  convolutions[2].update(integrate_exp_sinh_current.calculate(), _xd - _x);
+  convolutions[0].update(_x);
+  convolutions[1].update(_xd - _x);
+  double integral_term;
+  if (use_exponential_integral) {
+    convolutions[2].update(_xd - _x);
+    integral_term = convolutions[2].calculate();
+  } else {
+    // update integral of exp(-a*t)*sinh(b*t)
+    double exp_sinh_current = std::exp(-param.alpha * current_time) * std::sinh(param.beta * current_time);
+    integrate_exp_sinh_current.update(exp_sinh_current);
+    integral_convolution.update(integrate_exp_sinh_current.calculate(), _xd - _x);
+    integral_term = integral_convolution.calculate();
+  }
 
   // 2 dof controller
   velocity = (1 / (param.tc * param.ki * param.beta)) * (-convolutions[0].calculate() + convolutions[1].calculate())
-    + (1 / (param.tc * param.tc * param.ki * param.beta)) * convolutions[2].calculate();
+    + (1 / (param.tc * param.tc * param.ki * param.beta)) * integral_term;
 
   current_time += param.dt;
   
@@ -45,11 +45,13 @@ public:
   bool getParameter(TwoDofControllerDynamicsModelParam &_p);
 
 private:
+  void setupConvolutions(unsigned int _range);
   TwoDofControllerDynamicsModelParam param;
   double current_time;
-  Integrator integrate_exp_sinh_current;
-  std::vector<double> exp_sinh;
-  std::vector<Convolution> convolutions;
+  std::vector<ExponentialConvolution> convolutions;
+  bool use_exponential_integral; // integral of exp(-a*t)*sinh(b*t) is also convoluted as a sum of exponentials
+  Integrator integrate_exp_sinh_current; // used if !use_exponential_integral
+  Convolution integral_convolution; // used if !use_exponential_integral
 };
 
 #endif // TWO_DOF_CONTROLLER_DYNAMICS_MODEL_H
@@ -17,20 +17,14 @@
 TwoDofControllerPDModel::TwoDofControllerPDModel() {
   param = TwoDofControllerPDModel::TwoDofControllerPDModelParam(); // use default constructor
   current_time = 0;
-  convolutions.clear();
-  for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
-    convolutions.push_back(Convolution(0.0, 0.0));
-  }
+  setupConvolutions(0);
   error_prefix = ""; // inheritted from TwoDofControllerInterface  
 }
 
 TwoDofControllerPDModel::TwoDofControllerPDModel(TwoDofControllerPDModel::TwoDofControllerPDModelParam &_param, unsigned int _range) {
   param.ke = _param.ke; param.kd = _param.kd; param.tc = _param.tc; param.dt = _param.dt;
   current_time = 0;
-  convolutions.clear();
-  for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
-    convolutions.push_back(Convolution(_param.dt, _range));
-  }
+  setupConvolutions(_range);
   error_prefix = ""; // inheritted from TwoDofControllerInterface  
 }
 
@@ -45,11 +39,21 @@ void TwoDofControllerPDModel::setup() {
 
 void TwoDofControllerPDModel::setup(TwoDofControllerPDModel::TwoDofControllerPDModelParam &_param, unsigned int _range) {
   param.ke = _param.ke; param.kd = _param.kd; param.tc = _param.tc; param.dt = _param.dt;
+  setupConvolutions(_range);
+  reset();
+}
+
+void TwoDofControllerPDModel::setupConvolutions(unsigned int _range) {
+  // f(t) = exp((ke/kd) * t) is r^i where r = exp((ke/kd) * dt)
+  double r = param.kd ? std::exp((param.ke / param.kd) * param.dt) : 1.0;
   convolutions.clear();
   for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
-    convolutions.push_back(Convolution(_param.dt, _range));
+    convolutions.push_back(ExponentialConvolution(param.dt, _range));
   }
-  reset();
+  convolutions[0].addTerm(1.0, r); // exp((ke/kd) * t)
+  convolutions[1].addTerm(1.0, r); // exp((ke/kd) * t)
+  convolutions[2].addTerm(1.0, 1.0); // 1 - exp((ke/kd) * t)
+  convolutions[2].addTerm(-1.0, r);
 }
 
 bool TwoDofControllerPDModel::getParameter() {
@@ -66,7 +70,7 @@ bool TwoDofControllerPDModel::getParameter(TwoDofControllerPDModel::TwoDofContro
 
 void TwoDofControllerPDModel::reset() {
   current_time = 0;
-  for (std::vector<Convolution>::iterator itr = convolutions.begin(); itr != convolutions.end(); ++itr) {
+  for (std::vector<ExponentialConvolution>::iterator itr = convolutions.begin(); itr != convolutions.end(); ++itr) {
     (*itr).reset();
   }
 }
@@ -84,9 +88,9 @@ double TwoDofControllerPDModel::update (double _x, double _xd) {
   }
 
   // update convolution
-  convolutions[0].update(std::exp((param.ke / param.kd) * current_time), _x);
-  convolutions[1].update(std::exp((param.ke / param.kd) * current_time), _xd - _x);
-  convolutions[2].update(1 - std::exp((param.ke / param.kd) * current_time), _xd - _x);
+  convolutions[0].update(_x);
+  convolutions[1].update(_xd - _x);
+  convolutions[2].update(_xd - _x);
 
   // 2 dof controller
   velocity = (1 / (param.tc * param.kd)) * (-convolutions[0].calculate() + convolutions[1].calculate())
@@ -43,9 +43,10 @@ public:
   bool getParameter();
   bool getParameter(TwoDofControllerPDModelParam &_p);
 private:
+  void setupConvolutions(unsigned int _range);
   TwoDofControllerPDModelParam param;
   double current_time;
-  std::vector<Convolution> convolutions;
+  std::vector<ExponentialConvolution> convolutions;
 };
 
 #endif // TWO_DOF_CONTROLLER_PDMODEL_H
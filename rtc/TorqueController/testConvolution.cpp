@@ -0,0 +1,136 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "Convolution.h"
+#include "TwoDofControllerDynamicsModel.h"
+#include "TwoDofControllerPDModel.h"
+
+// regression test and benchmark of ExponentialConvolution, which must give the same values as Convolution
+
+static double get_time ()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static double relative_error (double a, double b)
+{
+  return std::fabs(a - b) / std::max(1.0, std::max(std::fabs(a), std::fabs(b)));
+}
+
+// f(i) = sum(c_k * r_k^i)
+static bool compare_convolution (const std::string& name, const std::vector<double>& c, const std::vector<double>& r, unsigned int range, int steps)
+{
+  double dt = 0.005, max_error = 0, conv_time = 0, exp_conv_time = 0;
+  Convolution conv(dt, range);
+  ExponentialConvolution exp_conv(dt, range);
+  for (size_t k = 0; k < c.size(); k++) {
+    exp_conv.addTerm(c[k], r[k]);
+  }
+  srand(0);
+  for (int i = 0; i < steps; i++) {
+    double f = 0;
+    for (size_t k = 0; k < c.size(); k++) {
+      f += c[k] * std::pow(r[k], i);
+    }
+    double g = std::sin(0.01 * i) + 0.1 * (rand() % 100) / 100.0;
+    double t0 = get_time();
+    conv.update(f, g);
+    double v0 = conv.calculate();
+    double t1 = get_time();
+    exp_conv.update(g);
+    double v1 = exp_conv.calculate();
+    double t2 = get_time();
+    conv_time += t1 - t0;
+    exp_conv_time += t2 - t1;
+    max_error = std::max(max_error, relative_error(v0, v1));
+  }
+  std::cerr << name << " (range = " << range << ") : max relative error = " << max_error
+            << ", Convolution = " << conv_time / steps * 1e6 << "[us], ExponentialConvolution = " << exp_conv_time / steps * 1e6 << "[us]" << std::endl;
+  return max_error < 1e-8;
+}
+
+// TwoDofControllerDynamicsModel::update computed by Convolution
+static double reference_dynamics_model (TwoDofControllerDynamicsModel::TwoDofControllerDynamicsModelParam& param, unsigned int range,
+                                        std::vector<Convolution>& convolutions, Integrator& integrator, int i, double x, double xd)
+{
+  double t = i * param.dt;
+  double exp_sinh = std::exp(-param.alpha * t) * std::sinh(param.beta * t);
+  integrator.update(exp_sinh);
+  convolutions[0].update(exp_sinh, x);
+  convolutions[1].update(exp_sinh, xd - x);
+  convolutions[2].update(integrator.calculate(), xd - x);
+  double velocity = (1 / (param.tc * param.ki * param.beta)) * (-convolutions[0].calculate() + convolutions[1].calculate())
+    + (1 / (param.tc * param.tc * param.ki * param.beta)) * convolutions[2].calculate();
+  return velocity * param.dt;
+}
+
+static bool compare_dynamics_model (unsigned int range, int steps)
+{
+  TwoDofControllerDynamicsModel::TwoDofControllerDynamicsModelParam param;
+  param.alpha = 10.0; param.beta = 12.0; param.ki = 0.01; param.tc = 0.05; param.dt = 0.005;
+  TwoDofControllerDynamicsModel controller(param, range);
+  std::vector<Convolution> convolutions(3, Convolution(param.dt, range));
+  Integrator integrator(param.dt, range);
+  double max_error = 0;
+  for (int i = 0; i < steps; i++) {
+    double x = 0.2 * std::sin(0.02 * i), xd = 0.2 * std::sin(0.02 * i + 0.1);
+    max_error = std::max(max_error, relative_error(reference_dynamics_model(param, range, convolutions, integrator, i, x, xd),
+                                                   controller.update(x, xd)));
+  }
+  std::cerr << "TwoDofControllerDynamicsModel (range = " << range << ") : max relative error = " << max_error << std::endl;
+  return max_error < 1e-8;
+}
+
+static bool compare_pd_model (unsigned int range, int steps)
+{
+  TwoDofControllerPDModel::TwoDofControllerPDModelParam param;
+  param.ke = 2.0; param.kd = 20.0; param.tc = 0.05; param.dt = 0.005;
+  TwoDofControllerPDModel controller(param, range);
+  std::vector<Convolution> convolutions(3, Convolution(param.dt, range));
+  double max_error = 0;
+  for (int i = 0; i < steps; i++) {
+    double x = 0.2 * std::sin(0.02 * i), xd = 0.2 * std::sin(0.02 * i + 0.1), t = i * param.dt;
+    convolutions[0].update(std::exp((param.ke / param.kd) * t), x);
+    convolutions[1].update(std::exp((param.ke / param.kd) * t), xd - x);
+    convolutions[2].update(1 - std::exp((param.ke / param.kd) * t), xd - x);
+    double velocity = (1 / (param.tc * param.kd)) * (-convolutions[0].calculate() + convolutions[1].calculate())
+      - (1 / (param.tc * param.tc * param.ke)) * convolutions[2].calculate();
+    max_error = std::max(max_error, relative_error(velocity * param.dt, controller.update(x, xd)));
+  }
+  std::cerr << "TwoDofControllerPDModel (range = " << range << ") : max relative error = " << max_error << std::endl;
+  return max_error < 1e-8;
+}
+
+int main (int argc, char* argv[]) {
+  int steps = 6000; // 30[s] in 200[Hz]
+  for (int i = 1; i < argc; ++ i) {
+    if (std::string(argv[i]) == "--steps") {
+      if (++i < argc) steps = atoi(argv[i]);
+    }
+  }
+  double dt = 0.005, alpha = 10.0, beta = 12.0, ke_kd = 0.1;
+  std::vector<double> c, r;
+  bool ret = true;
+  // exp(-a*t)*sinh(b*t)
+  c.push_back(0.5); r.push_back(std::exp((beta - alpha) * dt));
+  c.push_back(-0.5); r.push_back(std::exp(-(alpha + beta) * dt));
+  ret = compare_convolution("exp(-a*t)*sinh(b*t)", c, r, 0, steps) && ret;
+  ret = compare_convolution("exp(-a*t)*sinh(b*t)", c, r, 500, steps) && ret;
+  // 1 - exp((ke/kd)*t)
+  c.clear(); r.clear();
+  c.push_back(1.0); r.push_back(1.0);
+  c.push_back(-1.0); r.push_back(std::exp(ke_kd * dt));
+  ret = compare_convolution("1 - exp((ke/kd)*t)", c, r, 0, steps) && ret;
+  ret = compare_convolution("1 - exp((ke/kd)*t)", c, r, 1, steps) && ret;
+  ret = compare_convolution("1 - exp((ke/kd)*t)", c, r, 500, steps) && ret;
+  ret = compare_dynamics_model(0, steps) && ret;
+  ret = compare_dynamics_model(500, steps) && ret;
+  ret = compare_pd_model(0, steps) && ret;
+  ret = compare_pd_model(500, steps) && ret;
+  return ret ? 0 : 1;
+}
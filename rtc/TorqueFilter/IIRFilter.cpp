@@ -1,5 +1,11 @@
 #include <iostream>
+#include <algorithm>
 #include "IIRFilter.h"
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 IIRFilter::IIRFilter(int dim, std::vector<double>& fb_coeffs, std::vector<double>& ff_coeffs, const std::string& error_prefix)
 {
@@ -46,3 +52,108 @@ double IIRFilter::executeFilter(double input)
   
   return filtered;
 }
+
+IIRFilterBank::IIRFilterBank() : m_channels(0), m_dimention(0), m_head(0)
+{
+}
+
+IIRFilterBank::IIRFilterBank(int channels, int dim, const std::vector<double>& fb_coeffs, const std::vector<double>& ff_coeffs, const std::string& error_prefix)
+  : m_channels(0), m_dimention(0), m_head(0)
+{
+  setup(channels, dim, fb_coeffs, ff_coeffs, error_prefix);
+}
+
+IIRFilterBank::~IIRFilterBank()
+{
+}
+
+bool IIRFilterBank::setup(int channels, int dim, const std::vector<double>& fb_coeffs, const std::vector<double>& ff_coeffs, const std::string& error_prefix)
+{
+  m_error_prefix = error_prefix;
+  m_channels = channels;
+  m_dimention = dim;
+  m_fb_coefficients.assign((dim + 1) * channels, 0.0);
+  m_ff_coefficients.assign((dim + 1) * channels, 0.0);
+  m_history.assign(dim * channels, 0.0);
+  m_feedback.assign(channels, 0.0);
+  m_head = 0;
+  bool ret = true;
+  for (int c = 0; c < channels; c++) {
+    ret = setCoefficients(c, fb_coeffs, ff_coeffs) && ret;
+  }
+  return ret;
+}
+
+bool IIRFilterBank::setCoefficients(int channel, const std::vector<double>& fb_coeffs, const std::vector<double>& ff_coeffs)
+{
+  if (channel < 0 || channel >= m_channels) return false;
+  if(fb_coeffs.size() != m_dimention + 1 || ff_coeffs.size() != m_dimention + 1){
+    std::cout << "[" <<  m_error_prefix << "]" << "IIRFilterBank coefficients size error" << std::endl;
+    return false;
+  }
+  for (int i = 0; i < m_dimention + 1; i++) {
+    m_fb_coefficients[i * m_channels + channel] = fb_coeffs[i];
+    m_ff_coefficients[i * m_channels + channel] = ff_coeffs[i];
+  }
+  return true;
+}
+
+void IIRFilterBank::reset()
+{
+  std::fill(m_history.begin(), m_history.end(), 0.0);
+  m_head = 0;
+}
+
+void IIRFilterBank::executeFilter(const double *input, double *output)
+{
+  const int n = m_channels;
+  if (n == 0) return;
+  const double *fb = &m_fb_coefficients[0], *ff = &m_ff_coefficients[0];
+  double *feedback = &m_feedback[0];
+  // history[i] of IIRFilter, the feedback value i + 1 steps before, is the row (m_head + i) % m_dimention
+  int c = 0;
+#if defined(__AVX__)
+  for (; c + 4 <= n; c += 4) {
+    __m256d w = _mm256_mul_pd(_mm256_loadu_pd(fb + c), _mm256_loadu_pd(input + c));
+    for (int i = 0, row = m_head; i < m_dimention; i++, row = (row + 1 == m_dimention) ? 0 : row + 1) {
+      w = _mm256_add_pd(w, _mm256_mul_pd(_mm256_loadu_pd(fb + (i + 1) * n + c), _mm256_loadu_pd(&m_history[row * n + c])));
+    }
+    __m256d y = _mm256_mul_pd(_mm256_loadu_pd(ff + c), w);
+    for (int i = 0, row = m_head; i < m_dimention; i++, row = (row + 1 == m_dimention) ? 0 : row + 1) {
+      y = _mm256_add_pd(y, _mm256_mul_pd(_mm256_loadu_pd(ff + (i + 1) * n + c), _mm256_loadu_pd(&m_history[row * n + c])));
+    }
+    _mm256_storeu_pd(feedback + c, w);
+    _mm256_storeu_pd(output + c, y);
+  }
+#elif defined(__SSE2__)
+  for (; c + 2 <= n; c += 2) {
+    __m128d w = _mm_mul_pd(_mm_loadu_pd(fb + c), _mm_loadu_pd(input + c));
+    for (int i = 0, row = m_head; i < m_dimention; i++, row = (row + 1 == m_dimention) ? 0 : row + 1) {
+      w = _mm_add_pd(w, _mm_mul_pd(_mm_loadu_pd(fb + (i + 1) * n + c), _mm_loadu_pd(&m_history[row * n + c])));
+    }
+    __m128d y = _mm_mul_pd(_mm_loadu_pd(ff + c), w);
+    for (int i = 0, row = m_head; i < m_dimention; i++, row = (row + 1 == m_dimention) ? 0 : row + 1) {
+      y = _mm_add_pd(y, _mm_mul_pd(_mm_loadu_pd(ff + (i + 1) * n + c), _mm_loadu_pd(&m_history[row * n + c])));
+    }
+    _mm_storeu_pd(feedback + c, w);
+    _mm_storeu_pd(output + c, y);
+  }
+#endif
+  for (; c < n; c++) {
+    double w = fb[c] * input[c];
+    for (int i = 0, row = m_head; i < m_dimention; i++, row = (row + 1 == m_dimention) ? 0 : row + 1) {
+      w += fb[(i + 1) * n + c] * m_history[row * n + c];
+    }
+    double y = ff[c] * w;
+    for (int i = 0, row = m_head; i < m_dimention; i++, row = (row + 1 == m_dimention) ? 0 : row + 1) {
+      y += ff[(i + 1) * n + c] * m_history[row * n + c];
+    }
+    feedback[c] = w;
+    output[c] = y;
+  }
+  // update previous values, the oldest row is overwritten by the latest one
+  if (m_dimention > 0) {
+    m_head = (m_head == 0) ? m_dimention - 1 : m_head - 1;
+    std::copy(feedback, feedback + n, &m_history[m_head * n]);
+  }
+}
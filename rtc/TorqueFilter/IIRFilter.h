@@ -51,6 +51,61 @@ class IIRFilter
 
 };
 
+/**
+   Bank of IIRFilters which filters multiple channels at once.
+   Coefficients and histories are stored as structure of arrays, whose
+   elements of the same order are contiguous over channels, so that
+   channels are filtered by SIMD instructions (SSE2/AVX) if available.
+   Each channel gives the same output as IIRFilter with the same coefficients.
+ */
+class IIRFilterBank
+{
+ public:
+  IIRFilterBank();
+  /**
+     \brief Constructor with coefficients shared by all channels
+     \param channels the number of channels
+     \param dim dimention of the filter
+     \param fb_coeffs coeeficients of feedback
+     \param ff_coeffs coefficients of feedforward
+  */
+  IIRFilterBank(int channels, int dim, const std::vector<double>& fb_coeffs, const std::vector<double>& ff_coeffs, const std::string& error_prefix = "");
+  ~IIRFilterBank();
+
+  /**
+     \brief set coefficients shared by all channels and clear histories
+     \return true if the sizes of coefficients are correct
+  */
+  bool setup(int channels, int dim, const std::vector<double>& fb_coeffs, const std::vector<double>& ff_coeffs, const std::string& error_prefix = "");
+  /**
+     \brief set coefficients of a channel
+     \return true if the sizes of coefficients are correct
+  */
+  bool setCoefficients(int channel, const std::vector<double>& fb_coeffs, const std::vector<double>& ff_coeffs);
+  /**
+     \brief clear histories of all channels
+  */
+  void reset();
+  int numChannels() const { return m_channels; }
+
+  /**
+     \brief Execute filtering of all channels
+     \param input values of channels
+     \param output filtered values of channels, can be the same as input
+  */
+  void executeFilter(const double *input, double *output);
+
+ private:
+  int m_channels;
+  int m_dimention;
+  int m_head; // row of m_history which holds the latest feedback values
+  std::vector<double> m_fb_coefficients; // (m_dimention + 1) rows of m_channels, m_fb_coefficients[0] would be 1.0
+  std::vector<double> m_ff_coefficients; // (m_dimention + 1) rows of m_channels
+  std::vector<double> m_history; // m_dimention rows of m_channels, ring buffer of previous feedback values
+  std::vector<double> m_feedback; // feedback values of the current step
+  std::string m_error_prefix;
+};
+
 /**
    First order low pass filter
  */
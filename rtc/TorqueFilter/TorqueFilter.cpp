@@ -198,9 +198,8 @@ RTC::ReturnCode_t TorqueFilter::onInitialize()
   }
   
   // make filter instance
-  for(int i = 0; i < m_robot->numJoints(); i++){
-    m_filters.push_back(IIRFilter(filter_dim, fb_coeffs, ff_coeffs, std::string(m_profile.instance_name)));
-  }
+  m_filters.setup(m_robot->numJoints(), filter_dim, fb_coeffs, ff_coeffs, std::string(m_profile.instance_name));
+  m_filtered_torque.resize(m_robot->numJoints());
   
   return RTC::RTC_OK;
 }
@@ -303,11 +302,17 @@ RTC::ReturnCode_t TorqueFilter::onExecute(RTC::UniqueId ec_id)
       std::cerr << std::endl;
     }
 
+    // filter torques of all joints at once
+    for (int i = 0; i < num_joints; i++) {
+      m_filtered_torque[i] = m_tauIn.data[i];
+    }
+    m_filters.executeFilter(&m_filtered_torque[0], &m_filtered_torque[0]);
+
     for (int i = 0; i < num_joints; i++) {
       // torque calculation from electric current
       // torque[j] = m_tauIn.data[path->joint(j)->jointId] - joint_torque(j);
       // torque[j] = m_filters[path->joint(j)->jointId].executeFilter(m_tauIn.data[path->joint(j)->jointId]) - joint_torque(j); // use filtered tau
-      torque[i] = m_filters[i].executeFilter(m_tauIn.data[i]) - m_torque_offset[i];
+      torque[i] = m_filtered_torque[i] - m_torque_offset[i];
 
       // torque calclation from error of joint angle
       // if ( m_error_to_torque_gain[path->joint(j)->jointId] == 0.0
@@ -147,7 +147,8 @@ class TorqueFilter
   hrp::BodyPtr m_robot;
   unsigned int m_debugLevel;
   std::vector<double> m_torque_offset;
-  std::vector<IIRFilter> m_filters;
+  IIRFilterBank m_filters; // a channel for each joint
+  std::vector<double> m_filtered_torque;
   bool m_is_gravity_compensation;
 };
 
@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <iostream>
 #include <vector>
+#include <sys/time.h>
 #include <boost/shared_ptr.hpp>
 #include <hrpUtil/Eigen3d.h>
 
@@ -107,12 +108,61 @@ template<> void testIIRFilter<hrp::Vector3>::fprintf_plot (FILE* gp_pos)
     fprintf(gp_pos, "'/tmp/plot-iirfilter.dat' using 1:6 with lines title 'input (2)' lw 4, '/tmp/plot-iirfilter.dat' using 1:7 with lines title 'filtered (2)' lw 3\n");
 };
 
+/* compare IIRFilterBank with IIRFilters for each channel */
+bool benchmark_filter_bank (const std::vector<std::string>& arg_strs)
+{
+    int channels = 32, steps = 100000;
+    for (int i = 0; i < arg_strs.size(); ++ i) {
+        if ( arg_strs[i]== "--channels" ) {
+            if (++i < arg_strs.size()) channels = atoi(arg_strs[i].c_str());
+        } else if ( arg_strs[i]== "--steps" ) {
+            if (++i < arg_strs.size()) steps = atoi(arg_strs[i].c_str());
+        }
+    }
+    // 2dim butterworth filter sampling = 200[hz] cutoff = 5[hz], the same as default of TorqueFilter
+    int dim = 2;
+    std::vector<double> fb_coeffs(dim + 1), ff_coeffs(dim + 1);
+    fb_coeffs[0] = 1.00000; fb_coeffs[1] = 1.88903; fb_coeffs[2] = -0.89487;
+    ff_coeffs[0] = 0.0014603; ff_coeffs[1] = 0.0029206; ff_coeffs[2] = 0.0014603;
+    std::vector<IIRFilter> filters(channels, IIRFilter(dim, fb_coeffs, ff_coeffs));
+    IIRFilterBank bank(channels, dim, fb_coeffs, ff_coeffs);
+    std::vector<double> input(channels), output(channels), bank_output(channels);
+    double filters_tm = 0, bank_tm = 0, max_diff = 0;
+    long mismatches = 0;
+    struct timeval t0, t1, t2;
+    for (int n = 0; n < steps; n++) {
+        for (int c = 0; c < channels; c++) {
+            input[c] = std::sin(0.01 * n + c) + 0.1 * ((n * (c + 7)) % 13);
+        }
+        gettimeofday(&t0, NULL);
+        for (int c = 0; c < channels; c++) {
+            output[c] = filters[c].executeFilter(input[c]);
+        }
+        gettimeofday(&t1, NULL);
+        bank.executeFilter(&input[0], &bank_output[0]);
+        gettimeofday(&t2, NULL);
+        filters_tm += (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_usec - t0.tv_usec) * 1e3;
+        bank_tm += (t2.tv_sec - t1.tv_sec) * 1e9 + (t2.tv_usec - t1.tv_usec) * 1e3;
+        for (int c = 0; c < channels; c++) {
+            max_diff = std::max(max_diff, std::fabs(output[c] - bank_output[c]));
+            // outputs must be bit-identical
+            if (output[c] != bank_output[c]) mismatches++;
+        }
+    }
+    std::cerr << "[testIIRFilter] " << channels << " channels x " << steps << " steps" << std::endl;
+    std::cerr << "[testIIRFilter]   IIRFilter     : " << filters_tm / steps / channels << "[ns/sample]" << std::endl;
+    std::cerr << "[testIIRFilter]   IIRFilterBank : " << bank_tm / steps / channels << "[ns/sample]" << std::endl;
+    std::cerr << "[testIIRFilter]   max difference = " << max_diff << ", " << mismatches << " outputs differ" << std::endl;
+    return mismatches == 0;
+};
+
 void print_usage ()
 {
     std::cerr << "Usage : testIIRFilter [mode] [test-name] [option]" << std::endl;
-    std::cerr << " [mode] should be: --double, --vector3" << std::endl;
+    std::cerr << " [mode] should be: --double, --vector3, --bank" << std::endl;
     std::cerr << " [test-name] should be:" << std::endl;
-    std::cerr << "  --test0 : test" << std::endl;
+    std::cerr << "  --test0 : test (--double, --vector3), outputs of IIRFilterBank are the same as IIRFilter (--bank)" << std::endl;
+    std::cerr << "  --benchmark : compare throughput of IIRFilterBank and IIRFilter (--bank)" << std::endl;
     std::cerr << " [option] should be:" << std::endl;
 };
 
@@ -142,6 +192,22 @@ int main(int argc, char* argv[])
                 print_usage();
                 ret = 1;
             }
+        } else if (std::string(argv[1]) == "--bank") {
+            std::vector<std::string> arg_strs;
+            for (int i = 2; i < argc; ++ i) {
+                arg_strs.push_back(std::string(argv[i]));
+            }
+            if (std::string(argv[2]) == "--test0") {
+                // fewer steps, only outputs are checked
+                arg_strs.push_back("--steps");
+                arg_strs.push_back("10000");
+                if (!benchmark_filter_bank(arg_strs)) ret = 1;
+            } else if (std::string(argv[2]) == "--benchmark") {
+                if (!benchmark_filter_bank(arg_strs)) ret = 1;
+            } else {
+                print_usage();
+                ret = 1;
+            }
         } else {
             print_usage();
             ret = 1;
@@ -0,0 +1,281 @@
+// -*- C++ -*-
+/*!
+ * @file  CollisionChecker.cpp
+ * @brief collision checking of link pairs with a broad phase and threads
+ * $Date$
+ *
+ * $Id$
+ */
+
+#include "CollisionChecker.h"
+#include <coil/Guard.h>
+#include <hrpModel/Link.h>
+#include <hrpCollision/ColdetModel.h>
+#include <algorithm>
+#include <map>
+
+typedef coil::Guard<coil::Mutex> Guard;
+
+// the number of pairs processed by a thread at once
+static const size_t chunk_size = 8;
+// margin of bounding boxes which covers rounding errors of the narrow
+// phase computed in single precision
+static const double bbox_margin = 1e-3;
+
+static void setCollisionPoints(std::vector<hrp::collision_data>& cdata,
+                               OpenHRP::CollisionPointSequence& points)
+{
+    int npoints = 0;
+    for(size_t i = 0; i < cdata.size(); i++) {
+        for(int j = 0; j < cdata[i].num_of_i_points; j++){
+            if(cdata[i].i_point_new[j]) npoints++;
+        }
+    }
+    points.length(npoints);
+    int idx = 0;
+    for (size_t i = 0; i < cdata.size(); i++) {
+        hrp::collision_data& cd = cdata[i];
+        for(int j=0; j < cd.num_of_i_points; j++){
+            if (cd.i_point_new[j]){
+                OpenHRP::CollisionPoint& point = points[idx];
+                for(int k=0; k < 3; k++){
+                    point.position[k] = cd.i_points[j][k];
+                }
+                for(int k=0; k < 3; k++){
+                    point.normal[k] = cd.n_vector[k];
+                }
+                point.idepth = cd.depth;
+                idx++;
+            }
+        }
+    }
+}
+
+// bounding box of vertices in the segment frame. Primitives other than boxes
+// may be checked without vertices, so they are regarded as unbounded.
+static bool calcLocalBoundingBox(hrp::Link *link, hrp::Vector3& center, hrp::Vector3& half)
+{
+    hrp::ColdetModelPtr model = link->coldetModel;
+    if (!model || !model->getNumVertices()) return false;
+    int ptype = model->getPrimitiveType();
+    if (ptype != hrp::ColdetModel::SP_MESH && ptype != hrp::ColdetModel::SP_BOX) return false;
+    float v[3];
+    hrp::Vector3 lower, upper;
+    for (int i=0; i<model->getNumVertices(); i++){
+        model->getVertex(i, v[0], v[1], v[2]);
+        for (int k=0; k<3; k++){
+            if (i == 0 || v[k] < lower[k]) lower[k] = v[k];
+            if (i == 0 || v[k] > upper[k]) upper[k] = v[k];
+        }
+    }
+    center = (upper + lower)/2;
+    half = (upper - lower)/2;
+    return true;
+}
+
+CollisionCheckerWorker::CollisionCheckerWorker(CollisionChecker *checker)
+    : m_checker(checker)
+{
+}
+
+int CollisionCheckerWorker::svc(void)
+{
+    unsigned long job = 0;
+    while (m_checker->waitForJob(job)){
+        m_checker->processPairs();
+        m_checker->finishJob();
+    }
+    return 0;
+}
+
+CollisionChecker::CollisionChecker()
+    : m_cond(m_mutex), m_running(true), m_job(0), m_finished(0), m_next(0),
+      m_broadPhase(true), m_collisions(NULL)
+{
+}
+
+CollisionChecker::~CollisionChecker()
+{
+    setNumThreads(1);
+}
+
+void CollisionChecker::setNumThreads(int n)
+{
+    if (n < 1) n = 1;
+    if (n == numThreads()) return;
+    {
+        Guard guard(m_mutex);
+        m_running = false;
+        m_cond.broadcast();
+    }
+    for (unsigned int i=0; i<m_workers.size(); i++){
+        m_workers[i]->wait();
+        delete m_workers[i];
+    }
+    m_workers.clear();
+    // new workers wait for the first job
+    m_running = true;
+    m_job = 0;
+    for (int i=1; i<n; i++){
+        CollisionCheckerWorker *worker = new CollisionCheckerWorker(this);
+        worker->activate();
+        m_workers.push_back(worker);
+    }
+}
+
+void CollisionChecker::setPairs(const std::vector<hrp::ColdetLinkPairPtr>& pairs)
+{
+    m_pairs = pairs;
+    m_links.clear();
+    m_localCenter.clear();
+    m_localHalf.clear();
+    m_order.clear();
+    m_partners.clear();
+    m_unbounded.clear();
+
+    std::map<hrp::Link *, int> index;
+    std::vector<bool> bounded;
+    for (size_t i=0; i<m_pairs.size(); i++){
+        int ids[2];
+        for (int k=0; k<2; k++){
+            hrp::Link *link = m_pairs[i]->link(k);
+            std::map<hrp::Link *, int>::iterator it = index.find(link);
+            if (it != index.end()){
+                ids[k] = it->second;
+                continue;
+            }
+            ids[k] = index[link] = m_links.size();
+            m_links.push_back(link);
+            hrp::Vector3 c(hrp::Vector3::Zero()), h(hrp::Vector3::Zero());
+            bounded.push_back(calcLocalBoundingBox(link, c, h));
+            m_localCenter.push_back(c);
+            m_localHalf.push_back(h);
+            m_partners.push_back(std::vector<std::pair<int, int> >());
+            if (bounded.back()) m_order.push_back(ids[k]);
+        }
+        if (bounded[ids[0]] && bounded[ids[1]]){
+            int lo = std::min(ids[0], ids[1]), hi = std::max(ids[0], ids[1]);
+            m_partners[lo].push_back(std::make_pair(hi, (int)i));
+        }else{
+            m_unbounded.push_back(i);
+        }
+    }
+    for (size_t i=0; i<m_partners.size(); i++){
+        std::sort(m_partners[i].begin(), m_partners[i].end());
+    }
+    m_lower.resize(m_links.size());
+    m_upper.resize(m_links.size());
+}
+
+void CollisionChecker::sweep()
+{
+    for (size_t i=0; i<m_order.size(); i++){
+        int id = m_order[i];
+        hrp::Link *link = m_links[id];
+        // vertices of coldet models are in the segment frame
+        hrp::Matrix33 R(link->segmentAttitude());
+        hrp::Vector3 c(R*m_localCenter[id] + link->p);
+        hrp::Vector3 h(R.array().abs().matrix()*m_localHalf[id]);
+        h.array() += bbox_margin;
+        m_lower[id] = c - h;
+        m_upper[id] = c + h;
+    }
+    // links move little in a step, so the order of the previous step is
+    // almost sorted
+    for (size_t i=1; i<m_order.size(); i++){
+        int id = m_order[i];
+        size_t j = i;
+        for (; j > 0 && m_lower[m_order[j-1]][0] > m_lower[id][0]; j--){
+            m_order[j] = m_order[j-1];
+        }
+        m_order[j] = id;
+    }
+    for (size_t i=0; i<m_order.size(); i++){
+        int id1 = m_order[i];
+        for (size_t j=i+1; j<m_order.size(); j++){
+            int id2 = m_order[j];
+            if (m_lower[id2][0] > m_upper[id1][0]) break;
+            if (m_lower[id2][1] > m_upper[id1][1] || m_lower[id1][1] > m_upper[id2][1]
+                || m_lower[id2][2] > m_upper[id1][2] || m_lower[id1][2] > m_upper[id2][2]) continue;
+            int lo = std::min(id1, id2), hi = std::max(id1, id2);
+            const std::vector<std::pair<int, int> >& partners = m_partners[lo];
+            std::vector<std::pair<int, int> >::const_iterator it
+                = std::lower_bound(partners.begin(), partners.end(), std::make_pair(hi, -1));
+            for (; it != partners.end() && it->first == hi; it++){
+                m_candidate[it->second] = 1;
+            }
+        }
+    }
+}
+
+size_t CollisionChecker::check(OpenHRP::CollisionSequence& collisions)
+{
+    m_candidates.clear();
+    if (m_broadPhase){
+        m_candidate.assign(m_pairs.size(), 0);
+        for (size_t i=0; i<m_unbounded.size(); i++){
+            m_candidate[m_unbounded[i]] = 1;
+        }
+        sweep();
+        for (size_t i=0; i<m_pairs.size(); i++){
+            if (m_candidate[i]){
+                m_candidates.push_back(i);
+            }else{
+                collisions[i].points.length(0);
+            }
+        }
+    }else{
+        for (size_t i=0; i<m_pairs.size(); i++) m_candidates.push_back(i);
+    }
+    m_collisions = &collisions;
+    run();
+    return m_candidates.size();
+}
+
+void CollisionChecker::run()
+{
+    m_next = 0;
+    if (m_workers.empty() || m_candidates.size() <= chunk_size){
+        processPairs();
+        return;
+    }
+    {
+        Guard guard(m_mutex);
+        m_job++;
+        m_finished = 0;
+        m_cond.broadcast();
+    }
+    processPairs();
+    Guard guard(m_mutex);
+    while (m_finished < m_workers.size()) m_cond.wait();
+}
+
+bool CollisionChecker::waitForJob(unsigned long& job)
+{
+    Guard guard(m_mutex);
+    while (m_running && m_job == job) m_cond.wait();
+    if (!m_running) return false;
+    job = m_job;
+    return true;
+}
+
+void CollisionChecker::finishJob()
+{
+    Guard guard(m_mutex);
+    m_finished++;
+    m_cond.broadcast();
+}
+
+void CollisionChecker::processPairs()
+{
+    while (1){
+        size_t begin = __sync_fetch_and_add(&m_next, chunk_size);
+        if (begin >= m_candidates.size()) break;
+        size_t end = std::min(begin + chunk_size, m_candidates.size());
+        for (size_t i=begin; i<end; i++){
+            int idx = m_candidates[i];
+            // each pair has its own buffer of collision data
+            setCollisionPoints(m_pairs[idx]->detectCollisions(), (*m_collisions)[idx].points);
+        }
+    }
+}
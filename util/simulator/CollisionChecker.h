@@ -0,0 +1,100 @@
+// -*- C++ -*-
+/*!
+ * @file  CollisionChecker.h
+ * @brief collision checking of link pairs with a broad phase and threads
+ * @date  $Date$
+ *
+ * $Id$
+ */
+
+#ifndef COLLISION_CHECKER_H
+#define COLLISION_CHECKER_H
+
+#include <coil/Task.h>
+#include <coil/Mutex.h>
+#include <coil/Condition.h>
+#include <hrpCorba/OpenHRPCommon.hh>
+#include <hrpModel/ColdetLinkPair.h>
+#include <hrpUtil/EigenTypes.h>
+#include <vector>
+
+class CollisionChecker;
+
+class CollisionCheckerWorker : public coil::Task
+{
+public:
+    CollisionCheckerWorker(CollisionChecker *checker);
+    int svc(void);
+private:
+    CollisionChecker *m_checker;
+};
+
+/**
+   \brief check collisions of link pairs in two phases. Axis aligned
+   bounding boxes of links are swept along x axis first, and only pairs
+   whose boxes overlap are checked by ColdetLinkPair::detectCollisions()
+   in parallel. Collision points of the other pairs are cleared, so the
+   result is the same as the one of checking all pairs.
+ */
+class CollisionChecker
+{
+public:
+    CollisionChecker();
+    ~CollisionChecker();
+    /**
+       \brief set the number of threads including the caller thread
+     */
+    void setNumThreads(int n);
+    int numThreads() const { return m_workers.size() + 1; }
+    /**
+       \brief check all pairs without the broad phase if false
+     */
+    void useBroadPhase(bool on) { m_broadPhase = on; }
+    /**
+       \brief set pairs to be checked. Bounding boxes of links are computed
+       from vertices of their coldet models, so this must be called again
+       when the models are replaced.
+     */
+    void setPairs(const std::vector<hrp::ColdetLinkPairPtr>& pairs);
+    /**
+       \brief set collision points of pairs to collisions in the order of pairs.
+       Positions of coldet models must be updated beforehand.
+       \return the number of pairs checked by the narrow phase
+     */
+    size_t check(OpenHRP::CollisionSequence& collisions);
+
+    // called from worker threads
+    bool waitForJob(unsigned long& job);
+    void processPairs();
+    void finishJob();
+private:
+    void sweep();
+    void run();
+
+    std::vector<CollisionCheckerWorker *> m_workers;
+    coil::Mutex m_mutex;
+    coil::Condition<coil::Mutex> m_cond;
+    bool m_running;
+    unsigned long m_job;
+    unsigned int m_finished;
+    volatile size_t m_next; ///< index of the first candidate not processed yet
+
+    bool m_broadPhase;
+    std::vector<hrp::ColdetLinkPairPtr> m_pairs;
+
+    // links of pairs and their bounding boxes
+    std::vector<hrp::Link *> m_links;
+    std::vector<hrp::Vector3> m_localCenter, m_localHalf;
+    std::vector<hrp::Vector3> m_lower, m_upper;
+    std::vector<int> m_order; ///< bounded links sorted by the lower bound along x axis
+    // pairs of each link with links of larger indices, sorted by the latter
+    std::vector<std::vector<std::pair<int, int> > > m_partners;
+    std::vector<int> m_unbounded; ///< pairs which include links without vertices
+
+    // inputs of a job
+    std::vector<char> m_candidate;
+    std::vector<int> m_candidates;
+    OpenHRP::CollisionSequence *m_collisions;
+};
+
+#endif // COLLISION_CHECKER_H
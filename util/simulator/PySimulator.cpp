@@ -342,6 +342,16 @@ void PySimulator::setWindowSize(int s)
     window.setSize(s,s);
 }
 
+bool PySimulator::logSpill(std::string fname, double maxMemory)
+{
+    return log.setSpillFile(fname, maxMemory*1024*1024);
+}
+
+void PySimulator::logRange(bool flag)
+{
+    log.logRange(flag);
+}
+
 BOOST_PYTHON_MODULE( hrpsysext )
 {
     using namespace boost::python;
@@ -357,6 +367,7 @@ BOOST_PYTHON_MODULE( hrpsysext )
         .def("simulate", (void(PySimulator::*)())&PySimulator::simulate)
         .def("simulate", (void(PySimulator::*)(double))&PySimulator::simulate)
         .def("realTime", &PySimulator::realTime)
+        .def("collisionThreads", &PySimulator::collisionThreads)
         .def("useBBox", &PySimulator::setUseBBox)
         .def("windowSize", &PySimulator::setWindowSize)
         .def("endless", &PySimulator::endless)
@@ -369,6 +380,8 @@ BOOST_PYTHON_MODULE( hrpsysext )
         .def("pause", &PySimulator::pause)
         .def("capture", &PySimulator::capture)
         .def("logLength", &PySimulator::logLength)
+        .def("logSpill", &PySimulator::logSpill)
+        .def("logRange", &PySimulator::logRange)
         .def("body", &PySimulator::getBody, return_internal_reference<>())
         .def("bodies", &PySimulator::bodies)
         .def("initialize", &PySimulator::initialize)
@@ -40,8 +40,10 @@ public:
     void setWindowSize(int s);
     void setMaxLogLength(double len);
     double maxLogLength();
+    bool logSpill(std::string fname, double maxMemory);
+    void logRange(bool flag);
 private:  
-    LogManager<SceneState> log;
+    SceneLogManager log;
     GLscene scene;
     SDLwindow window;
     RTC::Manager* manager;
@@ -30,3 +30,148 @@ void SceneState::set(hrp::WorldBase& i_world, OpenHRP::CollisionSequence& i_coll
         }
     }
 }
+
+static const double kinematics_quantum = 1e-7;
+static const double sensor_quantum = 1e-5;
+static const double range_quantum = 1e-4;
+
+// values are encoded as differences from prev if the numbers of them are same
+static void putValues(std::vector<unsigned char>& buf,
+                      const double *v, size_t n, const double *prev, size_t nprev,
+                      double quantum)
+{
+    LogStream::putUInt(buf, n);
+    for (size_t i=0; i<n; i++){
+        LogStream::putDelta(buf, v[i], n == nprev ? prev[i] : 0, quantum);
+    }
+}
+
+template<class C>
+static void putVectors(std::vector<unsigned char>& buf, const C& v, const C& prev,
+                       double quantum)
+{
+    LogStream::putUInt(buf, v.size());
+    for (size_t i=0; i<v.size(); i++){
+        if (v.size() == prev.size()){
+            putValues(buf, v[i].data(), v[i].size(), prev[i].data(), prev[i].size(), quantum);
+        }else{
+            putValues(buf, v[i].data(), v[i].size(), NULL, 0, quantum);
+        }
+    }
+}
+
+static void getValues(const unsigned char*& p, double *v, size_t n, double quantum)
+{
+    for (size_t i=0; i<n; i++){
+        LogStream::getDelta(p, v[i], quantum);
+    }
+}
+
+// returns the number of values. v is reset to zero if the number is changed
+template<class V>
+static size_t resize(const unsigned char*& p, V& v)
+{
+    size_t n = LogStream::getUInt(p);
+    if (n != (size_t)v.size()){
+        v.resize(n);
+        for (size_t i=0; i<n; i++) v[i] = 0;
+    }
+    return n;
+}
+
+template<class C>
+static void getVectors(const unsigned char*& p, C& v, double quantum)
+{
+    size_t n = LogStream::getUInt(p);
+    bool changed = n != v.size();
+    v.resize(n);
+    for (size_t i=0; i<n; i++){
+        size_t m = LogStream::getUInt(p);
+        if (changed) v[i].setZero();
+        getValues(p, v[i].data(), m, quantum);
+    }
+}
+
+void SceneStateCodec::encode(const SceneState& state, const SceneState& prev,
+                             std::vector<unsigned char>& buf)
+{
+    static const BodyState empty;
+    LogStream::putDouble(buf, state.time);
+    LogStream::putUInt(buf, state.bodyStates.size());
+    bool same = state.bodyStates.size() == prev.bodyStates.size();
+    for (size_t i=0; i<state.bodyStates.size(); i++){
+        const BodyState& s = state.bodyStates[i];
+        const BodyState& ps = same ? prev.bodyStates[i] : empty;
+        putValues(buf, s.q.data(), s.q.size(), ps.q.data(), ps.q.size(), kinematics_quantum);
+        putValues(buf, s.p.data(), 3, ps.p.data(), same ? 3 : 0, kinematics_quantum);
+        putValues(buf, s.R.data(), 9, ps.R.data(), same ? 9 : 0, kinematics_quantum);
+        putVectors(buf, s.acc, ps.acc, sensor_quantum);
+        putVectors(buf, s.rate, ps.rate, sensor_quantum);
+        putVectors(buf, s.force, ps.force, sensor_quantum);
+        LogStream::putUInt(buf, s.range.size());
+        for (size_t j=0; j<s.range.size(); j++){
+            const std::vector<double>& r = s.range[j];
+            size_t n = m_logRange ? r.size() : 0;
+            // ranges of prev are empty in the log if they were not logged
+            size_t nprev = ps.range.size() == s.range.size() && m_loggedRange ? ps.range[j].size() : 0;
+            putValues(buf, n ? &r[0] : NULL, n, nprev ? &ps.range[j][0] : NULL, nprev, range_quantum);
+        }
+    }
+    m_loggedRange = m_logRange;
+    LogStream::putUInt(buf, state.collisions.size());
+    bool sameCollisions = state.collisions.size() == prev.collisions.size();
+    for (size_t i=0; i<state.collisions.size(); i++){
+        const CollisionInfo& ci = state.collisions[i];
+        const CollisionInfo *pci = sameCollisions ? &prev.collisions[i] : NULL;
+        for (int k=0; k<3; k++){
+            LogStream::putDelta(buf, ci.position[k], pci ? pci->position[k] : 0, kinematics_quantum);
+            LogStream::putDelta(buf, ci.normal[k], pci ? pci->normal[k] : 0, kinematics_quantum);
+        }
+        LogStream::putDelta(buf, ci.idepth, pci ? pci->idepth : 0, kinematics_quantum);
+    }
+}
+
+void SceneStateCodec::decode(const unsigned char*& p, SceneState& state)
+{
+    state.time = LogStream::getDouble(p);
+    size_t n = LogStream::getUInt(p);
+    if (n != state.bodyStates.size()){
+        state.bodyStates.clear();
+        state.bodyStates.resize(n);
+        for (size_t i=0; i<n; i++){
+            state.bodyStates[i].p.setZero();
+            state.bodyStates[i].R.setZero();
+        }
+    }
+    for (size_t i=0; i<n; i++){
+        BodyState& s = state.bodyStates[i];
+        getValues(p, s.q.data(), resize(p, s.q), kinematics_quantum);
+        getValues(p, s.p.data(), LogStream::getUInt(p), kinematics_quantum);
+        getValues(p, s.R.data(), LogStream::getUInt(p), kinematics_quantum);
+        getVectors(p, s.acc, sensor_quantum);
+        getVectors(p, s.rate, sensor_quantum);
+        getVectors(p, s.force, sensor_quantum);
+        size_t nrange = LogStream::getUInt(p);
+        bool changed = nrange != s.range.size();
+        if (changed) s.range.clear();
+        s.range.resize(nrange);
+        for (size_t j=0; j<nrange; j++){
+            std::vector<double>& r = s.range[j];
+            size_t m = resize(p, r);
+            getValues(p, m ? &r[0] : NULL, m, range_quantum);
+        }
+    }
+    n = LogStream::getUInt(p);
+    if (n != state.collisions.size()){
+        state.collisions.resize(n);
+        if (n) memset(&state.collisions[0], 0, sizeof(CollisionInfo)*n);
+    }
+    for (size_t i=0; i<n; i++){
+        CollisionInfo& ci = state.collisions[i];
+        for (int k=0; k<3; k++){
+            LogStream::getDelta(p, ci.position[k], kinematics_quantum);
+            LogStream::getDelta(p, ci.normal[k], kinematics_quantum);
+        }
+        LogStream::getDelta(p, ci.idepth, kinematics_quantum);
+    }
+}
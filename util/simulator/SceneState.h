@@ -3,6 +3,8 @@
 
 #include <hrpCorba/OpenHRPCommon.hh>
 #include <hrpModel/World.h>
+#include "util/LogManager.h"
+#include "util/SegmentedLog.h"
 #include "BodyState.h"
 
 class CollisionInfo
@@ -22,4 +24,45 @@ public:
     std::vector<CollisionInfo> collisions;
 };
 
+/**
+   \brief codec of SceneState for SegmentedLog. Positions, attitudes,
+   joint angles and collisions are quantized by 1e-7, outputs of force,
+   rate and acceleration sensors by 1e-5 and ranges by 1e-4, and they are
+   encoded as differences from the previous state. Time is not quantized.
+ */
+class SceneStateCodec
+{
+public:
+    SceneStateCodec() : m_logRange(true), m_loggedRange(true) {}
+    /**
+       \brief ranges are logged as empty if flag is false
+     */
+    void logRange(bool flag) { m_logRange = flag; }
+    void encode(const SceneState& state, const SceneState& prev, std::vector<unsigned char>& buf);
+    void decode(const unsigned char*& p, SceneState& state);
+private:
+    bool m_logRange, m_loggedRange;
+};
+
+class SceneLogManager : public LogManager<SceneState, SegmentedLog<SceneState, SceneStateCodec> >
+{
+public:
+    bool setSpillFile(const std::string& filename, size_t maxMemory){
+        boost::mutex::scoped_lock lock(m_mutex);
+        return m_log.setSpillFile(filename, maxMemory);
+    }
+    void logRange(bool flag){
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_log.codec().logRange(flag);
+    }
+    size_t memorySize(){
+        boost::mutex::scoped_lock lock(m_mutex);
+        return m_log.memorySize();
+    }
+    size_t fileSize(){
+        boost::mutex::scoped_lock lock(m_mutex);
+        return m_log.fileSize();
+    }
+};
+
 #endif
@@ -1,13 +1,14 @@
 #include "Simulator.h"
 #include "util/BodyRTC.h"
 
-Simulator::Simulator(LogManager<SceneState> *i_log) 
+Simulator::Simulator(SceneLogManager *i_log) 
   : log(i_log), adjustTime(false)
 {
 }
 
 void Simulator::init(Project &prj, BodyFactory &factory){
     initWorld(prj, factory, *this, pairs);
+    m_collisionChecker.setPairs(pairs);
     initRTS(prj, receivers);
     std::cout << "number of receivers:" << receivers.size() << std::endl;
     m_totalTime = prj.totalTime();
@@ -50,41 +51,7 @@ void Simulator::checkCollision(OpenHRP::CollisionSequence &collisions)
     for (int i=0; i<numBodies(); i++){
         body(i)->updateLinkColdetModelPositions();
     }
-    for(size_t colIndex=0; colIndex < pairs.size(); ++colIndex){
-        hrp::ColdetLinkPairPtr linkPair = pairs[colIndex];
-        OpenHRP::Collision& collision = collisions[colIndex];
-        OpenHRP::CollisionPointSequence* pCollisionPoints = &collision.points;
-        std::vector<hrp::collision_data>& cdata = linkPair->detectCollisions();
-            
-        if(cdata.empty()){
-            pCollisionPoints->length(0);
-        } else {
-            int npoints = 0;
-            for(int i = 0; i < cdata.size(); i++) {
-                for(int j = 0; j < cdata[i].num_of_i_points; j++){
-                    if(cdata[i].i_point_new[j]) npoints++;
-                }
-            }
-            pCollisionPoints->length(npoints);
-            int idx = 0;
-            for (int i = 0; i < cdata.size(); i++) {
-                hrp::collision_data& cd = cdata[i];
-                for(int j=0; j < cd.num_of_i_points; j++){
-                    if (cd.i_point_new[j]){
-                        OpenHRP::CollisionPoint& point = (*pCollisionPoints)[idx];
-                        for(int k=0; k < 3; k++){
-                            point.position[k] = cd.i_points[j][k];
-                        }
-                        for(int k=0; k < 3; k++){
-                            point.normal[k] = cd.n_vector[k];
-                        }
-                        point.idepth = cd.depth;
-                        idx++;
-                    }
-                }
-            }
-        }
-    }
+    m_collisionChecker.check(collisions);
 }
 
 bool Simulator::oneStep(){
@@ -197,6 +164,7 @@ void Simulator::clear()
     constraintForceSolver.clearCollisionCheckLinkPairs();
     setCurrentTime(0.0);
     pairs.clear();
+    m_collisionChecker.setPairs(pairs);
     receivers.clear();
 }
 
@@ -240,6 +208,7 @@ void Simulator::addCollisionCheckPair(BodyRTC *bodyPtr1, BodyRTC *bodyPtr2)
         pair.linkName1 = CORBA::string_dup(link0->name.c_str());
         pair.linkName2 = CORBA::string_dup(link1->name.c_str());
     }
+    m_collisionChecker.setPairs(pairs);
 }
 
 void Simulator::kinematicsOnly(bool flag)
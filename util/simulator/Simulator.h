@@ -7,6 +7,7 @@
 #include "util/LogManager.h"
 #include "util/ProjectUtil.h"
 #include "SceneState.h"
+#include "CollisionChecker.h"
 
 class BodyRTC;
 class SDL_Thread;
@@ -15,7 +16,7 @@ class Simulator : virtual public hrp::World<hrp::ConstraintForceSolver>,
     public ThreadedObject
 {
 public:
-    Simulator(LogManager<SceneState> *i_log);
+    Simulator(SceneLogManager *i_log);
     void init(Project &prj, BodyFactory &factory);
     bool oneStep();
     void checkCollision(OpenHRP::CollisionSequence &collisions);
@@ -28,10 +29,12 @@ public:
     void appendLog();
     void addCollisionCheckPair(BodyRTC *b1, BodyRTC *b2);
     void kinematicsOnly(bool flag);
+    void collisionThreads(int n) { m_collisionChecker.setNumThreads(n); }
 private:
-    LogManager<SceneState> *log;
+    SceneLogManager *log;
     std::vector<ClockReceiver> receivers;
     std::vector<hrp::ColdetLinkPairPtr> pairs;
+    CollisionChecker m_collisionChecker;
     OpenHRP::CollisionSequence collisions;
     SceneState state;
     double m_totalTime, m_logTimeStep, m_nextLogTime;
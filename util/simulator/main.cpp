@@ -96,6 +96,10 @@ void print_usage(char* progname)
     std::cerr << " -exit-on-finish    : exit the program when the simulation finish" << std::endl;
     std::cerr << " -record            : record the simulation as movie" << std::endl;
     std::cerr << " -bg [r] [g] [b]    : specify background color" << std::endl;
+    std::cerr << " -collision-threads [n] : specify the number of threads to check collisions" << std::endl;
+    std::cerr << " -log-spill [file]  : spill the log to file when its size in memory exceeds the limit" << std::endl;
+    std::cerr << " -log-memory [MB]   : specify the limit of the log size in memory(default:64)" << std::endl;
+    std::cerr << " -no-log-range      : don't log outputs of range sensors" << std::endl;
     std::cerr << " -h --help          : show this help message" << std::endl;
 }
 
@@ -111,6 +115,10 @@ int main(int argc, char* argv[])
     double maxLogLen = 60;
     bool realtime = false;
     bool endless = false;
+    int collisionThreads = 1;
+    std::string logSpillFile;
+    double logMemory = 64;
+    bool logRange = true;
 
     if (argc <= 1){
         print_usage(argv[0]);
@@ -146,6 +154,14 @@ int main(int argc, char* argv[])
             bgColor[0] = atof(argv[++i]);
             bgColor[1] = atof(argv[++i]);
             bgColor[2] = atof(argv[++i]);
+        }else if(strcmp("-collision-threads", argv[i])==0){
+            collisionThreads = atoi(argv[++i]);
+        }else if(strcmp("-log-spill", argv[i])==0){
+            logSpillFile = argv[++i];
+        }else if(strcmp("-log-memory", argv[i])==0){
+            logMemory = atof(argv[++i]);
+        }else if(strcmp("-no-log-range", argv[i])==0){
+            logRange = false;
         }else if(strcmp("-h", argv[i])==0 || strcmp("--help", argv[i])==0){
             print_usage(argv[0]);
             return 1;
@@ -181,6 +197,10 @@ int main(int argc, char* argv[])
             && strcmp(argv[i], "-exit-on-finish")
             && strcmp(argv[i], "-record")
             && strcmp(argv[i], "-bg")
+            && strcmp(argv[i], "-collision-threads")
+            && strcmp(argv[i], "-log-spill")
+            && strcmp(argv[i], "-log-memory")
+            && strcmp(argv[i], "-no-log-range")
             ){
             rtmargv.push_back(argv[i]);
             rtmargc++;
@@ -206,13 +226,18 @@ int main(int argc, char* argv[])
         return 1;
     }
     //==================== Viewer setup ===============
-    LogManager<SceneState> log;
+    SceneLogManager log;
+    log.logRange(logRange);
+    if (logSpillFile != "" && !log.setSpillFile(logSpillFile, logMemory*1024*1024)){
+        return 1;
+    }
     GLscene scene(&log);
     scene.setBackGroundColor(bgColor);
     scene.showSensors(showsensors);
     scene.maxEdgeLen(maxEdgeLen);
     scene.showCollision(prj.view().showCollision);
     Simulator simulator(&log);
+    simulator.collisionThreads(collisionThreads);
 
     SDLwindow window(&scene, &log, &simulator);
     if (display){
@@ -0,0 +1,246 @@
+/* -*- coding:utf-8-unix; mode:c++; -*- */
+
+#include "CollisionChecker.h"
+#include <hrpModel/Body.h>
+#include <hrpModel/Link.h>
+#include <hrpCollision/ColdetModel.h>
+#include <hrpUtil/Eigen3d.h>
+/* samples */
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <sys/time.h>
+
+class testCollisionChecker
+{
+protected:
+    int loop, threads, tiles;
+    hrp::BodyPtr env, robot;
+    std::vector<hrp::ColdetLinkPairPtr> pairs;
+    double get_time ()
+    {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return tv.tv_sec + tv.tv_usec * 1e-6;
+    };
+    // box whose half sizes are s in the link frame
+    hrp::ColdetModelPtr makeBox (const std::string& name, const hrp::Vector3& s)
+    {
+        hrp::ColdetModelPtr model(new hrp::ColdetModel());
+        model->setName(name);
+        model->setNumVertices(8);
+        for (int i = 0; i < 8; i++) {
+            model->setVertex(i, (i & 1) ? s[0] : -s[0], (i & 2) ? s[1] : -s[1], (i & 4) ? s[2] : -s[2]);
+        }
+        int triangles[] = {0,2,3, 0,3,1, 4,5,7, 4,7,6, 0,1,5, 0,5,4,
+                           2,6,7, 2,7,3, 0,4,6, 0,6,2, 1,3,7, 1,7,5};
+        model->setNumTriangles(12);
+        for (int i = 0; i < 12; i++) {
+            model->setTriangle(i, triangles[i*3], triangles[i*3+1], triangles[i*3+2]);
+        }
+        model->build();
+        return model;
+    };
+    // Rs is the attitude of the segment frame, where vertices are defined
+    hrp::Link *makeLink (const std::string& name, int jtype, const hrp::Vector3& b, const hrp::Vector3& s,
+                         const hrp::Matrix33& Rs = hrp::Matrix33::Identity())
+    {
+        hrp::Link *link = new hrp::Link();
+        link->name = name;
+        link->jointType = (hrp::Link::JointType)jtype;
+        link->a = hrp::Vector3::UnitY();
+        link->b = b;
+        link->Rs = Rs;
+        link->p = hrp::Vector3::Zero();
+        link->R = hrp::Matrix33::Identity();
+        link->q = 0;
+        link->coldetModel = makeBox(name, s);
+        return link;
+    };
+    // stepping stones of tiles x tiles and a chain of links swinging over them
+    void makeBodies ()
+    {
+        env = hrp::BodyPtr(new hrp::Body());
+        env->setName("env");
+        hrp::Link *root = makeLink("FLOOR", hrp::Link::FIXED_JOINT, hrp::Vector3::Zero(), hrp::Vector3(0.01, 0.01, 0.01));
+        env->setRootLink(root);
+        for (int i = 0; i < tiles; i++) {
+            for (int j = 0; j < tiles; j++) {
+                std::ostringstream oss;
+                oss << "TILE" << i << "_" << j;
+                double h = 0.05 + 0.05 * ((i * 7 + j * 3) % 4);
+                // some tiles are rotated by their segment frames
+                hrp::Matrix33 Rs = (i + j) % 3 ? hrp::Matrix33(hrp::Matrix33::Identity()) : hrp::rotFromRpy(0, 0, 0.6);
+                root->addChild(makeLink(oss.str(), hrp::Link::FIXED_JOINT,
+                                        hrp::Vector3(0.3 * i, 0.3 * j, h), hrp::Vector3(0.14, 0.06, h), Rs));
+            }
+        }
+        env->updateLinkTree();
+        robot = hrp::BodyPtr(new hrp::Body());
+        robot->setName("robot");
+        hrp::Link *parent = makeLink("WAIST", hrp::Link::FREE_JOINT, hrp::Vector3::Zero(), hrp::Vector3(0.15, 0.1, 0.1));
+        robot->setRootLink(parent);
+        for (int i = 0; i < 8; i++) {
+            std::ostringstream oss;
+            oss << "LINK" << i;
+            // links along the z axis of the joint frame are defined along x axis of odd segment frames
+            hrp::Link *link = i % 2
+                ? makeLink(oss.str(), hrp::Link::ROTATIONAL_JOINT, hrp::Vector3(0, 0, -0.2), hrp::Vector3(0.1, 0.04, 0.04), hrp::rotFromRpy(0, M_PI / 2, 0))
+                : makeLink(oss.str(), hrp::Link::ROTATIONAL_JOINT, hrp::Vector3(0, 0, -0.2), hrp::Vector3(0.04, 0.04, 0.1));
+            parent->addChild(link);
+            parent = link;
+        }
+        robot->updateLinkTree();
+        pairs.clear();
+        for (int i = 0; i < robot->numLinks(); i++) {
+            for (int j = 0; j < env->numLinks(); j++) {
+                pairs.push_back(new hrp::ColdetLinkPair(robot->link(i), env->link(j)));
+            }
+        }
+    };
+    void setPose (int step)
+    {
+        double t = step * 0.01;
+        hrp::Link *root = robot->rootLink();
+        root->p = hrp::Vector3(0.3 * tiles * (0.5 + 0.45 * sin(0.3 * t)), 0.3 * tiles * (0.5 + 0.45 * sin(0.23 * t)), 1.3 + 0.3 * sin(t));
+        root->R = hrp::rotFromRpy(0, 0, 0.5 * t);
+        for (int i = 1; i < robot->numLinks(); i++) {
+            robot->link(i)->q = 0.6 * sin(1.3 * t + i);
+        }
+        robot->calcForwardKinematics();
+        env->calcForwardKinematics();
+        robot->updateLinkColdetModelPositions();
+        env->updateLinkColdetModelPositions();
+    };
+    // returns the number of pairs whose collision points differ
+    size_t compareCollisions (const OpenHRP::CollisionSequence& c1, const OpenHRP::CollisionSequence& c2)
+    {
+        size_t ndiff = 0;
+        for (size_t i = 0; i < c1.length(); i++) {
+            const OpenHRP::CollisionPointSequence& p1 = c1[i].points;
+            const OpenHRP::CollisionPointSequence& p2 = c2[i].points;
+            bool same = p1.length() == p2.length();
+            for (size_t j = 0; same && j < p1.length(); j++) {
+                for (int k = 0; k < 3; k++) {
+                    same = same && p1[j].position[k] == p2[j].position[k] && p1[j].normal[k] == p2[j].normal[k];
+                }
+                same = same && p1[j].idepth == p2[j].idepth;
+            }
+            if (!same) ndiff++;
+        }
+        return ndiff;
+    };
+    size_t countCollisions (const OpenHRP::CollisionSequence& c)
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < c.length(); i++) {
+            if (c[i].points.length()) n++;
+        }
+        return n;
+    };
+public:
+    std::vector<std::string> arg_strs;
+    testCollisionChecker() : loop(500), threads(4), tiles(20)
+    {
+    };
+    bool test0 ()
+    {
+        std::cerr << "[testCollisionChecker] test0 : compare with checking all pairs" << std::endl;
+        parse_params();
+        makeBodies();
+        CollisionChecker brute, checker;
+        brute.useBroadPhase(false);
+        brute.setPairs(pairs);
+        checker.setNumThreads(threads);
+        checker.setPairs(pairs);
+        OpenHRP::CollisionSequence c1, c2;
+        c1.length(pairs.size());
+        c2.length(pairs.size());
+        size_t ndiff = 0, ncollisions = 0, ncandidates = 0;
+        for (int i = 0; i < loop; i++) {
+            setPose(i);
+            brute.check(c1);
+            ncandidates += checker.check(c2);
+            ndiff += compareCollisions(c1, c2);
+            ncollisions += countCollisions(c1);
+        }
+        std::cerr << "[testCollisionChecker]   " << pairs.size() << " pairs, " << loop << " steps, "
+                  << (double)ncandidates / loop << " candidates, " << (double)ncollisions / loop << " colliding pairs per step, "
+                  << ndiff << " different pairs" << std::endl;
+        return ndiff == 0 && ncollisions > 0;
+    };
+    bool benchmark ()
+    {
+        parse_params();
+        makeBodies();
+        std::cerr << "[testCollisionChecker] benchmark : " << pairs.size() << " pairs, " << loop << " steps" << std::endl;
+        OpenHRP::CollisionSequence c;
+        c.length(pairs.size());
+        int nthreads[2] = {1, threads};
+        for (int broad = 0; broad < 2; broad++) {
+            for (int k = 0; k < 2; k++) {
+                CollisionChecker checker;
+                checker.useBroadPhase(broad);
+                checker.setNumThreads(nthreads[k]);
+                checker.setPairs(pairs);
+                double tm = 0;
+                for (int i = 0; i < loop; i++) {
+                    setPose(i);
+                    double t0 = get_time();
+                    checker.check(c);
+                    tm += get_time() - t0;
+                }
+                std::cerr << "[testCollisionChecker]   " << (broad ? "broad phase" : "all pairs") << ", "
+                          << nthreads[k] << " threads : " << tm / loop * 1e3 << "[ms/step]" << std::endl;
+            }
+        }
+        return true;
+    };
+    void parse_params ()
+    {
+        for (unsigned int i = 0; i < arg_strs.size(); ++ i) {
+            if ( arg_strs[i]== "--loop" ) {
+                if (++i < arg_strs.size()) loop = atoi(arg_strs[i].c_str());
+            } else if ( arg_strs[i]== "--threads" ) {
+                if (++i < arg_strs.size()) threads = atoi(arg_strs[i].c_str());
+            } else if ( arg_strs[i]== "--tiles" ) {
+                if (++i < arg_strs.size()) tiles = atoi(arg_strs[i].c_str());
+            }
+        }
+    };
+};
+
+void print_usage ()
+{
+    std::cerr << "Usage : testCollisionChecker [option]" << std::endl;
+    std::cerr << " [option] should be:" << std::endl;
+    std::cerr << "  --test0 [--loop n] [--threads n] [--tiles n] : compare with checking all pairs in a single thread" << std::endl;
+    std::cerr << "  --benchmark [--loop n] [--threads n] [--tiles n] : measure time of checking collisions" << std::endl;
+    std::cerr << "    a chain of 9 links swings over tiles x tiles stepping stones" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    int ret = 0;
+    if (argc >= 2) {
+        testCollisionChecker tcc;
+        for (int i = 1; i < argc; ++ i) {
+            tcc.arg_strs.push_back(std::string(argv[i]));
+        }
+        if (std::string(argv[1]) == "--test0") {
+            ret = tcc.test0() ? 0 : 1;
+        } else if (std::string(argv[1]) == "--benchmark") {
+            ret = tcc.benchmark() ? 0 : 1;
+        } else {
+            print_usage();
+            ret = 1;
+        }
+    } else {
+        print_usage();
+        ret = 1;
+    }
+    return ret;
+}
@@ -0,0 +1,271 @@
+/* -*- coding:utf-8-unix; mode:c++; -*- */
+
+#include "SceneState.h"
+#include <hrpUtil/Eigen3d.h>
+/* samples */
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <deque>
+#include <vector>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+typedef SegmentedLog<SceneState, SceneStateCodec> SceneLog;
+
+class testSceneLog
+{
+protected:
+    int loop, length, joints, ranges;
+    double get_time ()
+    {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return tv.tv_sec + tv.tv_usec * 1e-6;
+    };
+    // a robot walking with sensors and a floor, which collide at a few points
+    void makeState (int step, bool range, SceneState& s)
+    {
+        double t = step * 0.005;
+        s.time = t;
+        s.bodyStates.resize(2);
+        BodyState& b = s.bodyStates[0];
+        b.q.resize(joints);
+        for (int i = 0; i < joints; i++) b.q[i] = 0.8 * sin(2.1 * t + i);
+        b.p = hrp::Vector3(0.3 * t, 0.05 * sin(3.0 * t), 0.8 + 0.01 * cos(6.0 * t));
+        b.R = hrp::rotFromRpy(0.02 * sin(3.0 * t), 0.03 * cos(3.0 * t), 0.1 * t);
+        b.acc.resize(1);
+        b.acc[0] = hrp::Vector3(0.5 * sin(6.0 * t), 0.3 * cos(6.0 * t), 9.8 + 0.8 * sin(6.0 * t));
+        b.rate.resize(1);
+        b.rate[0] = hrp::Vector3(0.06 * cos(3.0 * t), -0.09 * sin(3.0 * t), 0.1);
+        b.force.resize(2);
+        for (int i = 0; i < 2; i++) {
+            for (int k = 0; k < 6; k++) b.force[i][k] = (k == 2 ? 300 : 10) * (1 + sin(6.0 * t + i * M_PI + k));
+        }
+        b.range.resize(1);
+        b.range[0].resize(range ? ranges : 0);
+        for (int i = 0; i < (int)b.range[0].size(); i++) b.range[0][i] = 2.0 + sin(0.05 * i + 0.5 * t);
+        BodyState& f = s.bodyStates[1];
+        f.q.resize(0);
+        f.p = hrp::Vector3::Zero();
+        f.R = hrp::Matrix33::Identity();
+        s.collisions.resize((step / 7) % 4 * 2);
+        for (size_t i = 0; i < s.collisions.size(); i++) {
+            CollisionInfo& c = s.collisions[i];
+            c.position[0] = 0.3 * t + 0.1 * i;
+            c.position[1] = i % 2 ? 0.1 : -0.1;
+            c.position[2] = 0;
+            c.normal[0] = c.normal[1] = 0;
+            c.normal[2] = 1;
+            c.idepth = 1e-4 * (1 + sin(t + i));
+        }
+    };
+    // the number of doubles kept in SceneState
+    size_t rawSize (const SceneState& s)
+    {
+        size_t n = 1 + s.collisions.size() * 7;
+        for (size_t i = 0; i < s.bodyStates.size(); i++) {
+            const BodyState& b = s.bodyStates[i];
+            n += b.q.size() + 3 + 9 + b.acc.size() * 3 + b.rate.size() * 3 + b.force.size() * 6;
+            for (size_t j = 0; j < b.range.size(); j++) n += b.range[j].size();
+        }
+        return n * sizeof(double);
+    };
+    double maxError (const double *v1, const double *v2, size_t n, double e)
+    {
+        for (size_t i = 0; i < n; i++) e = std::max(e, fabs(v1[i] - v2[i]));
+        return e;
+    };
+    // returns false if the decoded state differs from the original beyond quantization
+    bool compareState (const SceneState& s1, const SceneState& s2)
+    {
+        if (s1.time != s2.time || s1.bodyStates.size() != s2.bodyStates.size()
+            || s1.collisions.size() != s2.collisions.size()) return false;
+        double ek = 0, es = 0, er = 0;
+        for (size_t i = 0; i < s1.bodyStates.size(); i++) {
+            const BodyState& b1 = s1.bodyStates[i];
+            const BodyState& b2 = s2.bodyStates[i];
+            if (b1.q.size() != b2.q.size() || b1.acc.size() != b2.acc.size() || b1.rate.size() != b2.rate.size()
+                || b1.force.size() != b2.force.size() || b1.range.size() != b2.range.size()) return false;
+            ek = maxError(b1.q.data(), b2.q.data(), b1.q.size(), ek);
+            ek = maxError(b1.p.data(), b2.p.data(), 3, ek);
+            ek = maxError(b1.R.data(), b2.R.data(), 9, ek);
+            for (size_t j = 0; j < b1.acc.size(); j++) es = maxError(b1.acc[j].data(), b2.acc[j].data(), 3, es);
+            for (size_t j = 0; j < b1.rate.size(); j++) es = maxError(b1.rate[j].data(), b2.rate[j].data(), 3, es);
+            for (size_t j = 0; j < b1.force.size(); j++) es = maxError(b1.force[j].data(), b2.force[j].data(), 6, es);
+            for (size_t j = 0; j < b1.range.size(); j++) {
+                if (b1.range[j].size() != b2.range[j].size()) return false;
+                if (b1.range[j].size()) er = maxError(&b1.range[j][0], &b2.range[j][0], b1.range[j].size(), er);
+            }
+        }
+        for (size_t i = 0; i < s1.collisions.size(); i++) {
+            ek = maxError(s1.collisions[i].position, s2.collisions[i].position, 3, ek);
+            ek = maxError(s1.collisions[i].normal, s2.collisions[i].normal, 3, ek);
+            ek = maxError(&s1.collisions[i].idepth, &s2.collisions[i].idepth, 1, ek);
+        }
+        return ek <= 0.51e-7 && es <= 0.51e-5 && er <= 0.51e-4;
+    };
+    // ranges are not logged in [loop/3, loop/2)
+    bool rangeLogged (int step)
+    {
+        return step < loop / 3 || step >= loop / 2;
+    };
+    // push loop states keeping the last length ones and decode them in random order
+    bool checkLog (SceneLog& log)
+    {
+        std::deque<SceneState> ref;
+        SceneState s;
+        size_t ndiff = 0;
+        for (int i = 0; i < loop; i++) {
+            log.codec().logRange(rangeLogged(i));
+            makeState(i, true, s);
+            log.push_back(s);
+            makeState(i, rangeLogged(i), s);
+            ref.push_back(s);
+            if ((int)log.size() > length) {
+                log.pop_front();
+                ref.pop_front();
+            }
+            if (i % 97 == 0) {
+                for (size_t j = 0; j < log.size(); j += 13) {
+                    if (!compareState(ref[j], log[j])) ndiff++;
+                }
+            }
+        }
+        unsigned int seed = 1;
+        for (int i = 0; i < loop; i++) {
+            size_t j = rand_r(&seed) % log.size();
+            if (!compareState(ref[j], log[j])) ndiff++;
+        }
+        for (size_t j = 0; j < log.size(); j++) {
+            if (!compareState(ref[j], log[j])) ndiff++;
+        }
+        std::cerr << "[testSceneLog]   " << log.size() << " states, " << log.memorySize() << " bytes in memory, "
+                  << log.fileSize() << " bytes in the file, " << ndiff << " different states" << std::endl;
+        return ndiff == 0 && (int)log.size() == std::min(loop, length);
+    };
+public:
+    std::vector<std::string> arg_strs;
+    testSceneLog() : loop(5000), length(2000), joints(30), ranges(360)
+    {
+    };
+    bool test0 ()
+    {
+        std::cerr << "[testSceneLog] test0 : compare decoded states with original ones" << std::endl;
+        parse_params();
+        SceneLog log;
+        return checkLog(log);
+    };
+    bool test1 ()
+    {
+        std::cerr << "[testSceneLog] test1 : compare decoded states with original ones spilling them to a file" << std::endl;
+        parse_params();
+        std::ostringstream oss;
+        oss << "/tmp/testSceneLog" << getpid() << ".log";
+        SceneLog log;
+        bool ret = log.setSpillFile(oss.str(), 100000);
+        ret = checkLog(log) && log.fileSize() > 0 && log.memorySize() < 200000 && ret;
+        // pages of popped segments are released
+        struct stat st;
+        stat(oss.str().c_str(), &st);
+        std::cerr << "[testSceneLog]   " << st.st_size << " bytes written, " << st.st_blocks * 512 << " bytes used" << std::endl;
+        if (log.punchHole()) {
+            ret = (size_t)st.st_blocks * 512 < log.fileSize() + 65536 && ret;
+        } else {
+            std::cerr << "[testSceneLog]   holes can't be punched in /tmp, disk usage is not checked" << std::endl;
+        }
+        log.clear();
+        ret = log.fileSize() == 0 && log.empty() && checkLog(log) && ret;
+        // spilled segments are read back when the file is changed
+        std::vector<SceneState> states;
+        for (size_t i = 0; i < log.size(); i++) states.push_back(log[i]);
+        std::string filename2 = oss.str() + "2";
+        ret = log.setSpillFile(filename2, (size_t)-1) && log.fileSize() == 0 && ret;
+        size_t ndiff = 0;
+        for (size_t i = 0; i < log.size(); i++) {
+            if (!compareState(states[i], log[i])) ndiff++;
+        }
+        std::cerr << "[testSceneLog]   " << ndiff << " different states after reading back" << std::endl;
+        ret = ndiff == 0 && ret;
+        unlink(oss.str().c_str());
+        unlink(filename2.c_str());
+        return ret;
+    };
+    bool benchmark ()
+    {
+        parse_params();
+        std::cerr << "[testSceneLog] benchmark : " << loop << " states, " << joints << " joints, " << ranges << " ranges" << std::endl;
+        SceneState s;
+        std::vector<SceneState> states(loop);
+        for (int i = 0; i < loop; i++) makeState(i, true, states[i]);
+        for (int range = 1; range >= 0; range--) {
+            SceneLog log;
+            log.codec().logRange(range);
+            double t0 = get_time();
+            for (int i = 0; i < loop; i++) log.push_back(states[i]);
+            double t1 = get_time();
+            unsigned int seed = 1;
+            for (int i = 0; i < loop; i++) log[rand_r(&seed) % loop];
+            double t2 = get_time();
+            for (int i = 0; i < loop; i++) log[i];
+            double t3 = get_time();
+            makeState(0, range, s);
+            std::cerr << "[testSceneLog]   " << (range ? "with ranges" : "without ranges") << " : "
+                      << rawSize(s) << "[bytes/state] -> " << (double)log.memorySize() / loop << "[bytes/state], push "
+                      << (t1 - t0) / loop * 1e6 << "[us], seek " << (t2 - t1) / loop * 1e6 << "[us], next "
+                      << (t3 - t2) / loop * 1e6 << "[us]" << std::endl;
+        }
+        return true;
+    };
+    void parse_params ()
+    {
+        for (unsigned int i = 0; i < arg_strs.size(); ++ i) {
+            if ( arg_strs[i]== "--loop" ) {
+                if (++i < arg_strs.size()) loop = atoi(arg_strs[i].c_str());
+            } else if ( arg_strs[i]== "--length" ) {
+                if (++i < arg_strs.size()) length = atoi(arg_strs[i].c_str());
+            } else if ( arg_strs[i]== "--joints" ) {
+                if (++i < arg_strs.size()) joints = atoi(arg_strs[i].c_str());
+            } else if ( arg_strs[i]== "--ranges" ) {
+                if (++i < arg_strs.size()) ranges = atoi(arg_strs[i].c_str());
+            }
+        }
+    };
+};
+
+void print_usage ()
+{
+    std::cerr << "Usage : testSceneLog [option]" << std::endl;
+    std::cerr << " [option] should be:" << std::endl;
+    std::cerr << "  --test0 [--loop n] [--length n] [--joints n] [--ranges n] : compare decoded states with original ones" << std::endl;
+    std::cerr << "  --test1 [--loop n] [--length n] [--joints n] [--ranges n] : same as test0 spilling states to a file" << std::endl;
+    std::cerr << "  --benchmark [--loop n] [--joints n] [--ranges n] : measure size of the log and time of accessing it" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    int ret = 0;
+    if (argc >= 2) {
+        testSceneLog tsl;
+        for (int i = 1; i < argc; ++ i) {
+            tsl.arg_strs.push_back(std::string(argv[i]));
+        }
+        if (std::string(argv[1]) == "--test0") {
+            ret = tsl.test0() ? 0 : 1;
+        } else if (std::string(argv[1]) == "--test1") {
+            ret = tsl.test1() ? 0 : 1;
+        } else if (std::string(argv[1]) == "--benchmark") {
+            ret = tsl.benchmark() ? 0 : 1;
+        } else {
+            print_usage();
+            ret = 1;
+        }
+    } else {
+        print_usage();
+        ret = 1;
+    }
+    return ret;
+}